@@ -24,6 +24,7 @@
 #include "kconfig_p.h"
 
 #include <cstdlib>
+#include <climits>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -37,6 +38,7 @@
 #include <kaboutdata.h>
 #include <kshell.h>
 #include <kdebug.h>
+#include <kglobal.h>
 
 #include <qbytearray.h>
 #include <qfile.h>
@@ -45,10 +47,342 @@
 #include <qrect.h>
 #include <qsize.h>
 #include <qcolor.h>
+#include <QtCore/QCoreApplication>
 #include <QtCore/QProcess>
 #include <QtCore/QPointer>
 #include <QtCore/QSet>
 #include <QtCore/QStack>
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QElapsedTimer>
+
+// how long the changes of configurations opened with KConfig::AsyncSync are
+// collected before they are written out
+static const int KCONFIG_SYNCDELAY = 500; // ms
+
+// Writes the dirty entries of entryMap to the local and, if requested, the
+// global file, merging them with the changes done by other processes. The
+// dirty flags of the written entries are cleared.
+static bool writeEntryMap(KConfigIniBackend *localBackend, const QString &globalFilePath,
+                          const QByteArray &locale, const KComponentData &componentData,
+                          bool lockFiles, bool writeLocals, bool writeGlobals, KEntryMap &entryMap)
+{
+    // Create the containing dir, maybe it wasn't there
+    localBackend->createEnclosing();
+
+    // lock the local file
+    if (lockFiles && !localBackend->lock(componentData)) {
+        qWarning() << "couldn't lock local file";
+        return false;
+    }
+
+    bool result = true;
+    if (writeGlobals) {
+        KConfigIniBackend globalBackend;
+        globalBackend.setFilePath(globalFilePath);
+        if (lockFiles && !globalBackend.lock(componentData)) {
+            qWarning() << "couldn't lock global file";
+            if (localBackend->isLocked()) {
+                localBackend->unlock();
+            }
+            return false;
+        }
+        if (!globalBackend.writeConfig(locale, entryMap, KConfigIniBackend::WriteGlobal)) {
+            result = false;
+            // TODO KDE5: return false? (to tell the app that writing wasn't possible, e.g.
+            // config file is immutable or disk full)
+        }
+        if (globalBackend.isLocked()) {
+            globalBackend.unlock();
+        }
+    }
+
+    if (writeLocals) {
+        if (!localBackend->writeConfig(locale, entryMap, KConfigIniBackend::WriteOptions())) {
+            result = false;
+        }
+    }
+    if (localBackend->isLocked()) {
+        localBackend->unlock();
+    }
+    return result;
+}
+
+// the changes of a configuration, queued for writing
+struct KConfigSyncJob
+{
+    const KConfigPrivate *config; // only used to identify the jobs of a configuration
+    QString localFilePath;
+    QString globalFilePath;
+    QByteArray locale;
+    KComponentData componentData;
+    bool lockFiles;
+    bool writeLocals;
+    bool writeGlobals;
+    KEntryMap entryMap;
+
+    // adds the changes of an older job for the same configuration
+    void merge(const KConfigSyncJob &older)
+    {
+        const KEntryMapConstIterator theEnd = older.entryMap.constEnd();
+        for (KEntryMapConstIterator it = older.entryMap.constBegin(); it != theEnd; ++it) {
+            if (!it->bDirty) {
+                continue;
+            }
+            const KEntryMapIterator newer = entryMap.find(it.key());
+            if (newer == entryMap.end()) {
+                entryMap.insert(it.key(), *it);
+            } else {
+                // a newer value would be dirty, this one was not changed since
+                newer->bDirty = true;
+            }
+        }
+        writeLocals = writeLocals || older.writeLocals;
+        writeGlobals = writeGlobals || older.writeGlobals;
+    }
+};
+
+// writes the changes of configurations opened with KConfig::AsyncSync from a thread, the
+// changes done to a configuration during KCONFIG_SYNCDELAY are merged and written in one go
+class KConfigSyncWriter : public QThread
+{
+public:
+    KConfigSyncWriter();
+    ~KConfigSyncWriter();
+
+    void enqueue(const KConfigSyncJob &job);
+    bool flush(const int timeout);
+    void finish(const KConfigPrivate *config);
+    bool hasFailed(const KConfigPrivate *config);
+    void stop();
+
+protected:
+    void run() final;
+
+private:
+    Q_DISABLE_COPY(KConfigSyncWriter);
+
+    void writeJobs(QList<KConfigSyncJob> &jobs);
+
+    QMutex m_mutex;
+    QWaitCondition m_queuecondition;
+    QWaitCondition m_idlecondition;
+    QWaitCondition m_writtencondition;
+    QList<KConfigSyncJob> m_queue;
+    // jobs that could not be written, retried with the next changes of their configuration
+    QList<KConfigSyncJob> m_failed;
+    // configurations of the jobs the thread is writing
+    QList<const KConfigPrivate*> m_writingconfigs;
+    bool m_writing;
+    bool m_flushing;
+    bool m_stop;
+};
+K_GLOBAL_STATIC(KConfigSyncWriter, globalKConfigSyncWriter)
+
+// post routine since writing needs the component data and the locale, which
+// may be gone by the time the global static is destroyed
+static void kConfigSyncWriterFlush()
+{
+    if (!globalKConfigSyncWriter.isDestroyed()) {
+        globalKConfigSyncWriter->stop();
+    }
+}
+
+KConfigSyncWriter::KConfigSyncWriter()
+    : m_writing(false),
+    m_flushing(false),
+    m_stop(false)
+{
+    qAddPostRoutine(kConfigSyncWriterFlush);
+}
+
+KConfigSyncWriter::~KConfigSyncWriter()
+{
+    qRemovePostRoutine(kConfigSyncWriterFlush);
+
+    // without an application the post routine did not run, only stop the thread
+    QMutexLocker locker(&m_mutex);
+    const QList<KConfigSyncJob> discarded = (m_queue + m_failed);
+    m_queue.clear();
+    m_failed.clear();
+    m_stop = true;
+    m_queuecondition.wakeOne();
+    locker.unlock();
+    wait();
+
+    foreach (const KConfigSyncJob &job, discarded) {
+        qWarning() << "Discarding changes that were not written to" << job.localFilePath;
+    }
+}
+
+void KConfigSyncWriter::enqueue(const KConfigSyncJob &job)
+{
+    QMutexLocker locker(&m_mutex);
+    KConfigSyncJob newjob(job);
+    for (int i = 0; i < m_failed.size(); i++) {
+        if (m_failed.at(i).config == job.config) {
+            newjob.merge(m_failed.takeAt(i));
+            break;
+        }
+    }
+    bool merged = false;
+    for (int i = 0; i < m_queue.size(); i++) {
+        if (m_queue.at(i).config == job.config) {
+            newjob.merge(m_queue.at(i));
+            m_queue[i] = newjob;
+            merged = true;
+            break;
+        }
+    }
+    if (!merged) {
+        m_queue.append(newjob);
+    }
+    if (!isRunning()) {
+        m_stop = false;
+        start(QThread::LowPriority);
+    }
+    m_queuecondition.wakeOne();
+}
+
+bool KConfigSyncWriter::flush(const int timeout)
+{
+    if (!m_mutex.tryLock(timeout)) {
+        return false;
+    }
+    bool result = true;
+    const unsigned long waittime = (timeout < 0 ? ULONG_MAX : timeout);
+    m_flushing = true;
+    m_queuecondition.wakeOne();
+    while (isRunning() && (!m_queue.isEmpty() || m_writing)) {
+        if (!m_idlecondition.wait(&m_mutex, waittime)) {
+            result = false;
+            break;
+        }
+    }
+    m_flushing = false;
+    m_mutex.unlock();
+    return result;
+}
+
+// writes the pending changes of config from the calling thread, waits only if the thread is
+// writing changes of config right now
+void KConfigSyncWriter::finish(const KConfigPrivate *config)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_writingconfigs.contains(config)) {
+        m_writtencondition.wait(&m_mutex);
+    }
+
+    QList<KConfigSyncJob> jobs;
+    for (int i = 0; i < m_queue.size(); i++) {
+        if (m_queue.at(i).config == config) {
+            jobs.append(m_queue.takeAt(i));
+            break;
+        }
+    }
+    for (int i = 0; i < m_failed.size(); i++) {
+        if (m_failed.at(i).config == config) {
+            if (jobs.isEmpty()) {
+                jobs.append(m_failed.takeAt(i));
+            } else {
+                jobs.first().merge(m_failed.takeAt(i));
+            }
+            break;
+        }
+    }
+    locker.unlock();
+
+    writeJobs(jobs);
+    foreach (const KConfigSyncJob &job, jobs) {
+        kWarning() << "Discarding changes that could not be written to" << job.localFilePath;
+    }
+}
+
+bool KConfigSyncWriter::hasFailed(const KConfigPrivate *config)
+{
+    QMutexLocker locker(&m_mutex);
+    foreach (const KConfigSyncJob &job, m_failed) {
+        if (job.config == config) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void KConfigSyncWriter::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stop = true;
+        m_queuecondition.wakeOne();
+    }
+    wait();
+
+    QMutexLocker locker(&m_mutex);
+    m_stop = false;
+    if (!m_queue.isEmpty()) {
+        // queued while the thread was finishing
+        QList<KConfigSyncJob> jobs = m_queue;
+        m_queue.clear();
+        writeJobs(jobs);
+    }
+}
+
+void KConfigSyncWriter::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (true) {
+        while (m_queue.isEmpty() && !m_stop) {
+            m_idlecondition.wakeAll();
+            m_queuecondition.wait(&m_mutex);
+        }
+        if (m_queue.isEmpty()) {
+            break;
+        }
+
+        // collect more changes before writing, unless asked not to wait
+        QElapsedTimer delay;
+        delay.start();
+        while (!m_stop && !m_flushing && delay.elapsed() < KCONFIG_SYNCDELAY) {
+            m_queuecondition.wait(&m_mutex, KCONFIG_SYNCDELAY - delay.elapsed());
+        }
+
+        QList<KConfigSyncJob> jobs = m_queue;
+        m_queue.clear();
+        m_writing = true;
+        foreach (const KConfigSyncJob &job, jobs) {
+            m_writingconfigs.append(job.config);
+        }
+        locker.unlock();
+
+        writeJobs(jobs);
+
+        locker.relock();
+        m_failed += jobs;
+        m_writing = false;
+        m_writingconfigs.clear();
+        m_writtencondition.wakeAll();
+    }
+    m_idlecondition.wakeAll();
+}
+
+// on return jobs contains the jobs that failed
+void KConfigSyncWriter::writeJobs(QList<KConfigSyncJob> &jobs)
+{
+    QList<KConfigSyncJob> failed;
+    for (int i = 0; i < jobs.size(); i++) {
+        KConfigSyncJob &job = jobs[i];
+        KConfigIniBackend localBackend;
+        localBackend.setFilePath(job.localFilePath);
+        if (!writeEntryMap(&localBackend, job.globalFilePath, job.locale, job.componentData,
+                           job.lockFiles, job.writeLocals, job.writeGlobals, job.entryMap)) {
+            kWarning() << "Couldn't write" << job.localFilePath << ", will retry on the next sync";
+            failed.append(job);
+        }
+    }
+    jobs = failed;
+}
 
 KConfigPrivate::KConfigPrivate(const KComponentData &componentData_, KConfig::OpenFlags flags,
                                const char* resource)
@@ -149,6 +483,10 @@ KConfig::~KConfig()
     Q_D(KConfig);
     if (d->bDirty && d->mBackend.isUnique())
         sync();
+    if ((d->openFlags & AsyncSync) && !globalKConfigSyncWriter.isDestroyed()) {
+        // the changes of other configurations can wait
+        globalKConfigSyncWriter->finish(d);
+    }
     delete d;
 }
 
@@ -163,9 +501,11 @@ QStringList KConfig::groupList() const
     Q_D(const KConfig);
     QSet<QString> groups;
 
-    for (KEntryMap::ConstIterator entryMapIt( d->entryMap.constBegin() ); entryMapIt != d->entryMap.constEnd(); ++entryMapIt) {
-        const KEntryKey& key = entryMapIt.key();
-        const QByteArray group = key.mGroup;
+    // visit the group markers only, they are the first entry of their group
+    const KEntryMapConstIterator theEnd = d->entryMap.constEnd();
+    for (KEntryMapConstIterator it = d->entryMap.constBegin(); it != theEnd; it = d->entryMap.nextGroup(it)) {
+        const KEntryKey& key = it.key();
+        const QByteArray& group = key.mGroup;
         if (key.mKey.isNull() && !group.isEmpty() && group != "<default>" && group != "$Version") {
             const QString groupname = QString::fromUtf8(group, group.size());
             groups << groupname.left(groupname.indexOf(QLatin1Char('\x1d')));
@@ -180,9 +520,13 @@ QStringList KConfigPrivate::groupList(const QByteArray& group) const
     QByteArray theGroup = group + '\x1d';
     QSet<QString> groups;
 
-    for (KEntryMap::ConstIterator entryMapIt( entryMap.constBegin() ); entryMapIt != entryMap.constEnd(); ++entryMapIt) {
-        const KEntryKey& key = entryMapIt.key();	
-        if (key.mKey.isNull() && key.mGroup.startsWith(theGroup)) {
+    // the sub groups are contiguous, starting at the first one prefixed with theGroup
+    const KEntryMapConstIterator theEnd = entryMap.constEnd();
+    for (KEntryMapConstIterator it = entryMap.lowerBoundGroup(theGroup); it != theEnd; it = entryMap.nextGroup(it)) {
+        const KEntryKey& key = it.key();
+        if (!key.mGroup.startsWith(theGroup))
+            break;
+        if (key.mKey.isNull()) {
             const QString groupname = QString::fromUtf8(key.mGroup.mid(theGroup.length()));
             groups << groupname.left(groupname.indexOf(QLatin1Char('\x1d')));
         }
@@ -204,8 +548,11 @@ QSet<QByteArray> KConfigPrivate::allSubGroups(const QByteArray& parentGroup) con
 {
     QSet<QByteArray> groups;
 
-    for (KEntryMap::const_iterator entryMapIt = entryMap.begin(); entryMapIt != entryMap.end(); ++entryMapIt) {
-        const KEntryKey& key = entryMapIt.key();
+    const KEntryMapConstIterator theEnd = entryMap.constEnd();
+    for (KEntryMapConstIterator it = entryMap.lowerBoundGroup(parentGroup); it != theEnd; it = entryMap.nextGroup(it)) {
+        const KEntryKey& key = it.key();
+        if (!key.mGroup.startsWith(parentGroup))
+            break;
         if (key.mKey.isNull() && isGroupOrSubGroupMatch(key.mGroup, parentGroup)) {
             groups << key.mGroup;
         }
@@ -215,11 +562,18 @@ QSet<QByteArray> KConfigPrivate::allSubGroups(const QByteArray& parentGroup) con
 
 bool KConfigPrivate::hasNonDeletedEntries(const QByteArray& group) const
 {
-    for (KEntryMap::const_iterator it = entryMap.begin(); it != entryMap.end(); ++it) {
+    const KEntryMapConstIterator theEnd = entryMap.constEnd();
+    KEntryMapConstIterator it = entryMap.lowerBoundGroup(group);
+    while (it != theEnd && it.key().mGroup.startsWith(group)) {
+        if (!isGroupOrSubGroupMatch(it.key().mGroup, group)) {
+            it = entryMap.nextGroup(it);
+            continue;
+        }
         const KEntryKey& key = it.key();
         // Check for any non-deleted entry
-        if (isGroupOrSubGroupMatch(key.mGroup, group) && !key.mKey.isNull() && !it->bDeleted)
+        if (!key.mKey.isNull() && !it->bDeleted)
             return true;
+        ++it;
     }
     return false;
 }
@@ -294,18 +648,15 @@ void KConfig::sync()
         return;
     }
 
+    if ((d->openFlags & AsyncSync) && !globalKConfigSyncWriter.isDestroyed()
+        && globalKConfigSyncWriter->hasFailed(d)) {
+        // the last changes could not be written, they are retried with these
+        d->bDirty = true;
+    }
+
     if (d->bDirty && d->mBackend) {
         const QByteArray utf8Locale(locale().toUtf8());
 
-        // Create the containing dir, maybe it wasn't there
-        d->mBackend->createEnclosing();
-
-        // lock the local file
-        if (d->configState == ReadWrite && !d->lockLocal()) {
-            qWarning() << "couldn't lock local file";
-            return;
-        }
-
         // Rewrite global/local config only if there is a dirty entry in it.
         bool writeGlobals = false;
         bool writeLocals = false;
@@ -322,40 +673,42 @@ void KConfig::sync()
                 }
             }
         }
-
-        d->bDirty = false; // will revert to true if a config write fails
-
-        if (d->wantGlobals() && writeGlobals) {
-            KConfigIniBackend *tmp = new KConfigIniBackend();
-            tmp->setFilePath(d->sGlobalFileName);
-            if (d->configState == ReadWrite && !tmp->lock(componentData())) {
-                qWarning() << "couldn't lock global file";
-                d->bDirty = true;
-                tmp->deleteLater();
-                return;
-            }
-            if (!tmp->writeConfig(utf8Locale, d->entryMap, KConfigIniBackend::WriteGlobal)) {
-                d->bDirty = true;
-                // TODO KDE5: return false? (to tell the app that writing wasn't possible, e.g.
-                // config file is immutable or disk full)
-            }
-            if (tmp->isLocked()) {
-                tmp->unlock();
-            }
-            tmp->deleteLater();
+        writeGlobals = writeGlobals && d->wantGlobals();
+
+        if ((d->openFlags & AsyncSync) && !globalKConfigSyncWriter.isDestroyed()) {
+            KConfigSyncJob job;
+            job.config = d;
+            job.localFilePath = d->mBackend->filePath();
+            job.globalFilePath = d->sGlobalFileName;
+            job.locale = utf8Locale;
+            job.componentData = d->componentData;
+            job.lockFiles = (d->configState == ReadWrite);
+            job.writeLocals = writeLocals;
+            job.writeGlobals = writeGlobals;
+            job.entryMap = d->entryMap;
+
+            // the writer owns the changes now
+            d->bDirty = false;
+            const KEntryMapIterator theEnd = d->entryMap.end();
+            for (KEntryMapIterator it = d->entryMap.begin(); it != theEnd; ++it)
+                it->bDirty = false;
+
+            globalKConfigSyncWriter->enqueue(job);
+            return;
         }
 
-        if (writeLocals) {
-            if (!d->mBackend->writeConfig(utf8Locale, d->entryMap, KConfigIniBackend::WriteOptions())) {
-                d->bDirty = true;
-                // TODO KDE5: return false? (to tell the app that writing wasn't possible, e.g.
-                // config file is immutable or disk full)
-            }
-        }
-        if (d->mBackend->isLocked()) {
-            d->mBackend->unlock();
-        }
+        // will revert to true if a config write fails
+        d->bDirty = !writeEntryMap(d->mBackend.data(), d->sGlobalFileName, utf8Locale, d->componentData,
+                                   d->configState == ReadWrite, writeLocals, writeGlobals, d->entryMap);
+    }
+}
+
+bool KConfig::flushScheduledSyncs(int timeout)
+{
+    if (globalKConfigSyncWriter.isDestroyed()) {
+        return true;
     }
+    return globalKConfigSyncWriter->flush(timeout);
 }
 
 void KConfig::markAsClean()
@@ -372,6 +725,10 @@ void KConfig::markAsClean()
 bool KConfig::isDirty() const
 {
     Q_D(const KConfig);
+    if ((d->openFlags & AsyncSync) && !globalKConfigSyncWriter.isDestroyed()
+        && globalKConfigSyncWriter->hasFailed(d)) {
+        return true;
+    }
     return d->bDirty;
 }
 
@@ -451,6 +808,9 @@ void KConfig::reparseConfiguration()
     // Don't lose pending changes
     if (!d->isReadOnly() && d->bDirty)
         sync();
+    // and read them back once written
+    if (d->openFlags & AsyncSync)
+        flushScheduledSyncs();
 
     d->entryMap.clear();
 
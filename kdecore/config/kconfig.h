@@ -80,13 +80,21 @@ public:
      * global sources.  The exception is that if a key or group is marked as
      * being immutable, it will not be overridden.
      *
-     * Note that all values other than IncludeGlobals and CascadeConfig are
-     * convenience definitions for the basic mode.
-     * Do @em not combine them with anything.
+     * If AsyncSync is selected, sync() only hands the changes over to a
+     * background thread which writes them a short while later, merged with
+     * the changes of the following calls to sync(). Use it for configurations
+     * that are synced often, e.g. after every change. The changes are written
+     * at the latest when the object is destroyed, when the application exits
+     * or when flushScheduledSyncs() is called.
+     *
+     * Note that all values other than IncludeGlobals, CascadeConfig and
+     * AsyncSync are convenience definitions for the basic mode.
+     * Do @em not combine them with anything but AsyncSync.
      */
     enum OpenFlag {
         IncludeGlobals  = 0x01, ///< Blend kdeglobals into the config object.
         CascadeConfig   = 0x02, ///< Cascade to system-wide config files.
+        AsyncSync       = 0x04, ///< Write the changes from a thread, see above. @since 4.24
 
         SimpleConfig    = 0x00, ///< Just a single config file.
         NoCascade       = IncludeGlobals, ///< Include user's globals, but omit system settings.
@@ -174,6 +182,16 @@ public:
     /// @reimp
     void sync();
 
+    /**
+     * Writes the changes of all the configurations opened with AsyncSync
+     * that are still waiting to be written.
+     *
+     * @param timeout how long to wait for the writes, in milliseconds, or -1 to wait until done
+     * @return true if all the changes were handled within @p timeout
+     * @since 4.24
+     */
+    static bool flushScheduledSyncs(int timeout = -1);
+
     /// Returns true if sync has any changes to write out.
     /// @since 4.12
     bool isDirty() const;
@@ -93,7 +93,7 @@ private:
 
     bool wantGlobals() const { return openFlags&KConfig::IncludeGlobals && !bSuppressGlobal; }
     bool wantDefaults() const { return openFlags&KConfig::CascadeConfig; }
-    bool isSimple() const { return openFlags == KConfig::SimpleConfig; }
+    bool isSimple() const { return (openFlags & ~KConfig::AsyncSync) == KConfig::SimpleConfig; }
     bool isReadOnly() const { return configState == KConfig::ReadOnly; }
 
     bool setLocale(const QString& aLocale);
@@ -116,11 +116,13 @@ bool KEntryMap::setEntry(const QByteArray& group, const QByteArray& key, const Q
         KEntryMap const *that = this;
         ConstIterator cit = that->findEntry(group);
         if (cit == constEnd())
-            insert(KEntryKey(group), KEntry());
+            cit = insert(KEntryKey(group), KEntry());
         else if (cit->bImmutable)
             return false; // this group is immutable, so we cannot change this entry.
 
-        k = KEntryKey(group, key);
+        // share the group name of the marker, so that all the entries
+        // of a group reference a single copy of it
+        k = KEntryKey(cit.key().mGroup, key);
         newKey = true;
     }
 
@@ -286,6 +288,18 @@ void KEntryMap::setEntryOption(QMap< KEntryKey, KEntry >::Iterator it, KEntryMap
     }
 }
 
+QMap< KEntryKey, KEntry >::ConstIterator KEntryMap::nextGroup(const QMap< KEntryKey, KEntry >::ConstIterator& it) const
+{
+    if (it == constEnd())
+        return it;
+
+    // group names never contain a null byte, so no group sorts between
+    // the current one and the current one followed by \x01
+    QByteArray successor(it.key().mGroup);
+    successor += '\x01';
+    return lowerBound(KEntryKey(successor));
+}
+
 bool KEntryMap::revertEntry(const QByteArray& group, const QByteArray& key, KEntryMap::SearchFlags flags)
 {
     Q_ASSERT((flags & KEntryMap::SearchDefaults) == 0);
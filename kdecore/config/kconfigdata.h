@@ -212,6 +212,23 @@ class KEntryMap : public QMap<KEntryKey, KEntry>
         }
 
         bool revertEntry(const QByteArray& group, const QByteArray& key, SearchFlags flags=SearchFlags());
+
+        /**
+         * Returns the first entry whose group is not less than @p group,
+         * i.e. the group marker of @p group if the group exists.
+         * All entries of a group are contiguous, so together with nextGroup()
+         * this enumerates groups in O(log n) per group instead of visiting
+         * every entry.
+         */
+        ConstIterator lowerBoundGroup(const QByteArray& group) const
+        {
+            return lowerBound(KEntryKey(group));
+        }
+
+        /**
+         * Returns the first entry of the group following the one of @p it.
+         */
+        ConstIterator nextGroup(const ConstIterator& it) const;
 };
 Q_DECLARE_OPERATORS_FOR_FLAGS(KEntryMap::SearchFlags)
 Q_DECLARE_OPERATORS_FOR_FLAGS(KEntryMap::EntryOptions)
@@ -28,11 +28,16 @@
 
 #include <QCoreApplication>
 #include <QFile>
+#include <QHash>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
 #include <QDateTime>
 
 #include <unistd.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <limits.h>
 #include <syslog.h>
 
 #ifdef HAVE_BACKTRACE
@@ -49,6 +54,9 @@ enum KDebugType {
 
 static const QString s_kdebugfilepath = QString::fromLatin1("kdebug.log");
 
+// maximum number of messages queued for writing to files before the callers are blocked
+#define KDEBUG_QUEUESIZE 10000
+
 static int s_kde_debug_methodname = -1;
 static int s_kde_debug_timestamp = -1;
 static int s_kde_debug_color = -1;
@@ -112,6 +120,269 @@ protected:
 };
 K_GLOBAL_STATIC(KDebugNullDevice, globalKDebugNullDevie)
 
+struct KDebugFileMessage
+{
+    QString filepath;
+    QByteArray data;
+};
+
+// writes the messages for file output from a thread, the files are kept open and the messages
+// queued while writing are written in one go
+class KDebugFileWriter : public QThread
+{
+public:
+    KDebugFileWriter();
+    ~KDebugFileWriter();
+
+    void setMaxFileSize(const qint64 maxfilesize);
+
+    void enqueue(const QString &filepath, const QByteArray &data);
+    bool flush(const int timeout);
+    void stop();
+
+    void prepareFork();
+    void parentForked();
+    void childForked();
+
+protected:
+    void run() final;
+
+private:
+    Q_DISABLE_COPY(KDebugFileWriter);
+
+    void writeMessages(const QList<KDebugFileMessage> &messages);
+    QFile* openFile(const QString &filepath);
+    void closeFiles();
+
+    QMutex m_mutex;
+    QWaitCondition m_queuecondition;
+    QWaitCondition m_spacecondition;
+    QWaitCondition m_idlecondition;
+    QList<KDebugFileMessage> m_queue;
+    bool m_writing;
+    bool m_stop;
+    // the thread is not in the child of a fork, messages are written synchronously there
+    bool m_forked;
+    qint64 m_maxfilesize;
+    // accessed only from the thread
+    QHash<QString, QFile*> m_files;
+};
+K_GLOBAL_STATIC(KDebugFileWriter, globalKDebugFileWriter)
+
+static void kDebugPrepareFork()
+{
+    if (globalKDebugFileWriter.exists()) {
+        globalKDebugFileWriter->prepareFork();
+    }
+}
+
+static void kDebugParentForked()
+{
+    if (globalKDebugFileWriter.exists()) {
+        globalKDebugFileWriter->parentForked();
+    }
+}
+
+static void kDebugChildForked()
+{
+    if (globalKDebugFileWriter.exists()) {
+        globalKDebugFileWriter->childForked();
+    }
+}
+
+KDebugFileWriter::KDebugFileWriter()
+    : m_writing(false),
+    m_stop(false),
+    m_forked(false),
+    m_maxfilesize(0)
+{
+    static bool s_atforkregistered = false;
+    if (!s_atforkregistered) {
+        ::pthread_atfork(kDebugPrepareFork, kDebugParentForked, kDebugChildForked);
+        s_atforkregistered = true;
+    }
+}
+
+KDebugFileWriter::~KDebugFileWriter()
+{
+    stop();
+}
+
+void KDebugFileWriter::setMaxFileSize(const qint64 maxfilesize)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxfilesize = maxfilesize;
+}
+
+void KDebugFileWriter::enqueue(const QString &filepath, const QByteArray &data)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_forked) {
+        const KDebugFileMessage message = { filepath, data };
+        writeMessages(QList<KDebugFileMessage>() << message);
+        closeFiles();
+        return;
+    }
+    while (m_queue.size() >= KDEBUG_QUEUESIZE && isRunning()) {
+        m_spacecondition.wait(&m_mutex);
+    }
+    m_queue.append({ filepath, data });
+    if (!isRunning()) {
+        m_stop = false;
+        start(QThread::LowPriority);
+    }
+    m_queuecondition.wakeOne();
+}
+
+bool KDebugFileWriter::flush(const int timeout)
+{
+    if (!m_mutex.tryLock(timeout)) {
+        return false;
+    }
+    bool result = true;
+    const unsigned long waittime = (timeout < 0 ? ULONG_MAX : timeout);
+    while (isRunning() && (!m_queue.isEmpty() || m_writing)) {
+        if (!m_idlecondition.wait(&m_mutex, waittime)) {
+            result = false;
+            break;
+        }
+    }
+    m_mutex.unlock();
+    return result;
+}
+
+void KDebugFileWriter::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_forked) {
+            // there is no thread to wait for and nothing is queued
+            return;
+        }
+        m_stop = true;
+        m_queuecondition.wakeOne();
+    }
+    wait();
+
+    QMutexLocker locker(&m_mutex);
+    m_stop = false;
+    if (!m_queue.isEmpty()) {
+        // queued while the thread was finishing
+        const QList<KDebugFileMessage> messages = m_queue;
+        m_queue.clear();
+        writeMessages(messages);
+        closeFiles();
+    }
+}
+
+void KDebugFileWriter::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (true) {
+        while (m_queue.isEmpty() && !m_stop) {
+            m_idlecondition.wakeAll();
+            m_queuecondition.wait(&m_mutex);
+        }
+        if (m_queue.isEmpty()) {
+            break;
+        }
+
+        const QList<KDebugFileMessage> messages = m_queue;
+        m_queue.clear();
+        m_writing = true;
+        m_spacecondition.wakeAll();
+        locker.unlock();
+
+        writeMessages(messages);
+
+        locker.relock();
+        m_writing = false;
+    }
+    closeFiles();
+    m_idlecondition.wakeAll();
+}
+
+void KDebugFileWriter::writeMessages(const QList<KDebugFileMessage> &messages)
+{
+    // messages for the same file are joined so that each file is written to once
+    QList<QString> filepaths;
+    QHash<QString, QByteArray> filesdata;
+    foreach (const KDebugFileMessage &message, messages) {
+        QHash<QString, QByteArray>::iterator it = filesdata.find(message.filepath);
+        if (it == filesdata.end()) {
+            filepaths.append(message.filepath);
+            filesdata.insert(message.filepath, message.data);
+        } else {
+            it.value().append(message.data);
+        }
+    }
+
+    foreach (const QString &filepath, filepaths) {
+        const QByteArray filedata = filesdata.value(filepath);
+        QFile* writefile = openFile(filepath);
+        if (!writefile) {
+            continue;
+        }
+        if (m_maxfilesize > 0 && writefile->size() > 0
+            && (writefile->size() + filedata.size()) > m_maxfilesize) {
+            // keep one old log
+            const QString rotatedfilepath = filepath + QLatin1String(".1");
+            writefile->close();
+            QFile::remove(rotatedfilepath);
+            QFile::rename(filepath, rotatedfilepath);
+            if (!writefile->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+                delete m_files.take(filepath);
+                continue;
+            }
+        }
+        writefile->write(filedata.constData(), filedata.size());
+    }
+}
+
+// the mutex is held from before the fork until after it, so that the child does not
+// inherit it locked by a thread that does not exist there
+void KDebugFileWriter::prepareFork()
+{
+    m_mutex.lock();
+}
+
+void KDebugFileWriter::parentForked()
+{
+    m_mutex.unlock();
+}
+
+void KDebugFileWriter::childForked()
+{
+    // the parent writes the queued messages, the thread is gone in the child and
+    // QThread still thinks it is running
+    m_forked = true;
+    m_queue.clear();
+    m_writing = false;
+    // the files are unbuffered, closing them does not write anything twice
+    closeFiles();
+    m_mutex.unlock();
+}
+
+QFile* KDebugFileWriter::openFile(const QString &filepath)
+{
+    QFile* writefile = m_files.value(filepath, nullptr);
+    if (!writefile) {
+        writefile = new QFile(filepath);
+        if (!writefile->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+            delete writefile;
+            return nullptr;
+        }
+        m_files.insert(filepath, writefile);
+    }
+    return writefile;
+}
+
+void KDebugFileWriter::closeFiles()
+{
+    qDeleteAll(m_files);
+    m_files.clear();
+}
+
 
 class KDebugFileDevice: public KDebugNullDevice
 {
@@ -120,6 +391,7 @@ public:
     KDebugFileDevice()
         : m_type(QtDebugMsg),
         m_abortfatal(true),
+        m_asynchronous(true),
         m_filepath(s_kdebugfilepath)
         { }
 
@@ -131,10 +403,31 @@ public:
         { m_header = header; }
     void setFilepath(const QString &filepath)
         { m_filepath = filepath; }
+    void setAsynchronous(const bool asynchronous)
+        { m_asynchronous = asynchronous; }
 
 protected:
     qint64 writeData(const char* data, qint64 len) final
         {
+            // TODO: insert type somewhere
+            QByteArray message;
+            message.reserve(m_header.size() + len + 3);
+            message.append(m_header.constData(), m_header.size());
+            message.append(": ", 2);
+            message.append(data, len);
+            message.append('\n');
+
+            if (m_asynchronous && !globalKDebugFileWriter.isDestroyed()) {
+                globalKDebugFileWriter->enqueue(m_filepath, message);
+                if (m_type == QtFatalMsg) {
+                    globalKDebugFileWriter->flush(-1);
+                    if (m_abortfatal) {
+                        ::abort();
+                    }
+                }
+                return len;
+            }
+
             QFile writefile(m_filepath);
             if (!writefile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
                 if (m_abortfatal && m_type == QtFatalMsg) {
@@ -142,11 +435,7 @@ protected:
                 }
                 return 0;
             }
-            // TODO: insert type somewhere
-            writefile.write(m_header.constData(), m_header.size());
-            writefile.write(": ", 2);
-            writefile.write(data, len);
-            writefile.write("\n", 1);
+            writefile.write(message.constData(), message.size());
             if (m_abortfatal && m_type == QtFatalMsg) {
                 ::abort();
             }
@@ -157,6 +446,7 @@ private:
     Q_DISABLE_COPY(KDebugFileDevice);
     QtMsgType m_type;
     bool m_abortfatal;
+    bool m_asynchronous;
     QByteArray m_header;
     QString m_filepath;
 };
@@ -389,6 +679,7 @@ private:
     KDebugAreaCache areaCache(const int area);
 
     bool m_disableall;
+    bool m_asynchronousfile;
     QMap<int,QByteArray> m_areanames;
     QMap<int,KDebugAreaCache> m_areacache;
     QMap<uint,QIODevice*> m_areadevices;
@@ -397,7 +688,8 @@ K_GLOBAL_STATIC(KDebugConfig, globalKDebugConfig)
 
 KDebugConfig::KDebugConfig()
     : KConfig(QString::fromLatin1("kdebugrc"), KConfig::NoGlobals),
-    m_disableall(false)
+    m_disableall(false),
+    m_asynchronousfile(true)
 {
     cacheAreas();
 }
@@ -414,6 +706,10 @@ void KDebugConfig::cacheAreas()
 
     KConfigGroup generalgroup = KConfig::group(QString());
     m_disableall = generalgroup.readEntry("DisableAll", false);
+    m_asynchronousfile = generalgroup.readEntry("AsynchronousFile", true);
+    if (!globalKDebugFileWriter.isDestroyed()) {
+        globalKDebugFileWriter->setMaxFileSize(generalgroup.readEntry("MaxFileSize", qint64(0)));
+    }
     if (m_disableall) {
         return;
     }
@@ -534,6 +830,7 @@ QIODevice* KDebugConfig::areaDevice(const QtMsgType type, const char* const func
             kdebugdevice->setAbortFatal(areaabort);
             kdebugdevice->setHeader(kDebugHeader(KDebugConfig::areaName(area), funcinfo, areaoutput));
             kdebugdevice->setFilepath(areafilename);
+            kdebugdevice->setAsynchronous(m_asynchronousfile);
             return kdebugdevice;
         }
         case KDebugType::TypeMessageBox: {
@@ -611,10 +908,23 @@ QByteArray kBacktrace(int levels)
 #endif // HAVE_BACKTRACE
 }
 
+bool kFlushDebug(const int timeout)
+{
+    if (globalKDebugFileWriter.isDestroyed()) {
+        return true;
+    }
+    return globalKDebugFileWriter->flush(timeout);
+}
+
 void kClearDebugConfig()
 {
     QMutexLocker locker(globalKDebugMutex);
 
+    // write pending messages and close the files, the file paths may change
+    if (!globalKDebugFileWriter.isDestroyed()) {
+        globalKDebugFileWriter->stop();
+    }
+
     globalKDebugConfig->destroyDevices();
     globalKDebugConfig->reparseConfiguration();
     globalKDebugConfig->cacheAreas();
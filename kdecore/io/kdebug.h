@@ -34,6 +34,12 @@
     KDE_DEBUG_METHODNAME - adds the method to the message
     KDE_DEBUG_COLOR - colorizes the message, applies only for shell output type
                       and when it is TTY
+
+    Messages for file output are written from a separate thread which keeps the
+    files open, that can be disabled by setting AsynchronousFile=false in the
+    general group of kdebugrc. MaxFileSize (in bytes) in the same group enables
+    rotation of the files, the previous content is moved to a file with ".1"
+    suffix.
 */
 
 #ifndef KDE_DEFAULT_DEBUG_AREA
@@ -78,6 +84,18 @@ KDECORE_EXPORT QByteArray kBacktrace(int levels = -1);
 */
 KDECORE_EXPORT void kClearDebugConfig();
 
+/*!
+    @brief Writes the debug messages queued for file output.
+
+    @note This is done automatically on exit and before aborting due to fatal
+    message.
+
+    @param timeout maximum time to wait in milliseconds, -1 means no limit
+    @return true if all messages were written, false otherwise
+    @since 4.24
+*/
+KDECORE_EXPORT bool kFlushDebug(const int timeout = -1);
+
 /*!
     @brief Returns a debug stream.
 
@@ -36,6 +36,17 @@ KDirWatchPrivate::~KDirWatchPrivate()
 
 K_GLOBAL_STATIC(KDirWatch, globalWatch)
 
+// watching non-existing directory requires a trailing slash, directories are
+// watched and looked up with one
+static QString kDirWatchDirPath(const QString &path)
+{
+    QString dirpath = path;
+    if (dirpath != QDir::rootPath() && !dirpath.endsWith(QDir::separator())) {
+        dirpath.append(QDir::separator());
+    }
+    return dirpath;
+}
+
 KDirWatch* KDirWatch::self()
 {
     return globalWatch;
@@ -60,16 +71,14 @@ void KDirWatch::addDir(const QString &path, bool recurse)
 {
     if (path.isEmpty() || path.startsWith(QLatin1String("/dev"))) {
         return; // Don't even go there.
-    } else if (d->watcher->directories().contains(path)) {
-        return;
     }
 
-    kDebug(7001) << "watching directory" << path;
-    QString dirpath = path;
-    // watching non-existing directory requires a trailing slash
-    if (dirpath != QDir::rootPath() && !dirpath.endsWith(QDir::separator())) {
-        dirpath.append(QDir::separator());
+    const QString dirpath = kDirWatchDirPath(path);
+    if (d->watcher->directories().contains(dirpath)) {
+        return;
     }
+
+    kDebug(7001) << "watching directory" << dirpath;
     d->watcheddirs.append(dirpath);
     d->watcher->addPath(dirpath);
 
@@ -104,8 +113,9 @@ void KDirWatch::addFile(const QString &path)
 
 void KDirWatch::removeDir(const QString &path)
 {
-    d->watcheddirs.removeAll(path);
-    d->watcher->removePath(path);
+    const QString dirpath = kDirWatchDirPath(path);
+    d->watcheddirs.removeAll(dirpath);
+    d->watcher->removePath(dirpath);
 }
 
 void KDirWatch::removeFile(const QString &path)
@@ -116,7 +126,7 @@ void KDirWatch::removeFile(const QString &path)
 
 bool KDirWatch::contains(const QString &path) const
 {
-    return (d->watcher->files().contains(path) || d->watcher->directories().contains(path));
+    return (d->watcher->files().contains(path) || d->watcher->directories().contains(kDirWatchDirPath(path)));
 }
 
 int KDirWatch::interval() const
@@ -18,8 +18,12 @@
 */
 
 #include "kfilesystemtype_p.h"
+#include "kglobal.h"
+#include "kde_file.h"
 #include <QFile>
 #include <QDebug>
+#include <QHash>
+#include <QMutex>
 //#include <errno.h>
 
 inline KFileSystemType::Type kde_typeFromName(const char *name)
@@ -106,7 +110,48 @@ KFileSystemType::Type determineFileSystemTypeImpl(const QByteArray& path)
 }
 #endif
 
+// statfs() is a round-trip to the server on network filesystems, stat() is
+// usually answered from the attribute cache; so the type is looked up once
+// per device and the device of a path found with stat().
+class KFileSystemTypeCache
+{
+public:
+    KFileSystemTypeCache() : generation(-1) {}
+
+    QMutex mutex;
+    int generation;
+    QHash<quint64, KFileSystemType::Type> types;
+};
+
+K_GLOBAL_STATIC(KFileSystemTypeCache, globalKFileSystemTypeCache)
+
 KFileSystemType::Type KFileSystemType::fileSystemType(const QString& path)
 {
-    return determineFileSystemTypeImpl(QFile::encodeName(path));
+    const QByteArray encodedPath = QFile::encodeName(path);
+    KDE_struct_stat buff;
+    if (KDE_stat(encodedPath.constData(), &buff) != 0)
+        return determineFileSystemTypeImpl(encodedPath);
+    return fileSystemType(path, buff.st_dev);
+}
+
+KFileSystemType::Type KFileSystemType::fileSystemType(const QString& path, quint64 deviceId)
+{
+    const int generation = mountTableGeneration();
+    KFileSystemTypeCache *cache = globalKFileSystemTypeCache;
+    {
+        QMutexLocker locker(&cache->mutex);
+        if (cache->generation != generation) {
+            cache->generation = generation;
+            cache->types.clear();
+        }
+        QHash<quint64, Type>::const_iterator it = cache->types.constFind(deviceId);
+        if (it != cache->types.constEnd())
+            return it.value();
+    }
+
+    const Type type = determineFileSystemTypeImpl(QFile::encodeName(path));
+    QMutexLocker locker(&cache->mutex);
+    if (cache->generation == generation)
+        cache->types.insert(deviceId, type);
+    return type;
 }
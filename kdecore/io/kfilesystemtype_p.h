@@ -33,6 +33,16 @@ namespace KFileSystemType
 
    KDECORE_EXPORT Type fileSystemType(const QString& path);
 
+   /**
+    * Same as fileSystemType(path), for a path on device @p deviceId (st_dev).
+    * The type of each device is remembered until the mount table changes.
+    */
+   KDECORE_EXPORT Type fileSystemType(const QString& path, quint64 deviceId);
+
+   // Changes whenever something gets mounted or unmounted, or on every call
+   // where that cannot be known. Implemented in kmountpoint.cpp.
+   int mountTableGeneration();
+
 }
 
 #endif
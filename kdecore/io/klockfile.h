@@ -28,13 +28,26 @@ class KLockFilePrivate;
 /**
  * \class KLockFile klockfile.h <KLockFile>
  * 
- * The KLockFile class provides NFS safe lockfiles.
+ * The KLockFile class provides inter-process locks for files.
+ *
+ * The lock is a kernel lock on a file in the temporary directory, it is
+ * released by the kernel if the process holding it dies. Every KLockFile
+ * object has its own lock, even within the same process.
  *
  * @author Ivailo Monev <xakepa10@gmail.com>
  */
 class KDECORE_EXPORT KLockFile
 {
 public:
+    /*!
+        @brief How the lock is held
+        @since 4.24
+    */
+    enum LockMode {
+        ExclusiveLock = 0, ///< only one object can hold the lock
+        SharedLock = 1 ///< any number of objects can hold the lock, but not together with an exclusive one
+    };
+
     /*!
         @brief Creates the object, does not attempt to acquire the lock
     */
@@ -46,15 +59,25 @@ public:
     ~KLockFile();
 
     /*!
-        @brief Attempts to acquire the lock
+        @brief Attempts to acquire the lock, without waiting for it
     */
-    bool tryLock();
+    bool tryLock(LockMode mode = ExclusiveLock);
 
     /*!
-        @brief Acquires the lock
+        @brief Acquires the exclusive lock, waiting until it is released by its holder
     */
     void lock();
 
+    /*!
+        @brief Acquires the lock, waiting until it is released by its holder
+        @param timeout the time in milliseconds to wait at most, -1 to wait
+        for as long as it takes. The kernel can only be asked to wait forever,
+        with a timeout the lock is polled with increasing intervals instead.
+        @return whether the lock was acquired
+        @since 4.24
+    */
+    bool lock(LockMode mode, int timeout = -1);
+
     /*!
         @brief Returns whether the lock is held or not
     */
@@ -65,6 +88,12 @@ public:
     */
     void unlock();
 
+    /*!
+        @brief Returns how many times lock() had to wait in this process
+        @since 4.24
+    */
+    static int contentionCount();
+
 private:
     Q_DISABLE_COPY(KLockFile);
     KLockFilePrivate *const d;
@@ -22,36 +22,113 @@
 #include "kdebug.h"
 #include "kde_file.h"
 
-#include <QCoreApplication>
+#include <QAtomicInt>
+#include <QElapsedTimer>
 #include <QThread>
 
 #include <sys/types.h>
+#include <sys/file.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 
-#define KLOCKFILE_TIMEOUT 150
 #define KLOCKFILE_SLEEPTIME 50
+// longer names are shortened, most filesystems allow 255 bytes
+#define KLOCKFILE_MAXNAME 200
+
+static QAtomicInt s_contentions(0);
 
 class KLockFilePrivate
 {
 public:
     KLockFilePrivate();
 
+    bool acquire(KLockFile::LockMode mode, bool wait);
+
     QByteArray m_lockfile;
     int m_lockfd;
+    KLockFile::LockMode m_lockmode;
 };
 
 KLockFilePrivate::KLockFilePrivate()
-    : m_lockfd(-1)
+    : m_lockfd(-1),
+    m_lockmode(KLockFile::ExclusiveLock)
+{
+}
+
+// Open file description locks belong to the open() call like flock() ones,
+// unlike POSIX record locks that belong to the process. Either way two
+// KLockFile objects in the same process exclude each other.
+static bool lockFd(int fd, KLockFile::LockMode mode, bool wait)
+{
+    int result = -1;
+#if defined(F_OFD_SETLK)
+    struct flock lock;
+    ::memset(&lock, 0, sizeof(lock));
+    lock.l_type = (mode == KLockFile::SharedLock ? F_RDLCK : F_WRLCK);
+    lock.l_whence = SEEK_SET;
+    lock.l_start = 0;
+    lock.l_len = 0;
+    do {
+        result = ::fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &lock);
+    } while (result == -1 && errno == EINTR);
+#else
+    const int operation = (mode == KLockFile::SharedLock ? LOCK_SH : LOCK_EX);
+    do {
+        result = ::flock(fd, wait ? operation : (operation | LOCK_NB));
+    } while (result == -1 && errno == EINTR);
+#endif
+    if (result == -1 && errno != EWOULDBLOCK && errno != EAGAIN && errno != EACCES) {
+        const int savederrno = errno;
+        kWarning() << "Could not lock file" << qt_error_string(savederrno);
+    }
+    return (result != -1);
+}
+
+bool KLockFilePrivate::acquire(KLockFile::LockMode mode, bool wait)
 {
+    while (true) {
+        const int fd = KDE_open(m_lockfile.constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            const int savederrno = errno;
+            kWarning() << "Could not open lock file" << m_lockfile << qt_error_string(savederrno);
+            return false;
+        }
+        if (!lockFd(fd, mode, wait)) {
+            QT_CLOSE(fd);
+            return false;
+        }
+
+        // The previous holder removes the file when it is done with it, if
+        // that happened while waiting then the lock is on a file nobody else
+        // can see anymore and it has to be done again
+        KDE_struct_stat fdstat;
+        KDE_struct_stat pathstat;
+        if (KDE_fstat(fd, &fdstat) == 0 && KDE_stat(m_lockfile.constData(), &pathstat) == 0
+            && fdstat.st_dev == pathstat.st_dev && fdstat.st_ino == pathstat.st_ino) {
+            m_lockfd = fd;
+            m_lockmode = mode;
+            return true;
+        }
+        QT_CLOSE(fd);
+    }
 }
 
 KLockFile::KLockFile(const QString &file)
     : d(new KLockFilePrivate())
 {
+    // the whole path is part of the name so that different files never
+    // share a lock, unless it is too long for that
+    QByteArray name = QFile::encodeName(file);
+    name.replace('%', "%25");
+    name.replace('/', "%2F");
+    if (name.size() > KLOCKFILE_MAXNAME) {
+        name = QByteArray::number(qHash(name)) + '-' + name.right(KLOCKFILE_MAXNAME - 16);
+    }
     d->m_lockfile = QFile::encodeName(KGlobal::dirs()->saveLocation("tmp"));
-    d->m_lockfile.append(QByteArray::number(qHash(file)));
+    d->m_lockfile.append(name);
     d->m_lockfile.append(".klockfile");
 }
 
@@ -61,21 +138,44 @@ KLockFile::~KLockFile()
     delete d;
 }
 
-bool KLockFile::tryLock()
+bool KLockFile::tryLock(LockMode mode)
 {
     if (d->m_lockfd != -1) {
         return true;
     }
 
-    d->m_lockfd = KDE_open(d->m_lockfile.constData(), O_WRONLY | O_CREAT | O_EXCL, 0644);
-    return (d->m_lockfd != -1);
+    return d->acquire(mode, false);
 }
 
 void KLockFile::lock()
 {
-    while (!tryLock()) {
-        QCoreApplication::processEvents(QEventLoop::AllEvents, KLOCKFILE_TIMEOUT);
-        QThread::msleep(KLOCKFILE_SLEEPTIME);
+    lock(KLockFile::ExclusiveLock);
+}
+
+bool KLockFile::lock(LockMode mode, int timeout)
+{
+    if (tryLock(mode)) {
+        return true;
+    }
+
+    s_contentions.fetchAndAddOrdered(1);
+    if (timeout < 0) {
+        return d->acquire(mode, true);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int sleeptime = 1;
+    while (true) {
+        const qint64 remaining = timeout - timer.elapsed();
+        if (remaining <= 0) {
+            return false;
+        }
+        QThread::msleep(qMin(qint64(sleeptime), remaining));
+        if (d->acquire(mode, false)) {
+            return true;
+        }
+        sleeptime = qMin(sleeptime * 2, KLOCKFILE_SLEEPTIME);
     }
 }
 
@@ -87,11 +187,18 @@ bool KLockFile::isLocked() const
 void KLockFile::unlock()
 {
     if (d->m_lockfd != -1) {
-        QT_CLOSE(d->m_lockfd);
-        if (Q_UNLIKELY(::unlink(d->m_lockfile.constData()) == -1)) {
+        // other holders of a shared lock may still need the file
+        if (d->m_lockmode == KLockFile::ExclusiveLock
+            && Q_UNLIKELY(::unlink(d->m_lockfile.constData()) == -1)) {
             const int savederrno = errno;
             kWarning() << "Could not remove lock file" << qt_error_string(savederrno);
         }
+        QT_CLOSE(d->m_lockfd);
         d->m_lockfd = -1;
     }
 }
+
+int KLockFile::contentionCount()
+{
+    return s_contentions.load();
+}
@@ -19,14 +19,18 @@
  */
 
 #include "kmountpoint.h"
+#include "kfilesystemtype_p.h"
 
 #include <config.h>
 #include <stdlib.h>
 
 #include <QtCore/QFileInfo>
 #include <QtCore/QTextStream>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
 
 #include "kstandarddirs.h"
+#include "kglobal.h"
 
 
 static Qt::CaseSensitivity cs = Qt::CaseSensitive;
@@ -76,6 +80,12 @@ static Qt::CaseSensitivity cs = Qt::CaseSensitive;
 
 #include "kdebug.h"
 
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
 
 #ifdef Q_OS_SOLARIS
 #define FSTAB "/etc/vfstab"
@@ -88,6 +98,8 @@ public:
     void finalizePossibleMountPoint(DetailsNeededFlags infoNeeded);
     void finalizeCurrentMountPoint(DetailsNeededFlags infoNeeded);
 
+    static KMountPoint::List readCurrentMountPoints(DetailsNeededFlags infoNeeded);
+
     QString mountedFrom;
     QString device; // Only available when the NeedRealDeviceName flag was set.
     QString mountPoint;
@@ -95,6 +107,75 @@ public:
     QStringList mountOptions;
 };
 
+// Process-wide copy of the mount table. On Linux the kernel flags
+// /proc/self/mountinfo with POLLPRI whenever something gets mounted or
+// unmounted; elsewhere nothing tells and the table is read every time.
+class KMountTableCache
+{
+public:
+    KMountTableCache();
+    ~KMountTableCache();
+
+    // Forgets the cached mountpoints if the mount table changed, must be
+    // called with the mutex locked
+    void checkChanged();
+
+    QMutex mutex;
+    int generation;
+    QHash<int, KMountPoint::List> mountPoints; // by DetailsNeededFlags
+    // Mountpoints by path without trailing slash, for currentMountPoint()
+    QHash<int, QHash<QString, KMountPoint::Ptr> > mountPointsByPath;
+
+private:
+    int m_fd;
+};
+
+KMountTableCache::KMountTableCache()
+    : generation(0),
+    m_fd(-1)
+{
+#ifdef Q_OS_LINUX
+    m_fd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+KMountTableCache::~KMountTableCache()
+{
+#ifdef Q_OS_LINUX
+    if (m_fd != -1) {
+        ::close(m_fd);
+    }
+#endif
+}
+
+void KMountTableCache::checkChanged()
+{
+#ifdef Q_OS_LINUX
+    if (m_fd != -1) {
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLPRI;
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, 0) == 0) {
+            return;
+        }
+    }
+#endif
+    generation++;
+    mountPoints.clear();
+    mountPointsByPath.clear();
+}
+
+K_GLOBAL_STATIC(KMountTableCache, globalKMountTableCache)
+
+int KFileSystemType::mountTableGeneration()
+{
+    KMountTableCache *cache = globalKMountTableCache;
+    QMutexLocker locker(&cache->mutex);
+    cache->checkChanged();
+    return cache->generation;
+}
+
 KMountPoint::KMountPoint()
     :d( new Private )
 {
@@ -270,6 +351,73 @@ KMountPoint::List KMountPoint::possibleMountPoints(DetailsNeededFlags infoNeeded
 }
 
 KMountPoint::List KMountPoint::currentMountPoints(DetailsNeededFlags infoNeeded)
+{
+    KMountTableCache *cache = globalKMountTableCache;
+    QMutexLocker locker(&cache->mutex);
+    cache->checkChanged();
+    QHash<int, List>::const_iterator it = cache->mountPoints.constFind(int(infoNeeded));
+    if (it != cache->mountPoints.constEnd()) {
+        return it.value();
+    }
+
+    const KMountPoint::List result = Private::readCurrentMountPoints(infoNeeded);
+    cache->mountPoints.insert(int(infoNeeded), result);
+    return result;
+}
+
+KMountPoint::Ptr KMountPoint::currentMountPoint(const QString& path, DetailsNeededFlags infoNeeded)
+{
+    /* If the path contains symlinks, get the real name */
+    QString realname = KStandardDirs::realFilePath(path);
+
+    KMountTableCache *cache = globalKMountTableCache;
+    QMutexLocker locker(&cache->mutex);
+    cache->checkChanged();
+    QHash<int, List>::iterator lit = cache->mountPoints.find(int(infoNeeded));
+    if (lit == cache->mountPoints.end()) {
+        lit = cache->mountPoints.insert(int(infoNeeded), Private::readCurrentMountPoints(infoNeeded));
+    }
+    const List &mountPoints = lit.value();
+
+    QHash<int, QHash<QString, Ptr> >::iterator it = cache->mountPointsByPath.find(int(infoNeeded));
+    if (it == cache->mountPointsByPath.end()) {
+        QHash<QString, Ptr> byPath;
+        for (List::const_iterator mit = mountPoints.begin(); mit != mountPoints.end(); ++mit) {
+            QString mountPoint = (*mit)->d->mountPoint;
+            if (mountPoint.length() > 1 && mountPoint.endsWith(QLatin1Char('/'))) {
+                mountPoint.chop(1);
+            }
+            // like findByPath(), the first of several mounts on the same path wins
+            if (!byPath.contains(mountPoint)) {
+                byPath.insert(mountPoint, *mit);
+            }
+        }
+        it = cache->mountPointsByPath.insert(int(infoNeeded), byPath);
+    }
+    const QHash<QString, Ptr> &byPath = it.value();
+
+    // Try the path itself, then each of its parents
+    while (!realname.isEmpty()) {
+        if (realname.length() > 1 && realname.endsWith(QLatin1Char('/'))) {
+            realname.chop(1);
+        }
+        QHash<QString, Ptr>::const_iterator found = byPath.constFind(realname);
+        if (found != byPath.constEnd()) {
+            return found.value();
+        }
+        if (realname == QLatin1String("/")) {
+            break;
+        }
+        const int slash = realname.lastIndexOf(QLatin1Char('/'));
+        if (slash == -1) {
+            break;
+        }
+        realname.truncate(slash == 0 ? 1 : slash);
+    }
+    return Ptr();
+}
+
+KMountPoint::List KMountPoint::Private::readCurrentMountPoints(DetailsNeededFlags infoNeeded)
 {
     KMountPoint::List result;
 
@@ -79,11 +79,24 @@ public:
 
     /**
      * This function gives a list of all currently used mountpoints. (mtab)
+     * Where the system tells when something gets mounted or unmounted (Linux)
+     * the list is only read again after that happened.
      * @param infoNeeded Flags that specify which additional information
      * should be fetched.
      */
     static List currentMountPoints(DetailsNeededFlags infoNeeded = BasicInfoNeeded);
 
+    /**
+     * Returns the currently used mountpoint that contains @p path, same as
+     * currentMountPoints(infoNeeded).findByPath(path) but the mountpoints
+     * are looked up by path instead of comparing @p path with all of them.
+     * @param path the path to check
+     * @param infoNeeded Flags that specify which additional information
+     * should be fetched.
+     * @since 4.24
+     */
+    static Ptr currentMountPoint(const QString& path, DetailsNeededFlags infoNeeded = BasicInfoNeeded);
+
     /**
      * Where this filesystem gets mounted from.
      * This can refer to a device, a remote server or something else.
@@ -128,11 +128,19 @@ KService::List KMimeTypeTrader::query( const QString& mimeType,
                                        const QString& genericServiceType,
                                        const QString& constraint ) const
 {
+    // Service type names never contain a null character, so these keys
+    // can't clash with the ones of KServiceTypeTrader::query
+    const QString cacheKey = mimeType + QLatin1Char('\0') + genericServiceType;
+    KService::List lst;
+    if (KServiceFactory::self()->findCachedQuery(cacheKey, constraint, &lst))
+        return lst;
+
     // Get all services of this mime type.
-    KService::List lst = mimeTypeSycocaServiceOffers(mimeType);
+    lst = mimeTypeSycocaServiceOffers(mimeType);
     filterMimeTypeOffers(lst, genericServiceType);
 
     KServiceTypeTrader::applyConstraints(lst, constraint);
+    KServiceFactory::self()->cacheQuery(cacheKey, constraint, lst);
 
     kDebug(7014) << "query for mimeType " << mimeType << ", " << genericServiceType
                  << " : returning " << lst.count() << " offers";
@@ -33,12 +33,14 @@
 #include <QtCore/QFile>
 #include <QtCore/QDir>
 #include <QtCore/QMap>
+#include <QtCore/QMutex>
 
 #include <kdebug.h>
 #include <kdesktopfile.h>
 #include <kglobal.h>
 #include <kconfiggroup.h>
 #include <kstandarddirs.h>
+#include <ksycoca.h>
 
 #include "kservicefactory.h"
 #include "kservicetypefactory.h"
@@ -309,12 +311,33 @@ void KServicePrivate::load(QDataStream& s)
 {
     qint8 def, term;
     qint8 initpref;
+    QByteArray props;
 
     // NOTE: make sure to update the version number in ksycoca.cpp
     s >> m_strType >> m_strName >> m_strExec >> m_strIcon
       >> term >> m_strTerminalOptions
-      >> m_strPath >> m_strComment >> def >> m_mapProps
-      >> m_strLibrary
+      >> m_strPath >> m_strComment >> def;
+
+    // The property map is by far the biggest part of a service and most
+    // services never get asked for any property, so unless we are building
+    // the database only remember where it is and read it in properties().
+    if (KSycoca::self()->isBuilding()) {
+        s >> props;
+        QDataStream propsStream(props);
+        propsStream.setVersion(s.version());
+        propsStream >> m_mapProps;
+    } else {
+        quint32 propsSize;
+        s >> propsSize;
+        if (propsSize != 0xffffffff) {
+            m_propsOffset = s.device()->pos();
+            m_propsDatabase = KSycoca::self();
+            m_propsGeneration = KSycoca::generation();
+            s.skipRawData(propsSize);
+        }
+    }
+
+    s >> m_strLibrary
       >> m_strDesktopEntryName
       >> initpref
       >> m_lstKeywords >> m_strGenName
@@ -333,10 +356,16 @@ void KServicePrivate::save(QDataStream& s)
     qint8 def = m_bAllowAsDefault, initpref = m_initialPreference;
     qint8 term = m_bTerminal;
 
+    // Stored as a byte array so that load() can skip it
+    QByteArray props;
+    QDataStream propsStream(&props, QIODevice::WriteOnly);
+    propsStream.setVersion(s.version());
+    propsStream << properties();
+
     // NOTE: make sure to update the version number in ksycoca.cpp
     s << m_strType << m_strName << m_strExec << m_strIcon
       << term << m_strTerminalOptions
-      << m_strPath << m_strComment << def << m_mapProps
+      << m_strPath << m_strComment << def << props
       << m_strLibrary
       << m_strDesktopEntryName
       << initpref
@@ -344,6 +373,63 @@ void KServicePrivate::save(QDataStream& s)
       << categories << menuId << m_actions << m_serviceTypes;
 }
 
+K_GLOBAL_STATIC(QMutex, globalPropertiesMutex)
+
+const QMap<QString,QVariant>& KServicePrivate::properties() const
+{
+    QMutexLocker locker(globalPropertiesMutex);
+    if (!m_propsOffset) {
+        return m_mapProps;
+    }
+    const qint64 offset = m_propsOffset;
+    const KSycoca *database = m_propsDatabase;
+    const int generation = m_propsGeneration;
+    // stream() may have to open or even rebuild the database, which must not
+    // happen with the mutex held
+    locker.unlock();
+
+    KSycoca *sycoca = KSycoca::self();
+    QMap<QString,QVariant> props;
+    bool loaded = false;
+    if (database == sycoca && generation == KSycoca::generation()) {
+        // The stream belongs to this thread, no lock is needed to read it
+        QDataStream *str = sycoca->stream();
+        Q_ASSERT(str);
+        // opening the database in stream() closes the old one first
+        if (generation == KSycoca::generation()) {
+            str->device()->seek(offset);
+            *str >> props;
+            loaded = true;
+        }
+    }
+
+    if (!loaded) {
+        if (sycoca->isBuilding()) {
+            // kbuildsycoca has to load the properties of the entries it
+            // reuses before it replaces the database
+            kWarning(servicesDebugArea()) << "Properties of" << path << "were not loaded before rebuilding ksycoca";
+        } else {
+            // The entry was read by another thread or from a database that
+            // was closed since, the offset means nothing in the database of
+            // this thread. Take the properties of the entry it has now.
+            const KService::Ptr service = KServiceFactory::self()->findServiceByDesktopPath(path);
+            if (service) {
+                props = service->d_func()->properties();
+            } else {
+                kWarning(servicesDebugArea()) << "Properties of" << path << "are no longer in ksycoca";
+            }
+        }
+    }
+
+    locker.relock();
+    if (m_propsOffset) {
+        // another thread may have been faster
+        m_mapProps = props;
+        m_propsOffset = 0;
+    }
+    return m_mapProps;
+}
+
 ////
 
 KService::KService( const QString & _name, const QString &_exec, const QString &_icon)
@@ -520,8 +606,9 @@ QVariant KServicePrivate::property( const QString& _name, QVariant::Type t ) con
         }
     }
 
-    QMap<QString,QVariant>::ConstIterator it = m_mapProps.find( _name );
-    if ( (it == m_mapProps.end()) || (!it->isValid()))
+    const QMap<QString,QVariant>& props = properties();
+    QMap<QString,QVariant>::ConstIterator it = props.find( _name );
+    if ( (it == props.end()) || (!it->isValid()))
     {
         //kDebug(servicesDebugArea()) << "Property not found " << _name;
         return QVariant(); // No property set.
@@ -543,9 +630,7 @@ QStringList KServicePrivate::propertyNames() const
 {
     QStringList res;
 
-    QMap<QString,QVariant>::ConstIterator it = m_mapProps.begin();
-    for( ; it != m_mapProps.end(); ++it )
-        res.append( it.key() );
+    res = properties().keys();
 
     res.append( QString::fromLatin1("Type") );
     res.append( QString::fromLatin1("Name") );
@@ -633,16 +718,17 @@ bool KService::showInKDE() const
 {
     Q_D(const KService);
 
-    QMap<QString,QVariant>::ConstIterator it = d->m_mapProps.find( QString::fromLatin1("OnlyShowIn") );
-    if ( (it != d->m_mapProps.end()) && (it->isValid()))
+    const QMap<QString,QVariant>& props = d->properties();
+    QMap<QString,QVariant>::ConstIterator it = props.find( QString::fromLatin1("OnlyShowIn") );
+    if ( (it != props.end()) && (it->isValid()))
     {
         const QStringList aList = it->toString().split(QLatin1Char(';'));
         if (!aList.contains(QString::fromLatin1("KDE")))
             return false;
     }
 
-    it = d->m_mapProps.find( QString::fromLatin1("NotShowIn") );
-    if ( (it != d->m_mapProps.end()) && (it->isValid()))
+    it = props.find( QString::fromLatin1("NotShowIn") );
+    if ( (it != props.end()) && (it->isValid()))
     {
         const QStringList aList = it->toString().split(QLatin1Char(';'));
         if (aList.contains(QString::fromLatin1("KDE")))
@@ -663,8 +749,9 @@ bool KService::noDisplay() const {
 
 QString KService::parentApp() const {
     Q_D(const KService);
-    QMap<QString,QVariant>::ConstIterator it = d->m_mapProps.find(QLatin1String("X-KDE-ParentApp"));
-    if ( (it == d->m_mapProps.end()) || (!it->isValid()))
+    const QMap<QString,QVariant>& props = d->properties();
+    QMap<QString,QVariant>::ConstIterator it = props.find(QLatin1String("X-KDE-ParentApp"));
+    if ( (it == props.end()) || (!it->isValid()))
     {
         return QString();
     }
@@ -675,8 +762,9 @@ QString KService::parentApp() const {
 QString KService::pluginKeyword() const
 {
     Q_D(const KService);
-    QMap<QString,QVariant>::ConstIterator it = d->m_mapProps.find(QString::fromLatin1("X-KDE-PluginKeyword"));
-    if ((it == d->m_mapProps.end()) || (!it->isValid())) {
+    const QMap<QString,QVariant>& props = d->properties();
+    QMap<QString,QVariant>::ConstIterator it = props.find(QString::fromLatin1("X-KDE-PluginKeyword"));
+    if ((it == props.end()) || (!it->isValid())) {
         return QString();
     }
 
@@ -686,8 +774,9 @@ QString KService::pluginKeyword() const
 QString KService::docPath() const
 {
     Q_D(const KService);
-    QMap<QString,QVariant>::ConstIterator it = d->m_mapProps.find(QLatin1String("X-DocPath"));
-    if ((it == d->m_mapProps.end()) || (!it->isValid())) {
+    const QMap<QString,QVariant>& props = d->properties();
+    QMap<QString,QVariant>::ConstIterator it = props.find(QLatin1String("X-DocPath"));
+    if ((it == props.end()) || (!it->isValid())) {
         return QString();
     }
 
@@ -484,6 +484,7 @@ public:
 protected:
     friend class KMimeAssociations;
     friend class KBuildServiceFactory;
+    friend class KServicePrivate;
 
     /// @internal for KBuildSycoca only
     struct ServiceTypeAndPreference
@@ -26,17 +26,19 @@
 
 #include <ksycocaentry_p.h>
 
+class KSycoca;
+
 class KServicePrivate : public KSycocaEntryPrivate
 {
 public:
     K_SYCOCATYPE( KST_KService, KSycocaEntryPrivate )
 
     KServicePrivate(const QString &path)
-        : KSycocaEntryPrivate(path),  m_bValid(true)
+        : KSycocaEntryPrivate(path), m_propsOffset(0), m_propsDatabase(0), m_propsGeneration(0), m_bValid(true)
     {
     }
     KServicePrivate(QDataStream& _str, int _offset)
-        : KSycocaEntryPrivate(_str, _offset), m_bValid(true)
+        : KSycocaEntryPrivate(_str, _offset), m_propsOffset(0), m_propsDatabase(0), m_propsGeneration(0), m_bValid(true)
     {
         load(_str);
     }
@@ -71,6 +73,9 @@ public:
 
     QStringList serviceTypes() const;
 
+    // Returns m_mapProps, reading it from ksycoca first if it was not loaded yet
+    const QMap<QString,QVariant>& properties() const;
+
     QStringList categories;
     QString menuId;
     QString m_strType;
@@ -87,7 +92,13 @@ public:
     QVector<KService::ServiceTypeAndPreference> m_serviceTypes;
 
     QString m_strDesktopEntryName;
-    QMap<QString,QVariant> m_mapProps;
+    mutable QMap<QString,QVariant> m_mapProps;
+    // Position of m_mapProps in the ksycoca stream, 0 once it is loaded.
+    // The offset is only valid in the database of the thread that read the
+    // entry, and only as long as that database was not closed.
+    mutable qint64 m_propsOffset;
+    KSycoca *m_propsDatabase;
+    int m_propsGeneration;
     QStringList m_lstKeywords;
     QString m_strGenName;
     QList<KServiceAction> m_actions;
@@ -86,6 +86,25 @@ KServiceFactory * KServiceFactory::self()
     return kServiceFactoryInstance;
 }
 
+// enough for the queries issued by plugin-heavy applications at start-up
+static const int s_maxCachedQueries = 256;
+
+bool KServiceFactory::findCachedQuery( const QString &key, const QString &constraint, KService::List *result ) const
+{
+    QHash<QPair<QString, QString>, KService::List>::const_iterator it = m_queryCache.constFind(qMakePair(key, constraint));
+    if (it == m_queryCache.constEnd())
+        return false;
+    *result = it.value();
+    return true;
+}
+
+void KServiceFactory::cacheQuery( const QString &key, const QString &constraint, const KService::List &result )
+{
+    if (m_queryCache.size() >= s_maxCachedQueries)
+        m_queryCache.clear();
+    m_queryCache.insert(qMakePair(key, constraint), result);
+}
+
 KService::Ptr KServiceFactory::findServiceByName(const QString &_name)
 {
     if (!sycocaDict()) return KService::Ptr(); // Error!
@@ -25,6 +25,9 @@
 #include "ksycocafactory.h"
 #include <assert.h>
 
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+
 class KSycoca;
 class KSycocaDict;
 
@@ -103,6 +106,20 @@ public:
      */
     static KServiceFactory * self();
 
+    /**
+     * Looks up the result of a trader query run before with the same @p key
+     * (e.g. the service type) and @p constraint.
+     * The results are cached for as long as this factory lives, which is
+     * until the database changes.
+     * @return true if found, the services are then stored in @p result
+     */
+    bool findCachedQuery( const QString &key, const QString &constraint, KService::List *result ) const;
+
+    /**
+     * Caches the result of a trader query, see findCachedQuery()
+     */
+    void cacheQuery( const QString &key, const QString &constraint, const KService::List &result );
+
 protected:
     virtual KService * createEntry(int offset) const;
 
@@ -114,6 +131,9 @@ protected:
     int m_relNameDictOffset;
     KSycocaDict *m_menuIdDict;
     int m_menuIdDictOffset;
+
+private:
+    QHash<QPair<QString, QString>, KService::List> m_queryCache;
 };
 
 #endif
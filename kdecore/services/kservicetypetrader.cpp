@@ -52,10 +52,11 @@ void KServiceTypeTrader::applyConstraints( KService::List& lst,
     } else {
         // Find all services matching the constraint
         // and remove the other ones
+        KTraderParse::PropertyTypes types;
         KService::List::iterator it = lst.begin();
         while( it != lst.end() )
         {
-            if ( matchConstraint( pConstraintTree, (*it), lst ) != 1 )
+            if ( matchConstraint( pConstraintTree, (*it), lst, types ) != 1 )
                 it = lst.erase( it );
             else
                 ++it;
@@ -101,6 +102,10 @@ static KServiceOfferList weightedOffers( const QString& serviceType )
 KService::List KServiceTypeTrader::query( const QString& serviceType,
                                           const QString& constraint ) const
 {
+    KService::List lst;
+    if ( KServiceFactory::self()->findCachedQuery( serviceType, constraint, &lst ) )
+        return lst;
+
     KServiceType::Ptr servTypePtr = KServiceTypeFactory::self()->findServiceTypeByName( serviceType );
     if ( !servTypePtr ) {
         kWarning(7014) << "KServiceTypeTrader: serviceType " << serviceType << " not found";
@@ -109,10 +114,10 @@ KService::List KServiceTypeTrader::query( const QString& serviceType,
     if ( servTypePtr->serviceOffersOffset() == -1 )
         return KService::List();
 
-    KService::List lst =
-        KServiceFactory::self()->serviceOffers( servTypePtr->offset(), servTypePtr->serviceOffersOffset() );
+    lst = KServiceFactory::self()->serviceOffers( servTypePtr->offset(), servTypePtr->serviceOffersOffset() );
 
     applyConstraints( lst, constraint );
+    KServiceFactory::self()->cacheQuery( serviceType, constraint, lst );
 
     //kDebug(7014) << "query for serviceType " << serviceType << constraint
     //             << " : returning " << lst.count() << " offers";
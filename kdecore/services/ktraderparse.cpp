@@ -32,6 +32,8 @@ void KTraderParse_mainParse( const char *_code );
 #include <stdlib.h>
 #include <kdebug.h>
 
+#include <QtCore/QCache>
+
 namespace KTraderParse
 {
 
@@ -53,8 +55,20 @@ static int KTraderParseDeinit() {
 }
 Q_DESTRUCTOR_FUNCTION(KTraderParseDeinit);
 
+// The parse trees are never modified once built, applications tend to run
+// the same few queries over and over so they are kept around, parse errors
+// included (as null trees). The least recently used tree goes first when
+// the cache is full, each thread has its own cache that goes away with it.
+static const int s_maxParsedConstraints = 64;
+thread_local QCache<QString, ParseTreeBase::Ptr> s_parsedConstraints(s_maxParsedConstraints);
+
 ParseTreeBase::Ptr KTraderParse::parseConstraints( const QString& _constr )
 {
+    const ParseTreeBase::Ptr *cached = s_parsedConstraints.object(_constr);
+    if (cached) {
+        return *cached;
+    }
+
     if (s_parsingData) {
         s_parsingData->ptr.clear();
         delete s_parsingData;
@@ -63,6 +77,8 @@ ParseTreeBase::Ptr KTraderParse::parseConstraints( const QString& _constr )
     s_parsingData->buffer = _constr.toUtf8();
     KTraderParse_mainParse(s_parsingData->buffer.constData());
     ParseTreeBase::Ptr ret = s_parsingData->ptr;
+
+    s_parsedConstraints.insert(_constr, new ParseTreeBase::Ptr(ret));
     return ret;
 }
 
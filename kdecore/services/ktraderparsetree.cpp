@@ -18,6 +18,7 @@
 */
 
 #include "ktraderparsetree_p.h"
+#include "kservicetypefactory.h"
 
 namespace KTraderParse {
 
@@ -405,7 +406,7 @@ bool ParseTreeEXIST::eval( ParseContext *_context ) const
 {
   _context->type = ParseContext::T_BOOL;
 
-  QVariant prop = _context->service->property( m_id );
+  QVariant prop = _context->property( m_id );
   _context->b = prop.isValid();
 
   return true;
@@ -494,7 +495,7 @@ bool ParseTreeIN::eval( ParseContext *_context ) const
 
 bool ParseTreeID::eval( ParseContext *_context ) const
 {
-  QVariant prop = _context->service->property( m_str );
+  QVariant prop = _context->property( m_str );
   if ( !prop.isValid() )
     return false;
 
@@ -548,7 +549,7 @@ bool ParseTreeMIN2::eval( ParseContext *_context ) const
 {
   _context->type = ParseContext::T_DOUBLE;
 
-  QVariant prop = _context->service->property( m_strId );
+  QVariant prop = _context->property( m_strId );
   if ( !prop.isValid() )
     return false;
 
@@ -579,7 +580,7 @@ bool ParseTreeMAX2::eval( ParseContext *_context ) const
 {
   _context->type = ParseContext::T_DOUBLE;
 
-  QVariant prop = _context->service->property( m_strId );
+  QVariant prop = _context->property( m_strId );
   if ( !prop.isValid() )
     return false;
 
@@ -610,13 +611,20 @@ bool ParseTreeMAX2::eval( ParseContext *_context ) const
 
 int matchConstraint( const ParseTreeBase *_tree, const KService::Ptr &_service,
 		     const KService::List& _list )
+{
+  PropertyTypes types;
+  return matchConstraint( _tree, _service, _list, types );
+}
+
+int matchConstraint( const ParseTreeBase *_tree, const KService::Ptr &_service,
+		     const KService::List& _list, PropertyTypes& _types )
 {
   // Empty tree matches always
   if ( !_tree )
     return 1;
 
   QMap<QString,PreferencesMaxima> maxima;
-  ParseContext c( _service, _list, maxima );
+  ParseContext c( _service, _list, maxima, _types );
 
   // Error during evaluation ?
   if ( !_tree->eval( &c ) )
@@ -629,10 +637,23 @@ int matchConstraint( const ParseTreeBase *_tree, const KService::Ptr &_service,
   return ( c.b ? 1 : 0 );
 }
 
+QVariant ParseContext::property( const QString& _name ) const
+{
+  PropertyTypes::const_iterator it = propertyTypes.constFind( _name );
+  if ( it == propertyTypes.constEnd() )
+    it = propertyTypes.insert( _name, KServiceTypeFactory::self()->findPropertyTypeByName( _name ) );
+
+  // Unknown to the service types, may still be one of the standard properties
+  if ( it.value() == QVariant::Invalid )
+    return service->property( _name );
+
+  return service->property( _name, it.value() );
+}
+
 bool ParseContext::initMaxima( const QString& _prop )
 {
   // Is the property known ?
-  QVariant prop = service->property( _prop );
+  QVariant prop = property( _prop );
   if ( !prop.isValid() )
     return false;
 
@@ -657,7 +678,7 @@ bool ParseContext::initMaxima( const QString& _prop )
   KService::List::ConstIterator oit = offers.begin();
   for( ; oit != offers.end(); ++oit )
   {
-    QVariant p = (*oit)->property( _prop );
+    QVariant p = (*oit)->property( _prop, propertyTypes.value( _prop ) );
     if ( p.isValid() )
     {
       // Determine new maximum/minimum
@@ -685,9 +706,9 @@ bool ParseContext::initMaxima( const QString& _prop )
       // Correct existing extrema
       else if ( extrema.type == PreferencesMaxima::PM_DOUBLE )
       {
-	if ( p.toDouble() < it.value().fMin )
+	if ( p.toDouble() < extrema.fMin )
 	  extrema.fMin = p.toDouble();
-	if ( p.toDouble() > it.value().fMax )
+	if ( p.toDouble() > extrema.fMax )
 	  extrema.fMax = p.toDouble();
       }
     }
@@ -22,10 +22,19 @@
 
 #include <kservice.h>
 
+#include <QtCore/QHash>
+
 namespace KTraderParse {
 
 class ParseTreeBase;
 
+/**
+ * @internal
+ * The types of the properties used by a query, looked up in the service
+ * types once per query instead of once per service and property access.
+ */
+typedef QHash<QString, QVariant::Type> PropertyTypes;
+
 /**
  * @internal
  * @return 0  => Does not match
@@ -35,6 +44,14 @@ class ParseTreeBase;
 int matchConstraint( const ParseTreeBase *_tree, const KService::Ptr &,
                      const KService::List& );
 
+/**
+ * @internal
+ * Same as above, using and filling @p types for all the services matched
+ * against the same tree.
+ */
+int matchConstraint( const ParseTreeBase *_tree, const KService::Ptr &,
+                     const KService::List&, PropertyTypes& types );
+
 /**
  * @internal
  */
@@ -64,13 +81,19 @@ public:
    * This is NOT a copy constructor.
    */
   explicit ParseContext( const ParseContext* _ctx ) : service( _ctx->service ), maxima( _ctx->maxima ),
-    offers( _ctx->offers ) {}
+    offers( _ctx->offers ), propertyTypes( _ctx->propertyTypes ) {}
   ParseContext( const KService::Ptr & _service, const KService::List& _offers,
-		QMap<QString,PreferencesMaxima>& _m )
-    : service( _service ), maxima( _m ), offers( _offers ) {}
+		QMap<QString,PreferencesMaxima>& _m, PropertyTypes& _types )
+    : service( _service ), maxima( _m ), offers( _offers ), propertyTypes( _types ) {}
 
   bool initMaxima( const QString& _prop);
 
+  /**
+   * Same as service->property( _name ), with the type of the property
+   * resolved through propertyTypes.
+   */
+  QVariant property( const QString& _name ) const;
+
   enum Type { T_STRING = 1, T_DOUBLE = 2, T_NUM = 3, T_BOOL = 4,
 	      T_STR_SEQ = 5, T_SEQ = 6 };
 
@@ -86,6 +109,7 @@ public:
 
   QMap<QString,PreferencesMaxima>& maxima;
   const KService::List& offers;
+  PropertyTypes& propertyTypes;
 };
 
 /**
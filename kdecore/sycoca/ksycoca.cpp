@@ -34,6 +34,7 @@
 #include <QtCore/QFile>
 #include <QtCore/QBuffer>
 #include <QProcess>
+#include <QAtomicInt>
 #include <QtDBus/QtDBus>
 #include <QtCore/qthread.h>
 
@@ -45,6 +46,7 @@
 #include "ksycocadevices_p.h"
 
 static bool s_autoRebuild = true;
+static QAtomicInt s_generation(0);
 
 // The following limitations are in place:
 // Maximum length of a single string: 8192 bytes
@@ -246,6 +248,7 @@ void KSycocaPrivate::closeDatabase()
 
     databaseStatus = DatabaseNotOpen;
     timeStamp = 0;
+    s_generation.fetchAndAddOrdered(1);
 }
 
 void KSycoca::addFactory(KSycocaFactory *factory)
@@ -432,6 +435,11 @@ quint32 KSycoca::updateSignature()
     return d->updateSig;
 }
 
+int KSycoca::generation()
+{
+    return s_generation.load();
+}
+
 QString KSycoca::absoluteFilePath(DatabaseType type)
 {
     if (type == GlobalDatabase) {
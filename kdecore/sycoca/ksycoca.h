@@ -128,6 +128,15 @@ public:
     */
    quint32 updateSignature();
 
+   /**
+    * @internal - returns a number that changes whenever a database is closed
+    *
+    * Entries that read parts of the database on demand compare it with
+    * the value at creation time to know if their offsets are still valid.
+    * @since 4.24
+    */
+   static int generation();
+
    /**
     * @internal - returns all directories with information
     * stored inside sycoca.
@@ -31,7 +31,7 @@
  * If the existing file is outdated, it will not get read
  * but instead we'll ask kded to regenerate a new one...
  */
-#define KSYCOCA_VERSION 245
+#define KSYCOCA_VERSION 246
 
 /**
  * Sycoca file name, used internally (by kbuildsycoca)
@@ -1575,6 +1575,56 @@ void KConfigTest::testNoKdeHome()
     KTempDir::removeDir(kdeHome);
 }
 
+void KConfigTest::testAsyncSync()
+{
+    const QString file = KStandardDirs::locateLocal("config", "kconfigtest_async");
+    QFile::remove(file);
+
+    {
+        KConfig sc("kconfigtest_async", KConfig::SimpleConfig|KConfig::AsyncSync);
+        KConfigGroup cg(&sc, "Async");
+        cg.writeEntry("first", "1");
+        sc.sync();
+        QVERIFY(!sc.isDirty());
+        cg.writeEntry("second", "2");
+        sc.sync();
+        cg.writeEntry("first", "one");
+        sc.sync();
+
+        // the pending changes are merged and written in one go
+        QVERIFY(KConfig::flushScheduledSyncs());
+        QVERIFY(QFile::exists(file));
+
+        KConfig check("kconfigtest_async", KConfig::SimpleConfig);
+        KConfigGroup checkGroup(&check, "Async");
+        QCOMPARE(checkGroup.readEntry("first"), QString("one"));
+        QCOMPARE(checkGroup.readEntry("second"), QString("2"));
+
+        // changes that are not flushed explicitly are written on destruction
+        cg.writeEntry("third", "3");
+        sc.sync();
+    }
+
+    KConfig check("kconfigtest_async", KConfig::SimpleConfig);
+    QCOMPARE(check.group("Async").readEntry("third"), QString("3"));
+    QFile::remove(file);
+
+    // changes that could not be written keep the configuration dirty, a file
+    // is in the way of the directory
+    const QString blocker = KStandardDirs::locateLocal("config", "kconfigtest_async_blocker");
+    QFile blockerFile(blocker);
+    QVERIFY(blockerFile.open(QIODevice::WriteOnly));
+    blockerFile.close();
+    {
+        KConfig sc("kconfigtest_async_blocker/rc", KConfig::SimpleConfig|KConfig::AsyncSync);
+        sc.group("Async").writeEntry("first", "1");
+        sc.sync();
+        QVERIFY(KConfig::flushScheduledSyncs());
+        QVERIFY(sc.isDirty());
+    }
+    QFile::remove(blocker);
+}
+
 // To find multithreading bugs: valgrind --tool=helgrind --track-lockorders=no ./kconfigtest testThreads
 void KConfigTest::testThreads()
 {
@@ -74,6 +74,7 @@ private Q_SLOTS:
     void testLocaleConfig();
     void testDirtyAfterRevert();
     void testKdeGlobals();
+    void testAsyncSync();
     void testNoKdeHome();
 
     void testThreads();
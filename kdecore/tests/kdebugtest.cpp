@@ -63,6 +63,7 @@ private Q_SLOTS:
     void output();
 
     void to_file();
+    void to_file_rotation();
     void different_output_type();
 };
 
@@ -121,6 +122,7 @@ void KDebugTest::to_file()
     setupArea(s_areaname, 0, s_areafilename);
 
     testArea(s_areanumber);
+    QVERIFY(kFlushDebug());
 
     QFile areafile(s_areafilename);
     QVERIFY(areafile.open(QFile::ReadOnly));
@@ -131,6 +133,34 @@ void KDebugTest::to_file()
     QCOMPARE(areafilelines.size(), 4);
 }
 
+void KDebugTest::to_file_rotation()
+{
+    const QString rotatedfilename = s_areafilename + QLatin1String(".1");
+    QFile::remove(rotatedfilename);
+    {
+        KConfig kconfig(QString::fromLatin1("kdebugrc"), KConfig::NoGlobals);
+        KConfigGroup kconfiggroup = kconfig.group(QString());
+        kconfiggroup.writeEntry("MaxFileSize", 100);
+    }
+    setupArea(s_areaname, 0, s_areafilename);
+
+    // messages written in one go are not split between files
+    for (int i = 0; i < 10; i++) {
+        testArea(s_areanumber);
+        QVERIFY(kFlushDebug());
+    }
+
+    QVERIFY(QFile::exists(rotatedfilename));
+
+    {
+        KConfig kconfig(QString::fromLatin1("kdebugrc"), KConfig::NoGlobals);
+        KConfigGroup kconfiggroup = kconfig.group(QString());
+        kconfiggroup.deleteEntry("MaxFileSize");
+    }
+    kClearDebugConfig();
+    QFile::remove(rotatedfilename);
+}
+
 void KDebugTest::different_output_type()
 {
     QFile::remove(s_areafilename);
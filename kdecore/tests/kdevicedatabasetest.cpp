@@ -35,6 +35,10 @@ void KDeviceDatabaseTest::testPCI()
     }
 
     QCOMPARE(m_devicedb.lookupPCIVendor("0001"), QLatin1String("SafeNet (wrong ID)"));
+    QCOMPARE(m_devicedb.lookupPCIVendor("0x0001"), QLatin1String("SafeNet (wrong ID)"));
+    QCOMPARE(m_devicedb.lookupPCIVendor("1"), QLatin1String("SafeNet (wrong ID)"));
+    QCOMPARE(m_devicedb.lookupPCIVendor("zzzz"), QString());
+    QCOMPARE(m_devicedb.lookupPCIVendor("123456"), QString());
     QCOMPARE(m_devicedb.lookupPCIDevice("0010", "8139"), QLatin1String("AT-2500TX V3 Ethernet"));
     QCOMPARE(m_devicedb.lookupPCIClass("00"), QLatin1String("Unclassified device"));
     QCOMPARE(m_devicedb.lookupPCISubClass("00", "00"), QLatin1String("Non-VGA unclassified device"));
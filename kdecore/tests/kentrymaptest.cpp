@@ -201,3 +201,63 @@ void KEntryMapTest::testLocale()
     map.setEntry(group1, key1, translated, EntryLocalized); // set the translated entry to a different locale
     QCOMPARE(map.findEntry(group1, key1, SearchLocalized)->mValue, translated);
 }
+
+void KEntryMapTest::testGroups()
+{
+    KEntryMap map;
+    map.setEntry("B", key1, value1, EntryOptions());
+    map.setEntry("A\x1dSub", key1, value1, EntryOptions());
+    map.setEntry("A", key1, value1, EntryOptions());
+    map.setEntry("A", key2, value2, EntryOptions());
+    map.setEntry("AB", key1, value1, EntryOptions());
+
+    QList<QByteArray> groups;
+    for (KEntryMapConstIterator it = map.constBegin(); it != map.constEnd(); it = map.nextGroup(it))
+        groups << it.key().mGroup;
+    QCOMPARE(groups, QList<QByteArray>() << "A" << "A\x1dSub" << "AB" << "B");
+
+    KEntryMapConstIterator it = map.lowerBoundGroup("A\x1d");
+    QCOMPARE(it.key().mGroup, QByteArray("A\x1dSub"));
+    QVERIFY(it.key().mKey.isNull());
+    QVERIFY(map.lowerBoundGroup("C") == map.constEnd());
+    QVERIFY(map.nextGroup(map.constEnd()) == map.constEnd());
+
+    // all the entries of a group share the group name of its marker
+    const QByteArray group("A");
+    const char *groupData = map.findEntry(group).key().mGroup.constData();
+    QVERIFY(map.findEntry(group, key1).key().mGroup.constData() == groupData);
+    QVERIFY(map.findEntry(group, key2).key().mGroup.constData() == groupData);
+}
+
+// A config the size of a large shortcut scheme or session file
+static void fillMap(KEntryMap &map)
+{
+    for (int g = 0; g < 200; ++g) {
+        const QByteArray group = "Group " + QByteArray::number(g);
+        for (int k = 0; k < 50; ++k) {
+            map.setEntry(group, "Key " + QByteArray::number(k), value1, KEntryMap::EntryOptions());
+        }
+    }
+}
+
+void KEntryMapTest::benchmarkSetEntry()
+{
+    QBENCHMARK {
+        KEntryMap map;
+        fillMap(map);
+    }
+}
+
+void KEntryMapTest::benchmarkGroupList()
+{
+    KEntryMap map;
+    fillMap(map);
+
+    int count = 0;
+    QBENCHMARK {
+        count = 0;
+        for (KEntryMapConstIterator it = map.constBegin(); it != map.constEnd(); it = map.nextGroup(it))
+            ++count;
+    }
+    QCOMPARE(count, 200);
+}
@@ -52,6 +52,9 @@ private Q_SLOTS:
     void testGlobal();
     void testImmutable();
     void testLocale();
+    void testGroups();
+    void benchmarkSetEntry();
+    void benchmarkGroupList();
 };
 
 #endif // KENTRYMAPTEST_H
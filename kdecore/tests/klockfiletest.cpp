@@ -21,13 +21,13 @@
 
 #include <kdebug.h>
 
+#include <QElapsedTimer>
 #include <QProcess>
 #include <QTextStream>
+#include <QThread>
 
 #include <unistd.h>
 
-// TODO test locking from two different threads
-
 static const QString lockName = "klockfiletest";
 static const char *const lockNameFull = "klockfiletest.klockfile";
 
@@ -73,4 +73,95 @@ void Test_KLockFile::testUnlock()
     QVERIFY(!lockFile->isLocked());
 }
 
+void Test_KLockFile::testSharedLock()
+{
+    KLockFile shared1(lockName);
+    KLockFile shared2(lockName);
+    QVERIFY(shared1.tryLock(KLockFile::SharedLock));
+    QVERIFY(shared2.tryLock(KLockFile::SharedLock));
+
+    // Exclusive locks have to wait for all shared ones
+    QVERIFY(!lockFile->tryLock());
+    shared1.unlock();
+    QVERIFY(!lockFile->tryLock());
+    shared2.unlock();
+    QVERIFY(lockFile->tryLock());
+
+    // and the other way around
+    QVERIFY(!shared1.tryLock(KLockFile::SharedLock));
+    lockFile->unlock();
+    QVERIFY(shared1.tryLock(KLockFile::SharedLock));
+    shared1.unlock();
+}
+
+void Test_KLockFile::testTimeout()
+{
+    QVERIFY(lockFile->lock(KLockFile::ExclusiveLock));
+
+    KLockFile lockFile2(lockName);
+    const int contentions = KLockFile::contentionCount();
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(!lockFile2.lock(KLockFile::ExclusiveLock, 200));
+    QVERIFY(timer.elapsed() >= 200);
+    QVERIFY(!lockFile2.isLocked());
+    QCOMPARE(KLockFile::contentionCount(), contentions + 1);
+
+    lockFile->unlock();
+    QVERIFY(lockFile2.lock(KLockFile::ExclusiveLock, 200));
+    lockFile2.unlock();
+}
+
+class LockThread : public QThread
+{
+public:
+    LockThread(int count) : m_count(count) {}
+
+protected:
+    void run() final
+    {
+        KLockFile lockFile(lockName);
+        for (int i = 0; i < m_count; ++i) {
+            lockFile.lock();
+            lockFile.unlock();
+        }
+    }
+
+private:
+    int m_count;
+};
+
+void Test_KLockFile::benchmarkContention_data()
+{
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("4 threads") << 4;
+    QTest::newRow("16 threads") << 16;
+}
+
+void Test_KLockFile::benchmarkContention()
+{
+    QFETCH(int, threads);
+
+    const int contentions = KLockFile::contentionCount();
+    QBENCHMARK {
+        QList<LockThread*> lockThreads;
+        for (int i = 0; i < threads; ++i) {
+            lockThreads.append(new LockThread(100));
+        }
+        foreach (LockThread *lockThread, lockThreads) {
+            lockThread->start();
+        }
+        foreach (LockThread *lockThread, lockThreads) {
+            lockThread->wait();
+        }
+        qDeleteAll(lockThreads);
+    }
+    // a single thread never has to wait for the lock
+    if (threads == 1) {
+        QCOMPARE(KLockFile::contentionCount(), contentions);
+    }
+}
+
 QTEST_KDEMAIN_CORE(Test_KLockFile)
@@ -32,6 +32,10 @@ private Q_SLOTS:
     void cleanupTestCase();
     void testLock();
     void testUnlock();
+    void testSharedLock();
+    void testTimeout();
+    void benchmarkContention_data();
+    void benchmarkContention();
 };
 
 #endif // KLOCKFILETEST_H
@@ -23,6 +23,7 @@
 #include "kmountpoint.h"
 #include <kdebug.h>
 #include <kde_file.h>
+#include <QDir>
 #include <sys/stat.h>
 
 QTEST_KDEMAIN_CORE( KMountPointTest )
@@ -129,3 +130,59 @@ void KMountPointTest::testPossibleMountPoints()
 #endif
 }
 
+void KMountPointTest::testCurrentMountPoint_data()
+{
+    QTest::addColumn<QString>("path");
+
+    QTest::newRow("root") << "/";
+    QTest::newRow("home") << "/home";
+    QTest::newRow("proc") << "/proc/self";
+    QTest::newRow("trailing slash") << "/tmp/";
+    QTest::newRow("current dir") << QDir::currentPath();
+    QTest::newRow("does not exist") << "/I/Dont/Exist"; // krazy:exclude=spelling
+}
+
+void KMountPointTest::testCurrentMountPoint()
+{
+    QFETCH(QString, path);
+
+    const KMountPoint::List mountPoints = KMountPoint::currentMountPoints();
+    if (mountPoints.isEmpty()) { // can happen in chroot jails
+        QSKIP("mtab is empty", SkipAll);
+        return;
+    }
+
+    const KMountPoint::Ptr expected = mountPoints.findByPath(path);
+    const KMountPoint::Ptr mountPoint = KMountPoint::currentMountPoint(path);
+    QCOMPARE(bool(mountPoint), bool(expected));
+    if (expected) {
+        QCOMPARE(mountPoint->mountPoint(), expected->mountPoint());
+        QCOMPARE(mountPoint->mountedFrom(), expected->mountedFrom());
+    }
+}
+
+void KMountPointTest::benchmarkCurrentMountPoint_data()
+{
+    QTest::addColumn<bool>("lookup");
+
+    QTest::newRow("findByPath") << false;
+    QTest::newRow("currentMountPoint") << true;
+}
+
+void KMountPointTest::benchmarkCurrentMountPoint()
+{
+    QFETCH(bool, lookup);
+
+    const QString path = QDir::currentPath();
+    KMountPoint::Ptr mountPoint;
+    if (lookup) {
+        QBENCHMARK {
+            mountPoint = KMountPoint::currentMountPoint(path);
+        }
+    } else {
+        QBENCHMARK {
+            mountPoint = KMountPoint::currentMountPoints().findByPath(path);
+        }
+    }
+    QVERIFY(mountPoint || KMountPoint::currentMountPoints().isEmpty());
+}
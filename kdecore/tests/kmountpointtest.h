@@ -28,6 +28,10 @@ private Q_SLOTS:
 
     void testCurrentMountPoints();
     void testPossibleMountPoints();
+    void testCurrentMountPoint_data();
+    void testCurrentMountPoint();
+    void benchmarkCurrentMountPoint_data();
+    void benchmarkCurrentMountPoint();
 
 private:
 };
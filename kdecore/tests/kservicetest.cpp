@@ -254,6 +254,35 @@ void KServiceTest::testByStorageId()
     QCOMPARE(KService::serviceByDesktopName("kmailservice")->menuId(), QString("kde4-kmailservice.desktop"));
 }
 
+void KServiceTest::benchmarkAllServices_data()
+{
+    QTest::addColumn<bool>("readProperties");
+
+    // properties are only read from ksycoca when they are needed
+    QTest::newRow("entries only") << false;
+    QTest::newRow("entries and properties") << true;
+}
+
+void KServiceTest::benchmarkAllServices()
+{
+    if ( !KSycoca::isAvailable() )
+        QSKIP( "ksycoca not available", SkipAll );
+
+    QFETCH(bool, readProperties);
+
+    int propertyCount = 0;
+    QBENCHMARK {
+        const KService::List list = KService::allServices();
+        QVERIFY(!list.isEmpty());
+        if (readProperties) {
+            foreach (const KService::Ptr& service, list) {
+                propertyCount += service->propertyNames().count();
+            }
+        }
+    }
+    QCOMPARE(propertyCount > 0, readProperties);
+}
+
 void KServiceTest::testServiceTypeTraderForReadOnlyPart()
 {
     if ( !KSycoca::isAvailable() )
@@ -314,6 +343,42 @@ void KServiceTest::testTraderConstraints()
     QVERIFY(offers.isEmpty());
 }
 
+void KServiceTest::benchmarkTraderQuery_data()
+{
+    QTest::addColumn<QString>("constraint");
+    QTest::addColumn<bool>("repeated");
+
+    const QString constraint = "([X-KDE-Version] > 4.559) and (Library == 'faketextplugin' or exist Library)";
+    // what plugin-heavy applications do at start-up
+    QTest::newRow("repeated query") << constraint << true;
+    // evaluation of the constraint against all the offers
+    QTest::newRow("constraint evaluation") << constraint << false;
+}
+
+void KServiceTest::benchmarkTraderQuery()
+{
+    if ( !KSycoca::isAvailable() )
+        QSKIP( "ksycoca not available", SkipAll );
+
+    QFETCH(QString, constraint);
+    QFETCH(bool, repeated);
+
+    const KService::List all = KServiceTypeTrader::self()->query("KTextEditor/Plugin");
+    QVERIFY(!all.isEmpty());
+    KService::List offers;
+    if (repeated) {
+        QBENCHMARK {
+            offers = KServiceTypeTrader::self()->query("KTextEditor/Plugin", constraint);
+        }
+    } else {
+        QBENCHMARK {
+            offers = all;
+            KServiceTypeTrader::applyConstraints(offers, constraint);
+        }
+    }
+    QCOMPARE(offers.count(), KServiceTypeTrader::self()->query("KTextEditor/Plugin", constraint).count());
+}
+
 void KServiceTest::testHasServiceType1() // with services constructed with a full path (rare)
 {
     QString fakepartPath = KStandardDirs::locate( "services", "fakepart.desktop" );
@@ -433,6 +498,30 @@ void KServiceTest::testKSycocaUpdate()
     QVERIFY(m_resourcesUpdated.contains("services"));
 }
 
+void KServiceTest::benchmarkBuildSycoca_data()
+{
+    QTest::addColumn<QStringList>("args");
+
+    QTest::newRow("sequential") << (QStringList() << "--noincremental" << "--nosignal" << "--noparallel");
+    QTest::newRow("parallel") << (QStringList() << "--noincremental" << "--nosignal");
+}
+
+void KServiceTest::benchmarkBuildSycoca()
+{
+    QFETCH(QStringList, args);
+
+    const QString kbuildsycoca = KStandardDirs::findExe(KBUILDSYCOCA_EXENAME);
+    QVERIFY(!kbuildsycoca.isEmpty());
+    // every run rebuilds the database from scratch
+    QBENCHMARK_ONCE {
+        QProcess proc;
+        proc.setProcessChannelMode(QProcess::MergedChannels); // silence kbuildsycoca output
+        proc.start(kbuildsycoca, args);
+        QVERIFY(proc.waitForFinished(60000));
+        QCOMPARE(proc.exitCode(), 0);
+    }
+}
+
 void KServiceTest::createFakeService()
 {
     const QString fakeService = KStandardDirs::locateLocal("services", "fakeservice.desktop");
@@ -33,14 +33,20 @@ private Q_SLOTS:
     void testProperty();
     void testAllServiceTypes();
     void testAllServices();
+    void benchmarkAllServices_data();
+    void benchmarkAllServices();
     void testServiceTypeTraderForReadOnlyPart();
     void testTraderConstraints();
+    void benchmarkTraderQuery_data();
+    void benchmarkTraderQuery();
     void testHasServiceType1();
     void testHasServiceType2();
     void testByStorageId();
     void testActionsAndDataStream();
     void testServiceGroups();
     void testKSycocaUpdate();
+    void benchmarkBuildSycoca_data();
+    void benchmarkBuildSycoca();
     void testReaderThreads();
     void testThreads();
 
@@ -141,6 +141,115 @@ void KStringHandlerTest::naturalCompare()
     QCOMPARE(KStringHandler::naturalCompare("abc.jpg", "abc_a.jpg", Qt::CaseInsensitive), -1);
 }
 
+void KStringHandlerTest::naturalSortKey_data()
+{
+    QTest::addColumn<QString>("a");
+    QTest::addColumn<QString>("b");
+    QTest::addColumn<int>("caseSensitivity");
+
+    const char* const pairs[][2] = {
+        { "a", "b" },
+        { "a", "a" },
+        { "1", "2" },
+        { "1", "10" },
+        { "9", "10" },
+        { "1", "100" },
+        { "1a", "2a" },
+        { "1b", "1a" },
+        { "a9", "a10" },
+        { "a1a1", "a1a10" },
+        { "a1a1", "a10a1" },
+        { "Test 9.gif", "Test 10.gif" },
+        { "cmake_2.4.6", "cmake_2.4.10" },
+        { "cmake_2.4.6", "cmake_2.5.6" },
+        { "A-123.txt", "A-a.txt" },
+        { "A-012.txt", "A-a.txt" },
+        { "E & G", "E & J" },
+        { "E & S", "Em & M" },
+        { "text", "text.txt" },
+        { "text.txt", "text1" },
+        { "text1", "text1.txt" },
+        { "A B", "A.B" },
+        { "1", "a" },
+        { "a", "v01 1" },
+        { "v01 1", "v01 a" },
+        { "sysvinit-2.86-i486-6.txz", "sysvinit-2.86-i486-6.txz.asc" },
+        { "sysvinit-2.86-i486-6.txz.asc", "sysvinit-functions-8.53-i486-2.txt" },
+        { "abc.jpg", "abc1.jpg" },
+        { "abc1.jpg", "abc01.jpg" },
+        { "file.05", "file.5" },
+        { "file.005", "file.05" },
+        { "file.00", "file.0" },
+        { "file.05", "file." },
+        { "file.", "file.5" },
+        { "aaa", "AAA" },
+        { "aAa", "AaA" }
+    };
+    for (uint i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        const QString a = QString::fromLatin1(pairs[i][0]);
+        const QString b = QString::fromLatin1(pairs[i][1]);
+        QTest::newRow(QString(a + " < " + b).toLatin1().constData()) << a << b << int(Qt::CaseSensitive);
+        QTest::newRow(QString(b + " > " + a).toLatin1().constData()) << b << a << int(Qt::CaseSensitive);
+        QTest::newRow(QString(a + " <i " + b).toLatin1().constData()) << a << b << int(Qt::CaseInsensitive);
+    }
+    QTest::newRow("replacement") << QString(QChar(QChar::ReplacementCharacter)) << QString::fromLatin1("z") << int(Qt::CaseSensitive);
+}
+
+static int sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+void KStringHandlerTest::naturalSortKey()
+{
+    QFETCH(QString, a);
+    QFETCH(QString, b);
+    QFETCH(int, caseSensitivity);
+
+    const Qt::CaseSensitivity cs = static_cast<Qt::CaseSensitivity>(caseSensitivity);
+    const QByteArray keyA = KStringHandler::naturalSortKey(a, cs);
+    const QByteArray keyB = KStringHandler::naturalSortKey(b, cs);
+    QCOMPARE(sign(qstrcmp(keyA, keyB)), sign(KStringHandler::naturalCompare(a, b, cs)));
+    QCOMPARE(keyA, KStringHandler::naturalSortKey(a, cs));
+}
+
+static bool naturalLessThan(const QString &a, const QString &b)
+{
+    return KStringHandler::naturalCompare(a, b, Qt::CaseInsensitive) < 0;
+}
+
+void KStringHandlerTest::naturalSortKeyBenchmark_data()
+{
+    QTest::addColumn<bool>("useKeys");
+
+    QTest::newRow("naturalCompare") << false;
+    QTest::newRow("naturalSortKey") << true;
+}
+
+void KStringHandlerTest::naturalSortKeyBenchmark()
+{
+    QFETCH(bool, useKeys);
+
+    QStringList names;
+    for (int i = 0; i < 20000; i++) {
+        names.append(QString::fromLatin1("IMG_%1 - Holiday %2.jpg").arg((i * 7919) % 20000).arg(i % 13));
+    }
+
+    QBENCHMARK {
+        if (useKeys) {
+            QList<QPair<QByteArray, int> > keys;
+            keys.reserve(names.size());
+            for (int i = 0; i < names.size(); i++) {
+                keys.append(qMakePair(KStringHandler::naturalSortKey(names.at(i), Qt::CaseInsensitive), i));
+            }
+            qSort(keys);
+        } else {
+            QStringList sorted = names;
+            qSort(sorted.begin(), sorted.end(), naturalLessThan);
+        }
+    }
+}
+
 void KStringHandlerTest::preProcessWrap_data()
 {
     const QChar zwsp(0x200b);
@@ -12,6 +12,10 @@ private Q_SLOTS:
     void tagURLs();
     void perlSplit();
     void naturalCompare();
+    void naturalSortKey_data();
+    void naturalSortKey();
+    void naturalSortKeyBenchmark_data();
+    void naturalSortKeyBenchmark();
     void preProcessWrap_data();
     void preProcessWrap();
 
@@ -26,6 +26,9 @@
 #include <QtCore/QRegExp>            // for the word ranges
 #include <QtCore/qstring.h>
 #include <QtCore/qstringlist.h>
+#include <QtCore/QVarLengthArray>
+
+#include <string.h>
 
 //
 // Capitalization routines
@@ -327,6 +330,113 @@ int KStringHandler::naturalCompare(const QString &_a, const QString &_b, Qt::Cas
     return currA->isNull() ? -1 : + 1;
 }
 
+// The natural sort key consists of the same pieces naturalCompare() compares: a sequence of
+// characters, followed by punctuation, spaces and digits. The pieces are encoded so that the
+// keys compare byte-wise the way naturalCompare() compares the pieces:
+// - the characters are the strxfrm() collation key which orders like strcoll(), with 0x01
+//   escaped as 0x01 0x02 and terminated with 0x01 0x01 so that shorter sequences come first
+// - punctuation and space are a separator with their UTF-16 code unit
+// - digit sequences starting with 0 are a separator with the code unit 0 followed by the left
+//   aligned digits, terminated with a byte greater than any digit because naturalCompare()
+//   orders the shorter sequence last
+// - other digit sequences are a separator with the code unit of '0', the count of the digits
+//   and the digits, that orders them against punctuation like naturalCompare() does
+// - a string ending with punctuation or space is ordered after a digit sequence starting
+//   with 0 and before anything else
+enum KNaturalSortKeyPiece {
+    NaturalSortKeyEscape = 0x01,
+    NaturalSortKeySeparator = 0x10,
+    NaturalSortKeyCharacters = 0x7F,
+    NaturalSortKeyFractionEnd = 0x7F,
+    NaturalSortKeyReplacement = 0xFF
+};
+
+static void appendCollationKey(QByteArray &key, const QStringRef &characters)
+{
+    key.append(char(NaturalSortKeyCharacters));
+    if (!characters.isEmpty()) {
+        const QByteArray local = characters.toString().toLocal8Bit();
+        const size_t collationsize = ::strxfrm(nullptr, local.constData(), 0);
+        QVarLengthArray<char, 256> collation(collationsize + 1);
+        ::strxfrm(collation.data(), local.constData(), collationsize + 1);
+        for (size_t i = 0; i < collationsize; i++) {
+            const char c = collation[i];
+            key.append(c);
+            if (c == char(NaturalSortKeyEscape)) {
+                key.append(char(0x02));
+            }
+        }
+    }
+    key.append(char(NaturalSortKeyEscape));
+    key.append(char(NaturalSortKeyEscape));
+}
+
+static void appendSeparator(QByteArray &key, const ushort unicode)
+{
+    key.append(char(NaturalSortKeySeparator));
+    key.append(char(unicode >> 8));
+    key.append(char(unicode & 0xFF));
+}
+
+QByteArray KStringHandler::naturalSortKey(const QString &_string, Qt::CaseSensitivity caseSensitivity)
+{
+    const QString string = (caseSensitivity == Qt::CaseSensitive ? _string : _string.toLower());
+
+    QByteArray key;
+    key.reserve(string.size() * 3);
+    const QChar* curr = string.unicode();
+    const QChar* end = curr + string.size();
+    while (curr != end) {
+        if (curr->unicode() == QChar::ObjectReplacementCharacter
+            || curr->unicode() == QChar::ReplacementCharacter) {
+            // naturalCompare() orders these after anything else
+            key.append(char(NaturalSortKeyReplacement));
+            break;
+        }
+
+        const QChar* begin = curr;
+        while (curr != end && !curr->isDigit() && !curr->isPunct() && !curr->isSpace()) {
+            ++curr;
+        }
+        appendCollationKey(key, string.midRef(begin - string.unicode(), curr - begin));
+
+        begin = curr;
+        while (curr != end && (curr->isPunct() || curr->isSpace())) {
+            appendSeparator(key, curr->unicode());
+            ++curr;
+        }
+        if (curr == end && curr != begin) {
+            appendSeparator(key, 0x0001);
+            break;
+        }
+
+        if (curr != end && curr->isDigit()) {
+            begin = curr;
+            while (curr != end && curr->isDigit()) {
+                ++curr;
+            }
+            if (begin->digitValue() == 0) {
+                appendSeparator(key, 0x0000);
+                for (const QChar* digit = begin; digit != curr; ++digit) {
+                    key.append(char('0' + digit->digitValue()));
+                }
+                key.append(char(NaturalSortKeyFractionEnd));
+            } else {
+                const int digits = (curr - begin);
+                appendSeparator(key, QLatin1Char('0').unicode());
+                key.append(char((digits >> 24) & 0xFF));
+                key.append(char((digits >> 16) & 0xFF));
+                key.append(char((digits >> 8) & 0xFF));
+                key.append(char(digits & 0xFF));
+                for (const QChar* digit = begin; digit != curr; ++digit) {
+                    key.append(char('0' + digit->digitValue()));
+                }
+            }
+        }
+    }
+    return key;
+}
+
 QString KStringHandler::preProcessWrap(const QString &text)
 {
     const QChar zwsp(0x200b);
@@ -178,6 +178,22 @@ namespace KStringHandler
      */
     KDECORE_EXPORT int naturalCompare(const QString &a, const QString &b, Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive);
 
+    /**
+      Returns a key for natural sorting of the string. Comparing the keys of two strings
+      byte-wise (e.g. with the less-than operator of QByteArray) orders them the same way as
+      naturalCompare() does. The digits are normalized and the locale collation key of the text
+      is computed once, which makes sorting many strings much faster than calling
+      naturalCompare() for every comparison.
+
+      The keys depend on the collation locale of the process, they must not be stored.
+
+      @param string the string to compute the key for
+      @param caseSensitivity whether the key is for case sensitive compare or not
+
+      @since 4.24
+     */
+    KDECORE_EXPORT QByteArray naturalSortKey(const QString &string, Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive);
+
     /**
       Preprocesses the given string in order to provide additional line breaking
       opportunities for QTextLayout.
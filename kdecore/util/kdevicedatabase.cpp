@@ -18,9 +18,47 @@
 
 #include "kdevicedatabase.h"
 #include "kstandarddirs.h"
+#include "ksavefile.h"
+#include "kde_file.h"
 #include "kdebug.h"
 
 #include <QFile>
+#include <QMap>
+
+#include <algorithm>
+
+// the IDs files are compiled into a binary file placed in the cache directory, it consists of a
+// header, sorted tables of fixed-size records and pool of null-terminated strings. The file is
+// mapped so that the pages are shared between processes and nothing is parsed on lookup
+#define KDEVICEDATABASE_MAGIC "KDDB"
+#define KDEVICEDATABASE_VERSION 1
+
+enum KDeviceTable {
+    VendorsTable = 0,
+    DevicesTable = 1,
+    ClassesTable = 2,
+    SubClassesTable = 3,
+    ProtocolsTable = 4,
+    TablesCount = 5
+};
+
+struct KDeviceDatabaseHeader
+{
+    char magic[4];
+    quint32 version;
+    quint64 sourcestamp;
+    quint32 tableoffsets[TablesCount];
+    quint32 tablesizes[TablesCount];
+};
+
+struct KDeviceDatabaseRecord
+{
+    quint32 key;
+    quint32 stringoffset;
+
+    bool operator<(const quint32 other) const
+        { return key < other; }
+};
 
 struct KDeviceEntry
 {
@@ -69,6 +107,17 @@ static inline QByteArray normalizeID(const QByteArray &id, const int padding)
     return result;
 }
 
+static inline bool parseID(const QByteArray &id, const int padding, quint32 *result)
+{
+    const QByteArray normalizedid = normalizeID(id, padding);
+    if (normalizedid.size() != padding) {
+        return false;
+    }
+    bool ok = false;
+    *result = normalizedid.toUInt(&ok, 16);
+    return ok;
+}
+
 static void extractIDs(QFile *idsfile,
                        KVendorEntryMap *vendormap, KDeviceEntryMap *devicemap,
                        KClassEntryMap *classmap, KSubClassEntryMap *subclassmap, KProtocolEntryMap *protocolmap)
@@ -192,116 +241,259 @@ static void extractIDs(QFile *idsfile,
     }
 }
 
-class KDeviceDatabasePrivate
+static quint64 sourceStamp(const QStringList &idsfiles)
 {
-public:
-    KDeviceDatabasePrivate();
+    quint64 result = 0;
+    foreach (const QString &idsfile, idsfiles) {
+        KDE_struct_stat statistic;
+        if (KDE::stat(idsfile, &statistic) == -1) {
+            continue;
+        }
+        result = (result * 31) + qHash(idsfile);
+        result = (result * 31) + quint64(statistic.st_size);
+        result = (result * 31) + quint64(statistic.st_mtime);
+    }
+    return result;
+}
+
+static void appendTable(QByteArray *compiled, KDeviceDatabaseHeader *header, const KDeviceTable table,
+                        const QMap<quint32, QString> &entries, QHash<QString, quint32> *strings, QByteArray *stringpool)
+{
+    header->tableoffsets[table] = compiled->size();
+    header->tablesizes[table] = entries.size();
+
+    QMap<quint32, QString>::const_iterator it = entries.constBegin();
+    while (it != entries.constEnd()) {
+        quint32 stringoffset = strings->value(it.value(), 0);
+        if (stringoffset == 0) {
+            // the actual offset is known once all tables are written
+            stringoffset = stringpool->size() + 1;
+            strings->insert(it.value(), stringoffset);
+            stringpool->append(it.value().toUtf8());
+            stringpool->append('\0');
+        }
+        const KDeviceDatabaseRecord record = { it.key(), stringoffset };
+        compiled->append(reinterpret_cast<const char*>(&record), sizeof(record));
+        it++;
+    }
+}
+
+static QByteArray compileIDs(const QStringList &idsfiles, const quint64 sourcestamp)
+{
+    KVendorEntryMap vendormap;
+    KDeviceEntryMap devicemap;
+    KClassEntryMap classmap;
+    KSubClassEntryMap subclassmap;
+    KProtocolEntryMap protocolmap;
+    foreach (const QString &idsfile, idsfiles) {
+        QFile file(idsfile);
+        if (!file.open(QFile::ReadOnly)) {
+            kWarning() << "Could not open" << idsfile;
+            continue;
+        }
+        extractIDs(
+            &file,
+            &vendormap, &devicemap,
+            &classmap, &subclassmap, &protocolmap
+        );
+    }
+
+    QMap<quint32, QString> tables[TablesCount];
+    quint32 key = 0;
+    quint32 subkey = 0;
+    quint32 protocolkey = 0;
+    for (KVendorEntryMap::const_iterator it = vendormap.constBegin(); it != vendormap.constEnd(); it++) {
+        if (parseID(it.key(), 4, &key)) {
+            tables[VendorsTable].insert(key, it.value());
+        }
+    }
+    for (KDeviceEntryMap::const_iterator it = devicemap.constBegin(); it != devicemap.constEnd(); it++) {
+        if (parseID(it.key().vendorid, 4, &key) && parseID(it.key().deviceid, 4, &subkey)) {
+            tables[DevicesTable].insert((key << 16) | subkey, it.value());
+        }
+    }
+    for (KClassEntryMap::const_iterator it = classmap.constBegin(); it != classmap.constEnd(); it++) {
+        if (parseID(it.key(), 2, &key)) {
+            tables[ClassesTable].insert(key, it.value());
+        }
+    }
+    for (KSubClassEntryMap::const_iterator it = subclassmap.constBegin(); it != subclassmap.constEnd(); it++) {
+        if (parseID(it.key().vendorid, 2, &key) && parseID(it.key().deviceid, 2, &subkey)) {
+            tables[SubClassesTable].insert((key << 8) | subkey, it.value());
+        }
+    }
+    for (KProtocolEntryMap::const_iterator it = protocolmap.constBegin(); it != protocolmap.constEnd(); it++) {
+        if (parseID(it.key().classid, 2, &key) && parseID(it.key().subclassid, 2, &subkey)
+            && parseID(it.key().protocolid, 2, &protocolkey)) {
+            tables[ProtocolsTable].insert((key << 16) | (subkey << 8) | protocolkey, it.value());
+        }
+    }
+
+    KDeviceDatabaseHeader header;
+    ::memset(&header, 0, sizeof(header));
+    ::memcpy(header.magic, KDEVICEDATABASE_MAGIC, sizeof(header.magic));
+    header.version = KDEVICEDATABASE_VERSION;
+    header.sourcestamp = sourcestamp;
+
+    QByteArray compiled(sizeof(header), '\0');
+    QHash<QString, quint32> strings;
+    QByteArray stringpool;
+    for (int i = 0; i < TablesCount; i++) {
+        appendTable(&compiled, &header, KDeviceTable(i), tables[i], &strings, &stringpool);
+    }
 
-    bool readPCIDatabase();
-    bool readUSBDatabase();
+    // string offsets are relative to the pool (plus one) until now
+    const quint32 stringpooloffset = compiled.size() - 1;
+    KDeviceDatabaseRecord* records = reinterpret_cast<KDeviceDatabaseRecord*>(compiled.data() + sizeof(header));
+    const int recordscount = (compiled.size() - sizeof(header)) / sizeof(KDeviceDatabaseRecord);
+    for (int i = 0; i < recordscount; i++) {
+        records[i].stringoffset += stringpooloffset;
+    }
+    ::memcpy(compiled.data(), &header, sizeof(header));
+    compiled.append(stringpool);
+    compiled.append('\0');
+    return compiled;
+}
 
-    KVendorEntryMap pcivendorsmap;
-    KDeviceEntryMap pcidevicesmap;
-    KClassEntryMap pciclassesmap;
-    KSubClassEntryMap pcisubclassesmap;
-    KProtocolEntryMap pciprotocolsmap;
-    KVendorEntryMap usbvendorsmap;
-    KDeviceEntryMap usbdevicesmap;
-    KClassEntryMap usbclassesmap;
-    KSubClassEntryMap usbsubclassesmap;
-    KProtocolEntryMap usbprotocolsmap;
+static bool isValidDatabase(const uchar *data, const qint64 size, const quint64 sourcestamp)
+{
+    if (size < qint64(sizeof(KDeviceDatabaseHeader)) || data[size - 1] != '\0') {
+        return false;
+    }
+
+    const KDeviceDatabaseHeader* header = reinterpret_cast<const KDeviceDatabaseHeader*>(data);
+    if (::memcmp(header->magic, KDEVICEDATABASE_MAGIC, sizeof(header->magic)) != 0
+        || header->version != KDEVICEDATABASE_VERSION
+        || header->sourcestamp != sourcestamp) {
+        return false;
+    }
+    for (int i = 0; i < TablesCount; i++) {
+        const qint64 tableend = qint64(header->tableoffsets[i]) + (qint64(header->tablesizes[i]) * sizeof(KDeviceDatabaseRecord));
+        if ((header->tableoffsets[i] % sizeof(quint32)) != 0 || tableend > size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class KDeviceDatabaseIndex
+{
+public:
+    KDeviceDatabaseIndex(const char* const name);
+
+    bool load();
+    QString lookup(const KDeviceTable table, const quint32 key) const;
 
 private:
-    bool m_pcicached;
-    bool m_usbcached;
+    bool map(const quint64 sourcestamp);
+
+    QString m_name;
+    QFile m_file;
+    QByteArray m_compiled;
+    const uchar* m_data;
+    qint64 m_size;
 };
 
-KDeviceDatabasePrivate::KDeviceDatabasePrivate()
-    : m_pcicached(false),
-    m_usbcached(false)
+KDeviceDatabaseIndex::KDeviceDatabaseIndex(const char* const name)
+    : m_name(QString::fromLatin1(name)),
+    m_data(nullptr),
+    m_size(0)
 {
 }
 
-bool KDeviceDatabasePrivate::readPCIDatabase()
+bool KDeviceDatabaseIndex::load()
 {
-    if (m_pcicached) {
+    if (m_data) {
         return true;
     }
 
-    pcivendorsmap.clear();
-    pcidevicesmap.clear();
-    pciclassesmap.clear();
-    pcisubclassesmap.clear();
-    pciprotocolsmap.clear();
-
-    const QString pciids = KStandardDirs::locate("data", QString::fromLatin1("kdevicedatabase/pci.ids"));
-    QFile pciidsfile(pciids);
-    if (!pciidsfile.open(QFile::ReadOnly)) {
-        kWarning() << "PCI IDs database not found";
+    const QString ids = KStandardDirs::locate("data", QString::fromLatin1("kdevicedatabase/%1.ids").arg(m_name));
+    if (ids.isEmpty()) {
+        kWarning() << m_name.toUpper() << "IDs database not found";
         return false;
     }
-    extractIDs(
-        &pciidsfile,
-        &pcivendorsmap, &pcidevicesmap,
-        &pciclassesmap, &pcisubclassesmap, &pciprotocolsmap
-    );
+    QStringList idsfiles;
+    idsfiles.append(ids);
 
-    const QString kde4pciids = KStandardDirs::locate("data", QString::fromLatin1("kdevicedatabase/kde4_pci.ids"));
-    QFile kde4pciidsfile(kde4pciids);
-    if (!kde4pciidsfile.open(QFile::ReadOnly)) {
-        kDebug() << "KDE PCI IDs database not found";
+    const QString kde4ids = KStandardDirs::locate("data", QString::fromLatin1("kdevicedatabase/kde4_%1.ids").arg(m_name));
+    if (kde4ids.isEmpty()) {
+        kDebug() << "KDE" << m_name.toUpper() << "IDs database not found";
     } else {
-        extractIDs(
-            &kde4pciidsfile,
-            &pcivendorsmap, &pcidevicesmap,
-            &pciclassesmap, &pcisubclassesmap, &pciprotocolsmap
-        );
+        idsfiles.append(kde4ids);
     }
 
-    // qDebug() << Q_FUNC_INFO << pcivendorsmap;
-    m_pcicached = true;
+    const quint64 sourcestamp = sourceStamp(idsfiles);
+    m_file.setFileName(KStandardDirs::locateLocal("cache", QString::fromLatin1("kdevicedatabase/%1.cache").arg(m_name)));
+    if (map(sourcestamp)) {
+        return true;
+    }
+
+    kDebug() << "Compiling" << idsfiles << "to" << m_file.fileName();
+    m_compiled = compileIDs(idsfiles, sourcestamp);
+    KSaveFile savefile(m_file.fileName());
+    if (savefile.open(QIODevice::WriteOnly)
+        && savefile.write(m_compiled) == m_compiled.size()
+        && savefile.finalize()) {
+        if (map(sourcestamp)) {
+            m_compiled.clear();
+            return true;
+        }
+    } else {
+        kWarning() << "Could not write" << m_file.fileName() << savefile.errorString();
+        savefile.abort();
+    }
+
+    // use the compiled data without sharing it
+    m_data = reinterpret_cast<const uchar*>(m_compiled.constData());
+    m_size = m_compiled.size();
     return true;
 }
 
-bool KDeviceDatabasePrivate::readUSBDatabase()
+bool KDeviceDatabaseIndex::map(const quint64 sourcestamp)
 {
-    if (m_usbcached) {
-        return true;
+    if (!m_file.open(QFile::ReadOnly)) {
+        return false;
     }
 
-    usbvendorsmap.clear();
-    usbdevicesmap.clear();
-    usbclassesmap.clear();
-    usbsubclassesmap.clear();
-    usbprotocolsmap.clear();
-
-    const QString usbids = KStandardDirs::locate("data", QString::fromLatin1("kdevicedatabase/usb.ids"));
-    QFile usbidsfile(usbids);
-    if (!usbidsfile.open(QFile::ReadOnly)) {
-        kWarning() << "USB IDs database not found";
+    const qint64 filesize = m_file.size();
+    const uchar* mapped = m_file.map(0, filesize);
+    if (!mapped || !isValidDatabase(mapped, filesize, sourcestamp)) {
+        kDebug() << "Outdated or invalid" << m_file.fileName();
+        m_file.close();
         return false;
     }
-    extractIDs(
-        &usbidsfile,
-        &usbvendorsmap, &usbdevicesmap,
-        &usbclassesmap, &usbsubclassesmap, &usbprotocolsmap
-    );
 
-    const QString kde4usbids = KStandardDirs::locate("data", QString::fromLatin1("kdevicedatabase/kde4_usb.ids"));
-    QFile kde4usbidsfile(kde4usbids);
-    if (!kde4usbidsfile.open(QFile::ReadOnly)) {
-        kDebug() << "KDE USB IDs database not found";
-    } else {
-        extractIDs(
-            &kde4usbidsfile,
-            &usbvendorsmap, &usbdevicesmap,
-            &usbclassesmap, &usbsubclassesmap, &usbprotocolsmap
-        );
+    m_data = mapped;
+    m_size = filesize;
+    return true;
+}
+
+QString KDeviceDatabaseIndex::lookup(const KDeviceTable table, const quint32 key) const
+{
+    Q_ASSERT(m_data);
+    const KDeviceDatabaseHeader* header = reinterpret_cast<const KDeviceDatabaseHeader*>(m_data);
+    const KDeviceDatabaseRecord* recordsbegin = reinterpret_cast<const KDeviceDatabaseRecord*>(m_data + header->tableoffsets[table]);
+    const KDeviceDatabaseRecord* recordsend = recordsbegin + header->tablesizes[table];
+    const KDeviceDatabaseRecord* record = std::lower_bound(recordsbegin, recordsend, key);
+    if (record == recordsend || record->key != key || record->stringoffset >= m_size) {
+        return QString();
     }
+    return QString::fromUtf8(reinterpret_cast<const char*>(m_data + record->stringoffset));
+}
 
-    // qDebug() << Q_FUNC_INFO << usbvendorsmap;
-    m_usbcached = true;
-    return true;
+class KDeviceDatabasePrivate
+{
+public:
+    KDeviceDatabasePrivate();
+
+    KDeviceDatabaseIndex pciindex;
+    KDeviceDatabaseIndex usbindex;
+};
+
+KDeviceDatabasePrivate::KDeviceDatabasePrivate()
+    : pciindex("pci"),
+    usbindex("usb")
+{
 }
 
 KDeviceDatabase::KDeviceDatabase()
@@ -309,168 +501,129 @@ KDeviceDatabase::KDeviceDatabase()
 {
 }
 
+KDeviceDatabase::~KDeviceDatabase()
+{
+    delete d;
+}
+
 QString KDeviceDatabase::lookupPCIVendor(const QByteArray &vendorid)
 {
-    if (!d->readPCIDatabase()) {
+    quint32 vendorkey = 0;
+    if (!d->pciindex.load() || !parseID(vendorid, 4, &vendorkey)) {
         return QString();
     }
 
-    const QByteArray normalizedvendor = normalizeID(vendorid, 4);
-    foreach (const QByteArray &deviceentry, d->pcivendorsmap.keys()) {
-        if (qstrcmp(deviceentry.constData(), normalizedvendor.constData()) == 0) {
-            return d->pcivendorsmap.value(deviceentry);
-        }
-    }
-    return QString();
+    return d->pciindex.lookup(VendorsTable, vendorkey);
 }
 
 QString KDeviceDatabase::lookupPCIDevice(const QByteArray &vendorid, const QByteArray &deviceid)
 {
-    if (!d->readPCIDatabase()) {
+    quint32 vendorkey = 0;
+    quint32 devicekey = 0;
+    if (!d->pciindex.load()
+        || !parseID(vendorid, 4, &vendorkey)
+        || !parseID(deviceid, 4, &devicekey)) {
         return QString();
     }
 
-    const QByteArray normalizedvendor = normalizeID(vendorid, 4);
-    const QByteArray normalizeddevice = normalizeID(deviceid, 4);
-    foreach (const KDeviceEntry &deviceentry, d->pcidevicesmap.keys()) {
-        if (qstrcmp(deviceentry.vendorid.constData(), normalizedvendor.constData()) == 0
-            && qstrcmp(deviceentry.deviceid.constData(), normalizeddevice.constData()) == 0) {
-            return d->pcidevicesmap.value(deviceentry);
-        }
-    }
-    return QString();
+    return d->pciindex.lookup(DevicesTable, (vendorkey << 16) | devicekey);
 }
 
 QString KDeviceDatabase::lookupPCIClass(const QByteArray &classid)
 {
-    if (!d->readPCIDatabase()) {
+    quint32 classkey = 0;
+    if (!d->pciindex.load() || !parseID(classid, 2, &classkey)) {
         return QString();
     }
 
-    const QByteArray normalizedclass = normalizeID(classid, 2);
-    foreach (const QByteArray &deviceentry, d->pciclassesmap.keys()) {
-        if (qstrcmp(deviceentry.constData(), normalizedclass.constData()) == 0) {
-            return d->pciclassesmap.value(deviceentry);
-        }
-    }
-    return QString();
+    return d->pciindex.lookup(ClassesTable, classkey);
 }
 
 QString KDeviceDatabase::lookupPCISubClass(const QByteArray &classid, const QByteArray &subclassid)
 {
-    if (!d->readPCIDatabase()) {
+    quint32 classkey = 0;
+    quint32 subclasskey = 0;
+    if (!d->pciindex.load()
+        || !parseID(classid, 2, &classkey)
+        || !parseID(subclassid, 2, &subclasskey)) {
         return QString();
     }
 
-    const QByteArray normalizedclass = normalizeID(classid, 2);
-    const QByteArray normalizedsubclass = normalizeID(subclassid, 2);
-    foreach (const KDeviceEntry &deviceentry, d->pcisubclassesmap.keys()) {
-        if (qstrcmp(deviceentry.vendorid.constData(), normalizedclass.constData()) == 0
-            && qstrcmp(deviceentry.deviceid.constData(), normalizedsubclass.constData()) == 0) {
-            return d->pcisubclassesmap.value(deviceentry);
-        }
-    }
-    return QString();
+    return d->pciindex.lookup(SubClassesTable, (classkey << 8) | subclasskey);
 }
 
 QString KDeviceDatabase::lookupPCIProtocol(const QByteArray &classid, const QByteArray &subclassid, const QByteArray &protocolid)
 {
-    if (!d->readPCIDatabase()) {
+    quint32 classkey = 0;
+    quint32 subclasskey = 0;
+    quint32 protocolkey = 0;
+    if (!d->pciindex.load()
+        || !parseID(classid, 2, &classkey)
+        || !parseID(subclassid, 2, &subclasskey)
+        || !parseID(protocolid, 2, &protocolkey)) {
         return QString();
     }
 
-    const QByteArray normalizedclass = normalizeID(classid, 2);
-    const QByteArray normalizedsubclass = normalizeID(subclassid, 2);
-    const QByteArray normalizedprotocol = normalizeID(protocolid, 2);
-    foreach (const KProtocolEntry &protocolentry, d->pciprotocolsmap.keys()) {
-        if (qstrcmp(protocolentry.classid.constData(), normalizedclass.constData()) == 0
-            && qstrcmp(protocolentry.subclassid.constData(), normalizedsubclass.constData()) == 0
-            && qstrcmp(protocolentry.protocolid.constData(), normalizedprotocol.constData()) == 0) {
-            return d->pciprotocolsmap.value(protocolentry);
-        }
-    }
-    return QString();
+    return d->pciindex.lookup(ProtocolsTable, (classkey << 16) | (subclasskey << 8) | protocolkey);
 }
 
 QString KDeviceDatabase::lookupUSBVendor(const QByteArray &vendorid)
 {
-    if (!d->readUSBDatabase()) {
+    quint32 vendorkey = 0;
+    if (!d->usbindex.load() || !parseID(vendorid, 4, &vendorkey)) {
         return QString();
     }
 
-    const QByteArray normalizedvendor = normalizeID(vendorid, 4);
-    foreach (const QByteArray &deviceentry, d->usbvendorsmap.keys()) {
-        if (qstrcmp(deviceentry.constData(), normalizedvendor.constData()) == 0) {
-            return d->usbvendorsmap.value(deviceentry);
-        }
-    }
-    return QString();
+    return d->usbindex.lookup(VendorsTable, vendorkey);
 }
 
 QString KDeviceDatabase::lookupUSBDevice(const QByteArray &vendorid, const QByteArray &deviceid)
 {
-    if (!d->readUSBDatabase()) {
+    quint32 vendorkey = 0;
+    quint32 devicekey = 0;
+    if (!d->usbindex.load()
+        || !parseID(vendorid, 4, &vendorkey)
+        || !parseID(deviceid, 4, &devicekey)) {
         return QString();
     }
 
-    const QByteArray normalizedvendor = normalizeID(vendorid, 4);
-    const QByteArray normalizeddevice = normalizeID(deviceid, 4);
-    foreach (const KDeviceEntry &deviceentry, d->usbdevicesmap.keys()) {
-        if (qstrcmp(deviceentry.vendorid.constData(), normalizedvendor.constData()) == 0
-            && qstrcmp(deviceentry.deviceid.constData(), normalizeddevice.constData()) == 0) {
-            return d->usbdevicesmap.value(deviceentry);
-        }
-    }
-    return QString();
+    return d->usbindex.lookup(DevicesTable, (vendorkey << 16) | devicekey);
 }
 
 QString KDeviceDatabase::lookupUSBClass(const QByteArray &classid)
 {
-    if (!d->readUSBDatabase()) {
+    quint32 classkey = 0;
+    if (!d->usbindex.load() || !parseID(classid, 2, &classkey)) {
         return QString();
     }
 
-    const QByteArray normalizedclass = normalizeID(classid, 2);
-    foreach (const QByteArray &deviceentry, d->usbclassesmap.keys()) {
-        if (qstrcmp(deviceentry.constData(), normalizedclass.constData()) == 0) {
-            return d->usbclassesmap.value(deviceentry);
-        }
-    }
-    return QString();
+    return d->usbindex.lookup(ClassesTable, classkey);
 }
 
 QString KDeviceDatabase::lookupUSBSubClass(const QByteArray &classid, const QByteArray &subclassid)
 {
-    if (!d->readUSBDatabase()) {
+    quint32 classkey = 0;
+    quint32 subclasskey = 0;
+    if (!d->usbindex.load()
+        || !parseID(classid, 2, &classkey)
+        || !parseID(subclassid, 2, &subclasskey)) {
         return QString();
     }
 
-    const QByteArray normalizedclass = normalizeID(classid, 2);
-    const QByteArray normalizedsubclass = normalizeID(subclassid, 2);
-    foreach (const KDeviceEntry &deviceentry, d->usbsubclassesmap.keys()) {
-        if (qstrcmp(deviceentry.vendorid.constData(), normalizedclass.constData()) == 0
-            && qstrcmp(deviceentry.deviceid.constData(), normalizedsubclass.constData()) == 0) {
-            return d->usbsubclassesmap.value(deviceentry);
-        }
-    }
-    return QString();
+    return d->usbindex.lookup(SubClassesTable, (classkey << 8) | subclasskey);
 }
 
 QString KDeviceDatabase::lookupUSBProtocol(const QByteArray &classid, const QByteArray &subclassid, const QByteArray &protocolid)
 {
-    if (!d->readUSBDatabase()) {
+    quint32 classkey = 0;
+    quint32 subclasskey = 0;
+    quint32 protocolkey = 0;
+    if (!d->usbindex.load()
+        || !parseID(classid, 2, &classkey)
+        || !parseID(subclassid, 2, &subclasskey)
+        || !parseID(protocolid, 2, &protocolkey)) {
         return QString();
     }
 
-    const QByteArray normalizedclass = normalizeID(classid, 2);
-    const QByteArray normalizedsubclass = normalizeID(subclassid, 2);
-    const QByteArray normalizedprotocol = normalizeID(protocolid, 2);
-    foreach (const KProtocolEntry &protocolentry, d->usbprotocolsmap.keys()) {
-        if (qstrcmp(protocolentry.classid.constData(), normalizedclass.constData()) == 0
-            && qstrcmp(protocolentry.subclassid.constData(), normalizedsubclass.constData()) == 0
-            && qstrcmp(protocolentry.protocolid.constData(), normalizedprotocol.constData()) == 0) {
-            return d->usbprotocolsmap.value(protocolentry);
-        }
-    }
-    return QString();
+    return d->usbindex.lookup(ProtocolsTable, (classkey << 16) | (subclasskey << 8) | protocolkey);
 }
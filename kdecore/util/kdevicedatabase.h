@@ -32,6 +32,9 @@ class KDeviceDatabasePrivate;
     sub-class and protocol IDs should be 2 characters long, e.g. "0b". If they are not zero is
     prepended to the IDs.
 
+    The IDs databases are compiled on first use into a binary file in the cache directory which is
+    mapped into memory and shared between processes, it is recompiled when the databases change.
+
     @link https://pci-ids.ucw.cz/
     @link http://www.linux-usb.org/usb-ids.html
     @since 4.21
@@ -40,6 +43,7 @@ class KDECORE_EXPORT KDeviceDatabase
 {
 public:
     KDeviceDatabase();
+    ~KDeviceDatabase();
 
     /*!
         @return The vendor for @p vendorid, empty string if unknown
@@ -18,6 +18,7 @@
  **/
 
 #include "kbuildservicefactory.h"
+#include "kbuildsycoca.h"
 #include "kbuildservicegroupfactory.h"
 #include "kbuildmimetypefactory.h"
 #include "kmimetyperepository_p.h"
@@ -32,6 +33,8 @@
 #include <kdebug.h>
 #include <kmimetypefactory.h>
 
+#include <QtCore/QScopedPointer>
+
 #include <assert.h>
 
 KBuildServiceFactory::KBuildServiceFactory( KSycocaFactory *serviceTypeFactory,
@@ -92,9 +95,12 @@ KSycocaEntry* KBuildServiceFactory::createEntry( const QString& file, const char
     }
     // Is it a .desktop file?
     if (name.endsWith(QLatin1String(".desktop"))) {
-        KDesktopFile desktopFile(resource, file);
+        // on full rebuilds a worker thread parsed it already
+        QScopedPointer<KDesktopFile> desktopFile(KBuildSycoca::takeParsedDesktopFile(resource, file));
+        if (!desktopFile)
+            desktopFile.reset(new KDesktopFile(resource, file));
 
-        KService * serv = new KService(&desktopFile);
+        KService * serv = new KService(desktopFile.data());
         //kDebug(7021) << "Creating KService from" << file << "entryPath=" << serv->entryPath();
         // Note that the menuId will be set by the vfolder_menu.cpp code just after
         // createEntry returns.
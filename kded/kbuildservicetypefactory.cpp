@@ -17,6 +17,7 @@
  **/
 
 #include "kbuildservicetypefactory.h"
+#include "kbuildsycoca.h"
 #include "ksycoca.h"
 #include "ksycocadict_p.h"
 #include "ksycocaresourcelist.h"
@@ -29,6 +30,7 @@
 #include <kdesktopfile.h>
 #include <kconfiggroup.h>
 #include <QtCore/QHash>
+#include <QtCore/QScopedPointer>
 
 KBuildServiceTypeFactory::KBuildServiceTypeFactory() :
     KServiceTypeFactory()
@@ -69,26 +71,29 @@ KSycocaEntry* KBuildServiceTypeFactory::createEntry(const QString &file, const c
     if (name.isEmpty())
         return 0;
 
-    KDesktopFile desktopFile(resource, file);
-    const KConfigGroup desktopGroup = desktopFile.desktopGroup();
+    // on full rebuilds a worker thread parsed it already
+    QScopedPointer<KDesktopFile> desktopFile(KBuildSycoca::takeParsedDesktopFile(resource, file));
+    if (!desktopFile)
+        desktopFile.reset(new KDesktopFile(resource, file));
+    const KConfigGroup desktopGroup = desktopFile->desktopGroup();
 
     if ( desktopGroup.readEntry( "Hidden", false ) == true )
         return 0;
 
     const QString type = desktopGroup.readEntry( "Type" );
     if ( type != QLatin1String( "ServiceType" ) ) {
-        kWarning(7021) << "The service type config file " << desktopFile.fileName() << " has Type=" << type << " instead of Type=ServiceType";
+        kWarning(7021) << "The service type config file " << desktopFile->fileName() << " has Type=" << type << " instead of Type=ServiceType";
         return 0;
     }
 
     const QString serviceType = desktopGroup.readEntry( "X-KDE-ServiceType" );
 
     if ( serviceType.isEmpty() ) {
-        kWarning(7021) << "The service type config file " << desktopFile.fileName() << " does not contain a ServiceType=... entry";
+        kWarning(7021) << "The service type config file " << desktopFile->fileName() << " does not contain a ServiceType=... entry";
         return 0;
     }
 
-    KServiceType* e = new KServiceType( &desktopFile );
+    KServiceType* e = new KServiceType( desktopFile.data() );
 
     if (e->isDeleted()) {
         delete e;
@@ -35,6 +35,7 @@
 #include "kbuildprotocolinfofactory.h"
 #include "kctimefactory.h"
 #include <ktemporaryfile.h>
+#include <kdesktopfile.h>
 #include <kglobal.h>
 #include <kdebug.h>
 #include <kdirwatch.h>
@@ -49,8 +50,15 @@
 #endif
 
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QCoreApplication>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSet>
 #include <QDBusConnectionInterface>
 
 #include <stdlib.h>
@@ -76,6 +84,8 @@ static KBSEntryDict *g_serviceGroupEntryDict = 0;
 static KSycocaEntryListList *g_allEntries = 0; // entries from existing ksycoca
 static QStringList *g_allResourceDirs = 0;
 static bool g_changed = false;
+static QStringList *g_changedDirs = 0; // directories reported by kded
+static const QSet<QString> *g_changedRelDirs = 0; // the same, relative to g_resource
 static KSycocaEntry::List g_tempStorage;
 static VFolderMenu *g_vfolder = 0;
 static QByteArray g_sycocaPath = 0;
@@ -83,6 +93,10 @@ static QLatin1String g_defaultMenu = QLatin1String("kde-applications.menu");
 
 static bool bGlobalDatabase = false;
 static bool bMenuTest = false;
+static bool bParallel = true;
+
+// Number of files parsed by each job of the thread pool
+#define KBUILDSYCOCA_PARSE_BATCH 64
 
 void crashHandler(int sig)
 {
@@ -96,6 +110,112 @@ void crashHandler(int sig)
     ::exit(sig);
 }
 
+static QString parsedFileKey(const char *resource, const QString &file)
+{
+   return QString::fromLatin1(resource) + QLatin1Char(':') + file;
+}
+
+// Desktop files parsed on a thread pool when all of them have to be parsed
+// anyway. The factories still create the entries on the main thread in the
+// order in which the files were found, so the database comes out the same
+// as from a sequential build. They only take the parsed file instead of
+// parsing it themselves.
+class KBuildSycocaParsedFiles
+{
+public:
+   KBuildSycocaParsedFiles();
+   ~KBuildSycocaParsedFiles();
+
+   void parse(const QByteArray &resource, const QStringList &files);
+   // waits for the file if it is still being parsed, the caller owns the result
+   KDesktopFile* take(const char *resource, const QString &file);
+   void parsed(const QString &key, KDesktopFile *desktopFile);
+
+private:
+   Q_DISABLE_COPY(KBuildSycocaParsedFiles);
+
+   QThreadPool m_threadpool;
+   QMutex m_mutex;
+   QWaitCondition m_parsedCondition;
+   QSet<QString> m_pending;
+   QHash<QString, KDesktopFile*> m_parsed;
+};
+
+static KBuildSycocaParsedFiles *g_parsedFiles = 0;
+
+class KBuildSycocaParseRunnable : public QRunnable
+{
+public:
+   KBuildSycocaParseRunnable(KBuildSycocaParsedFiles *parsedFiles, const QByteArray &resource, const QStringList &files)
+      : QRunnable(), m_parsedFiles(parsedFiles), m_resource(resource), m_files(files)
+   {
+   }
+
+protected:
+   void run() final
+   {
+      foreach (const QString &file, m_files)
+      {
+         KDesktopFile *desktopFile = new KDesktopFile(m_resource.constData(), file);
+         m_parsedFiles->parsed(parsedFileKey(m_resource.constData(), file), desktopFile);
+      }
+   }
+
+private:
+   KBuildSycocaParsedFiles *m_parsedFiles;
+   QByteArray m_resource;
+   QStringList m_files;
+};
+
+KBuildSycocaParsedFiles::KBuildSycocaParsedFiles()
+{
+   m_threadpool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+KBuildSycocaParsedFiles::~KBuildSycocaParsedFiles()
+{
+   m_threadpool.waitForDone();
+   // files that no factory asked for
+   qDeleteAll(m_parsed);
+}
+
+void KBuildSycocaParsedFiles::parse(const QByteArray &resource, const QStringList &files)
+{
+   QStringList desktopFiles;
+   {
+      QMutexLocker locker(&m_mutex);
+      foreach (const QString &file, files)
+      {
+         const QString key = parsedFileKey(resource.constData(), file);
+         if (file.endsWith(QLatin1String(".desktop")) && !m_pending.contains(key) && !m_parsed.contains(key))
+         {
+            m_pending.insert(key);
+            desktopFiles.append(file);
+         }
+      }
+   }
+
+   for (int i = 0; i < desktopFiles.count(); i += KBUILDSYCOCA_PARSE_BATCH)
+      m_threadpool.start(new KBuildSycocaParseRunnable(this, resource, desktopFiles.mid(i, KBUILDSYCOCA_PARSE_BATCH)));
+}
+
+KDesktopFile* KBuildSycocaParsedFiles::take(const char *resource, const QString &file)
+{
+   const QString key = parsedFileKey(resource, file);
+   QMutexLocker locker(&m_mutex);
+   while (m_pending.contains(key))
+      m_parsedCondition.wait(&m_mutex);
+   return m_parsed.take(key);
+}
+
+void KBuildSycocaParsedFiles::parsed(const QString &key, KDesktopFile *desktopFile)
+{
+   QMutexLocker locker(&m_mutex);
+   m_pending.remove(key);
+   m_parsed.insert(key, desktopFile);
+   m_parsedCondition.wakeAll();
+}
+
 static QString sycocaPath()
 {
   return KSycoca::absoluteFilePath(bGlobalDatabase ? KSycoca::GlobalDatabase : KSycoca::LocalDatabase);
@@ -111,9 +231,23 @@ KBuildSycoca::~KBuildSycoca()
 
 }
 
+// When only some directories changed, the files elsewhere keep the timestamp
+// they had in the old database, the (many) stat() calls of calcResourceHash
+// are only needed for files in one of the changed directories.
+static bool isInUnchangedDir(const QString &file)
+{
+   if (!g_changedRelDirs)
+      return false;
+   return !g_changedRelDirs->contains(file.left(file.lastIndexOf('/') + 1));
+}
+
 KSycocaEntry::Ptr KBuildSycoca::createEntry(const QString &file, bool addToFactory)
 {
    quint32 timeStamp = g_ctimeInfo->dict()->ctime(file, g_resource);
+   if (!timeStamp && g_ctimeDict && isInUnchangedDir(file))
+   {
+      timeStamp = g_ctimeDict->ctime(file, g_resource);
+   }
    if (!timeStamp)
    {
       timeStamp = KGlobal::dirs()->calcResourceHash( g_resource, file,
@@ -170,6 +304,13 @@ KSycocaEntry::Ptr KBuildSycoca::createEntry(const QString &file, bool addToFacto
    return KSycocaEntry::Ptr();
 }
 
+KDesktopFile* KBuildSycoca::takeParsedDesktopFile(const char *resource, const QString &file)
+{
+   if (!g_parsedFiles)
+      return 0;
+   return g_parsedFiles->take(resource, file);
+}
+
 KService::Ptr KBuildSycoca::createService(const QString &path)
 {
    KSycocaEntry::Ptr entry = createEntry(path, false);
@@ -228,21 +369,74 @@ bool KBuildSycoca::build()
     }
   }
 
-  g_ctimeInfo = new KCTimeInfo(); // This is a build factory too, don't delete!!
-  bool uptodate = true;
-  // For all resources
+  // Find the files of all resources first, so that when everything has to
+  // be parsed anyway worker threads can parse them ahead of the factories.
+  QHash<QString, QStringList> allRelFiles;
+  QHash<QString, QSet<QString> > allChangedRelDirs;
+  KBuildSycocaParsedFiles parsedFiles;
+  g_parsedFiles = (bParallel && !g_allEntries) ? &parsedFiles : 0;
   foreach(const QString &it1, allResources)
   {
-     g_changed = false;
-     g_resource = it1.toLatin1();
+     if (g_changedDirs && g_allEntries)
+     {
+        // Map the changed directories to directories relative to the
+        // resource. A resource without any can reuse the old file list,
+        // one whose whole directory appeared or vanished is rescanned.
+        QSet<QString> changedRelDirs;
+        bool rescan = false;
+        foreach(const QString &resourceDir, KGlobal::dirs()->resourceDirs(it1.toLatin1()))
+        {
+           foreach(const QString &changedDir, *g_changedDirs)
+           {
+              if (changedDir.startsWith(resourceDir))
+                 changedRelDirs.insert(changedDir.mid(resourceDir.length()));
+              else if (resourceDir.startsWith(changedDir))
+                 rescan = true;
+           }
+        }
+        if (!rescan)
+        {
+           if (changedRelDirs.isEmpty())
+           {
+              allRelFiles.insert(it1, g_ctimeDict->files(it1.toLatin1()));
+              allChangedRelDirs.insert(it1, changedRelDirs);
+              continue;
+           }
+           allChangedRelDirs.insert(it1, changedRelDirs);
+        }
+     }
 
      QStringList relFiles;
-
-     (void) KGlobal::dirs()->findAllResources( g_resource,
+     (void) KGlobal::dirs()->findAllResources( it1.toLatin1(),
                                                QString(),
                                                KStandardDirs::Recursive |
                                                KStandardDirs::NoDuplicates,
                                                relFiles);
+     allRelFiles.insert(it1, relFiles);
+
+     if (g_parsedFiles)
+        g_parsedFiles->parse(it1.toLatin1(), relFiles);
+  }
+  if (g_parsedFiles)
+  {
+     // the applications are only created by the menu code at the end, it
+     // finds them under their absolute paths
+     g_parsedFiles->parse("xdgdata-apps", KGlobal::dirs()->findAllResources("xdgdata-apps",
+                                                                            QString(),
+                                                                            KStandardDirs::Recursive));
+  }
+
+  g_ctimeInfo = new KCTimeInfo(); // This is a build factory too, don't delete!!
+  bool uptodate = true;
+  // For all resources
+  foreach(const QString &it1, allResources)
+  {
+     g_changed = false;
+     g_resource = it1.toLatin1();
+     QHash<QString, QSet<QString> >::const_iterator changedIt = allChangedRelDirs.constFind(it1);
+     g_changedRelDirs = changedIt != allChangedRelDirs.constEnd() ? &changedIt.value() : 0;
+
+     const QStringList relFiles = allRelFiles.value(it1);
 
 
      // Now find all factories that use this resource....
@@ -300,6 +494,8 @@ bool KBuildSycoca::build()
   if (result || bMenuTest)
   {
      g_resource = "xdgdata-apps";
+     QHash<QString, QSet<QString> >::const_iterator changedIt = allChangedRelDirs.constFind(QString::fromLatin1(g_resource));
+     g_changedRelDirs = changedIt != allChangedRelDirs.constEnd() ? &changedIt.value() : 0;
      g_currentFactory = g_serviceFactory;
      g_currentEntryDict = serviceEntryDict;
      g_changed = false;
@@ -339,6 +535,8 @@ bool KBuildSycoca::build()
      }
   }
 
+  g_changedRelDirs = 0;
+  g_parsedFiles = 0;
   qDeleteAll(entryDictList);
   return result;
 }
@@ -641,6 +839,8 @@ int main(int argc, char **argv)
    options.add("nocheckfiles", ki18n("Disable checking files (dangerous)"));
    options.add("global", ki18n("Create global database"));
    options.add("menutest", ki18n("Perform menu generation test run only"));
+   options.add("noparallel", ki18n("Do not parse files with worker threads"));
+   options.add("changed <dir>", ki18n("Only check files in the given directory for changes, can be repeated"));
    options.add("track <menu-id>", ki18n("Track menu id for debug purposes"));
 
    KCmdLineArgs::init(argc, argv, &d);
@@ -648,6 +848,7 @@ int main(int argc, char **argv)
    KCmdLineArgs *args = KCmdLineArgs::parsedArgs();
    bGlobalDatabase = args->isSet("global");
    bMenuTest = args->isSet("menutest");
+   bParallel = args->isSet("parallel");
 
    if (bGlobalDatabase)
    {
@@ -710,7 +911,20 @@ int main(int argc, char **argv)
      }
    }
 
-   bool checkstamps = incremental && args->isSet("checkstamps") && checkfiles;
+   // kded knows which directories changed, there is no need to look
+   // at the timestamps of everything else
+   QStringList changedDirs;
+   if (incremental)
+   {
+      foreach (const QString &dir, args->getOptionList("changed"))
+      {
+         changedDirs.append(QDir::cleanPath(dir) + QLatin1Char('/'));
+      }
+      if (!changedDirs.isEmpty())
+         g_changedDirs = &changedDirs;
+   }
+
+   bool checkstamps = incremental && args->isSet("checkstamps") && checkfiles && !g_changedDirs;
    quint32 filestamp = 0;
    QStringList oldresourcedirs;
    if( checkstamps && incremental )
@@ -777,6 +991,10 @@ int main(int argc, char **argv)
 	      factory != factories->end(); ++factory)
          {
              const KSycocaEntry::List list = (*factory)->allEntries();
+             // Services read their properties on demand, do it while
+             // the old database is still open
+             foreach (const KSycocaEntry::Ptr &entry, list)
+                (void) entry->propertyNames();
              g_allEntries->append( list );
          }
          delete factories; factories = 0;
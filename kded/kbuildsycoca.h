@@ -35,6 +35,8 @@
 
 #include <QDataStream>
 
+class KDesktopFile;
+
 // No need for this in libkio - apps only get readonly access
 class KBuildSycoca : public KSycoca, public KBuildSycocaInterface
 {
@@ -52,6 +54,12 @@ public:
 
    static QStringList existingResourceDirs();
 
+   /**
+    * Returns @p file of @p resource if a worker thread parsed it ahead,
+    * null otherwise. The caller owns the result.
+    */
+   static KDesktopFile* takeParsedDesktopFile(const char *resource, const QString &file);
+
    void setTrackId(const QString &id) { m_trackId = id; }
 
    QStringList changedResources() const { return m_changedResources; }
@@ -61,6 +61,21 @@ QStringList KCTimeDict::resourceList() const
     return resources;
 }
 
+QStringList KCTimeDict::files(const QByteArray& resource) const
+{
+    const QString prefix = QString::fromLatin1(resource) + QLatin1Char('|');
+    QStringList files;
+    QHashIterator<QString,quint32> it(m_hash);
+    while (it.hasNext()) {
+        it.next();
+        const QString key = it.key();
+        if (key.startsWith(prefix))
+            files << key.mid(prefix.length());
+    }
+    files.sort();
+    return files;
+}
+
 void KCTimeDict::load(QDataStream &str)
 {
     QString key;
@@ -34,6 +34,8 @@ public:
     void dump() const;
     bool isEmpty() const { return m_hash.isEmpty(); }
     QStringList resourceList() const;
+    // Returns the files of @p resource, sorted
+    QStringList files(const QByteArray& resource) const;
 
     void load(QDataStream &str);
     void save(QDataStream &str) const;
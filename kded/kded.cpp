@@ -35,6 +35,7 @@
 #include <kstandarddirs.h>
 #include <kservicetypetrader.h>
 
+#include <QDir>
 #include <QFile>
 #include <QProcess>
 #include <QHostInfo>
@@ -47,6 +48,8 @@
 
 #define MODULES_PATH "/modules/"
 #define MODULES_PATH_SIZE 9
+// More changed directories than this and kbuildsycoca checks everything
+#define KDED_MAXCHANGEDDIRS 64
 
 Kded *Kded::_self = 0;
 
@@ -59,12 +62,17 @@ QT_BEGIN_NAMESPACE
 extern Q_DBUS_EXPORT void qDBusAddSpyHook(void (*)(const QDBusMessage&));
 QT_END_NAMESPACE
 
-static void runBuildSycoca()
+static void runBuildSycoca(const QStringList &changedDirs)
 {
     const QString exe = KStandardDirs::findExe(KBUILDSYCOCA_EXENAME);
     Q_ASSERT(!exe.isEmpty());
     QStringList args;
-    if (bCheckStamps) {
+    if (!changedDirs.isEmpty() && changedDirs.count() <= KDED_MAXCHANGEDDIRS) {
+        foreach (const QString &dir, changedDirs) {
+            args.append("--changed");
+            args.append(dir);
+        }
+    } else if (bCheckStamps) {
         args.append("--checkstamps");
     }
     if (QProcess::execute(exe, args) != 0) {
@@ -115,7 +123,7 @@ Kded::Kded(QObject *parent)
 
     m_pTimer = new QTimer(this);
     m_pTimer->setSingleShot(true);
-    connect(m_pTimer, SIGNAL(timeout()), this, SLOT(recreate()));
+    connect(m_pTimer, SIGNAL(timeout()), this, SLOT(recreateChanged()));
 
     if (bCheckHostname) {
         // Watch for hostname changes
@@ -466,9 +474,12 @@ void Kded::updateDirWatch()
         return;
     }
 
-    delete m_pDirWatch;
-    m_pDirWatch = new KDirWatch(this);
-    connect(m_pDirWatch, SIGNAL(dirty(QString)), this, SLOT(update(QString)));
+    // addDir() skips directories that are watched already, without looking
+    // into them again
+    if (!m_pDirWatch) {
+        m_pDirWatch = new KDirWatch(this);
+        connect(m_pDirWatch, SIGNAL(dirty(QString)), this, SLOT(update(QString)));
+    }
 
     foreach(const QString &it, m_allResourceDirs) {
         m_pDirWatch->addDir(it, true);
@@ -488,7 +499,16 @@ void Kded::updateResourceList()
 
 void Kded::recreate()
 {
-    runBuildSycoca();
+    m_changedDirs.clear();
+    recreateChanged();
+}
+
+void Kded::recreateChanged()
+{
+    const QStringList changedDirs = m_changedDirs.toList();
+    m_changedDirs.clear();
+
+    runBuildSycoca(changedDirs);
     updateResourceList();
     updateDirWatch();
 
@@ -498,7 +518,14 @@ void Kded::recreate()
 
 void Kded::update(const QString& path)
 {
-    Q_UNUSED(path);
+    m_changedDirs.insert(path);
+
+    // Watch directories created in the changed one too
+    const QFileInfoList subDirs = QDir(path).entryInfoList(QDir::NoDotAndDotDot | QDir::Dirs);
+    foreach (const QFileInfo &info, subDirs) {
+        m_pDirWatch->addDir(info.absoluteFilePath(), true);
+    }
+
     if (!m_pTimer->isActive()) {
         m_pTimer->start(5000);
     }
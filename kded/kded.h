@@ -159,6 +159,12 @@ private Q_SLOTS:
     */
    void update(const QString& dir);
 
+   /**
+    * @internal Updates the database for the directories changed since
+    * the last update
+    */
+   void recreateChanged();
+
    /**
     * @internal Executes kdontchangethehostname when hostname changes
     */
@@ -198,6 +204,11 @@ private:
 
    QStringList m_allResourceDirs;
 
+   /**
+    * Directories changed since the database was last updated
+    */
+   QSet<QString> m_changedDirs;
+
    static Kded *_self;
 };
 
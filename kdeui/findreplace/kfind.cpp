@@ -284,7 +284,7 @@ KFind::Result KFind::find()
             if ( d->options & KFind::RegularExpression )
                 d->index = KFind::find(d->text, *d->regExp, d->index, d->options, &d->matchedLength);
             else
-                d->index = KFind::find(d->text, d->pattern, d->index, d->options, &d->matchedLength);
+                d->index = d->literalMatcher().find(d->text, d->index, d->options, &d->matchedLength);
 
             if ( d->options & KFind::FindIncremental )
                 d->data[d->currentId].dirty = false;
@@ -425,49 +425,109 @@ static bool matchOk(const QString& text, int index, int matchedLength, long opti
     return false;
 }
 
-// static
-int KFind::find(const QString &text, const QString &pattern, int index, long options, int *matchedLength)
+KFindLiteralMatcher::KFindLiteralMatcher(const QString &pattern, Qt::CaseSensitivity cs)
+    : m_originalPattern(pattern), m_pattern(pattern), m_cs(cs)
 {
-    // Handle regular expressions in the appropriate way.
-    if (options & KFind::RegularExpression)
-    {
-        Qt::CaseSensitivity caseSensitive = (options & KFind::CaseSensitive) ? Qt::CaseSensitive : Qt::CaseInsensitive;
-        QRegExp regExp(pattern, caseSensitive);
+    if (m_cs == Qt::CaseInsensitive) {
+        QChar *p = m_pattern.data();
+        for (int i = 0; i < m_pattern.length(); ++i)
+            p[i] = p[i].toCaseFolded();
+    }
+    const int length = m_pattern.length();
+    const ushort *p = m_pattern.utf16();
+    for (int i = 0; i < 256; ++i) {
+        m_forwardSkip[i] = length;
+        m_backwardSkip[i] = length;
+    }
+    for (int i = 0; i < length - 1; ++i)
+        m_forwardSkip[p[i] & 0xff] = length - 1 - i;
+    for (int i = length - 1; i > 0; --i)
+        m_backwardSkip[p[i] & 0xff] = i;
+}
+
+int KFindLiteralMatcher::indexIn(const QString &text, int from) const
+{
+    const int length = m_pattern.length();
+    const int last = text.length() - length;
+    if (from < 0)
+        from = qMax(from + text.length(), 0);
+    if (length == 0)
+        return from <= text.length() ? from : -1;
+    if (from > last)
+        return -1;
+    const ushort *t = text.utf16();
+    const ushort *p = m_pattern.utf16();
+    const ushort lastChar = p[length - 1];
+    int pos = from;
+    while (pos <= last) {
+        const ushort ch = fold(t[pos + length - 1]);
+        if (ch == lastChar && matchesAt(t, pos, length - 1))
+            return pos;
+        pos += m_forwardSkip[ch & 0xff];
+    }
+    return -1;
+}
 
-        return find(text, regExp, index, options, matchedLength);
+int KFindLiteralMatcher::lastIndexIn(const QString &text, int from) const
+{
+    const int length = m_pattern.length();
+    if (length == 0)
+        return from <= text.length() ? from : -1;
+    int pos = qMin(from, text.length() - length);
+    const ushort *t = text.utf16();
+    const ushort firstChar = m_pattern.utf16()[0];
+    while (pos >= 0) {
+        const ushort ch = fold(t[pos]);
+        if (ch == firstChar && matchesAt(t + 1, pos, length - 1, 1))
+            return pos;
+        pos -= m_backwardSkip[ch & 0xff];
+    }
+    return -1;
+}
+
+bool KFindLiteralMatcher::matchesAt(const ushort *t, int pos, int count, int patternOffset) const
+{
+    const ushort *p = m_pattern.utf16() + patternOffset;
+    t += pos;
+    for (int i = 0; i < count; ++i) {
+        if (fold(t[i]) != p[i])
+            return false;
     }
+    return true;
+}
+
+int KFindLiteralMatcher::find(const QString &text, int index, long options, int *matchedLength) const
+{
+    const int length = m_pattern.length();
 
     // In Qt4 QString("aaaaaa").lastIndexOf("a",6) returns -1; we need
     // to start at text.length() - pattern.length() to give a valid index to QString.
     if (options & KFind::FindBackwards) {
-        index = qMin( qMax(0, text.length() - pattern.length()), index );
+        index = qMin( qMax(0, text.length() - length), index );
     }
 
-    Qt::CaseSensitivity caseSensitive = (options & KFind::CaseSensitive) ? Qt::CaseSensitive : Qt::CaseInsensitive;
-
     if (options & KFind::FindBackwards) {
         // Backward search, until the beginning of the line...
         while (index >= 0) {
             // ...find the next match.
-            index = text.lastIndexOf(pattern, index, caseSensitive);
+            index = lastIndexIn(text, index);
             if (index == -1)
                 break;
 
-            if (matchOk(text, index, pattern.length(), options))
+            if (matchOk(text, index, length, options))
                 break;
             index--;
-            kDebug() << "decrementing:" << index;
         }
     } else {
         // Forward search, until the end of the line...
         while (index <= text.length())
         {
             // ...find the next match.
-            index = text.indexOf(pattern, index, caseSensitive);
+            index = indexIn(text, index);
             if (index == -1)
                 break;
 
-            if (matchOk(text, index, pattern.length(), options))
+            if (matchOk(text, index, length, options))
                 break;
             index++;
         }
@@ -479,22 +539,51 @@ int KFind::find(const QString &text, const QString &pattern, int index, long opt
     if (index <= -1)
         *matchedLength = 0;
     else
-        *matchedLength = pattern.length();
+        *matchedLength = length;
     return index;
 }
 
-// Core method for the regexp-based find
+const KFindLiteralMatcher &KFind::Private::literalMatcher()
+{
+    const Qt::CaseSensitivity caseSensitive = (options & KFind::CaseSensitive) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    // the incremental search changes the pattern without going through setPattern()
+    if (!matcher || matcher->pattern() != pattern || matcher->caseSensitivity() != caseSensitive) {
+        delete matcher;
+        matcher = new KFindLiteralMatcher(pattern, caseSensitive);
+    }
+    return *matcher;
+}
+
+// static
+int KFind::find(const QString &text, const QString &pattern, int index, long options, int *matchedLength)
+{
+    // Handle regular expressions in the appropriate way.
+    if (options & KFind::RegularExpression)
+    {
+        Qt::CaseSensitivity caseSensitive = (options & KFind::CaseSensitive) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+        QRegExp regExp(pattern, caseSensitive);
+
+        return find(text, regExp, index, options, matchedLength);
+    }
+
+    Qt::CaseSensitivity caseSensitive = (options & KFind::CaseSensitive) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    const KFindLiteralMatcher matcher(pattern, caseSensitive);
+    return matcher.find(text, index, options, matchedLength);
+}
+
+// Core method for the regexp-based find.
+// The match is taken from a single indexIn()/lastIndexIn() call on the whole
+// text, which also leaves the captured texts in @p pattern for KReplace.
 static int doFind(const QString &text, const QRegExp &pattern, int index, long options, int *matchedLength)
 {
     if (options & KFind::FindBackwards) {
         // Backward search, until the beginning of the line...
         while (index >= 0) {
             // ...find the next match.
-            index = text.lastIndexOf(pattern, index);
+            index = pattern.lastIndexIn(text, index);
             if (index == -1)
                 break;
 
-            /*int pos =*/ pattern.indexIn( text.mid(index) );
             *matchedLength = pattern.matchedLength();
             if (matchOk(text, index, *matchedLength, options))
                 break;
@@ -504,11 +593,10 @@ static int doFind(const QString &text, const QRegExp &pattern, int index, long o
         // Forward search, until the end of the line...
         while (index <= text.length()) {
             // ...find the next match.
-            index = text.indexOf(pattern, index);
+            index = pattern.indexIn(text, index);
             if (index == -1)
                 break;
 
-            /*int pos =*/ pattern.indexIn( text.mid(index) );
             *matchedLength = pattern.matchedLength();
             if (matchOk(text, index, *matchedLength, options))
                 break;
@@ -523,46 +611,63 @@ static int doFind(const QString &text, const QRegExp &pattern, int index, long o
     return index;
 }
 
+static bool isLineBased(const QRegExp &pattern)
+{
+    const QString str = pattern.pattern();
+    return str.startsWith('^') || str.endsWith('$');
+}
+
 // Since QRegExp doesn't support multiline searches (the equivalent of perl's /m)
-// we have to cut the text into lines if the pattern starts with ^ or ends with $.
+// we have to search line by line if the pattern starts with ^ or ends with $.
+// The line boundaries are located on the fly, so only the lines actually
+// searched get copied.
 static int lineBasedFind(const QString &text, const QRegExp &pattern, int index, long options, int *matchedLength)
 {
-    const QStringList lines = text.split('\n');
-    int offset = 0;
     // Use "index" to find the first line we should start from
-    int startLineNumber = 0;
-    for (; startLineNumber < lines.count(); ++startLineNumber) {
-        const QString line = lines.at(startLineNumber);
-        if (index < offset + line.length()) {
+    int lineStart = 0;
+    int lineEnd = text.indexOf('\n');
+    bool pastEnd = false;
+    while (true) {
+        const int end = (lineEnd == -1) ? text.length() : lineEnd;
+        if (index < end)
+            break;
+        if (lineEnd == -1) {
+            pastEnd = true;
             break;
         }
-        offset += line.length() + 1 /*newline*/;
+        lineStart = lineEnd + 1;
+        lineEnd = text.indexOf('\n', lineStart);
     }
 
     if (options & KFind::FindBackwards) {
-
-        if (startLineNumber == lines.count()) {
-            // We went too far, go back to the last line
-            --startLineNumber;
-            offset -= lines.at(startLineNumber).length() + 1;
-        }
-
-        for (int lineNumber = startLineNumber; lineNumber >= 0; --lineNumber) {
-            const QString line = lines.at(lineNumber);
-            const int ret = doFind(line, pattern, lineNumber == startLineNumber ? index - offset : line.length(), options, matchedLength);
+        // When we went too far, we simply stay on the last line
+        bool first = true;
+        while (true) {
+            const int end = (lineEnd == -1) ? text.length() : lineEnd;
+            const QString line = text.mid(lineStart, end - lineStart);
+            const int ret = doFind(line, pattern, (first && !pastEnd) ? index - lineStart : line.length(), options, matchedLength);
             if (ret > -1)
-                return ret + offset;
-            offset -= line.length() + 1 /*newline*/;
+                return ret + lineStart;
+            if (lineStart == 0)
+                break;
+            lineEnd = lineStart - 1;
+            lineStart = (lineEnd == 0) ? 0 : text.lastIndexOf('\n', lineEnd - 1) + 1;
+            first = false;
         }
 
-    } else {
-        for (int lineNumber = startLineNumber; lineNumber < lines.count(); ++lineNumber) {
-            const QString line = lines.at(lineNumber);
-            const int ret = doFind(line, pattern, lineNumber == startLineNumber ? (index - offset) : 0, options, matchedLength);
-            if (ret > -1) {
-                return ret + offset;
-            }
-            offset += line.length() + 1 /*newline*/;
+    } else if (!pastEnd) {
+        bool first = true;
+        while (true) {
+            const int end = (lineEnd == -1) ? text.length() : lineEnd;
+            const QString line = text.mid(lineStart, end - lineStart);
+            const int ret = doFind(line, pattern, first ? (index - lineStart) : 0, options, matchedLength);
+            if (ret > -1)
+                return ret + lineStart;
+            if (lineEnd == -1)
+                break;
+            lineStart = lineEnd + 1;
+            lineEnd = text.indexOf('\n', lineStart);
+            first = false;
         }
     }
     return -1;
@@ -571,13 +676,85 @@ static int lineBasedFind(const QString &text, const QRegExp &pattern, int index,
 // static
 int KFind::find(const QString &text, const QRegExp &pattern, int index, long options, int *matchedLength)
 {
-    if (pattern.pattern().startsWith('^') || pattern.pattern().endsWith('$')) {
+    if (isLineBased(pattern)) {
         return lineBasedFind(text, pattern, index, options, matchedLength);
     }
 
     return doFind(text, pattern, index, options, matchedLength);
 }
 
+// Appends all non-overlapping matches of pattern in text to result,
+// shifting them by offset.
+static void findAllInText(const QString &text, const QRegExp &pattern, long options, int offset, QList<QPair<int, int> > &result)
+{
+    int index = 0;
+    while (index <= text.length()) {
+        index = pattern.indexIn(text, index);
+        if (index == -1)
+            break;
+        const int matchedLength = pattern.matchedLength();
+        if (matchOk(text, index, matchedLength, options)) {
+            result.append(qMakePair(index + offset, matchedLength));
+            index += qMax(matchedLength, 1);
+        } else {
+            ++index;
+        }
+    }
+}
+
+// static
+QList<QPair<int, int> > KFind::findAll(const QString &text, const QString &pattern, long options)
+{
+    if (options & KFind::RegularExpression) {
+        Qt::CaseSensitivity caseSensitive = (options & KFind::CaseSensitive) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+        return findAll(text, QRegExp(pattern, caseSensitive), options);
+    }
+
+    QList<QPair<int, int> > result;
+    if (pattern.isEmpty())
+        return result;
+
+    Qt::CaseSensitivity caseSensitive = (options & KFind::CaseSensitive) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    const KFindLiteralMatcher matcher(pattern, caseSensitive);
+    const int length = pattern.length();
+    int index = 0;
+    while ((index = matcher.indexIn(text, index)) != -1) {
+        if (matchOk(text, index, length, options)) {
+            result.append(qMakePair(index, length));
+            index += length;
+        } else {
+            ++index;
+        }
+    }
+    return result;
+}
+
+// static
+QList<QPair<int, int> > KFind::findAll(const QString &text, const QRegExp &pattern, long options)
+{
+    QList<QPair<int, int> > result;
+    if (pattern.isEmpty())
+        return result;
+
+    // Work on a copy, the captured texts of the caller's pattern are left alone
+    const QRegExp regExp(pattern);
+    if (!isLineBased(regExp)) {
+        findAllInText(text, regExp, options, 0, result);
+        return result;
+    }
+
+    int lineStart = 0;
+    while (true) {
+        const int lineEnd = text.indexOf('\n', lineStart);
+        const int end = (lineEnd == -1) ? text.length() : lineEnd;
+        findAllInText(text.mid(lineStart, end - lineStart), regExp, options, lineStart, result);
+        if (lineEnd == -1)
+            break;
+        lineStart = lineEnd + 1;
+    }
+    return result;
+}
+
 void KFind::Private::_k_slotFindNext()
 {
     emit q->findNext();
@@ -23,6 +23,8 @@
 
 #include <kdialog.h>
 #include <QtCore/QRect>
+#include <QtCore/QList>
+#include <QtCore/QPair>
 
 /**
  * @brief A generic implementation of the "find" function.
@@ -269,6 +271,28 @@ public:
 
     static int find( const QString &text, const QRegExp &pattern, int index, long options, int *matchedlength );
 
+    /**
+     * Search the given string for all the matches of a pattern in a single
+     * forward pass. Matches do not overlap; the FindBackwards option is ignored.
+     *
+     * This is considerably faster than calling find() in a loop when all the
+     * matches are needed, e.g. to highlight them or to replace all of them.
+     *
+     * @param text The string to search.
+     * @param pattern The pattern to look for. An empty pattern matches nothing.
+     * @param options The options to use.
+     * @return The index and length of every match, in increasing index order.
+     * @since 4.24
+     */
+    static QList<QPair<int, int> > findAll( const QString &text, const QString &pattern, long options );
+
+    /**
+     * @overload
+     * The captured texts of @p pattern are not modified.
+     * @since 4.24
+     */
+    static QList<QPair<int, int> > findAll( const QString &text, const QRegExp &pattern, long options );
+
     /**
      * Displays the final dialog saying "no match was found", if that was the case.
      * Call either this or shouldRestart().
@@ -31,6 +31,39 @@
 #include <QtCore/QPointer>
 #include <QtCore/QString>
 
+// Horspool matcher over UTF-16 code units. The skip table is indexed by the
+// low byte of each (case folded) code unit, which keeps it small while still
+// allowing large jumps through typical text.
+class KFindLiteralMatcher
+{
+public:
+    KFindLiteralMatcher(const QString &pattern, Qt::CaseSensitivity cs);
+
+    const QString &pattern() const { return m_originalPattern; }
+    Qt::CaseSensitivity caseSensitivity() const { return m_cs; }
+
+    // Like QString::indexOf(pattern, from, cs)
+    int indexIn(const QString &text, int from) const;
+    // Like QString::lastIndexOf(pattern, from, cs), for 0 <= from
+    int lastIndexIn(const QString &text, int from) const;
+    // Like KFind::find() with a literal pattern
+    int find(const QString &text, int index, long options, int *matchedLength) const;
+
+private:
+    ushort fold(ushort ch) const
+    {
+        return m_cs == Qt::CaseSensitive ? ch : QChar(ch).toCaseFolded().unicode();
+    }
+
+    // Compares count pattern code units, starting at patternOffset, with t + pos
+    bool matchesAt(const ushort *t, int pos, int count, int patternOffset = 0) const;
+
+    QString m_originalPattern;
+    QString m_pattern;
+    Qt::CaseSensitivity m_cs;
+    int m_forwardSkip[256];
+    int m_backwardSkip[256];
+};
 
 struct KFind::Private
 {
@@ -42,6 +75,7 @@ struct KFind::Private
         , patternChanged(false)
         , matchedPattern("")
         , emptyMatch(0)
+        , matcher(0)
     {
     }
 
@@ -53,6 +87,8 @@ struct KFind::Private
         data.clear();
         delete emptyMatch;
         emptyMatch = 0;
+        delete matcher;
+        matcher = 0;
     }
 
     struct Match
@@ -88,6 +124,8 @@ struct KFind::Private
 
     void init( const QString& pattern );
     void startNewIncrementalSearch();
+    // Built again only when the pattern or the case sensitivity changed
+    const KFindLiteralMatcher &literalMatcher();
 
     void _k_slotFindNext();
     void _k_slotDialogClosed();
@@ -104,6 +142,7 @@ struct KFind::Private
 
     QString pattern;
     QRegExp *regExp;
+    KFindLiteralMatcher *matcher;
     KDialog* dialog;
     long options;
     unsigned matches;
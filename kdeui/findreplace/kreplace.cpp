@@ -180,7 +180,7 @@ KFind::Result KReplace::replace()
         if ( df->options & KFind::RegularExpression )
             df->index = KFind::find(df->text, *df->regExp, df->index, df->options, &df->matchedLength);
         else
-            df->index = KFind::find(df->text, df->pattern, df->index, df->options, &df->matchedLength);
+            df->index = df->literalMatcher().find(df->text, df->index, df->options, &df->matchedLength);
 
 #ifdef DEBUG_REPLACE
         kDebug() << "KFind::find returned df->index=" << df->index;
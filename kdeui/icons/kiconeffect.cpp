@@ -28,7 +28,18 @@
 #include <math.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define KICONEFFECT_SSE2
+#endif
+
+#include <QtCore/QAtomicInt>
 #include <QtCore/QDebug>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVarLengthArray>
 #include <QtGui/QApplication>
 #include <QtGui/QPaintEngine>
 #include <QtGui/QDesktopWidget>
@@ -352,6 +363,182 @@ static bool painterSupportsAntialiasing()
    return pe && pe->hasFeature(QPaintEngine::Antialiasing);
 }
 
+#ifdef KICONEFFECT_SSE2
+// The SSE2 kernels below process 4 pixels at a time, each channel is kept in its own 32-bit
+// lane so that the integer math is the same as the one of the scalar code, the results are
+// bit-exact with it. The kernels return the first pixel they did not process, the scalar code
+// takes care of the remaining pixels. SSE2 is part of the x86-64 baseline so there is no need
+// for runtime detection.
+static inline __m128i kie_load(const QRgb *data)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+static inline void kie_store(QRgb *data, const __m128i pixels)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data), pixels);
+}
+
+static inline __m128i kie_alpha(const __m128i pixels)
+{
+    return _mm_srli_epi32(pixels, 24);
+}
+
+static inline __m128i kie_red(const __m128i pixels)
+{
+    return _mm_and_si128(_mm_srli_epi32(pixels, 16), _mm_set1_epi32(0xff));
+}
+
+static inline __m128i kie_green(const __m128i pixels)
+{
+    return _mm_and_si128(_mm_srli_epi32(pixels, 8), _mm_set1_epi32(0xff));
+}
+
+static inline __m128i kie_blue(const __m128i pixels)
+{
+    return _mm_and_si128(pixels, _mm_set1_epi32(0xff));
+}
+
+static inline __m128i kie_pack(const __m128i alpha, const __m128i red, const __m128i green, const __m128i blue)
+{
+    return _mm_or_si128(
+        _mm_or_si128(_mm_slli_epi32(alpha, 24), _mm_slli_epi32(red, 16)),
+        _mm_or_si128(_mm_slli_epi32(green, 8), blue)
+    );
+}
+
+// same as qGray(), (r * 11 + g * 16 + b * 5) / 32. the 16-bit multiplication is enough since
+// the upper half of the lanes is zero and the products are less than 65536
+static inline __m128i kie_gray(const __m128i pixels)
+{
+    const __m128i red = _mm_mullo_epi16(kie_red(pixels), _mm_set1_epi32(11));
+    const __m128i green = _mm_slli_epi32(kie_green(pixels), 4);
+    const __m128i blue = _mm_mullo_epi16(kie_blue(pixels), _mm_set1_epi32(5));
+    return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(red, green), blue), 5);
+}
+
+// (value * color + (0xFF - value) * channel) >> 8
+static inline __m128i kie_blend(const __m128i value, const __m128i inverse,
+                                const __m128i color, const __m128i channel)
+{
+    return _mm_srli_epi32(
+        _mm_add_epi32(_mm_mullo_epi16(value, color), _mm_mullo_epi16(inverse, channel)), 8
+    );
+}
+
+static QRgb* toGraySSE2(QRgb *data, QRgb *end)
+{
+    while ((end - data) >= 4) {
+        const __m128i pixels = kie_load(data);
+        const __m128i gray = kie_gray(pixels);
+        kie_store(data, kie_pack(kie_alpha(pixels), gray, gray, gray));
+        data += 4;
+    }
+    return data;
+}
+
+static QRgb* toGraySSE2(QRgb *data, QRgb *end, unsigned char val)
+{
+    const __m128i value = _mm_set1_epi32(val);
+    const __m128i inverse = _mm_set1_epi32(0xFF - val);
+    while ((end - data) >= 4) {
+        const __m128i pixels = kie_load(data);
+        const __m128i gray = kie_gray(pixels);
+        kie_store(data, kie_pack(
+            kie_alpha(pixels),
+            kie_blend(value, inverse, gray, kie_red(pixels)),
+            kie_blend(value, inverse, gray, kie_green(pixels)),
+            kie_blend(value, inverse, gray, kie_blue(pixels))
+        ));
+        data += 4;
+    }
+    return data;
+}
+
+static QRgb* colorizeSSE2(QRgb *data, QRgb *end, const QRgb *colors, unsigned char val)
+{
+    const __m128i value = _mm_set1_epi32(val);
+    const __m128i inverse = _mm_set1_epi32(0xFF - val);
+    quint32 grays[4];
+    while ((end - data) >= 4) {
+        const __m128i pixels = kie_load(data);
+        kie_store(grays, kie_gray(pixels));
+        const __m128i color = _mm_set_epi32(
+            colors[grays[3]], colors[grays[2]], colors[grays[1]], colors[grays[0]]
+        );
+        kie_store(data, kie_pack(
+            kie_alpha(pixels),
+            kie_blend(value, inverse, kie_red(color), kie_red(pixels)),
+            kie_blend(value, inverse, kie_green(color), kie_green(pixels)),
+            kie_blend(value, inverse, kie_blue(color), kie_blue(pixels))
+        ));
+        data += 4;
+    }
+    return data;
+}
+
+static QRgb* toMonochromeSSE2(QRgb *data, QRgb *end, bool grayscale, int threshold,
+                              QRgb black, QRgb white, unsigned char val)
+{
+    const __m128i value = _mm_set1_epi32(val);
+    const __m128i inverse = _mm_set1_epi32(0xFF - val);
+    const __m128i limit = _mm_set1_epi32(threshold);
+    const __m128i blackColor = _mm_set1_epi32(black);
+    const __m128i whiteColor = _mm_set1_epi32(white);
+    while ((end - data) >= 4) {
+        const __m128i pixels = kie_load(data);
+        const __m128i brightness = (grayscale ? kie_red(pixels) : kie_gray(pixels));
+        const __m128i isWhite = _mm_cmpgt_epi32(brightness, limit);
+        const __m128i color = _mm_or_si128(
+            _mm_and_si128(isWhite, whiteColor), _mm_andnot_si128(isWhite, blackColor)
+        );
+        kie_store(data, kie_pack(
+            kie_alpha(pixels),
+            kie_blend(value, inverse, kie_red(color), kie_red(pixels)),
+            kie_blend(value, inverse, kie_green(color), kie_green(pixels)),
+            kie_blend(value, inverse, kie_blue(color), kie_blue(pixels))
+        ));
+        data += 4;
+    }
+    return data;
+}
+
+static QRgb* semiTransparentSSE2(QRgb *data, QRgb *end)
+{
+    const __m128i colorMask = _mm_set1_epi32(0x00ffffff);
+    const __m128i alphaMask = _mm_set1_epi32(0x7f000000);
+    while ((end - data) >= 4) {
+        const __m128i pixels = kie_load(data);
+        kie_store(data, _mm_or_si128(
+            _mm_and_si128(pixels, colorMask),
+            _mm_and_si128(_mm_srli_epi32(pixels, 1), alphaMask)
+        ));
+        data += 4;
+    }
+    return data;
+}
+
+static QRgb* overlaySSE2(QRgb *sline, QRgb *send, const QRgb *oline)
+{
+    const __m128i full = _mm_set1_epi32(0xff);
+    while ((send - sline) >= 4) {
+        const __m128i spixels = kie_load(sline);
+        const __m128i opixels = kie_load(oline);
+        const __m128i value = kie_alpha(opixels);
+        const __m128i inverse = _mm_sub_epi32(full, value);
+        kie_store(sline, kie_pack(
+            _mm_max_epi16(value, kie_alpha(spixels)),
+            kie_blend(value, inverse, kie_red(opixels), kie_red(spixels)),
+            kie_blend(value, inverse, kie_green(opixels), kie_green(spixels)),
+            kie_blend(value, inverse, kie_blue(opixels), kie_blue(spixels))
+        ));
+        sline += 4;
+        oline += 4;
+    }
+    return sline;
+}
+#endif // KICONEFFECT_SSE2
+
 // Taken from KImageEffect. We don't want to link kdecore to kdeui! As long
 // as this code is not too big, it doesn't seem much of a problem to me.
 
@@ -367,6 +554,9 @@ void KIconEffect::toGray(QImage &img, float value)
 
     unsigned char gray;
     if (value == 1.0) {
+#ifdef KICONEFFECT_SSE2
+        data = toGraySSE2(data, end);
+#endif
         while(data != end) {
             gray = qGray(*data);
             *data = qRgba(gray, gray, gray, qAlpha(*data));
@@ -374,6 +564,9 @@ void KIconEffect::toGray(QImage &img, float value)
         }
     } else{
         unsigned char val = (unsigned char)(255.0*value);
+#ifdef KICONEFFECT_SSE2
+        data = toGraySSE2(data, end, val);
+#endif
         while (data != end) {
             gray = qGray(*data);
             *data = qRgba((val*gray+(0xFF-val)*qRed(*data)) >> 8,
@@ -395,11 +588,11 @@ void KIconEffect::colorize(QImage &img, const QColor &col, float value)
     QRgb *data = ii.data;
     QRgb *end = data + ii.pixels;
 
+    // the color depends only on the gray value of the pixel, compute it once for each
     float rcol = col.red(), gcol = col.green(), bcol = col.blue();
-    unsigned char red, green, blue, gray;
-    unsigned char val = (unsigned char)(255.0*value);
-    while (data != end) {
-        gray = qGray(*data);
+    unsigned char red, green, blue;
+    QRgb colors[256];
+    for (int gray = 0; gray < 256; gray++) {
         if (gray < 128) {
             red = static_cast<unsigned char>(rcol/128*gray);
             green = static_cast<unsigned char>(gcol/128*gray);
@@ -413,10 +606,18 @@ void KIconEffect::colorize(QImage &img, const QColor &col, float value)
             green = static_cast<unsigned char>(gcol);
             blue = static_cast<unsigned char>(bcol);
         }
+        colors[gray] = qRgb(red, green, blue);
+    }
 
-        *data = qRgba((val*red+(0xFF-val)*qRed(*data)) >> 8,
-                      (val*green+(0xFF-val)*qGreen(*data)) >> 8,
-                      (val*blue+(0xFF-val)*qBlue(*data)) >> 8,
+    unsigned char val = (unsigned char)(255.0*value);
+#ifdef KICONEFFECT_SSE2
+    data = colorizeSSE2(data, end, colors, val);
+#endif
+    while (data != end) {
+        const QRgb color = colors[qGray(*data)];
+        *data = qRgba((val*qRed(color)+(0xFF-val)*qRed(*data)) >> 8,
+                      (val*qGreen(color)+(0xFF-val)*qGreen(*data)) >> 8,
+                      (val*qBlue(color)+(0xFF-val)*qBlue(*data)) >> 8,
                       qAlpha(*data));
         ++data;
     }
@@ -432,19 +633,21 @@ void KIconEffect::toMonochrome(QImage &img, const QColor &black,
     KIEImgEdit ii(img);
     QRgb *data = ii.data;
     QRgb *end = data + ii.pixels;
+    if (ii.pixels == 0) {
+        return;
+    }
 
-    // Step 1: determine the average brightness
-    double values = 0.0, sum = 0.0;
+    // Step 1: determine the average brightness, the sum is exact in integer math
+    quint64 sum = 0;
     bool grayscale = true;
     while (data != end) {
         sum += qGray(*data)*qAlpha(*data) + 255*(255-qAlpha(*data));
-        values += 255;
         if ((qRed(*data) != qGreen(*data) ) || (qGreen(*data) != qBlue(*data))) {
             grayscale = false;
         }
         ++data;
     }
-    double medium = sum/values;
+    double medium = double(sum)/(255.0*double(ii.pixels));
 
     // Step 2: Modify the image
     unsigned char val = (unsigned char)(255.0*value);
@@ -452,6 +655,12 @@ void KIconEffect::toMonochrome(QImage &img, const QColor &black,
     int rb = black.red(), gb = black.green(), bb = black.blue();
     data = ii.data;
 
+#ifdef KICONEFFECT_SSE2
+    // the brightness is an integer, comparing it to the floor of the medium is the same
+    data = toMonochromeSSE2(data, end, grayscale, static_cast<int>(floor(medium)),
+                            qRgb(rb, gb, bb), qRgb(rw, gw, bw), val);
+#endif
+
     if (grayscale){
         while (data != end) {
             if (qRed(*data) <= medium) {
@@ -495,13 +704,22 @@ void KIconEffect::deSaturate(QImage &img, float value)
     QRgb *data = ii.data;
     QRgb *end = data + ii.pixels;
 
+    // icons consist mostly of runs of the same color, reuse the result of the previous pixel
     QColor color;
     int h, s, v;
+    QRgb lastRgb = 0, lastResult = 0;
+    bool hasLast = false;
     while (data != end) {
-        color.setRgb(*data);
-        color.getHsv(&h, &s, &v);
-        color.setHsv(h, (int) (s * (1.0 - value) + 0.5), v);
-        *data = qRgba(color.red(), color.green(), color.blue(), qAlpha(*data));
+        const QRgb rgb = (*data & 0x00ffffff);
+        if (!hasLast || rgb != lastRgb) {
+            color.setRgb(rgb);
+            color.getHsv(&h, &s, &v);
+            color.setHsv(h, (int) (s * (1.0 - value) + 0.5), v);
+            lastRgb = rgb;
+            lastResult = (color.rgb() & 0x00ffffff);
+            hasLast = true;
+        }
+        *data = (lastResult | (*data & ~0x00ffffff));
         ++data;
     }
 }
@@ -513,13 +731,12 @@ void KIconEffect::toGamma(QImage &img, float value)
     QRgb *end = data + ii.pixels;
 
     float gamma = 1/(2*value+0.5);
+    unsigned char table[256];
+    for (int i = 0; i < 256; i++) {
+        table[i] = static_cast<unsigned char>(pow(static_cast<float>(i)/255 , gamma)*255);
+    }
     while (data != end) {
-        *data = qRgba(static_cast<unsigned char>
-                      (pow(static_cast<float>(qRed(*data))/255 , gamma)*255),
-                      static_cast<unsigned char>
-                      (pow(static_cast<float>(qGreen(*data))/255 , gamma)*255),
-                      static_cast<unsigned char>
-                      (pow(static_cast<float>(qBlue(*data))/255 , gamma)*255),
+        *data = qRgba(table[qRed(*data)], table[qGreen(*data)], table[qBlue(*data)],
                       qAlpha(*data));
         ++data;
     }
@@ -536,16 +753,15 @@ void KIconEffect::semiTransparent(QImage &img)
         int height = img.height();
 
         if (painterSupportsAntialiasing()) {
-            unsigned char *line;
             for (y = 0; y < height; ++y) {
-#if Q_BYTE_ORDER == Q_BIG_ENDIAN
-                line = img.scanLine(y);
-#else
-                line = img.scanLine(y) + 3;
+                QRgb* line = (QRgb*)img.scanLine(y);
+                QRgb* end = line + width;
+#ifdef KICONEFFECT_SSE2
+                line = semiTransparentSSE2(line, end);
 #endif
-                for (x = 0; x < width; ++x){
-                    *line >>= 1;
-                    line += 4;
+                while (line != end) {
+                    *line = (*line & 0x00ffffff) | ((*line >> 1) & 0x7f000000);
+                    ++line;
                 }
             }
         } else {
@@ -669,7 +885,11 @@ void KIconEffect::overlay(QImage &src, QImage &overlay)
             oline = (QRgb*)overlay.scanLine(i);
             sline = (QRgb*)src.scanLine(i);
 
-            for (j = 0; j < src.width(); ++j) {
+            j = 0;
+#ifdef KICONEFFECT_SSE2
+            j = (overlaySSE2(sline, sline + src.width(), oline) - sline);
+#endif
+            for (; j < src.width(); ++j) {
                 r1 = qRed(oline[j]);
                 g1 = qGreen(oline[j]);
                 b1 = qBlue(oline[j]);
@@ -734,180 +954,410 @@ static const quint32 stack_blur8_shr[255] =
     24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24
 };
 
-inline static void blurHorizontal(QImage &image, unsigned int *stack, int div, int radius)
+// Separable stack blur on planes of 8-bit values. The horizontal pass blurs the columns of the
+// transposed plane so that both passes process adjacent columns, 4 at a time with SSE2. Large
+// planes are split into stripes of columns which are blurred by the global thread pool and the
+// calling thread.
+static const int s_blurParallelPixels = 256 * 256;
+static const int s_blurMinStripeWidth = 64;
+static const int s_blurMaxRadius = 254;
+
+#ifdef KICONEFFECT_SSE2
+// loads 4 adjacent 8-bit values into the 32-bit lanes
+static inline __m128i kie_load4(const uchar *data)
 {
-    int stackindex;
-    int stackstart;
-
-    quint32 * const pixels = reinterpret_cast<quint32 *>(image.bits());
-    quint32 pixel;
-
-    int w = image.width();
-    int h = image.height();
-    int wm = w - 1;
-
-    unsigned int mul_sum = stack_blur8_mul[radius];
-    unsigned int shr_sum = stack_blur8_shr[radius];
-
-    unsigned int sum, sum_in, sum_out;
+    quint32 four;
+    ::memcpy(&four, data, 4);
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(four), zero), zero);
+}
 
-    for (int y = 0; y < h; y++) {
-        sum     = 0;
-        sum_in  = 0;
-        sum_out = 0;
+static inline void kie_store4(uchar *data, const __m128i values)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const quint32 four = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(values, zero), zero));
+    ::memcpy(data, &four, 4);
+}
+#endif // KICONEFFECT_SSE2
 
-        const int yw = y * w;
-        pixel = pixels[yw];
+// blurs the columns from xstart to xend of the plane in place
+static void blurColumns(uchar *plane, int width, int height, int xstart, int xend, int radius)
+{
+    const int div = (radius * 2) + 1;
+    const int hm = height - 1;
+    const quint32 mul_sum = stack_blur8_mul[radius];
+    const quint32 shr_sum = stack_blur8_shr[radius];
+
+    int x = xstart;
+#ifdef KICONEFFECT_SSE2
+    QVarLengthArray<quint32, 1024> stack(div * 4);
+    quint32 *stackdata = stack.data();
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mul = _mm_set1_epi32(mul_sum);
+    const __m128i shr = _mm_cvtsi32_si128(shr_sum);
+    const __m128i evenMask = _mm_set_epi32(0, -1, 0, -1);
+    for (; (xend - x) >= 4; x += 4) {
+        __m128i sum = zero;
+        __m128i sum_in = zero;
+        __m128i sum_out = zero;
+
+        __m128i pixel = kie_load4(plane + x);
         for (int i = 0; i <= radius; i++) {
-            stack[i] = qAlpha(pixel);
-
-            sum += stack[i] * (i + 1);
-            sum_out += stack[i];
+            kie_store(stackdata + (i * 4), pixel);
+            sum = _mm_add_epi32(sum, _mm_mullo_epi16(pixel, _mm_set1_epi32(i + 1)));
+            sum_out = _mm_add_epi32(sum_out, pixel);
         }
 
         for (int i = 1; i <= radius; i++) {
-            pixel = pixels[yw + qMin(i, wm)];
-
-            unsigned int *stackpix = &stack[i + radius];
-            *stackpix = qAlpha(pixel);
-
-            sum    += *stackpix * (radius + 1 - i);
-            sum_in += *stackpix;
+            pixel = kie_load4(plane + (qMin(i, hm) * width) + x);
+            kie_store(stackdata + ((i + radius) * 4), pixel);
+            sum = _mm_add_epi32(sum, _mm_mullo_epi16(pixel, _mm_set1_epi32(radius + 1 - i)));
+            sum_in = _mm_add_epi32(sum_in, pixel);
         }
 
-        stackindex = radius;
-        for (int x = 0, i = yw; x < w; x++) {
-            pixels[i++] = (((sum * mul_sum) >> shr_sum) << 24) & 0xff000000;
+        int stackindex = radius;
+        for (int y = 0; y < height; y++) {
+            // (sum * mul_sum) >> shr_sum, SSE2 has no 32-bit multiplication so the even and the
+            // odd lanes are multiplied to 64 bits. The tables keep the product below 2^32.
+            const __m128i even = _mm_srl_epi64(_mm_mul_epu32(sum, mul), shr);
+            const __m128i odd = _mm_srl_epi64(_mm_mul_epu32(_mm_srli_epi64(sum, 32), mul), shr);
+            const __m128i result = _mm_or_si128(_mm_and_si128(even, evenMask), _mm_slli_epi64(odd, 32));
+            kie_store4(plane + (y * width) + x, result);
 
-            sum -= sum_out;
+            sum = _mm_sub_epi32(sum, sum_out);
 
-            stackstart = stackindex + div - radius;
+            int stackstart = stackindex + div - radius;
             if (stackstart >= div) {
                 stackstart -= div;
             }
 
-            unsigned int *stackpix = &stack[stackstart];
-
-            sum_out -= *stackpix;
-
-            pixel = pixels[yw + qMin(x + radius + 1, wm)];
+            quint32 *stackpix = stackdata + (stackstart * 4);
+            sum_out = _mm_sub_epi32(sum_out, kie_load(stackpix));
 
-            *stackpix = qAlpha(pixel);
+            pixel = kie_load4(plane + (qMin(y + radius + 1, hm) * width) + x);
+            kie_store(stackpix, pixel);
 
-            sum_in += *stackpix;
-            sum    += sum_in;
+            sum_in = _mm_add_epi32(sum_in, pixel);
+            sum = _mm_add_epi32(sum, sum_in);
 
             if (++stackindex >= div) {
                 stackindex = 0;
             }
 
-            stackpix = &stack[stackindex];
+            pixel = kie_load(stackdata + (stackindex * 4));
+            sum_out = _mm_add_epi32(sum_out, pixel);
+            sum_in = _mm_sub_epi32(sum_in, pixel);
+        }
+    }
+#endif // KICONEFFECT_SSE2
 
-            sum_out += *stackpix;
-            sum_in  -= *stackpix;
-        } // for (x = 0, ...)
-    } // for (y = 0, ...)
-}
+    QVarLengthArray<quint32, 512> scalarstack(div);
+    for (; x < xend; x++) {
+        quint32 sum = 0;
+        quint32 sum_in = 0;
+        quint32 sum_out = 0;
 
-inline static void blurVertical(QImage &image, unsigned int *stack, int div, int radius)
-{
-    int stackindex;
-    int stackstart;
+        quint32 pixel = plane[x];
+        for (int i = 0; i <= radius; i++) {
+            scalarstack[i] = pixel;
+            sum += pixel * (i + 1);
+            sum_out += pixel;
+        }
 
-    quint32 * const pixels = reinterpret_cast<quint32 *>(image.bits());
-    quint32 pixel;
+        for (int i = 1; i <= radius; i++) {
+            pixel = plane[(qMin(i, hm) * width) + x];
+            scalarstack[i + radius] = pixel;
+            sum += pixel * (radius + 1 - i);
+            sum_in += pixel;
+        }
+
+        int stackindex = radius;
+        for (int y = 0; y < height; y++) {
+            plane[(y * width) + x] = ((sum * mul_sum) >> shr_sum);
+
+            sum -= sum_out;
 
-    int w = image.width();
-    int h = image.height();
-    int hm = h - 1;
+            int stackstart = stackindex + div - radius;
+            if (stackstart >= div) {
+                stackstart -= div;
+            }
 
-    int mul_sum = stack_blur8_mul[radius];
-    int shr_sum = stack_blur8_shr[radius];
+            sum_out -= scalarstack[stackstart];
 
-    unsigned int sum, sum_in, sum_out;
+            pixel = plane[(qMin(y + radius + 1, hm) * width) + x];
+            scalarstack[stackstart] = pixel;
 
-    for (int x = 0; x < w; x++) {
-        sum     = 0;
-        sum_in  = 0;
-        sum_out = 0;
+            sum_in += pixel;
+            sum += sum_in;
 
-        pixel = pixels[x];
-        for (int i = 0; i <= radius; i++) {
-            stack[i] = qAlpha(pixel);
+            if (++stackindex >= div) {
+                stackindex = 0;
+            }
 
-            sum += stack[i] * (i + 1);
-            sum_out += stack[i];
+            sum_out += scalarstack[stackindex];
+            sum_in -= scalarstack[stackindex];
         }
+    }
+}
 
-        for (int i = 1; i <= radius; i++) {
-            pixel = pixels[qMin(i, hm) * w + x];
+// Stripes of a plane that the pool threads and the calling thread take turns to blur. The
+// calling thread blurs every stripe that no pool thread has taken, it never waits for a runnable
+// that has not started, so it is safe to blur from a thread of the global pool. Runnables that
+// start after all stripes were taken find nothing to do, which is why the job is refcounted.
+class KIconEffectBlurJob
+{
+public:
+    KIconEffectBlurJob(uchar *plane, int width, int height, int radius, int stripewidth, int stripes);
+
+    // blurs the next stripe nobody has taken yet, returns false if there is none
+    bool blurNextStripe();
+    void deref();
+
+    QAtomicInt ref;
+    QSemaphore done;
+
+private:
+    uchar* m_plane;
+    int m_width;
+    int m_height;
+    int m_radius;
+    int m_stripewidth;
+    int m_stripes;
+    QAtomicInt m_next;
+};
 
-            unsigned int *stackpix = &stack[i + radius];
-            *stackpix = qAlpha(pixel);
+KIconEffectBlurJob::KIconEffectBlurJob(uchar *plane, int width, int height, int radius,
+                                       int stripewidth, int stripes)
+    : ref(1),
+    m_plane(plane),
+    m_width(width),
+    m_height(height),
+    m_radius(radius),
+    m_stripewidth(stripewidth),
+    m_stripes(stripes),
+    m_next(0)
+{
+}
 
-            sum    += *stackpix * (radius + 1 - i);
-            sum_in += *stackpix;
-        }
+bool KIconEffectBlurJob::blurNextStripe()
+{
+    const int stripe = m_next.fetchAndAddOrdered(1);
+    if (stripe >= m_stripes) {
+        return false;
+    }
+    const int xstart = (stripe * m_stripewidth);
+    const int xend = ((stripe + 1) == m_stripes ? m_width : (xstart + m_stripewidth));
+    blurColumns(m_plane, m_width, m_height, xstart, xend, m_radius);
+    done.release();
+    return true;
+}
 
-        stackindex = radius;
-        for (int y = 0, i = x; y < h; y++, i += w) {
-            pixels[i] = (((sum * mul_sum) >> shr_sum) << 24) & 0xff000000;
+void KIconEffectBlurJob::deref()
+{
+    if (!ref.deref()) {
+        delete this;
+    }
+}
 
-            sum -= sum_out;
+class KIconEffectBlurRunnable : public QRunnable
+{
+public:
+    KIconEffectBlurRunnable(KIconEffectBlurJob *job);
+    ~KIconEffectBlurRunnable();
 
-            stackstart = stackindex + div - radius;
-            if (stackstart >= div) {
-                stackstart -= div;
-            }
+protected:
+    void run() final;
 
-            unsigned int *stackpix = &stack[stackstart];
+private:
+    KIconEffectBlurJob* m_job;
+};
+
+KIconEffectBlurRunnable::KIconEffectBlurRunnable(KIconEffectBlurJob *job)
+    : QRunnable(),
+    m_job(job)
+{
+    m_job->ref.ref();
+    setAutoDelete(true);
+}
 
-            sum_out -= *stackpix;
+KIconEffectBlurRunnable::~KIconEffectBlurRunnable()
+{
+    m_job->deref();
+}
 
-            pixel = pixels[qMin(y + radius + 1, hm) * w + x];
+void KIconEffectBlurRunnable::run()
+{
+    while (m_job->blurNextStripe()) {
+        ;
+    }
+}
 
-            *stackpix = qAlpha(pixel);
+static void blurColumnsParallel(uchar *plane, int width, int height, int radius)
+{
+    int stripes = 1;
+    if ((width * height) >= s_blurParallelPixels) {
+        stripes = qBound(1, width / s_blurMinStripeWidth, QThread::idealThreadCount());
+    }
+    if (stripes <= 1) {
+        blurColumns(plane, width, height, 0, width, radius);
+        return;
+    }
 
-            sum_in += *stackpix;
-            sum    += sum_in;
+    // multiple of 4 so that only the last stripe has columns for the scalar code
+    const int stripewidth = (((width / stripes) + 3) & ~3);
+    stripes = ((width + stripewidth - 1) / stripewidth);
+    KIconEffectBlurJob *job = new KIconEffectBlurJob(plane, width, height, radius, stripewidth, stripes);
+    for (int i = 1; i < stripes; i++) {
+        QThreadPool::globalInstance()->start(new KIconEffectBlurRunnable(job));
+    }
+    while (job->blurNextStripe()) {
+        ;
+    }
+    // only waits for the stripes that pool threads are blurring right now
+    job->done.acquire(stripes);
+    job->deref();
+}
 
-            if (++stackindex >= div) {
-                stackindex = 0;
+// transposes the width x height source plane into the height x width destination plane
+static void transposePlane(const uchar *source, uchar *destination, int width, int height)
+{
+    // in blocks so that the reads and the writes stay in the cache
+    static const int blocksize = 64;
+    for (int by = 0; by < height; by += blocksize) {
+        const int bymax = qMin(by + blocksize, height);
+        for (int bx = 0; bx < width; bx += blocksize) {
+            const int bxmax = qMin(bx + blocksize, width);
+            for (int y = by; y < bymax; y++) {
+                const uchar *sourceline = source + (y * width);
+                for (int x = bx; x < bxmax; x++) {
+                    destination[(x * height) + y] = sourceline[x];
+                }
             }
+        }
+    }
+}
 
-            stackpix = &stack[stackindex];
+static void stackBlurPlane(uchar *plane, int width, int height, int radius)
+{
+    QByteArray transposed(width * height, char(0));
+    uchar *transposeddata = reinterpret_cast<uchar*>(transposed.data());
+    transposePlane(plane, transposeddata, width, height);
+    blurColumnsParallel(transposeddata, height, width, radius);
+    transposePlane(transposeddata, plane, height, width);
+    blurColumnsParallel(plane, width, height, radius);
+}
 
-            sum_out += *stackpix;
-            sum_in  -= *stackpix;
-        } // for (y = 0, ...)
-    } // for (x = 0, ...)
+static int blurRadius(float radius)
+{
+    return qBound(0, qRound(radius), s_blurMaxRadius);
 }
 
-static void stackBlur(QImage &image, float radius)
+// Qt's rounding of (x * a) / 255
+static inline uint kie_multiply(uint x, uint a)
 {
-    radius = qRound(radius);
+    const uint t = (x * a) + 128;
+    return ((t + (t >> 8)) >> 8);
+}
 
-    int div = int(radius * 2) + 1;
-    unsigned int *stack  = new unsigned int[div];
+void KIconEffect::blur(QImage &image, float radius)
+{
+    const int r = blurRadius(radius);
+    if (r < 1 || image.isNull()) {
+        return;
+    }
 
-    blurHorizontal(image, stack, div, radius);
-    blurVertical(image, stack, div, radius);
+    if (image.format() != QImage::Format_ARGB32_Premultiplied) {
+        image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
 
-    delete [] stack;
+    const int width = image.width();
+    const int height = image.height();
+    const int planesize = (width * height);
+    QByteArray planes(planesize * 4, char(0));
+    uchar *alpha = reinterpret_cast<uchar*>(planes.data());
+    uchar *red = alpha + planesize;
+    uchar *green = red + planesize;
+    uchar *blue = green + planesize;
+    for (int y = 0; y < height; y++) {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < width; x++) {
+            const int i = (y * width) + x;
+            alpha[i] = qAlpha(line[x]);
+            red[i] = qRed(line[x]);
+            green[i] = qGreen(line[x]);
+            blue[i] = qBlue(line[x]);
+        }
+    }
+
+    stackBlurPlane(alpha, width, height, r);
+    stackBlurPlane(red, width, height, r);
+    stackBlurPlane(green, width, height, r);
+    stackBlurPlane(blue, width, height, r);
+
+    for (int y = 0; y < height; y++) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < width; x++) {
+            const int i = (y * width) + x;
+            // the channels of a premultiplied pixel can not exceed its alpha
+            const uchar a = alpha[i];
+            line[x] = qRgba(qMin(red[i], a), qMin(green[i], a), qMin(blue[i], a), a);
+        }
+    }
 }
 
 void KIconEffect::shadowBlur(QImage &image, float radius, const QColor &color)
 {
-    if (radius < 0) {
+    if (radius < 0 || image.isNull()) {
         return;
     }
 
-    if (radius > 0) {
-        stackBlur(image, radius);
+    // the alpha channel is enough for a shadow, only that is blurred
+    if (image.format() != QImage::Format_ARGB32_Premultiplied
+        && image.format() != QImage::Format_ARGB32) {
+        image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
     }
 
-    // Correct the color and opacity of the shadow
-    QPainter p(&image);
-    p.setCompositionMode(QPainter::CompositionMode_SourceIn);
-    p.fillRect(image.rect(), color);
+    const int width = image.width();
+    const int height = image.height();
+    QByteArray plane(width * height, char(0));
+    uchar *alpha = reinterpret_cast<uchar*>(plane.data());
+    for (int y = 0; y < height; y++) {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < width; x++) {
+            alpha[(y * width) + x] = qAlpha(line[x]);
+        }
+    }
+
+    const int r = blurRadius(radius);
+    if (r > 0) {
+        stackBlurPlane(alpha, width, height, r);
+    }
+
+    // Correct the color and opacity of the shadow, same as filling with the color using the
+    // SourceIn composition mode
+    const bool premultiplied = (image.format() == QImage::Format_ARGB32_Premultiplied);
+    const uint colorAlpha = color.alpha();
+    uint colorRed = color.red();
+    uint colorGreen = color.green();
+    uint colorBlue = color.blue();
+    if (premultiplied) {
+        colorRed = kie_multiply(colorRed, colorAlpha);
+        colorGreen = kie_multiply(colorGreen, colorAlpha);
+        colorBlue = kie_multiply(colorBlue, colorAlpha);
+    }
+    for (int y = 0; y < height; y++) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < width; x++) {
+            const uint a = alpha[(y * width) + x];
+            const uint resultAlpha = kie_multiply(colorAlpha, a);
+            if (resultAlpha == 0) {
+                line[x] = 0;
+            } else if (premultiplied) {
+                line[x] = qRgba(kie_multiply(colorRed, a), kie_multiply(colorGreen, a),
+                                kie_multiply(colorBlue, a), resultAlpha);
+            } else {
+                line[x] = qRgba(colorRed, colorGreen, colorBlue, resultAlpha);
+            }
+        }
+    }
 }
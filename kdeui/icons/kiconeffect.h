@@ -215,6 +215,7 @@ public:
     /**
      * Blurs the alpha channel of the image and recolors it to the specified color.
      * The image must have transparent padding on all sides, or the shadow will be clipped.
+     * Large images are blurred by multiple threads.
      *
      * @param image The image
      * @param radius The radius of the effect
@@ -222,6 +223,17 @@ public:
      */
     static void shadowBlur(QImage &image, float radius, const QColor &color);
 
+    /**
+     * Blurs all channels of the image. The image is converted to
+     * QImage::Format_ARGB32_Premultiplied if it is in a different format. Large images are
+     * blurred by multiple threads.
+     *
+     * @param image The image
+     * @param radius The radius of the effect
+     * @since 4.24
+     */
+    static void blur(QImage &image, float radius);
+
 private:
     KIconEffectPrivate* const d;
 };
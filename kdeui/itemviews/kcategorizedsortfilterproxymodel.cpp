@@ -28,13 +28,19 @@
 #include <QStringList>
 #include <QSize>
 
-#include <kstringhandler.h>
-
 KCategorizedSortFilterProxyModel::KCategorizedSortFilterProxyModel(QObject *parent)
     : QSortFilterProxyModel(parent)
     , d(new Private())
 
 {
+    connect(this, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+            this, SLOT(_k_clearCategoryKeys()));
+    connect(this, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+            this, SLOT(_k_clearCategoryKeys()));
+    connect(this, SIGNAL(layoutChanged()),
+            this, SLOT(_k_clearCategoryKeys()));
+    connect(this, SIGNAL(modelReset()),
+            this, SLOT(_k_clearCategoryKeys()));
 }
 
 KCategorizedSortFilterProxyModel::~KCategorizedSortFilterProxyModel()
@@ -135,7 +141,8 @@ int KCategorizedSortFilterProxyModel::compareCategories(const QModelIndex &left,
 
         if (d->sortCategoriesByNaturalComparison)
         {
-            return KStringHandler::naturalCompare(lstr, rstr);
+            const int result = qstrcmp(d->categoryKey(lstr), d->categoryKey(rstr));
+            return (result < 0 ? -1 : (result > 0 ? 1 : 0));
         }
         else
         {
@@ -168,3 +175,5 @@ int KCategorizedSortFilterProxyModel::compareCategories(const QModelIndex &left,
 
     return 0;
 }
+
+#include "moc_kcategorizedsortfilterproxymodel.cpp"
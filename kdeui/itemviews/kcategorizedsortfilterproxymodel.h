@@ -169,6 +169,8 @@ protected:
 private:
     class Private;
     Private *const d;
+
+    Q_PRIVATE_SLOT(d, void _k_clearCategoryKeys())
 };
 
 
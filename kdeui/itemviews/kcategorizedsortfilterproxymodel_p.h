@@ -22,6 +22,10 @@
 #ifndef KCATEGORIZEDSORTFILTERPROXYMODEL_P_H
 #define KCATEGORIZEDSORTFILTERPROXYMODEL_P_H
 
+#include <QtCore/QHash>
+
+#include <kstringhandler.h>
+
 class KCategorizedSortFilterProxyModel;
 
 class KCategorizedSortFilterProxyModel::Private
@@ -39,10 +43,32 @@ public:
     {
     }
 
+    /**
+      * Returns the natural sort key of the category, categories are few and are compared
+      * for every pair of items while sorting.
+      */
+    const QByteArray& categoryKey(const QString &category)
+    {
+        QHash<QString, QByteArray>::iterator it = categoryKeys.find(category);
+        if (it == categoryKeys.end()) {
+            it = categoryKeys.insert(category, KStringHandler::naturalSortKey(category));
+        }
+        return it.value();
+    }
+
+    /**
+      * The categories of the removed and changed items may not be there anymore.
+      */
+    void _k_clearCategoryKeys()
+    {
+        categoryKeys.clear();
+    }
+
     int sortColumn;
     Qt::SortOrder sortOrder;
     bool categorizedModel;
     bool sortCategoriesByNaturalComparison;
+    QHash<QString, QByteArray> categoryKeys;
 };
 
 #endif
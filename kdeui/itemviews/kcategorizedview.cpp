@@ -56,12 +56,11 @@ struct KCategorizedView::Private::Item
 struct KCategorizedView::Private::Block
 {
     Block()
-        : topLeft(QPoint())
-        , height(-1)
+        : height(-1)
+        , order(-1)
         , firstIndex(QModelIndex())
         , quarantineStart(QModelIndex())
         , items(QList<Item>())
-        , outOfQuarantine(false)
         , alternate(false)
         , collapsed(false)
     {
@@ -72,15 +71,9 @@ struct KCategorizedView::Private::Block
         return firstIndex != rhs.firstIndex;
     }
 
-    static bool lessThan(const Block &left, const Block &right)
-    {
-        Q_ASSERT(left.firstIndex.isValid());
-        Q_ASSERT(right.firstIndex.isValid());
-        return left.firstIndex.row() < right.firstIndex.row();
-    }
-
-    QPoint topLeft;
     int height;
+    // position of the block in Private::blockOrder
+    int order;
     QPersistentModelIndex firstIndex;
     // if we have n elements on this block, and we inserted an element at position i. The quarantine
     // will start at index (i, column, parent). This means that for all elements j where i <= j <= n, the
@@ -91,11 +84,6 @@ struct KCategorizedView::Private::Block
     QPersistentModelIndex quarantineStart;
     QList<Item> items;
 
-    // this affects the whole block, not items separately. items contain the topLeft point relative
-    // to the block. Because of insertions or removals a whole block can be moved, so the whole block
-    // will enter in quarantine, what is faster than moving all items in absolute terms.
-    bool outOfQuarantine;
-
     // should we alternate its color ? is just a hint, could not be used
     bool alternate;
     bool collapsed;
@@ -112,6 +100,8 @@ KCategorizedView::Private::Private(KCategorizedView *q)
     , hoveredIndex(QModelIndex())
     , pressedPosition(QPoint())
     , rubberBandRect(QRect())
+    , validBlockOffsets(0)
+    , blockOrderDirty(false)
 {
 }
 
@@ -183,33 +173,108 @@ QPair<QModelIndex, QModelIndex> KCategorizedView::Private::intersectingIndexesWi
 
 QPoint KCategorizedView::Private::blockPosition(const QString &category)
 {
-    Block &block = blocks[category];
+    ensureBlockOrder();
 
-    if (block.outOfQuarantine && !block.topLeft.isNull()) {
-        return block.topLeft;
+    QHash<QString, Block>::ConstIterator it = blocks.constFind(category);
+    if (it == blocks.constEnd() || it->order < 0) {
+        return QPoint(categorySpacing, 0);
     }
 
-    QPoint res(categorySpacing, 0);
+    return QPoint(categorySpacing, blockOffset(it->order));
+}
 
-    const QModelIndex index = block.firstIndex;
+void KCategorizedView::Private::ensureBlockOrder()
+{
+    if (!blockOrderDirty) {
+        return;
+    }
 
-    for (QHash<QString, Private::Block>::Iterator it = blocks.begin(); it != blocks.end(); ++it) {
-        Block &block = *it;
-        const QModelIndex categoryIndex = block.firstIndex;
-        if (index.row() < categoryIndex.row()) {
-            continue;
+    QList<QPair<int, QString> > rows;
+    rows.reserve(blocks.count());
+    for (QHash<QString, Block>::Iterator it = blocks.begin(); it != blocks.end(); ++it) {
+        if (it->firstIndex.isValid()) {
+            rows.append(qMakePair(it->firstIndex.row(), it.key()));
+        } else {
+            it->order = -1;
         }
-        res.ry() += categoryDrawer->categoryHeight(categoryIndex, q->viewOptions()) + categorySpacing;
-        if (index.row() == categoryIndex.row()) {
-            continue;
+    }
+    qSort(rows);
+
+    blockOrder.clear();
+    blockOrder.reserve(rows.count());
+    for (int i = 0; i < rows.count(); ++i) {
+        Block &block = blocks[rows.at(i).second];
+        block.order = i;
+        block.alternate = i % 2;
+        blockOrder.append(rows.at(i).second);
+    }
+
+    blockOffsets.resize(blockOrder.count());
+    validBlockOffsets = 0;
+    blockOrderDirty = false;
+}
+
+void KCategorizedView::Private::invalidateBlockPositions(const QString &category)
+{
+    if (blockOrderDirty) {
+        return;
+    }
+
+    QHash<QString, Block>::ConstIterator it = blocks.constFind(category);
+    if (it == blocks.constEnd() || it->order < 0) {
+        validBlockOffsets = 0;
+        return;
+    }
+
+    validBlockOffsets = qMin(validBlockOffsets, it->order + 1);
+}
+
+void KCategorizedView::Private::clearBlocks()
+{
+    blocks.clear();
+    blockOrder.clear();
+    blockOffsets.clear();
+    validBlockOffsets = 0;
+    blockOrderDirty = false;
+}
+
+int KCategorizedView::Private::blockOffset(int order)
+{
+    Q_ASSERT(!blockOrderDirty);
+    Q_ASSERT(order >= 0 && order < blockOrder.count());
+
+    while (validBlockOffsets <= order) {
+        const int i = validBlockOffsets;
+        const QModelIndex categoryIndex = blocks.value(blockOrder.at(i)).firstIndex;
+        int offset = 0;
+        if (i > 0) {
+            offset = blockOffsets.at(i - 1) + blockHeight(blockOrder.at(i - 1));
         }
-        res.ry() += blockHeight(it.key());
+        offset += categoryDrawer->categoryHeight(categoryIndex, q->viewOptions()) + categorySpacing;
+        blockOffsets[i] = offset;
+        ++validBlockOffsets;
     }
 
-    block.outOfQuarantine = true;
-    block.topLeft = res;
+    return blockOffsets.at(order);
+}
 
-    return res;
+int KCategorizedView::Private::blockIndexAt(int y)
+{
+    ensureBlockOrder();
+
+    // the bottom of every block is above the top of the next one
+    int bottom = 0;
+    int top = blockOrder.count() - 1;
+    while (bottom <= top) {
+        const int middle = (bottom + top) / 2;
+        if (blockOffset(middle) + blockHeight(blockOrder.at(middle)) <= y) {
+            bottom = middle + 1;
+        } else {
+            top = middle - 1;
+        }
+    }
+
+    return bottom;
 }
 
 int KCategorizedView::Private::blockHeight(const QString &category)
@@ -252,10 +317,10 @@ void KCategorizedView::Private::regenerateAllElements()
 {
     for (QHash<QString, Block>::Iterator it = blocks.begin(); it != blocks.end(); ++it) {
         Block &block = *it;
-        block.outOfQuarantine = false;
         block.quarantineStart = block.firstIndex;
         block.height = -1;
     }
+    validBlockOffsets = 0;
 }
 
 void KCategorizedView::Private::rowsInserted(const QModelIndex &parent, int start, int end)
@@ -283,6 +348,20 @@ void KCategorizedView::Private::rowsInserted(const QModelIndex &parent, int star
         }
         //END: update firstIndex
 
+        //BEGIN: update the block order
+        // blocks are usually appended, e.g. while items are streamed in
+        if (!firstIndex.isValid() && !blockOrderDirty) {
+            if (blockOrder.isEmpty() || blocks.value(blockOrder.last()).firstIndex.row() < index.row()) {
+                block.order = blockOrder.count();
+                block.alternate = block.order % 2;
+                blockOrder.append(category);
+                blockOffsets.resize(blockOrder.count());
+            } else {
+                blockOrderDirty = true;
+            }
+        }
+        //END: update the block order
+
         Q_ASSERT(block.firstIndex.isValid());
 
         const int firstIndexRow = block.firstIndex.row();
@@ -306,25 +385,7 @@ void KCategorizedView::Private::rowsInserted(const QModelIndex &parent, int star
     //BEGIN: mark as in quarantine those categories that are under the affected ones
     {
         const QModelIndex firstIndex = proxyModel->index(start, q->modelColumn(), parent);
-        const QString category = categoryForIndex(firstIndex);
-        const QModelIndex firstAffectedCategory = blocks[category].firstIndex;
-        //BEGIN: order for marking as alternate those blocks that are alternate
-        QList<Block> blockList = blocks.values();
-        qSort(blockList.begin(), blockList.end(), Block::lessThan);
-        QList<int> firstIndexesRows;
-        foreach (const Block &block, blockList) {
-            firstIndexesRows << block.firstIndex.row();
-        }
-        //END: order for marking as alternate those blocks that are alternate
-        for (QHash<QString, Private::Block>::Iterator it = blocks.begin(); it != blocks.end(); ++it) {
-            Private::Block &block = *it;
-            if (block.firstIndex.row() > firstAffectedCategory.row()) {
-                block.outOfQuarantine = false;
-                block.alternate = firstIndexesRows.indexOf(block.firstIndex.row()) % 2;
-            } else if (block.firstIndex.row() == firstAffectedCategory.row()) {
-                block.alternate = firstIndexesRows.indexOf(block.firstIndex.row()) % 2;
-            }
-        }
+        invalidateBlockPositions(categoryForIndex(firstIndex));
     }
     //END: mark as in quarantine those categories that are under the affected ones
 }
@@ -512,7 +573,7 @@ void KCategorizedView::setModel(QAbstractItemModel *model)
         return;
     }
 
-    d->blocks.clear();
+    d->clearBlocks();
 
     if (d->proxyModel) {
         disconnect(d->proxyModel, SIGNAL(layoutChanged()), this, SLOT(slotLayoutChanged()));
@@ -656,11 +717,7 @@ void KCategorizedView::setCategorySpacing(int categorySpacing)
     }
 
     d->categorySpacing = categorySpacing;
-
-    for (QHash<QString, Private::Block>::Iterator it = d->blocks.begin(); it != d->blocks.end(); ++it) {
-        Private::Block &block = *it;
-        block.outOfQuarantine = false;
-    }
+    d->validBlockOffsets = 0;
 }
 
 bool KCategorizedView::alternatingBlockColors() const
@@ -774,7 +831,7 @@ QModelIndex KCategorizedView::indexAt(const QPoint &point) const
 
 void KCategorizedView::reset()
 {
-    d->blocks.clear();
+    d->clearBlocks();
     QListView::reset();
 }
 
@@ -793,9 +850,10 @@ void KCategorizedView::paintEvent(QPaintEvent *event)
     Q_ASSERT(selectionModel()->model() == d->proxyModel);
 
     //BEGIN: draw categories
-    QHash<QString, Private::Block>::ConstIterator it(d->blocks.constBegin());
-    while (it != d->blocks.constEnd()) {
-        const Private::Block &block = *it;
+    // blocks are ordered from top to bottom, start with the first one reaching into the viewport
+    for (int i = d->blockIndexAt(verticalOffset()); i < d->blockOrder.count(); ++i) {
+        const QString category = d->blockOrder.at(i);
+        const Private::Block &block = d->blocks[category];
         const QModelIndex categoryIndex = d->proxyModel->index(block.firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
         QStyleOptionViewItemV4 option(viewOptions());
         option.features |= d->alternatingBlockColors && block.alternate ? QStyleOptionViewItemV4::Alternate
@@ -803,18 +861,19 @@ void KCategorizedView::paintEvent(QPaintEvent *event)
         option.state |= !d->collapsibleBlocks || !block.collapsed ? QStyle::State_Open
                                                                   : QStyle::State_None;
         const int height = d->categoryDrawer->categoryHeight(categoryIndex, option);
-        QPoint pos = d->blockPosition(it.key());
+        QPoint pos = d->blockPosition(category);
         pos.ry() -= height;
         option.rect.setTopLeft(pos);
         option.rect.setWidth(d->viewportWidth() + d->categoryDrawer->leftMargin() + d->categoryDrawer->rightMargin());
-        option.rect.setHeight(height + d->blockHeight(it.key()));
+        option.rect.setHeight(height + d->blockHeight(category));
         option.rect = d->mapToViewport(option.rect);
+        if (option.rect.top() > viewport()->rect().bottom()) {
+            break;
+        }
         if (!option.rect.intersects(viewport()->rect())) {
-            ++it;
             continue;
         }
         d->categoryDrawer->drawCategory(categoryIndex, d->proxyModel->sortRole(), option, &p);
-        ++it;
     }
     //END: draw categories
 
@@ -954,37 +1013,37 @@ void KCategorizedView::mouseMoveEvent(QMouseEvent *event)
     if (!d->categoryDrawer) {
         return;
     }
-    QHash<QString, Private::Block>::ConstIterator it(d->blocks.constBegin());
-    while (it != d->blocks.constEnd()) {
-        const Private::Block &block = *it;
+    const QPoint mousePos = viewport()->mapFromGlobal(QCursor::pos());
+    const int blockIndex = d->blockIndexAt(mousePos.y() + verticalOffset());
+    if (blockIndex < d->blockOrder.count()) {
+        const QString category = d->blockOrder.at(blockIndex);
+        const Private::Block &block = d->blocks[category];
         const QModelIndex categoryIndex = d->proxyModel->index(block.firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
         QStyleOptionViewItemV4 option(viewOptions());
         const int height = d->categoryDrawer->categoryHeight(categoryIndex, option);
-        QPoint pos = d->blockPosition(it.key());
+        QPoint pos = d->blockPosition(category);
         pos.ry() -= height;
         option.rect.setTopLeft(pos);
         option.rect.setWidth(d->viewportWidth() + d->categoryDrawer->leftMargin() + d->categoryDrawer->rightMargin());
-        option.rect.setHeight(height + d->blockHeight(it.key()));
+        option.rect.setHeight(height + d->blockHeight(category));
         option.rect = d->mapToViewport(option.rect);
-        const QPoint mousePos = viewport()->mapFromGlobal(QCursor::pos());
         if (option.rect.contains(mousePos)) {
             if (d->categoryDrawer && d->hoveredBlock->height != -1 && *d->hoveredBlock != block) {
                 const QModelIndex categoryIndex = d->proxyModel->index(d->hoveredBlock->firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
                 const QStyleOptionViewItemV4 option = d->blockRect(categoryIndex);
                 d->categoryDrawer->mouseLeft(categoryIndex, option.rect);
                 *d->hoveredBlock = block;
-                d->hoveredCategory = it.key();
+                d->hoveredCategory = category;
                 viewport()->update(option.rect);
             } else if (d->hoveredBlock->height == -1) {
                 *d->hoveredBlock = block;
-                d->hoveredCategory = it.key();
+                d->hoveredCategory = category;
             } else {
                 d->categoryDrawer->mouseMoved(categoryIndex, option.rect, event);
             }
             viewport()->update(option.rect);
             return;
         }
-        ++it;
     }
     if (d->categoryDrawer && d->hoveredBlock->height != -1) {
         const QModelIndex categoryIndex = d->proxyModel->index(d->hoveredBlock->firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
@@ -1007,12 +1066,12 @@ void KCategorizedView::mousePressEvent(QMouseEvent *event)
         QListView::mousePressEvent(event);
         return;
     }
-    QHash<QString, Private::Block>::ConstIterator it(d->blocks.constBegin());
-    while (it != d->blocks.constEnd()) {
-        const Private::Block &block = *it;
+    const QPoint mousePos = viewport()->mapFromGlobal(QCursor::pos());
+    const int blockIndex = d->blockIndexAt(mousePos.y() + verticalOffset());
+    if (blockIndex < d->blockOrder.count()) {
+        const Private::Block &block = d->blocks[d->blockOrder.at(blockIndex)];
         const QModelIndex categoryIndex = d->proxyModel->index(block.firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
         const QStyleOptionViewItemV4 option = d->blockRect(categoryIndex);
-        const QPoint mousePos = viewport()->mapFromGlobal(QCursor::pos());
         if (option.rect.contains(mousePos)) {
             d->categoryDrawer->mouseButtonPressed(categoryIndex, option.rect, event);
             viewport()->update(option.rect);
@@ -1021,7 +1080,6 @@ void KCategorizedView::mousePressEvent(QMouseEvent *event)
             }
             return;
         }
-        ++it;
     }
     QListView::mousePressEvent(event);
 }
@@ -1034,12 +1092,12 @@ void KCategorizedView::mouseReleaseEvent(QMouseEvent *event)
         QListView::mouseReleaseEvent(event);
         return;
     }
-    QHash<QString, Private::Block>::ConstIterator it(d->blocks.constBegin());
-    while (it != d->blocks.constEnd()) {
-        const Private::Block &block = *it;
+    const QPoint mousePos = viewport()->mapFromGlobal(QCursor::pos());
+    const int blockIndex = d->blockIndexAt(mousePos.y() + verticalOffset());
+    if (blockIndex < d->blockOrder.count()) {
+        const Private::Block &block = d->blocks[d->blockOrder.at(blockIndex)];
         const QModelIndex categoryIndex = d->proxyModel->index(block.firstIndex.row(), d->proxyModel->sortColumn(), rootIndex());
         const QStyleOptionViewItemV4 option = d->blockRect(categoryIndex);
-        const QPoint mousePos = viewport()->mapFromGlobal(QCursor::pos());
         if (option.rect.contains(mousePos)) {
             d->categoryDrawer->mouseButtonReleased(categoryIndex, option.rect, event);
             viewport()->update(option.rect);
@@ -1048,7 +1106,6 @@ void KCategorizedView::mouseReleaseEvent(QMouseEvent *event)
             }
             return;
         }
-        ++it;
     }
     QListView::mouseReleaseEvent(event);
 }
@@ -1208,7 +1265,7 @@ void KCategorizedView::rowsAboutToBeRemoved(const QModelIndex &parent,
     d->hoveredCategory = QString();
 
     if (end - start + 1 == d->proxyModel->rowCount()) {
-        d->blocks.clear();
+        d->clearBlocks();
         QListView::rowsAboutToBeRemoved(parent, start, end);
         return;
     }
@@ -1288,29 +1345,15 @@ void KCategorizedView::rowsAboutToBeRemoved(const QModelIndex &parent,
     }
     //END: update the items that are in quarantine in affected categories
 
-    Q_FOREACH (const QString &category, listOfCategoriesMarkedForRemoval) {
-        d->blocks.remove(category);
-    }
-
     //BEGIN: mark as in quarantine those categories that are under the affected ones
-    {
-        //BEGIN: order for marking as alternate those blocks that are alternate
-        QList<Private::Block> blockList = d->blocks.values();
-        qSort(blockList.begin(), blockList.end(), Private::Block::lessThan);
-        QList<int> firstIndexesRows;
-        foreach (const Private::Block &block, blockList) {
-            firstIndexesRows << block.firstIndex.row();
-        }
-        //END: order for marking as alternate those blocks that are alternate
-        for (QHash<QString, Private::Block>::Iterator it = d->blocks.begin(); it != d->blocks.end(); ++it) {
-            Private::Block &block = *it;
-            if (block.firstIndex.row() > start) {
-                block.outOfQuarantine = false;
-                block.alternate = firstIndexesRows.indexOf(block.firstIndex.row()) % 2;
-            } else if (block.firstIndex.row() == start) {
-                block.alternate = firstIndexesRows.indexOf(block.firstIndex.row()) % 2;
-            }
+    if (listOfCategoriesMarkedForRemoval.isEmpty()) {
+        const QModelIndex firstIndex = d->proxyModel->index(start, modelColumn(), parent);
+        d->invalidateBlockPositions(d->categoryForIndex(firstIndex));
+    } else {
+        Q_FOREACH (const QString &category, listOfCategoriesMarkedForRemoval) {
+            d->blocks.remove(category);
         }
+        d->blockOrderDirty = true;
     }
     //END: mark as in quarantine those categories that are under the affected ones
 
@@ -1462,7 +1505,7 @@ void KCategorizedView::slotLayoutChanged()
         return;
     }
 
-    d->blocks.clear();
+    d->clearBlocks();
     *d->hoveredBlock = Private::Block();
     d->hoveredCategory = QString();
     if (d->proxyModel->rowCount()) {
@@ -21,6 +21,9 @@
 #ifndef KCATEGORIZEDVIEW_P_H
 #define KCATEGORIZEDVIEW_P_H
 
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
 class KCategorizedSortFilterProxyModel;
 class KCategoryDrawer;
 
@@ -59,11 +62,44 @@ public:
     /**
       * Returns the position of the block of @p category.
       *
-      * Complexity: O(n) where n is the number of different categories when the block has been
-      *             marked as in quarantine. O(1) the rest of the times (the vast majority).
+      * Complexity: O(n) where n is the number of blocks above whose position has been
+      *             invalidated. O(1) the rest of the times (the vast majority).
       */
     QPoint blockPosition(const QString &category);
 
+    /**
+      * Sorts the blocks by the row of their first index if blocks have been inserted in between
+      * or removed, and updates whether they alternate.
+      *
+      * Complexity: O(n log(n)) where n is the number of different categories when the order
+      *             changed. O(1) the rest of the times.
+      */
+    void ensureBlockOrder();
+
+    /**
+      * Marks the positions of the blocks under the block of @p category as invalid.
+      */
+    void invalidateBlockPositions(const QString &category);
+
+    /**
+      * Removes all blocks.
+      */
+    void clearBlocks();
+
+    /**
+      * Returns the vertical position of the items of the block at @p order, computing the
+      * positions of the blocks above it as needed.
+      */
+    int blockOffset(int order);
+
+    /**
+      * Returns the order of the first block whose bottom is at or under @p y in absolute terms,
+      * or the number of blocks if there is none.
+      *
+      * Complexity: O(log(n)) where n is the number of different categories.
+      */
+    int blockIndexAt(int y);
+
     /**
       * Returns the height of the block determined by @p category.
       */
@@ -150,6 +186,14 @@ public:
     QRect rubberBandRect;
 
     QHash<QString, Block> blocks;
+
+    // the categories ordered by the row of their first index, and the prefix sums of the
+    // category and block heights: blockOffsets[i] is the position of the items of block i.
+    // Only the first validBlockOffsets positions are up to date.
+    QStringList blockOrder;
+    QVector<int> blockOffsets;
+    int validBlockOffsets;
+    bool blockOrderDirty;
 };
 
 #endif // KCATEGORIZEDVIEW_P_H
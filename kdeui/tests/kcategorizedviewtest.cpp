@@ -0,0 +1,231 @@
+/*  This file is part of the KDE libraries
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License version 2, as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include <qtest_kde.h>
+
+#include <kcategorizedview.h>
+#include <kcategorizedsortfilterproxymodel.h>
+#include <kcategorydrawer.h>
+
+#include <QStandardItemModel>
+
+static const QSize s_gridSize = QSize(50, 50);
+
+class KCategorizedViewTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testInsertRows();
+    void testInsertCategory();
+    void testRemoveRows();
+    void testRemoveCategory();
+
+private:
+    void addItem(const QString &text, const QString &category);
+    void removeItem(const QString &text);
+    void verifyLayout();
+
+    QStandardItemModel *m_model;
+    KCategorizedSortFilterProxyModel *m_proxyModel;
+    KCategorizedView *m_view;
+    KCategoryDrawer *m_drawer;
+};
+
+QTEST_KDEMAIN(KCategorizedViewTest, GUI)
+
+static void setupView(KCategorizedView *view, QAbstractItemModel *model, KCategoryDrawer *drawer)
+{
+    view->setViewMode(QListView::IconMode);
+    view->setGridSize(s_gridSize);
+    view->setCategoryDrawer(drawer);
+    view->setModel(model);
+    // large enough to never need a scroll bar
+    view->resize(500, 800);
+}
+
+void KCategorizedViewTest::init()
+{
+    m_model = new QStandardItemModel(this);
+    m_proxyModel = new KCategorizedSortFilterProxyModel(this);
+    m_proxyModel->setCategorizedModel(true);
+    m_proxyModel->setDynamicSortFilter(true);
+    m_proxyModel->setSourceModel(m_model);
+    m_proxyModel->sort(0);
+
+    addItem("b1", "B");
+    addItem("b2", "B");
+    addItem("b3", "B");
+    addItem("d1", "D");
+    addItem("d2", "D");
+    addItem("f1", "F");
+    addItem("f2", "F");
+    addItem("f3", "F");
+    addItem("f4", "F");
+
+    m_drawer = new KCategoryDrawer();
+    m_view = new KCategorizedView();
+    setupView(m_view, m_proxyModel, m_drawer);
+    m_view->show();
+    QVERIFY(QTest::qWaitForWindowShown(m_view));
+    verifyLayout();
+}
+
+void KCategorizedViewTest::cleanup()
+{
+    delete m_view;
+    m_view = nullptr;
+    delete m_drawer;
+    m_drawer = nullptr;
+    delete m_proxyModel;
+    m_proxyModel = nullptr;
+    delete m_model;
+    m_model = nullptr;
+}
+
+void KCategorizedViewTest::addItem(const QString &text, const QString &category)
+{
+    QStandardItem *item = new QStandardItem(text);
+    item->setData(category, KCategorizedSortFilterProxyModel::CategoryDisplayRole);
+    item->setData(category, KCategorizedSortFilterProxyModel::CategorySortRole);
+    m_model->appendRow(item);
+}
+
+void KCategorizedViewTest::removeItem(const QString &text)
+{
+    const QList<QStandardItem*> items = m_model->findItems(text);
+    QCOMPARE(items.count(), 1);
+    m_model->removeRow(items.first()->row());
+}
+
+// checks the layout of the view, which was updated as the rows changed, against the layout
+// expected from the grid and against a view that lays out the same rows from scratch
+void KCategorizedViewTest::verifyLayout()
+{
+    QVERIFY(m_proxyModel->rowCount() > 0);
+
+    KCategoryDrawer freshDrawer;
+    KCategorizedView freshView;
+    setupView(&freshView, m_proxyModel, &freshDrawer);
+    freshView.show();
+    QVERIFY(QTest::qWaitForWindowShown(&freshView));
+
+    const int headerHeight = m_drawer->categoryHeight(QModelIndex(), QStyleOption()) + m_view->categorySpacing();
+    const int viewportWidth = m_view->viewport()->width() - m_view->categorySpacing() * 2
+                              - m_drawer->leftMargin() - m_drawer->rightMargin();
+    const int itemsPerRow = qMax(viewportWidth / s_gridSize.width(), 1);
+
+    QString category;
+    int blockTop = 0;
+    int blockRow = 0;
+    int nextBlockTop = headerHeight;
+    for (int row = 0; row < m_proxyModel->rowCount(); ++row) {
+        const QModelIndex index = m_proxyModel->index(row, 0);
+        const QRect rect = m_view->visualRect(index);
+        QVERIFY(rect.isValid());
+        QCOMPARE(rect, freshView.visualRect(index));
+
+        // the blocks follow each other in the order of their first rows, each one under the
+        // header of its category
+        const QString indexCategory = index.data(KCategorizedSortFilterProxyModel::CategoryDisplayRole).toString();
+        if (indexCategory != category) {
+            QVERIFY(indexCategory > category);
+            category = indexCategory;
+            blockTop = nextBlockTop;
+            blockRow = row;
+        }
+
+        const int relativeRow = row - blockRow;
+        QCOMPARE(rect.top(), blockTop + (relativeRow / itemsPerRow) * s_gridSize.height());
+        if (relativeRow % itemsPerRow != 0) {
+            QVERIFY(rect.left() > m_view->visualRect(m_proxyModel->index(row - 1, 0)).left());
+        }
+        nextBlockTop = rect.top() + s_gridSize.height() + headerHeight;
+    }
+}
+
+void KCategorizedViewTest::testInsertRows()
+{
+    // moves the blocks under the first one
+    addItem("b4", "B");
+    addItem("b0", "B");
+    verifyLayout();
+
+    // in the middle and at the end
+    addItem("d3", "D");
+    addItem("f5", "F");
+    verifyLayout();
+
+    // more than a whole row of items, so that the first block grows
+    for (int i = 5; i < 15; ++i) {
+        addItem(QString::fromLatin1("b%1").arg(i), "B");
+    }
+    verifyLayout();
+}
+
+void KCategorizedViewTest::testInsertCategory()
+{
+    // in between the others
+    addItem("c1", "C");
+    verifyLayout();
+    addItem("e1", "E");
+    addItem("e2", "E");
+    verifyLayout();
+
+    // at the top and at the bottom
+    addItem("a1", "A");
+    addItem("g1", "G");
+    verifyLayout();
+}
+
+void KCategorizedViewTest::testRemoveRows()
+{
+    // the first, a middle and the last item of a block
+    removeItem("f1");
+    verifyLayout();
+    removeItem("f3");
+    verifyLayout();
+    removeItem("f4");
+    verifyLayout();
+
+    // moves the blocks under the first one
+    removeItem("b2");
+    verifyLayout();
+}
+
+void KCategorizedViewTest::testRemoveCategory()
+{
+    // in between the others
+    removeItem("d1");
+    removeItem("d2");
+    verifyLayout();
+
+    // at the top
+    removeItem("b1");
+    removeItem("b2");
+    removeItem("b3");
+    verifyLayout();
+
+    // a category that comes back
+    addItem("d1", "D");
+    verifyLayout();
+}
+
+#include "kcategorizedviewtest.moc"
@@ -163,6 +163,12 @@ void TestKFind::testStaticFindString_data()
     QTest::newRow("back, at begin, found") << "a" << "a" << 0 << int(KFind::FindBackwards) << 0 << 1;
     QTest::newRow("back, at end, found") << "a" << "a" << 1 << int(KFind::FindBackwards) << 0 << 1;
     QTest::newRow("back, text shorter than pattern") << "a" << "abcd" << 0 << int(KFind::FindBackwards) << -1 << 0;
+    QTest::newRow("case insensitive") << "xAbCab" << "abc" << 0 << int(0) << 1 << 3;
+    QTest::newRow("case sensitive") << "xAbCabc" << "abc" << 0 << int(KFind::CaseSensitive) << 4 << 3;
+    QTest::newRow("case insensitive, backwards") << "abcxABC" << "Abc" << 7 << int(KFind::FindBackwards) << 4 << 3;
+    QTest::newRow("case insensitive, non-latin") << QString::fromUtf8("xÄÖü") << QString::fromUtf8("äöÜ") << 0 << int(0) << 1 << 3;
+    QTest::newRow("long pattern") << "abcabdabcabcabe abcabcabe" << "abcabcabe" << 0 << int(0) << 6 << 9;
+    QTest::newRow("long pattern, backwards") << "abcabcabe abcabcabe" << "abcabcabe" << 9 << int(KFind::FindBackwards) << 0 << 9;
 }
 
 void TestKFind::testStaticFindString()
@@ -239,6 +245,58 @@ void TestKFind::testStaticFindRegexp()
     QCOMPARE(matchedLength, expectedMatchedLength);
 }
 
+void TestKFind::testFindAll_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<int>("options");
+    QTest::addColumn<QString>("expectedMatches"); // "index:length" pairs
+
+    QTest::newRow("simple") << "abc bcbc" << "bc" << 0 << "1:2 4:2 6:2";
+    QTest::newRow("no overlap") << "aaaaa" << "aa" << 0 << "0:2 2:2";
+    QTest::newRow("not found") << "abc" << "d" << 0 << "";
+    QTest::newRow("empty") << "abc" << "" << 0 << "";
+    QTest::newRow("case insensitive") << "Ab aB" << "ab" << 0 << "0:2 3:2";
+    QTest::newRow("case sensitive") << "Ab ab" << "ab" << int(KFind::CaseSensitive) << "3:2";
+    QTest::newRow("whole words") << "abc bcbc bc bmore bc" << "bc" << int(KFind::WholeWordsOnly) << "9:2 18:2";
+    QTest::newRow("regexp") << "abc bcbc bc" << "b." << int(KFind::RegularExpression) << "1:2 4:2 6:2 9:2";
+    QTest::newRow("regexp, whole words") << "abc bcbc bc" << "b." << int(KFind::RegularExpression | KFind::WholeWordsOnly) << "9:2";
+    QTest::newRow("regexp, variable length") << "a aa aaa" << "a+" << int(KFind::RegularExpression) << "0:1 2:2 5:3";
+    QTest::newRow("regexp, empty matches") << "ab" << "x*" << int(KFind::RegularExpression) << "0:0 1:0 2:0";
+    QTest::newRow("^multiline") << "bar\nfoo\nbar" << "^b." << int(KFind::RegularExpression) << "0:2 8:2";
+    QTest::newRow("multiline$") << "bar\nbaz\nbar" << "ar$" << int(KFind::RegularExpression) << "1:2 9:2";
+    QTest::newRow("multiline$, empty last line") << "bar\n" << "r$" << int(KFind::RegularExpression) << "2:1";
+}
+
+void TestKFind::testFindAll()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, pattern);
+    QFETCH(int, options);
+    QFETCH(QString, expectedMatches);
+
+    QStringList matches;
+    typedef QPair<int, int> Match;
+    foreach (const Match &match, KFind::findAll(text, pattern, options)) {
+        matches.append(QString::number(match.first) + ':' + QString::number(match.second));
+    }
+    QCOMPARE(matches.join(" "), expectedMatches);
+
+    // The result must be the same as calling KFind::find() repeatedly
+    if (!pattern.isEmpty()) {
+        QStringList found;
+        int index = 0;
+        int matchedLength = 0;
+        while ((index = KFind::find(text, pattern, index, options, &matchedLength)) != -1) {
+            found.append(QString::number(index) + ':' + QString::number(matchedLength));
+            index += qMax(matchedLength, 1);
+            if (index > text.length())
+                break;
+        }
+        QCOMPARE(found.join(" "), expectedMatches);
+    }
+}
+
 void TestKFind::testSimpleSearch()
 {
     // first we do a simple text searching the text and doing a few find nexts
@@ -369,6 +427,73 @@ void TestKFind::testFindIncrementalDynamic()
     QCOMPARE(test.hits().join(""), output3);
 }
 
+void TestKFind::benchmarkFind_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<int>("options");
+
+    QTest::newRow("literal") << "Free Software Foundation, Inc." << int(KFind::CaseSensitive);
+    QTest::newRow("literal, case insensitive") << "free software foundation, inc." << int(0);
+    QTest::newRow("literal, backwards") << "This file is part" << int(KFind::FindBackwards | KFind::CaseSensitive);
+    QTest::newRow("regexp") << "Fou?ndation, Inc\\." << int(KFind::RegularExpression | KFind::CaseSensitive);
+    QTest::newRow("regexp, multiline") << "^    Boston" << int(KFind::RegularExpression | KFind::CaseSensitive);
+}
+
+void TestKFind::benchmarkFind()
+{
+    QFETCH(QString, pattern);
+    QFETCH(int, options);
+
+    // A large text with the match near its far end
+    QString text;
+    for (int i = 0; i < 200; ++i) {
+        text += m_text;
+    }
+    text.replace("Free Software Foundation, Inc.", "Free Software Foundation");
+    text.replace("    Boston", "Boston");
+    if (options & KFind::FindBackwards) {
+        text.replace("This file is part", "This file is a part");
+        text.prepend(m_text);
+    } else {
+        text += m_text;
+    }
+
+    const int startIndex = (options & KFind::FindBackwards) ? text.length() : 0;
+    int result = -1;
+    int matchedLength = 0;
+    QBENCHMARK {
+        result = KFind::find(text, pattern, startIndex, options, &matchedLength);
+    }
+    QVERIFY(result != -1);
+}
+
+void TestKFind::benchmarkFindAll_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<int>("options");
+
+    QTest::newRow("literal") << "library" << int(0);
+    QTest::newRow("regexp") << "Libr?ary" << int(KFind::RegularExpression);
+    QTest::newRow("regexp, multiline") << "^    [A-Z]" << int(KFind::RegularExpression);
+}
+
+void TestKFind::benchmarkFindAll()
+{
+    QFETCH(QString, pattern);
+    QFETCH(int, options);
+
+    QString text;
+    for (int i = 0; i < 100; ++i) {
+        text += m_text;
+    }
+
+    int count = 0;
+    QBENCHMARK {
+        count = KFind::findAll(text, pattern, options).count();
+    }
+    QVERIFY(count > 0);
+}
+
 QTEST_KDEMAIN(TestKFind, GUI)
 
 #include "moc_kfindtest.cpp"
@@ -71,6 +71,8 @@ private Q_SLOTS:
     void testStaticFindString();
     void testStaticFindRegexp_data();
     void testStaticFindRegexp();
+    void testFindAll_data();
+    void testFindAll();
 
     void testSimpleSearch();
     void testSimpleRegexp();
@@ -78,6 +80,11 @@ private Q_SLOTS:
     void testFindIncremental();
     void testFindIncrementalDynamic();
 
+    void benchmarkFind_data();
+    void benchmarkFind();
+    void benchmarkFindAll_data();
+    void benchmarkFindAll();
+
 private:
     QString m_text;
 };
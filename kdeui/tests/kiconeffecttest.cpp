@@ -0,0 +1,556 @@
+/* This file is part of the KDE libraries
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License version 2 as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include <QtTest/QtTestGui>
+#include <QElapsedTimer>
+#include <QDesktopWidget>
+#include <QPaintEngine>
+
+#include <qtest_kde.h>
+#include <kiconeffect.h>
+
+#include <math.h>
+
+// the scalar implementations the optimized ones must be bit-exact with
+static void referenceToGray(QImage &img, float value)
+{
+    unsigned char val = (unsigned char)(255.0*value);
+    for (int y = 0; y < img.height(); y++) {
+        QRgb *data = (QRgb*)img.scanLine(y);
+        for (int x = 0; x < img.width(); x++) {
+            const unsigned char gray = qGray(data[x]);
+            if (value == 1.0) {
+                data[x] = qRgba(gray, gray, gray, qAlpha(data[x]));
+            } else {
+                data[x] = qRgba((val*gray+(0xFF-val)*qRed(data[x])) >> 8,
+                                (val*gray+(0xFF-val)*qGreen(data[x])) >> 8,
+                                (val*gray+(0xFF-val)*qBlue(data[x])) >> 8,
+                                qAlpha(data[x]));
+            }
+        }
+    }
+}
+
+static void referenceColorize(QImage &img, const QColor &col, float value)
+{
+    float rcol = col.red(), gcol = col.green(), bcol = col.blue();
+    unsigned char red, green, blue, gray;
+    unsigned char val = (unsigned char)(255.0*value);
+    for (int y = 0; y < img.height(); y++) {
+        QRgb *data = (QRgb*)img.scanLine(y);
+        for (int x = 0; x < img.width(); x++) {
+            gray = qGray(data[x]);
+            if (gray < 128) {
+                red = static_cast<unsigned char>(rcol/128*gray);
+                green = static_cast<unsigned char>(gcol/128*gray);
+                blue = static_cast<unsigned char>(bcol/128*gray);
+            } else if(gray > 128) {
+                red = static_cast<unsigned char>((gray-128)*(2-rcol/128)+rcol-1);
+                green = static_cast<unsigned char>((gray-128)*(2-gcol/128)+gcol-1);
+                blue = static_cast<unsigned char>((gray-128)*(2-bcol/128)+bcol-1);
+            } else{
+                red = static_cast<unsigned char>(rcol);
+                green = static_cast<unsigned char>(gcol);
+                blue = static_cast<unsigned char>(bcol);
+            }
+            data[x] = qRgba((val*red+(0xFF-val)*qRed(data[x])) >> 8,
+                            (val*green+(0xFF-val)*qGreen(data[x])) >> 8,
+                            (val*blue+(0xFF-val)*qBlue(data[x])) >> 8,
+                            qAlpha(data[x]));
+        }
+    }
+}
+
+static void referenceToMonochrome(QImage &img, const QColor &black, const QColor &white, float value)
+{
+    double values = 0.0, sum = 0.0;
+    bool grayscale = true;
+    for (int y = 0; y < img.height(); y++) {
+        const QRgb *data = (const QRgb*)img.constScanLine(y);
+        for (int x = 0; x < img.width(); x++) {
+            sum += qGray(data[x])*qAlpha(data[x]) + 255*(255-qAlpha(data[x]));
+            values += 255;
+            if ((qRed(data[x]) != qGreen(data[x]) ) || (qGreen(data[x]) != qBlue(data[x]))) {
+                grayscale = false;
+            }
+        }
+    }
+    double medium = sum/values;
+
+    unsigned char val = (unsigned char)(255.0*value);
+    for (int y = 0; y < img.height(); y++) {
+        QRgb *data = (QRgb*)img.scanLine(y);
+        for (int x = 0; x < img.width(); x++) {
+            const int brightness = (grayscale ? qRed(data[x]) : qGray(data[x]));
+            const QColor color = (brightness <= medium ? black : white);
+            data[x] = qRgba((val*color.red()+(0xFF-val)*qRed(data[x])) >> 8,
+                            (val*color.green()+(0xFF-val)*qGreen(data[x])) >> 8,
+                            (val*color.blue()+(0xFF-val)*qBlue(data[x])) >> 8,
+                            qAlpha(data[x]));
+        }
+    }
+}
+
+static void referenceDeSaturate(QImage &img, float value)
+{
+    QColor color;
+    int h, s, v;
+    for (int y = 0; y < img.height(); y++) {
+        QRgb *data = (QRgb*)img.scanLine(y);
+        for (int x = 0; x < img.width(); x++) {
+            color.setRgb(data[x]);
+            color.getHsv(&h, &s, &v);
+            color.setHsv(h, (int) (s * (1.0 - value) + 0.5), v);
+            data[x] = qRgba(color.red(), color.green(), color.blue(), qAlpha(data[x]));
+        }
+    }
+}
+
+static void referenceToGamma(QImage &img, float value)
+{
+    float gamma = 1/(2*value+0.5);
+    for (int y = 0; y < img.height(); y++) {
+        QRgb *data = (QRgb*)img.scanLine(y);
+        for (int x = 0; x < img.width(); x++) {
+            data[x] = qRgba(static_cast<unsigned char>
+                            (pow(static_cast<float>(qRed(data[x]))/255 , gamma)*255),
+                            static_cast<unsigned char>
+                            (pow(static_cast<float>(qGreen(data[x]))/255 , gamma)*255),
+                            static_cast<unsigned char>
+                            (pow(static_cast<float>(qBlue(data[x]))/255 , gamma)*255),
+                            qAlpha(data[x]));
+        }
+    }
+}
+
+static void referenceOverlay(QImage &src, const QImage &overlay)
+{
+    for (int y = 0; y < src.height(); y++) {
+        const QRgb *oline = (const QRgb*)overlay.constScanLine(y);
+        QRgb *sline = (QRgb*)src.scanLine(y);
+        for (int x = 0; x < src.width(); x++) {
+            const int a1 = qAlpha(oline[x]);
+            sline[x] = qRgba((a1 * qRed(oline[x]) + (0xff - a1) * qRed(sline[x])) >> 8,
+                             (a1 * qGreen(oline[x]) + (0xff - a1) * qGreen(sline[x])) >> 8,
+                             (a1 * qBlue(oline[x]) + (0xff - a1) * qBlue(sline[x])) >> 8,
+                             qMax(a1, qAlpha(sline[x])));
+        }
+    }
+}
+
+// the stack blur of the alpha channel as it was done before it was multi-threaded and vectorized
+static void referenceStackBlur(QImage &image, int radius)
+{
+    static const quint32 stack_blur8_mul_sample[] = { 512, 512, 456, 512, 328, 456 };
+    static const quint32 stack_blur8_shr_sample[] = { 9, 11, 12, 13, 13, 14 };
+    Q_ASSERT(radius < 6);
+    const quint32 mul_sum = stack_blur8_mul_sample[radius];
+    const quint32 shr_sum = stack_blur8_shr_sample[radius];
+    const int div = (radius * 2) + 1;
+    const int w = image.width();
+    const int h = image.height();
+    QVector<quint32> stack(div);
+    QVector<quint32> alpha(w * h);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            alpha[(y * w) + x] = qAlpha(image.pixel(x, y));
+        }
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        // the first pass blurs the rows, the second one the columns
+        const int lines = (pass == 0 ? h : w);
+        const int length = (pass == 0 ? w : h);
+        const int step = (pass == 0 ? 1 : w);
+        for (int line = 0; line < lines; line++) {
+            const int start = (pass == 0 ? line * w : line);
+            quint32 sum = 0, sum_in = 0, sum_out = 0;
+            for (int i = 0; i <= radius; i++) {
+                stack[i] = alpha[start];
+                sum += stack[i] * (i + 1);
+                sum_out += stack[i];
+            }
+            for (int i = 1; i <= radius; i++) {
+                stack[i + radius] = alpha[start + (qMin(i, length - 1) * step)];
+                sum += stack[i + radius] * (radius + 1 - i);
+                sum_in += stack[i + radius];
+            }
+            int stackindex = radius;
+            for (int i = 0; i < length; i++) {
+                alpha[start + (i * step)] = ((sum * mul_sum) >> shr_sum);
+                sum -= sum_out;
+                int stackstart = stackindex + div - radius;
+                if (stackstart >= div) {
+                    stackstart -= div;
+                }
+                sum_out -= stack[stackstart];
+                stack[stackstart] = alpha[start + (qMin(i + radius + 1, length - 1) * step)];
+                sum_in += stack[stackstart];
+                sum += sum_in;
+                if (++stackindex >= div) {
+                    stackindex = 0;
+                }
+                sum_out += stack[stackindex];
+                sum_in -= stack[stackindex];
+            }
+        }
+    }
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            image.setPixel(x, y, qRgba(0, 0, 0, alpha[(y * w) + x]));
+        }
+    }
+}
+
+// odd size so that the scalar tail of the vectorized loops is covered too
+static QImage randomImage(int width = 67, int height = 33)
+{
+    QImage image(width, height, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); y++) {
+        QRgb *data = (QRgb*)image.scanLine(y);
+        for (int x = 0; x < image.width(); x++) {
+            data[x] = qRgba(qrand() % 256, qrand() % 256, qrand() % 256, qrand() % 256);
+        }
+    }
+    return image;
+}
+
+static QImage grayImage()
+{
+    QImage image = randomImage();
+    referenceToGray(image, 1.0);
+    return image;
+}
+
+class KIconEffectTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void toGray_data();
+    void toGray();
+    void colorize();
+    void toMonochrome_data();
+    void toMonochrome();
+    void deSaturate();
+    void toGamma();
+    void semiTransparent();
+    void overlay();
+    void shadowBlur_data();
+    void shadowBlur();
+    void blur();
+    void benchmark_data();
+    void benchmark();
+    void blurBenchmark_data();
+    void blurBenchmark();
+};
+
+QTEST_KDEMAIN(KIconEffectTest, GUI)
+
+void KIconEffectTest::initTestCase()
+{
+    qsrand(1234);
+}
+
+void KIconEffectTest::toGray_data()
+{
+    QTest::addColumn<float>("value");
+
+    QTest::newRow("full") << 1.0f;
+    QTest::newRow("half") << 0.5f;
+    QTest::newRow("little") << 0.1f;
+}
+
+void KIconEffectTest::toGray()
+{
+    QFETCH(float, value);
+
+    const QImage image = randomImage();
+    QImage expected = image;
+    referenceToGray(expected, value);
+    QImage result = image;
+    KIconEffect::toGray(result, value);
+    QCOMPARE(result, expected);
+}
+
+void KIconEffectTest::colorize()
+{
+    const QImage image = randomImage();
+    const QColor color(qrand() % 256, qrand() % 256, qrand() % 256);
+    QImage expected = image;
+    referenceColorize(expected, color, 0.7f);
+    QImage result = image;
+    KIconEffect::colorize(result, color, 0.7f);
+    QCOMPARE(result, expected);
+}
+
+void KIconEffectTest::toMonochrome_data()
+{
+    QTest::addColumn<QImage>("image");
+
+    QTest::newRow("color") << randomImage();
+    QTest::newRow("grayscale") << grayImage();
+}
+
+void KIconEffectTest::toMonochrome()
+{
+    QFETCH(QImage, image);
+
+    QImage expected = image;
+    referenceToMonochrome(expected, Qt::darkBlue, Qt::yellow, 0.8f);
+    QImage result = image;
+    KIconEffect::toMonochrome(result, Qt::darkBlue, Qt::yellow, 0.8f);
+    QCOMPARE(result, expected);
+}
+
+void KIconEffectTest::deSaturate()
+{
+    // runs of the same color are handled specially
+    QImage image = randomImage();
+    for (int x = 10; x < 40; x++) {
+        image.setPixel(x, 0, image.pixel(9, 0));
+    }
+    QImage expected = image;
+    referenceDeSaturate(expected, 0.6f);
+    QImage result = image;
+    KIconEffect::deSaturate(result, 0.6f);
+    QCOMPARE(result, expected);
+}
+
+void KIconEffectTest::toGamma()
+{
+    const QImage image = randomImage();
+    QImage expected = image;
+    referenceToGamma(expected, 0.3f);
+    QImage result = image;
+    KIconEffect::toGamma(result, 0.3f);
+    QCOMPARE(result, expected);
+}
+
+void KIconEffectTest::semiTransparent()
+{
+    const QImage image = randomImage();
+    QImage result = image;
+    KIconEffect::semiTransparent(result);
+    // without antialiasing every other pixel is made transparent instead
+    QPaintEngine* const paintEngine = QApplication::desktop()->paintEngine();
+    const bool antialiasing = (paintEngine && paintEngine->hasFeature(QPaintEngine::Antialiasing));
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            const QRgb pixel = image.pixel(x, y);
+            const QRgb resultPixel = result.pixel(x, y);
+            QCOMPARE(qRgb(qRed(resultPixel), qGreen(resultPixel), qBlue(resultPixel)),
+                     qRgb(qRed(pixel), qGreen(pixel), qBlue(pixel)));
+            if (antialiasing) {
+                QCOMPARE(qAlpha(resultPixel), qAlpha(pixel) >> 1);
+            } else {
+                QCOMPARE(qAlpha(resultPixel), ((x + y) % 2) == 0 ? 0 : qAlpha(pixel));
+            }
+        }
+    }
+}
+
+void KIconEffectTest::overlay()
+{
+    const QImage image = randomImage();
+    QImage overlayImage = randomImage();
+    QImage expected = image;
+    referenceOverlay(expected, overlayImage);
+    QImage result = image;
+    KIconEffect::overlay(result, overlayImage);
+    QCOMPARE(result, expected);
+}
+
+void KIconEffectTest::shadowBlur_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("radius");
+
+    QTest::newRow("small") << QSize(67, 33) << 2;
+    QTest::newRow("tiny") << QSize(3, 2) << 5;
+    // blurred by multiple threads
+    QTest::newRow("large") << QSize(601, 403) << 5;
+}
+
+void KIconEffectTest::shadowBlur()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, radius);
+
+    const QImage image = randomImage(size.width(), size.height());
+    QImage expected = image;
+    referenceStackBlur(expected, radius);
+    QImage result = image;
+    KIconEffect::shadowBlur(result, radius, Qt::black);
+    QCOMPARE(result.size(), expected.size());
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            QCOMPARE(qAlpha(result.pixel(x, y)), qAlpha(expected.pixel(x, y)));
+        }
+    }
+}
+
+void KIconEffectTest::blur()
+{
+    // blurring an image of one color does not change it
+    QImage image(300, 300, QImage::Format_ARGB32_Premultiplied);
+    image.fill(qRgba(10, 20, 30, 40));
+    QImage result = image;
+    KIconEffect::blur(result, 7);
+    QCOMPARE(result, image);
+
+    // the image is blurred, the edge spreads
+    image.fill(0);
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width() / 2; x++) {
+            image.setPixel(x, y, qRgba(255, 255, 255, 255));
+        }
+    }
+    result = image;
+    KIconEffect::blur(result, 7);
+    QCOMPARE(result.format(), QImage::Format_ARGB32_Premultiplied);
+    QCOMPARE(result.pixel(0, 150), image.pixel(0, 150));
+    QVERIFY(qAlpha(result.pixel(149, 150)) < 255);
+    QVERIFY(qAlpha(result.pixel(150, 150)) > 0);
+    QCOMPARE(result.pixel(299, 150), image.pixel(299, 150));
+}
+
+void KIconEffectTest::benchmark_data()
+{
+    QTest::addColumn<int>("effect");
+
+    QTest::newRow("toGray") << int(KIconEffect::ToGray);
+    QTest::newRow("colorize") << int(KIconEffect::Colorize);
+    QTest::newRow("toMonochrome") << int(KIconEffect::ToMonochrome);
+    QTest::newRow("deSaturate") << int(KIconEffect::DeSaturate);
+    QTest::newRow("toGamma") << int(KIconEffect::ToGamma);
+    // not an effect value, used for semiTransparent()
+    QTest::newRow("semiTransparent") << -1;
+    // not an effect value, used for overlay()
+    QTest::newRow("overlay") << -2;
+}
+
+static void applyEffect(QImage &image, int effect, QImage &overlayImage)
+{
+    switch (effect) {
+        case KIconEffect::ToGray: {
+            KIconEffect::toGray(image, 0.5f);
+            break;
+        }
+        case KIconEffect::Colorize: {
+            KIconEffect::colorize(image, Qt::darkRed, 0.5f);
+            break;
+        }
+        case KIconEffect::ToMonochrome: {
+            KIconEffect::toMonochrome(image, Qt::black, Qt::white, 0.5f);
+            break;
+        }
+        case KIconEffect::DeSaturate: {
+            KIconEffect::deSaturate(image, 0.5f);
+            break;
+        }
+        case KIconEffect::ToGamma: {
+            KIconEffect::toGamma(image, 0.5f);
+            break;
+        }
+        case -1: {
+            KIconEffect::semiTransparent(image);
+            break;
+        }
+        case -2: {
+            KIconEffect::overlay(image, overlayImage);
+            break;
+        }
+    }
+}
+
+void KIconEffectTest::benchmark()
+{
+    QFETCH(int, effect);
+
+    // HiDPI icon size
+    const QImage image = randomImage(256, 256);
+    QImage overlayImage = randomImage(256, 256);
+
+    // the result is in megapixels per second, QTest has no metric for it so it is reported as
+    // events. The effect runs for long enough to even out the timer resolution
+    qint64 pixels = 0;
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        // the copy of the image is detached by the effects and is included in the measurement
+        QImage result = image;
+        applyEffect(result, effect, overlayImage);
+        pixels += (result.width() * result.height());
+    } while (timer.elapsed() < 500);
+    const qint64 elapsed = qMax(timer.nsecsElapsed(), qint64(1));
+    QTest::setBenchmarkResult((qreal(pixels) * 1000.0) / elapsed, QTest::Events);
+}
+
+void KIconEffectTest::blurBenchmark_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("radius");
+    QTest::addColumn<bool>("shadow");
+
+    // icon sizes and full-screen backgrounds, 256x256 and up are blurred by multiple threads
+    const QList<QSize> sizes = QList<QSize>() << QSize(48, 48) << QSize(128, 128) << QSize(256, 256)
+        << QSize(1920, 1080) << QSize(3840, 2160);
+    const QList<int> radii = QList<int>() << 2 << 8 << 32;
+    foreach (const QSize &size, sizes) {
+        foreach (const int radius, radii) {
+            const QByteArray tag = QByteArray::number(size.width()) + "x" + QByteArray::number(size.height())
+                + " radius " + QByteArray::number(radius);
+            QTest::newRow(QByteArray(tag + " shadow").constData()) << size << radius << true;
+            QTest::newRow(QByteArray(tag + " blur").constData()) << size << radius << false;
+        }
+    }
+}
+
+static void blurImage(const QImage &image, int radius, bool shadow)
+{
+    // the copy of the image is detached by the blur and is included in the measurement
+    QImage result = image;
+    if (shadow) {
+        KIconEffect::shadowBlur(result, radius, Qt::black);
+    } else {
+        KIconEffect::blur(result, radius);
+    }
+}
+
+void KIconEffectTest::blurBenchmark()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, radius);
+    QFETCH(bool, shadow);
+
+    const QImage image = randomImage(size.width(), size.height());
+    if ((size.width() * size.height()) >= (1920 * 1080)) {
+        // one run takes long enough to be measured on its own
+        QBENCHMARK_ONCE {
+            blurImage(image, radius, shadow);
+        }
+    } else {
+        QBENCHMARK {
+            blurImage(image, radius, shadow);
+        }
+    }
+}
+
+#include "kiconeffecttest.moc"
@@ -150,6 +150,9 @@ void KCrash::defaultCrashHandler(int sig)
 {
     KDE_signal(sig, SIG_DFL);
 
+    // the crash may have happened while writing debug messages, do not wait forever
+    kFlushDebug(1000);
+
     const QByteArray crashtrace = kBacktrace();
     {
         QFile crashfile(s_crashtmp);
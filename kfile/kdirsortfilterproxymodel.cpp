@@ -27,6 +27,7 @@
 #include "klocale.h"
 #include "kstringhandler.h"
 
+#include <QtCore/QHash>
 
 class KDirSortFilterProxyModel::KDirSortFilterProxyModelPrivate
 {
@@ -34,10 +35,16 @@ public:
     KDirSortFilterProxyModelPrivate(KDirSortFilterProxyModel* q);
 
     int compare(const QString&, const QString&, Qt::CaseSensitivity caseSensitivity  = Qt::CaseSensitive) const;
+    const QByteArray& naturalSortKey(const QString& string, Qt::CaseSensitivity caseSensitivity) const;
     void slotNaturalSortingChanged();
+    void slotClearSortKeys();
 
     bool m_sortFoldersFirst;
     bool m_naturalSorting;
+    // natural sort keys of the strings compared so far, computing them once is much cheaper
+    // than comparing the strings naturally O(n log n) times while sorting
+    mutable QHash<QString, QByteArray> m_caseSensitiveKeys;
+    mutable QHash<QString, QByteArray> m_caseInsensitiveKeys;
 };
 
 KDirSortFilterProxyModel::KDirSortFilterProxyModelPrivate::KDirSortFilterProxyModelPrivate(KDirSortFilterProxyModel* q) :
@@ -46,15 +53,45 @@ KDirSortFilterProxyModel::KDirSortFilterProxyModelPrivate::KDirSortFilterProxyMo
 {
     connect(KGlobalSettings::self(), SIGNAL(naturalSortingChanged()),
             q, SLOT(slotNaturalSortingChanged()));
+    // the strings of removed and changed items are not going to be compared again,
+    // the cache would otherwise grow with every item that ever was in the model
+    connect(q, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+            q, SLOT(slotClearSortKeys()));
+    connect(q, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+            q, SLOT(slotClearSortKeys()));
+    connect(q, SIGNAL(layoutChanged()),
+            q, SLOT(slotClearSortKeys()));
+    connect(q, SIGNAL(modelReset()),
+            q, SLOT(slotClearSortKeys()));
+}
+
+const QByteArray& KDirSortFilterProxyModel::KDirSortFilterProxyModelPrivate::naturalSortKey(const QString& string,
+                                                                                            Qt::CaseSensitivity caseSensitivity) const
+{
+    QHash<QString, QByteArray>& keys = (caseSensitivity == Qt::CaseSensitive ? m_caseSensitiveKeys : m_caseInsensitiveKeys);
+    QHash<QString, QByteArray>::iterator it = keys.find(string);
+    if (it == keys.end()) {
+        it = keys.insert(string, KStringHandler::naturalSortKey(string, caseSensitivity));
+    }
+    return it.value();
 }
 
 int KDirSortFilterProxyModel::KDirSortFilterProxyModelPrivate::compare(const QString& a,
                                                                        const QString& b,
                                                                        Qt::CaseSensitivity caseSensitivity) const
 {
+    if (m_naturalSorting) {
+        if (caseSensitivity == Qt::CaseInsensitive) {
+            const int result = qstrcmp(naturalSortKey(a, Qt::CaseInsensitive), naturalSortKey(b, Qt::CaseInsensitive));
+            if (result != 0) {
+                return result;
+            }
+        }
+        return qstrcmp(naturalSortKey(a, Qt::CaseSensitive), naturalSortKey(b, Qt::CaseSensitive));
+    }
+
     if (caseSensitivity == Qt::CaseInsensitive) {
-        const int result = m_naturalSorting ? KStringHandler::naturalCompare(a, b, Qt::CaseInsensitive)
-                                            : QString::compare(a, b, Qt::CaseInsensitive);
+        const int result = QString::compare(a, b, Qt::CaseInsensitive);
         if (result != 0) {
             // Only return the result, if the strings are not equal. If they are equal by a case insensitive
             // comparison, still a deterministic sort order is required. A case sensitive
@@ -63,14 +100,20 @@ int KDirSortFilterProxyModel::KDirSortFilterProxyModelPrivate::compare(const QSt
         }
     }
     
-    return m_naturalSorting ? KStringHandler::naturalCompare(a, b, Qt::CaseSensitive)
-                            : QString::compare(a, b, Qt::CaseSensitive);
+    return QString::compare(a, b, Qt::CaseSensitive);
 }
 
 
 void KDirSortFilterProxyModel::KDirSortFilterProxyModelPrivate::slotNaturalSortingChanged()
 {
     m_naturalSorting = KGlobalSettings::naturalSorting();
+    slotClearSortKeys();
+}
+
+void KDirSortFilterProxyModel::KDirSortFilterProxyModelPrivate::slotClearSortKeys()
+{
+    m_caseSensitiveKeys.clear();
+    m_caseInsensitiveKeys.clear();
 }
 
 KDirSortFilterProxyModel::KDirSortFilterProxyModel(QObject* parent)
@@ -91,6 +91,7 @@ protected:
                                  const QModelIndex& right) const;
 private:
     Q_PRIVATE_SLOT(d, void slotNaturalSortingChanged())
+    Q_PRIVATE_SLOT(d, void slotClearSortKeys())
     
 private:
     class KDirSortFilterProxyModelPrivate;
@@ -20,6 +20,9 @@
 
 #include <QImage>
 #include <QVariant>
+#include <QFile>
+#include <QBuffer>
+#include <qmath.h>
 #include <kdebug.h>
 
 #include <turbojpeg.h>
@@ -27,6 +30,9 @@
 static const char* const s_jpgpluginformat = "jpg";
 
 static const ushort s_peekbuffsize = 32;
+// the header is in front of the image data, EXIF data and thumbnails in front of it take up to
+// 64KiB per segment
+static const qint64 s_sizepeekbuffsize = 256 * 1024;
 #if Q_BYTE_ORDER == Q_BIG_ENDIAN
 static const TJPF s_jpegpf = TJPF_ARGB;
 #else
@@ -55,6 +61,119 @@ static const struct HeadersTblData {
 };
 static const qint16 HeadersTblSize = sizeof(HeadersTbl) / sizeof(HeadersTblData);
 
+// the data of the device, files are mapped and buffers are shared instead of read into memory
+class JPGData
+{
+public:
+    JPGData(QIODevice *device);
+    ~JPGData();
+
+    const uchar* data() const;
+    ulong size() const;
+
+private:
+    Q_DISABLE_COPY(JPGData);
+
+    QFile* m_file;
+    uchar* m_map;
+    qint64 m_mapsize;
+    QByteArray m_data;
+};
+
+JPGData::JPGData(QIODevice *device)
+    : m_file(nullptr),
+    m_map(nullptr),
+    m_mapsize(0)
+{
+    const qint64 devicepos = device->pos();
+    QFile* file = qobject_cast<QFile*>(device);
+    if (file) {
+        m_mapsize = (file->size() - devicepos);
+        if (m_mapsize > 0) {
+            m_map = file->map(devicepos, m_mapsize);
+        }
+        if (m_map) {
+            m_file = file;
+            device->seek(devicepos + m_mapsize);
+            return;
+        }
+        m_mapsize = 0;
+    }
+
+    QBuffer* buffer = qobject_cast<QBuffer*>(device);
+    if (buffer) {
+        // implicitly shared
+        m_data = buffer->data();
+        if (devicepos > 0) {
+            m_data = m_data.mid(devicepos);
+        }
+        device->seek(devicepos + m_data.size());
+        return;
+    }
+
+    m_data = device->readAll();
+}
+
+JPGData::~JPGData()
+{
+    if (m_map) {
+        m_file->unmap(m_map);
+    }
+}
+
+const uchar* JPGData::data() const
+{
+    if (m_map) {
+        return m_map;
+    }
+    return reinterpret_cast<const uchar*>(m_data.constData());
+}
+
+ulong JPGData::size() const
+{
+    if (m_map) {
+        return m_mapsize;
+    }
+    return m_data.size();
+}
+
+// returns the smallest size the DCT scaling can decode to that has at least the wanted size for
+// the region of the image, the scaling is applied to the whole image
+static QSize jpegScaledSize(const QSize &imagesize, const QSize &regionsize, const QSize &wantedsize)
+{
+    QSize result = imagesize;
+    if (!wantedsize.isValid()) {
+        return result;
+    }
+
+    int scalingfactorscount = 0;
+    const tjscalingfactor* scalingfactors = tjGetScalingFactors(&scalingfactorscount);
+    if (Q_UNLIKELY(!scalingfactors)) {
+        kWarning() << "Could not get scaling factors" << tjGetErrorStr();
+        return result;
+    }
+
+    for (int i = 0; i < scalingfactorscount; i++) {
+        const tjscalingfactor scalingfactor = scalingfactors[i];
+        // no upscaling, that is done smoothly once the image is decoded
+        if (scalingfactor.num >= scalingfactor.denom) {
+            continue;
+        }
+        if (TJSCALED(regionsize.width(), scalingfactor) < wantedsize.width()
+            || TJSCALED(regionsize.height(), scalingfactor) < wantedsize.height()) {
+            continue;
+        }
+        const QSize scaledsize(
+            TJSCALED(imagesize.width(), scalingfactor),
+            TJSCALED(imagesize.height(), scalingfactor)
+        );
+        if ((scaledsize.width() * scaledsize.height()) < (result.width() * result.height())) {
+            result = scaledsize;
+        }
+    }
+    return result;
+}
+
 JPGHandler::JPGHandler()
     : m_quality(100)
 {
@@ -71,9 +190,9 @@ bool JPGHandler::canRead() const
 
 bool JPGHandler::read(QImage *image)
 {
-    const QByteArray data = device()->readAll();
+    const JPGData data(device());
 
-    if (Q_UNLIKELY(data.isEmpty())) {
+    if (Q_UNLIKELY(data.size() == 0)) {
         return false;
     }
 
@@ -89,7 +208,7 @@ bool JPGHandler::read(QImage *image)
     int jpegcolorspace = 0;
     int jpegstatus = tjDecompressHeader3(
         jpegdecomp,
-        reinterpret_cast<const uchar*>(data.constData()), data.size(),
+        data.data(), data.size(),
         &jpegwidth, &jpegheight,
         &jpegsubsamp, &jpegcolorspace
     );
@@ -99,6 +218,23 @@ bool JPGHandler::read(QImage *image)
         return false;
     }
 
+    // the clip rectangle is relative to the full size image and it is scaled to the scaled size,
+    // the decoder scales down in the DCT domain so only a fraction of the pixels is decoded
+    const QSize jpegsize(jpegwidth, jpegheight);
+    QRect cliprect;
+    if (m_cliprect.isValid()) {
+        cliprect = m_cliprect.intersected(QRect(QPoint(0, 0), jpegsize));
+        if (Q_UNLIKELY(cliprect.isEmpty())) {
+            kWarning() << "Clip rectangle is outside of the image" << m_cliprect;
+            (void)tjDestroy(jpegdecomp);
+            return false;
+        }
+    }
+    const QSize regionsize = (cliprect.isValid() ? cliprect.size() : jpegsize);
+    const QSize scaledsize = jpegScaledSize(jpegsize, regionsize, m_scaledsize);
+    jpegwidth = scaledsize.width();
+    jpegheight = scaledsize.height();
+
     *image = QImage(jpegwidth, jpegheight, QImage::Format_ARGB32);
     if (Q_UNLIKELY(image->isNull())) {
         kWarning() << "Could not create image";
@@ -108,7 +244,7 @@ bool JPGHandler::read(QImage *image)
 
     jpegstatus = tjDecompress2(
         jpegdecomp,
-        reinterpret_cast<const uchar*>(data.constData()), data.size(),
+        data.data(), data.size(),
         image->bits(),
         jpegwidth, 0 , jpegheight,
         s_jpegpf,
@@ -123,6 +259,19 @@ bool JPGHandler::read(QImage *image)
 
     (void)tjDestroy(jpegdecomp);
 
+    if (cliprect.isValid()) {
+        const qreal scalefactor = (qreal(jpegwidth) / jpegsize.width());
+        const QRect scaledcliprect(
+            qFloor(cliprect.x() * scalefactor), qFloor(cliprect.y() * scalefactor),
+            qCeil(cliprect.width() * scalefactor), qCeil(cliprect.height() * scalefactor)
+        );
+        *image = image->copy(scaledcliprect.intersected(image->rect()));
+    }
+
+    if (m_scaledsize.isValid() && image->size() != m_scaledsize) {
+        *image = image->scaled(m_scaledsize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
     return true;
 }
 
@@ -185,7 +334,45 @@ QByteArray JPGHandler::name() const
 
 bool JPGHandler::supportsOption(QImageIOHandler::ImageOption option) const
 {
-    return (option == QImageIOHandler::Quality);
+    switch (option) {
+        case QImageIOHandler::Quality:
+        case QImageIOHandler::Size:
+        case QImageIOHandler::ScaledSize:
+        case QImageIOHandler::ClipRect: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+    Q_UNREACHABLE();
+}
+
+// the size from the header of the JPEG data, invalid if the header is not complete
+static QSize jpegSize(const uchar *data, const ulong size)
+{
+    tjhandle jpegdecomp = tjInitDecompress();
+    if (Q_UNLIKELY(!jpegdecomp)) {
+        kWarning() << "Could not initialize decompressor for size option" << tjGetErrorStr();
+        return QSize();
+    }
+
+    int jpegwidth = 0;
+    int jpegheight = 0;
+    int jpegsubsamp = 0;
+    int jpegcolorspace = 0;
+    const int jpegstatus = tjDecompressHeader3(
+        jpegdecomp,
+        data, size,
+        &jpegwidth, &jpegheight,
+        &jpegsubsamp, &jpegcolorspace
+    );
+    (void)tjDestroy(jpegdecomp);
+    if (Q_UNLIKELY(jpegstatus != 0)) {
+        kWarning() << "Could not decompress header for size option";
+        return QSize();
+    }
+    return QSize(jpegwidth, jpegheight);
 }
 
 QVariant JPGHandler::option(QImageIOHandler::ImageOption option) const
@@ -194,6 +381,24 @@ QVariant JPGHandler::option(QImageIOHandler::ImageOption option) const
         case QImageIOHandler::Quality: {
             return m_quality;
         }
+        case QImageIOHandler::Size: {
+            if (device()->isSequential()) {
+                // the data can not be read and seeked back to, peek at the start of it
+                const QByteArray data = device()->peek(s_sizepeekbuffsize);
+                return QVariant(jpegSize(reinterpret_cast<const uchar*>(data.constData()), data.size()));
+            }
+
+            const qint64 devicepos = device()->pos();
+            const JPGData data(device());
+            device()->seek(devicepos);
+            return QVariant(jpegSize(data.data(), data.size()));
+        }
+        case QImageIOHandler::ScaledSize: {
+            return m_scaledsize;
+        }
+        case QImageIOHandler::ClipRect: {
+            return m_cliprect;
+        }
         default: {
             return QVariant();
         }
@@ -211,6 +416,10 @@ void JPGHandler::setOption(QImageIOHandler::ImageOption option, const QVariant &
         } else {
             m_quality = qBound(0, newquality, 100);
         }
+    } else if (option == QImageIOHandler::ScaledSize) {
+        m_scaledsize = value.toSize();
+    } else if (option == QImageIOHandler::ClipRect) {
+        m_cliprect = value.toRect();
     }
 }
 
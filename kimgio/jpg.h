@@ -20,6 +20,7 @@
 #define KIMG_JPG_H
 
 #include <QtCore/qstringlist.h>
+#include <QtCore/qrect.h>
 #include <QtGui/qimageiohandler.h>
 
 class JPGHandler : public QImageIOHandler
@@ -41,6 +42,8 @@ public:
 
 private:
     int m_quality;
+    QSize m_scaledsize;
+    QRect m_cliprect;
 };
 
 class JPGPlugin : public QImageIOPlugin
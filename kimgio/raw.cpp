@@ -19,10 +19,19 @@
 #include "raw.h"
 
 #include <QImage>
+#include <QImageReader>
+#include <QTransform>
+#include <QBuffer>
+#include <QVariant>
 #include <kdebug.h>
 
 #include <libraw/libraw.h>
 
+#if defined(__SSE2__) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#  include <emmintrin.h>
+#  define KIMG_RAW_SSE2
+#endif
+
 static const char* const s_rawpluginformat = "raw";
 
 // for reference:
@@ -160,6 +169,142 @@ const char* RAWDataStream::fname()
 }
 
 
+// the size of the image once LibRaw rotated it
+static QSize rawFlippedSize(const QSize &size, const int flip)
+{
+    if (flip == 5 || flip == 6) {
+        return size.transposed();
+    }
+    return size;
+}
+
+static QImage rawFlippedImage(const QImage &image, const int flip)
+{
+    QTransform transform;
+    switch (flip) {
+        case 3: {
+            transform.rotate(180);
+            break;
+        }
+        case 5: {
+            transform.rotate(270);
+            break;
+        }
+        case 6: {
+            transform.rotate(90);
+            break;
+        }
+        default: {
+            return image;
+        }
+    }
+    return image.transformed(transform);
+}
+
+// converts packed 8-bit RGB triplets to QImage::Format_RGB32
+static bool rawRGBImage(const uchar *rgb, const int width, const int height, QImage *image)
+{
+    *image = QImage(width, height, QImage::Format_RGB32);
+    if (Q_UNLIKELY(image->isNull())) {
+        kWarning() << "Could not create QImage";
+        return false;
+    }
+
+    QRgb* imagebits = reinterpret_cast<QRgb*>(image->bits());
+    const uchar* rgbend = rgb + (width * height * 3);
+#ifdef KIMG_RAW_SSE2
+    // 4 pixels at a time, the loads are 16 bytes so the last pixels are left for the scalar loop
+    const __m128i redmask = _mm_set1_epi32(0x00ff0000);
+    const __m128i greenmask = _mm_set1_epi32(0x0000ff00);
+    const __m128i bluemask = _mm_set1_epi32(0x000000ff);
+    const __m128i alphamask = _mm_set1_epi32(0xff000000);
+    while ((rgbend - rgb) >= 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb));
+        // each triplet in the low bytes of its own 32-bit lane, i.e. 0x??BBGGRR
+        const __m128i pixels = _mm_unpacklo_epi64(
+            _mm_unpacklo_epi32(bytes, _mm_srli_si128(bytes, 3)),
+            _mm_unpacklo_epi32(_mm_srli_si128(bytes, 6), _mm_srli_si128(bytes, 9))
+        );
+        // swap red and blue, there is no byte shuffle before SSSE3
+        const __m128i red = _mm_and_si128(_mm_slli_epi32(pixels, 16), redmask);
+        const __m128i green = _mm_and_si128(pixels, greenmask);
+        const __m128i blue = _mm_and_si128(_mm_srli_epi32(pixels, 16), bluemask);
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(imagebits),
+            _mm_or_si128(_mm_or_si128(red, blue), _mm_or_si128(green, alphamask))
+        );
+        rgb += 12;
+        imagebits += 4;
+    }
+#endif
+    while (rgb != rgbend) {
+        *imagebits = qRgb(rgb[0], rgb[1], rgb[2]);
+        rgb += 3;
+        imagebits++;
+    }
+    return true;
+}
+
+// the size that fits in the wanted size and keeps the aspect ratio of the image
+static QSize rawScaledSize(const QSize &size, const QSize &scaledsize)
+{
+    return size.scaled(scaledsize, Qt::KeepAspectRatio);
+}
+
+// the embedded preview is used when it is at least as big as the wanted size
+static bool rawThumbnail(LibRaw &raw, const QSize &scaledsize, QImage *image)
+{
+    const libraw_thumbnail_t &rawthumbnail = raw.imgdata.thumbnail;
+    const int rawflip = raw.imgdata.sizes.flip;
+    if (rawthumbnail.tformat == LIBRAW_THUMBNAIL_UNKNOWN) {
+        return false;
+    }
+    const QSize thumbnailsize = rawFlippedSize(QSize(rawthumbnail.twidth, rawthumbnail.theight), rawflip);
+    const QSize thumbnailscaledsize = rawScaledSize(thumbnailsize, scaledsize);
+    if (thumbnailsize.width() < thumbnailscaledsize.width() || thumbnailsize.height() < thumbnailscaledsize.height()) {
+        kDebug() << "Thumbnail is too small" << thumbnailsize << scaledsize;
+        return false;
+    }
+
+    int rawresult = raw.unpack_thumb();
+    if (Q_UNLIKELY(rawresult != LIBRAW_SUCCESS)) {
+        kDebug() << "Could not unpack thumbnail" << libraw_strerror(rawresult);
+        return false;
+    }
+
+    libraw_processed_image_t* rawthumb = raw.dcraw_make_mem_thumb(&rawresult);
+    if (Q_UNLIKELY(!rawthumb || rawresult != LIBRAW_SUCCESS)) {
+        kDebug() << "Could not make thumbnail" << libraw_strerror(rawresult);
+        return false;
+    }
+
+    bool result = false;
+    if (rawthumb->type == LIBRAW_IMAGE_JPEG) {
+        // the JPEG plugin decodes directly to a fraction of the size
+        QByteArray thumbdata = QByteArray::fromRawData(
+            reinterpret_cast<const char*>(rawthumb->data), rawthumb->data_size
+        );
+        QBuffer thumbbuffer(&thumbdata);
+        thumbbuffer.open(QBuffer::ReadOnly);
+        QImageReader thumbreader(&thumbbuffer);
+        thumbreader.setScaledSize(rawFlippedSize(thumbnailscaledsize, rawflip));
+        result = thumbreader.read(image);
+        if (Q_UNLIKELY(!result)) {
+            kDebug() << "Could not read thumbnail" << thumbreader.errorString();
+        }
+    } else if (rawthumb->type == LIBRAW_IMAGE_BITMAP && rawthumb->colors == 3 && rawthumb->bits == 8) {
+        result = rawRGBImage(rawthumb->data, rawthumb->width, rawthumb->height, image);
+    } else {
+        kDebug() << "Thumbnail type not supported" << rawthumb->type;
+    }
+    raw.dcraw_clear_mem(rawthumb);
+
+    if (result) {
+        *image = rawFlippedImage(*image, rawflip);
+    }
+    return result;
+}
+
 RAWHandler::RAWHandler()
 {
 }
@@ -192,6 +337,27 @@ bool RAWHandler::read(QImage *image)
             return false;
         }
 
+        if (m_scaledsize.isValid()) {
+            if (rawThumbnail(raw, m_scaledsize, image)) {
+                raw.recycle();
+                const QSize thumbnailscaledsize = rawScaledSize(image->size(), m_scaledsize);
+                if (image->size() != thumbnailscaledsize) {
+                    *image = image->scaled(thumbnailscaledsize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+                }
+                return true;
+            }
+
+            // half-size decoding skips the demosaicing
+            const QSize rawsize = rawFlippedSize(
+                QSize(raw.imgdata.sizes.width, raw.imgdata.sizes.height),
+                raw.imgdata.sizes.flip
+            );
+            const QSize rawscaledsize = rawScaledSize(rawsize, m_scaledsize);
+            if ((rawscaledsize.width() * 2) <= rawsize.width() && (rawscaledsize.height() * 2) <= rawsize.height()) {
+                raw.imgdata.params.half_size = 1;
+            }
+        }
+
         rawresult = raw.unpack();
         if (Q_UNLIKELY(rawresult != LIBRAW_SUCCESS)) {
             kWarning() << "Could not unpack" << libraw_strerror(rawresult);
@@ -220,22 +386,21 @@ bool RAWHandler::read(QImage *image)
             return false;
         }
 
-        *image = QImage(rawimg->width, rawimg->height, QImage::Format_RGB32);
-        if (Q_UNLIKELY(image->isNull())) {
-            kWarning() << "Could not create QImage";
+        if (Q_UNLIKELY(!rawRGBImage(rawimg->data, rawimg->width, rawimg->height, image))) {
             raw.dcraw_clear_mem(rawimg);
             raw.recycle();
             return false;
         }
 
-        QRgb* imagebits = reinterpret_cast<QRgb*>(image->bits());
-        for (uint i = 0 ; i < rawimg->data_size; i += 3) {
-            *imagebits = qRgb(rawimg->data[i], rawimg->data[i + 1], rawimg->data[i + 2]);
-            imagebits++;
-        }
-
         raw.dcraw_clear_mem(rawimg);
         raw.recycle();
+
+        if (m_scaledsize.isValid()) {
+            const QSize imagescaledsize = rawScaledSize(image->size(), m_scaledsize);
+            if (image->size() != imagescaledsize) {
+                *image = image->scaled(imagescaledsize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            }
+        }
     } catch (...) {
         kWarning() << "Exception raised";
         return false;
@@ -255,6 +420,31 @@ QByteArray RAWHandler::name() const
     return s_rawpluginformat;
 }
 
+bool RAWHandler::supportsOption(QImageIOHandler::ImageOption option) const
+{
+    return (option == QImageIOHandler::ScaledSize);
+}
+
+QVariant RAWHandler::option(QImageIOHandler::ImageOption option) const
+{
+    switch (option) {
+        case QImageIOHandler::ScaledSize: {
+            return m_scaledsize;
+        }
+        default: {
+            return QVariant();
+        }
+    }
+    Q_UNREACHABLE();
+}
+
+void RAWHandler::setOption(QImageIOHandler::ImageOption option, const QVariant &value)
+{
+    if (option == QImageIOHandler::ScaledSize) {
+        m_scaledsize = value.toSize();
+    }
+}
+
 bool RAWHandler::canRead(QIODevice *device)
 {
     if (Q_UNLIKELY(!device)) {
@@ -20,6 +20,7 @@
 #define KIMG_RAW_H
 
 #include <QtCore/qstringlist.h>
+#include <QtCore/qsize.h>
 #include <QtGui/qimageiohandler.h>
 
 class RAWHandler : public QImageIOHandler
@@ -33,7 +34,14 @@ public:
 
     QByteArray name() const final;
 
+    bool supportsOption(QImageIOHandler::ImageOption option) const final;
+    QVariant option(QImageIOHandler::ImageOption option) const final;
+    void setOption(QImageIOHandler::ImageOption option, const QVariant &value) final;
+
     static bool canRead(QIODevice *device);
+
+private:
+    QSize m_scaledsize;
 };
 
 class RAWPlugin : public QImageIOPlugin
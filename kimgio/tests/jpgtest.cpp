@@ -0,0 +1,222 @@
+/*  This file is part of the KDE libraries
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License version 2, as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include "jpg.h"
+
+#include <QBuffer>
+#include <QImage>
+#include <qtest_kde.h>
+
+// a buffer that can not seek, like a pipe or a socket
+class SequentialBuffer : public QBuffer
+{
+public:
+    bool isSequential() const final { return true; }
+};
+
+class JPGTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testSize_data();
+    void testSize();
+    void testScaledSize_data();
+    void testScaledSize();
+    void testClipRect_data();
+    void testClipRect();
+};
+
+QTEST_KDEMAIN(JPGTest, NoGUI)
+
+// the DCT scaling and the smooth scaling do not give the same pixels
+static const int s_tolerance = 12;
+static const QSize s_imagesize = QSize(256, 192);
+
+static QByteArray jpegData(const QImage &image)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    JPGHandler handler;
+    handler.setDevice(&buffer);
+    if (!handler.write(image)) {
+        return QByteArray();
+    }
+    return buffer.data();
+}
+
+static QByteArray jpegData(const QSize &size)
+{
+    QImage image(size, QImage::Format_ARGB32);
+    image.fill(Qt::red);
+    return jpegData(image);
+}
+
+// smooth so that the compression does not add much to the difference
+static QImage gradientImage(const QSize &size)
+{
+    QImage image(size, QImage::Format_ARGB32);
+    for (int y = 0; y < size.height(); y++) {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < size.width(); x++) {
+            line[x] = qRgb(x * 255 / size.width(), y * 255 / size.height(), 128);
+        }
+    }
+    return image;
+}
+
+static QImage readJPEG(const QByteArray &data, const QSize &scaledsize, const QRect &cliprect)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    JPGHandler handler;
+    handler.setDevice(&buffer);
+    if (scaledsize.isValid()) {
+        handler.setOption(QImageIOHandler::ScaledSize, scaledsize);
+    }
+    if (cliprect.isValid()) {
+        handler.setOption(QImageIOHandler::ClipRect, cliprect);
+    }
+    QImage image;
+    if (!handler.read(&image)) {
+        return QImage();
+    }
+    return image;
+}
+
+// the largest difference of any channel of any pixel
+static int maxDifference(const QImage &image, const QImage &image2)
+{
+    Q_ASSERT(image.size() == image2.size());
+    const QImage image32 = image.convertToFormat(QImage::Format_ARGB32);
+    const QImage image232 = image2.convertToFormat(QImage::Format_ARGB32);
+    int result = 0;
+    for (int y = 0; y < image32.height(); y++) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image32.constScanLine(y));
+        const QRgb* line2 = reinterpret_cast<const QRgb*>(image232.constScanLine(y));
+        for (int x = 0; x < image32.width(); x++) {
+            result = qMax(result, qAbs(qRed(line[x]) - qRed(line2[x])));
+            result = qMax(result, qAbs(qGreen(line[x]) - qGreen(line2[x])));
+            result = qMax(result, qAbs(qBlue(line[x]) - qBlue(line2[x])));
+        }
+    }
+    return result;
+}
+
+void JPGTest::testSize_data()
+{
+    QTest::addColumn<bool>("sequential");
+
+    QTest::newRow("random access") << false;
+    QTest::newRow("sequential") << true;
+}
+
+void JPGTest::testSize()
+{
+    QFETCH(bool, sequential);
+
+    const QSize size(67, 33);
+    const QByteArray data = jpegData(size);
+    QVERIFY(!data.isEmpty());
+
+    QBuffer buffer;
+    SequentialBuffer sequentialbuffer;
+    QBuffer *device = (sequential ? &sequentialbuffer : &buffer);
+    device->setData(data);
+    QVERIFY(device->open(QIODevice::ReadOnly));
+
+    JPGHandler handler;
+    handler.setDevice(device);
+    QVERIFY(handler.supportsOption(QImageIOHandler::Size));
+    QCOMPARE(handler.option(QImageIOHandler::Size).toSize(), size);
+
+    // the size option does not take the data away from read()
+    QImage image;
+    QVERIFY(handler.read(&image));
+    QCOMPARE(image.size(), size);
+}
+
+void JPGTest::testScaledSize_data()
+{
+    QTest::addColumn<QSize>("scaledsize");
+
+    QTest::newRow("1/2") << (s_imagesize / 2);
+    QTest::newRow("1/4") << (s_imagesize / 4);
+    QTest::newRow("1/8") << (s_imagesize / 8);
+    QTest::newRow("in between") << QSize(100, 75);
+}
+
+void JPGTest::testScaledSize()
+{
+    QFETCH(QSize, scaledsize);
+
+    const QByteArray data = jpegData(gradientImage(s_imagesize));
+    QVERIFY(!data.isEmpty());
+    const QImage fullimage = readJPEG(data, QSize(), QRect());
+    QCOMPARE(fullimage.size(), s_imagesize);
+
+    const QImage image = readJPEG(data, scaledsize, QRect());
+    QCOMPARE(image.size(), scaledsize);
+    const QImage expected = fullimage.scaled(scaledsize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    const int difference = maxDifference(image, expected);
+    QVERIFY2(difference <= s_tolerance, QByteArray::number(difference));
+}
+
+void JPGTest::testClipRect_data()
+{
+    QTest::addColumn<QRect>("cliprect");
+    QTest::addColumn<QSize>("scaledsize");
+
+    QTest::newRow("inside") << QRect(10, 20, 100, 50) << QSize();
+    QTest::newRow("whole image") << QRect(QPoint(0, 0), s_imagesize) << QSize();
+    QTest::newRow("partially outside") << QRect(200, 150, 100, 100) << QSize();
+    QTest::newRow("scaled 1/2") << QRect(64, 32, 128, 128) << QSize(64, 64);
+    QTest::newRow("scaled 1/4") << QRect(64, 32, 128, 128) << QSize(32, 32);
+    QTest::newRow("scaled in between") << QRect(10, 20, 100, 50) << QSize(40, 20);
+}
+
+void JPGTest::testClipRect()
+{
+    QFETCH(QRect, cliprect);
+    QFETCH(QSize, scaledsize);
+
+    const QByteArray data = jpegData(gradientImage(s_imagesize));
+    QVERIFY(!data.isEmpty());
+    const QImage fullimage = readJPEG(data, QSize(), QRect());
+    QCOMPARE(fullimage.size(), s_imagesize);
+
+    // clipped first, then scaled
+    QImage expected = fullimage.copy(cliprect.intersected(fullimage.rect()));
+    if (scaledsize.isValid()) {
+        expected = expected.scaled(scaledsize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    const QImage image = readJPEG(data, scaledsize, cliprect);
+    QCOMPARE(image.size(), expected.size());
+    if (scaledsize.isValid()) {
+        const int difference = maxDifference(image, expected);
+        QVERIFY2(difference <= s_tolerance, QByteArray::number(difference));
+    } else {
+        // the same pixels as the full decode
+        QVERIFY(image == expected);
+    }
+
+    // outside of the image
+    QVERIFY(readJPEG(data, QSize(), QRect(QPoint(1000, 1000), QSize(10, 10))).isNull());
+}
+
+#include "jpgtest.moc"
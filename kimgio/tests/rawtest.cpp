@@ -0,0 +1,76 @@
+/*  This file is part of the KDE libraries
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License version 2, as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include "raw.h"
+
+#include <QFile>
+#include <QImage>
+#include <qtest_kde.h>
+
+// 128x96 Bayer DNG with a 32x24 uncompressed RGB preview
+static const char* const s_dngpath = KDESRCDIR "/tests.dng";
+
+class RAWTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testScaledSize_data();
+    void testScaledSize();
+};
+
+QTEST_KDEMAIN(RAWTest, NoGUI)
+
+static bool readRAW(const QSize &scaledsize, QImage *image)
+{
+    QFile file(QFile::decodeName(s_dngpath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    RAWHandler handler;
+    handler.setDevice(&file);
+    if (scaledsize.isValid()) {
+        handler.setOption(QImageIOHandler::ScaledSize, scaledsize);
+    }
+    return handler.read(image);
+}
+
+void RAWTest::testScaledSize_data()
+{
+    QTest::addColumn<QSize>("scaledsize");
+
+    QTest::newRow("embedded preview") << QSize(16, 16);
+    QTest::newRow("embedded preview, wide") << QSize(40, 10);
+    QTest::newRow("half size") << QSize(48, 48);
+    QTest::newRow("half size, tall") << QSize(60, 200);
+    QTest::newRow("full size") << QSize(100, 100);
+}
+
+void RAWTest::testScaledSize()
+{
+    QFETCH(QSize, scaledsize);
+
+    QImage fullimage;
+    QVERIFY(readRAW(QSize(), &fullimage));
+    QVERIFY(!fullimage.isNull());
+
+    // fits in the scaled size without being stretched
+    QImage image;
+    QVERIFY(readRAW(scaledsize, &image));
+    QCOMPARE(image.size(), fullimage.size().scaled(scaledsize, Qt::KeepAspectRatio));
+}
+
+#include "rawtest.moc"
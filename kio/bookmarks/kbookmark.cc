@@ -21,9 +21,11 @@
 */
 
 #include "kbookmark.h"
+#include "kbookmark_p.h"
 
 #include <QStack>
 #include <QDateTime>
+#include <QAtomicInt>
 
 #include <kdebug.h>
 #include <kmimetype.h>
@@ -40,6 +42,18 @@
 
 ////// utility functions
 
+static QAtomicInt s_generation(0);
+
+int kBookmarkGeneration()
+{
+    return s_generation.load();
+}
+
+static void bookmarksChanged()
+{
+    s_generation.fetchAndAddOrdered(1);
+}
+
 static QDomNode cd(QDomNode node, const QString &name, bool create)
 {
     QDomNode subnode = node.namedItem(name);
@@ -165,6 +179,7 @@ KBookmarkGroup KBookmarkGroup::createNewFolder(const QString &text)
     QDomDocument doc = element.ownerDocument();
     QDomElement groupElem = doc.createElement("folder");
     element.appendChild(groupElem);
+    bookmarksChanged();
     QDomElement textElem = doc.createElement("title");
     groupElem.appendChild(textElem);
     textElem.appendChild(doc.createTextNode(text));
@@ -180,6 +195,7 @@ KBookmark KBookmarkGroup::createNewSeparator()
     Q_ASSERT(!doc.isNull());
     QDomElement sepElem = doc.createElement("separator");
     element.appendChild( sepElem );
+    bookmarksChanged();
     return KBookmark(sepElem);
 }
 
@@ -204,12 +220,14 @@ bool KBookmarkGroup::moveBookmark(const KBookmark &item, const KBookmark &after)
             n = element.appendChild(item.element);
         }
     }
+    bookmarksChanged();
     return (!n.isNull());
 }
 
 KBookmark KBookmarkGroup::addBookmark(const KBookmark &bm)
 {
     element.appendChild(bm.internalElement());
+    bookmarksChanged();
     return bm;
 }
 
@@ -236,6 +254,7 @@ KBookmark KBookmarkGroup::addBookmark(const QString &text, const KUrl &url, cons
 void KBookmarkGroup::deleteBookmark(const KBookmark &bk)
 {
     element.removeChild(bk.element);
+    bookmarksChanged();
 }
 
 QList<KUrl> KBookmarkGroup::groupUrlList() const
@@ -325,6 +344,7 @@ KUrl KBookmark::url() const
 void KBookmark::setUrl(const KUrl &url)
 {
     element.setAttribute("href", url.url());
+    bookmarksChanged();
 }
 
 QString KBookmark::icon() const
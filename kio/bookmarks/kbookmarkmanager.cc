@@ -21,6 +21,7 @@
 */
 
 #include "kbookmarkmanager.h"
+#include "kbookmark_p.h"
 #include "kbookmarkmenu.h"
 #include "kbookmarkmenu_p.h"
 #include "kbookmarkdialog.h"
@@ -28,6 +29,9 @@
 
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QPair>
+#include <QStack>
 #include <QProcess>
 #include <QRegExp>
 #include <QTextStream>
@@ -60,52 +64,107 @@ public:
 
 K_GLOBAL_STATIC(KBookmarkManagerList, s_pSelf)
 
-class KBookmarkMap : private KBookmarkGroupTraverser
+// Bookmarks by URL and by address, rebuilt in one pass over the document
+// the first time it is needed after it was parsed or the bookmarks changed
+class KBookmarkIndex : private KBookmarkGroupTraverser
 {
 public:
-    KBookmarkMap() : m_mapNeedsUpdate(true) {}
-    void setNeedsUpdate() { m_mapNeedsUpdate = true; }
+    KBookmarkIndex() : m_valid(false), m_generation(0) {}
+    void setNeedsUpdate() { m_valid = false; }
     void update(KBookmarkManager*);
-    QList<KBookmark> find( const QString &url ) const
-    { return m_bk_map.value(url); }
+    QList<KBookmark> find(const QString &url) const;
+    KBookmark findByAddress(const QString &address);
 private:
+    void add(const KBookmark &);
     virtual void visit(const KBookmark &);
-    virtual void visitEnter(const KBookmarkGroup &) { ; }
-    virtual void visitLeave(const KBookmarkGroup &) { ; }
+    virtual void visitEnter(const KBookmarkGroup &);
+    virtual void visitLeave(const KBookmarkGroup &);
 private:
     typedef QList<KBookmark> KBookmarkList;
-    QMap<QString, KBookmarkList> m_bk_map;
-    bool m_mapNeedsUpdate;
+    QHash<QString, KBookmarkList> m_bk_map;
+    // the bookmarks with the parent they had when they were indexed
+    QHash<QString, QPair<KBookmark, QDomNode> > m_bk_addresses;
+    // address and next child position of the groups being traversed
+    QStack<QPair<QString, int> > m_groups;
+    bool m_valid;
+    int m_generation;
 };
 
-void KBookmarkMap::update(KBookmarkManager *manager)
+void KBookmarkIndex::update(KBookmarkManager *manager)
 {
-    if (m_mapNeedsUpdate) {
-        m_mapNeedsUpdate = false;
+    const int generation = kBookmarkGeneration();
+    if (m_valid && m_generation == generation) {
+        return;
+    }
 
-        m_bk_map.clear();
-        KBookmarkGroup root = manager->root();
-        traverse(root);
+    m_bk_map.clear();
+    m_bk_addresses.clear();
+    m_groups.push(qMakePair(QString(), 0));
+    traverse(manager->root());
+    m_groups.clear();
 
-        QMutableMapIterator<QString, KBookmarkList> iter(m_bk_map);
-        while (iter.hasNext()) {
-            iter.next();
-            foreach (KBookmark &it, iter.value()) {
-                kDebug() << "updating favicon for" << it.url();
-                it.setIcon(KMimeType::favIconForUrl(it.url()));
-            }
+    m_valid = true;
+    m_generation = generation;
+}
+
+QList<KBookmark> KBookmarkIndex::find(const QString &url) const
+{
+    QList<KBookmark> result = m_bk_map.value(url);
+    // the document may have been changed without going through KBookmark
+    QMutableListIterator<KBookmark> iter(result);
+    while (iter.hasNext()) {
+        const QDomElement element = iter.next().internalElement();
+        if (element.parentNode().isNull() || element.attribute("href") != url) {
+            iter.remove();
         }
     }
+    return result;
 }
 
-void KBookmarkMap::visit(const KBookmark &bk)
+KBookmark KBookmarkIndex::findByAddress(const QString &address)
 {
+    QHash<QString, QPair<KBookmark, QDomNode> >::const_iterator it = m_bk_addresses.constFind(address);
+    if (it == m_bk_addresses.constEnd()) {
+        return KBookmark();
+    }
+    // a bookmark that was moved or removed without going through KBookmark,
+    // the index is rebuilt on the next lookup
+    if (it.value().first.internalElement().parentNode() != it.value().second) {
+        m_valid = false;
+        return KBookmark();
+    }
+    return it.value().first;
+}
+
+void KBookmarkIndex::add(const KBookmark &bk)
+{
+    QPair<QString, int> &group = m_groups.top();
+    m_bk_addresses.insert(group.first + QLatin1Char('/') + QString::number(group.second),
+                          qMakePair(bk, bk.internalElement().parentNode()));
+    group.second++;
+}
+
+void KBookmarkIndex::visit(const KBookmark &bk)
+{
+    add(bk);
     if (!bk.isSeparator()) {
         // add bookmark to url map
         m_bk_map[bk.internalElement().attribute("href")].append(bk);
     }
 }
 
+void KBookmarkIndex::visitEnter(const KBookmarkGroup &group)
+{
+    add(group);
+    const QPair<QString, int> &parent = m_groups.top();
+    m_groups.push(qMakePair(parent.first + QLatin1Char('/') + QString::number(parent.second - 1), 0));
+}
+
+void KBookmarkIndex::visitLeave(const KBookmarkGroup &)
+{
+    m_groups.pop();
+}
+
 // #########################
 // KBookmarkManagerPrivate
 class KBookmarkManagerPrivate
@@ -139,7 +198,7 @@ public:
 
     KDirWatch* m_kDirWatch; // for external bookmark files
 
-    KBookmarkMap m_map;
+    KBookmarkIndex m_index;
 };
 
 // ################
@@ -344,7 +403,7 @@ void KBookmarkManager::parse() const
 
     file.close();
 
-    d->m_map.setNeedsUpdate();
+    d->m_index.setNeedsUpdate();
 }
 
 bool KBookmarkManager::save() const
@@ -360,7 +419,8 @@ bool KBookmarkManager::saveAs(const QString &filename) const
     if (file.open()) {
         QTextStream stream(&file);
         stream.setCodec(QTextCodec::codecForName("UTF-8"));
-        stream << internalDocument().toString();
+        // same output as toString(), without building the whole file in memory first
+        internalDocument().save(stream, 1);
         stream.flush();
         if (file.finalize()) {
             return true;
@@ -397,10 +457,9 @@ KBookmarkGroup KBookmarkManager::root() const
     return KBookmarkGroup(internalDocument().documentElement());
 }
 
-KBookmark KBookmarkManager::findByAddress(const QString &address)
+static KBookmark findByAddressInGroup(const KBookmarkGroup &root, const QString &address)
 {
-    // kDebug(7043) << "findByAddress" << address;
-    KBookmark result = root();
+    KBookmark result = root;
     // The address is something like /5/10/2+
     const QStringList addresses = address.split(QRegExp("[/+]"),QString::SkipEmptyParts);
     // kWarning() << addresses.join(",");
@@ -418,6 +477,19 @@ KBookmark KBookmarkManager::findByAddress(const QString &address)
        // kWarning() << "found section";
        result = bk;
     }
+    return result;
+}
+
+KBookmark KBookmarkManager::findByAddress(const QString &address)
+{
+    // kDebug(7043) << "findByAddress" << address;
+    d->m_index.update(this);
+    KBookmark result = d->m_index.findByAddress(address);
+    if (result.isNull()) {
+        // not an address as KBookmark::address() makes them, e.g. the root or
+        // "/2/+", or a bookmark that is no longer where it was indexed
+        result = findByAddressInGroup(root(), address);
+    }
     if (result.isNull()) {
         kWarning() << "couldn't find item" << address;
     } else {
@@ -426,7 +498,7 @@ KBookmark KBookmarkManager::findByAddress(const QString &address)
     }
     // kDebug() << "found " << result.address();
     return result;
- }
+}
 
 void KBookmarkManager::emitChanged()
 {
@@ -534,11 +606,23 @@ void KBookmarkManager::slotEditBookmarksAtAddress(const QString &address)
 }
 
 ///////
+void KBookmarkManager::invalidateIndex()
+{
+    d->m_index.setNeedsUpdate();
+}
+
+QList<KBookmark> KBookmarkManager::findByUrl(const QString &url)
+{
+    d->m_index.update(this);
+    return d->m_index.find(url);
+}
+
 bool KBookmarkManager::updateAccessMetadata(const QString &url)
 {
-    d->m_map.update(this);
-    QList<KBookmark> list = d->m_map.find(url);
+    QList<KBookmark> list = findByUrl(url);
     foreach (KBookmark &it, list) {
+        kDebug() << "updating favicon for" << it.url();
+        it.setIcon(KMimeType::favIconForUrl(it.url()));
         it.updateAccessMetadata();
     }
     return true;
@@ -546,8 +630,7 @@ bool KBookmarkManager::updateAccessMetadata(const QString &url)
 
 void KBookmarkManager::updateFavicon(const QString &url, const QString &faviconurl)
 {
-    d->m_map.update(this);
-    QList<KBookmark> list = d->m_map.find(url);
+    QList<KBookmark> list = findByUrl(url);
     foreach (KBookmark &it, list) {
         KUrl iconurl(faviconurl);
         it.setIcon(KMimeType::favIconForUrl(iconurl));
@@ -165,6 +165,25 @@ public:
      */
     KBookmark findByAddress(const QString &address);
 
+    /**
+     * @return all bookmarks pointing to @p url, in document order
+     * @param url the URL as stored in the bookmarks file, i.e. KUrl::url()
+     *
+     * Lookups by URL and by address use an index which is built the first
+     * time it is needed after the bookmarks were loaded or changed through
+     * the KBookmark API.
+     * @since 4.24
+     */
+    QList<KBookmark> findByUrl(const QString &url);
+
+    /**
+     * Rebuilds the index of findByUrl() and findByAddress() on the next
+     * lookup. Call it after changing internalDocument() directly instead
+     * of through the KBookmark API.
+     * @since 4.24
+     */
+    void invalidateIndex();
+
 
     /**
      * Saves the bookmark file and notifies everyone.
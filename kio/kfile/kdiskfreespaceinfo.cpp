@@ -100,7 +100,7 @@ KDiskFreeSpaceInfo KDiskFreeSpaceInfo::freeSpaceInfo(const QString &path)
     KDiskFreeSpaceInfo info;
 
     // determine the mount point
-    KMountPoint::Ptr mp = KMountPoint::currentMountPoints().findByPath(path);
+    KMountPoint::Ptr mp = KMountPoint::currentMountPoint(path);
     if (mp) {
         info.d->mountPoint = mp->mountPoint();
     }
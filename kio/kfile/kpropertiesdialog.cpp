@@ -1028,7 +1028,7 @@ KFilePropsPlugin::KFilePropsPlugin(KPropertiesDialog *props)
     if (isLocal && hasDirs) {
         // only for directories
 
-        KMountPoint::Ptr mp = KMountPoint::currentMountPoints().findByPath(url.toLocalFile());
+        KMountPoint::Ptr mp = KMountPoint::currentMountPoint(url.toLocalFile());
         if (mp) {
             KDiskFreeSpaceInfo info = KDiskFreeSpaceInfo::freeSpaceInfo(mp->mountPoint());
             if (info.size() != 0) {
@@ -1212,7 +1212,7 @@ void KFilePropsPlugin::slotSizeDetermine()
         const KFileItem item = properties->item();
         KUrl url = item.mostLocalUrl(isLocal);
         if (isLocal) {
-            KMountPoint::Ptr mp = KMountPoint::currentMountPoints().findByPath(url.toLocalFile());
+            KMountPoint::Ptr mp = KMountPoint::currentMountPoint(url.toLocalFile());
             if (mp) {
                 KDiskFreeSpaceInfo info = KDiskFreeSpaceInfo::freeSpaceInfo(mp->mountPoint());
                 slotFoundMountPoint(info.mountPoint(), info.size() / 1024, info.used() / 1024, info.available() / 1024);
@@ -568,7 +568,11 @@ bool KFileItemPrivate::isSlow() const
     if (m_slow == SlowUnknown) {
         const QString path = localPath();
         if (!path.isEmpty()) {
-            const KFileSystemType::Type fsType = KFileSystemType::fileSystemType(path);
+            // the device from the listing is the one of the link, not of its target
+            const long long deviceId = m_bLink ? -1 : m_entry.numberValue(KIO::UDSEntry::UDS_DEVICE_ID, -1);
+            const KFileSystemType::Type fsType = deviceId != -1
+                ? KFileSystemType::fileSystemType(path, deviceId)
+                : KFileSystemType::fileSystemType(path);
             m_slow = (fsType == KFileSystemType::Nfs || fsType == KFileSystemType::Smb) ? Slow : Fast;
         } else {
             m_slow = Slow;
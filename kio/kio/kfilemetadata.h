@@ -37,6 +37,10 @@
 
     @since 4.21
     @note all virtual methods, despite not being pure-virtual, must be reimplemented
+    @note KFileMetaInfo::fromPaths() creates one instance per thread and calls metaData()
+    from several threads at the same time. Plugins whose library is not reentrant have to
+    set X-KDE-MetadataNotReentrant=true in their .desktop file, their metaData() is then
+    called from one thread at a time.
 */
 class KIO_EXPORT KFileMetaDataPlugin : public QObject
 {
@@ -31,7 +31,18 @@
 #include <kmimetype.h>
 
 #include <QFileInfo>
+#include <QDateTime>
 #include <QStringList>
+#include <QHash>
+#include <QCache>
+#include <QMutex>
+#include <QVector>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+// number of files fromPaths() remembers the metadata of
+#define KFILEMETAINFO_CACHESIZE 10000
 
 static const KFileMetaInfoItem nullitem;
 static KFileMetaInfoItem mutablenullitem;
@@ -53,6 +64,135 @@ static QStringList kMetaGlobMimeTypes(const QStringList &servicetypes)
 }
 
 
+// An enabled plugin, everything that needs the service properties is
+// resolved by the thread that creates the dispatch
+struct KFileMetaDataPluginEntry
+{
+    KService::Ptr service;
+    QString name;
+    QString keyword;
+    QStringList mimeTypes;
+    // only one thread at a time extracts metadata with a plugin whose
+    // library is not reentrant, the others run in parallel
+    bool notReentrant;
+    QMutex mutex;
+};
+
+// Maps mimetypes to the enabled plugins for them, the configuration and
+// the service query are read once per instance
+class KFileMetaDataDispatch
+{
+public:
+    KFileMetaDataDispatch();
+    ~KFileMetaDataDispatch();
+
+    QList<KFileMetaDataPluginEntry*> plugins(const KMimeType::Ptr &filemimetype);
+
+private:
+    Q_DISABLE_COPY(KFileMetaDataDispatch);
+
+    QList<KFileMetaDataPluginEntry*> m_plugins;
+    QMutex m_mutex;
+    QHash<QString, QList<KFileMetaDataPluginEntry*> > m_pluginsByMimeType;
+};
+
+KFileMetaDataDispatch::KFileMetaDataDispatch()
+{
+    KConfig config("kmetainformationrc", KConfig::NoGlobals);
+    KConfigGroup pluginsgroup = config.group("Plugins");
+    const KService::List kfmdplugins = KServiceTypeTrader::self()->query("KFileMetaData/Plugin");
+    foreach (const KService::Ptr &kfmdplugin, kfmdplugins) {
+        const QString kfmdname = kfmdplugin->desktopEntryName();
+        const bool enable = pluginsgroup.readEntry(kfmdname, true);
+        if (enable) {
+            KFileMetaDataPluginEntry *entry = new KFileMetaDataPluginEntry();
+            entry->service = kfmdplugin;
+            entry->name = kfmdname;
+            // the properties are read from the ksycoca of this thread
+            entry->keyword = kfmdplugin->pluginKeyword();
+            entry->mimeTypes = kMetaGlobMimeTypes(kfmdplugin->serviceTypes());
+            entry->notReentrant = kfmdplugin->property("X-KDE-MetadataNotReentrant", QVariant::Bool).toBool();
+            m_plugins.append(entry);
+        }
+    }
+}
+
+KFileMetaDataDispatch::~KFileMetaDataDispatch()
+{
+    qDeleteAll(m_plugins);
+}
+
+QList<KFileMetaDataPluginEntry*> KFileMetaDataDispatch::plugins(const KMimeType::Ptr &filemimetype)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, QList<KFileMetaDataPluginEntry*> >::const_iterator it = m_pluginsByMimeType.constFind(filemimetype->name());
+    if (it != m_pluginsByMimeType.constEnd()) {
+        return it.value();
+    }
+
+    QList<KFileMetaDataPluginEntry*> result;
+    foreach (KFileMetaDataPluginEntry *entry, m_plugins) {
+        // qDebug() << Q_FUNC_INFO << filemimetype->name() << entry->name;
+        foreach (const QString &kfmdpluginmime, entry->mimeTypes) {
+            bool mimematches = false;
+            if (kfmdpluginmime.endsWith('*')) {
+                const QString kfmdpluginmimeglob = kfmdpluginmime.mid(0, kfmdpluginmime.size() - 1);
+                if (filemimetype->name().startsWith(kfmdpluginmimeglob)) {
+                    mimematches = true;
+                }
+            }
+
+            if (!mimematches && filemimetype->is(kfmdpluginmime)) {
+                mimematches = true;
+            }
+
+            if (mimematches) {
+                result.append(entry);
+                break;
+            }
+        }
+    }
+    m_pluginsByMimeType.insert(filemimetype->name(), result);
+    return result;
+}
+
+// Plugin instances of one thread, kept until it is done with its files
+class KFileMetaDataPluginPool
+{
+public:
+    KFileMetaDataPluginPool() { }
+    ~KFileMetaDataPluginPool() { qDeleteAll(m_instances); }
+
+    KFileMetaDataPlugin* instance(const KFileMetaDataPluginEntry *entry);
+
+private:
+    Q_DISABLE_COPY(KFileMetaDataPluginPool);
+
+    QHash<const KFileMetaDataPluginEntry*, KFileMetaDataPlugin*> m_instances;
+};
+
+KFileMetaDataPlugin* KFileMetaDataPluginPool::instance(const KFileMetaDataPluginEntry *entry)
+{
+    QHash<const KFileMetaDataPluginEntry*, KFileMetaDataPlugin*>::const_iterator it = m_instances.constFind(entry);
+    if (it != m_instances.constEnd()) {
+        return it.value();
+    }
+    // not KService::createInstance(), it reads the plugin keyword from the
+    // service properties which belong to the thread of the dispatch
+    KFileMetaDataPlugin *kfmdplugininstance = nullptr;
+    KPluginLoader pluginloader(*entry->service);
+    KPluginFactory *factory = pluginloader.factory();
+    if (factory) {
+        kfmdplugininstance = factory->create<KFileMetaDataPlugin>(entry->keyword);
+    }
+    if (!kfmdplugininstance) {
+        kWarning() << "Could not create KFileMetaDataPlugin instance" << entry->name;
+    }
+    // a failure is remembered too, it will not go better for the next file
+    m_instances.insert(entry, kfmdplugininstance);
+    return kfmdplugininstance;
+}
+
 class KFileMetaInfoPrivate : public QSharedData
 {
 public:
@@ -60,6 +200,8 @@ public:
     KUrl m_url;
 
     void init(const QString &filename, const KUrl& url);
+    void init(const QString &filename, const KUrl& url,
+              KFileMetaDataDispatch *dispatch, KFileMetaDataPluginPool *pool);
     void operator=(const KFileMetaInfoPrivate &kfmip) {
         items = kfmip.items;
         m_url = kfmip.m_url;
@@ -67,46 +209,33 @@ public:
 };
 
 void KFileMetaInfoPrivate::init(const QString &filename, const KUrl &url)
+{
+    if (!url.isLocalFile()) {
+        init(filename, url, nullptr, nullptr);
+        return;
+    }
+    KFileMetaDataDispatch dispatch;
+    KFileMetaDataPluginPool pool;
+    init(filename, url, &dispatch, &pool);
+}
+
+void KFileMetaInfoPrivate::init(const QString &filename, const KUrl &url,
+                                KFileMetaDataDispatch *dispatch, KFileMetaDataPluginPool *pool)
 {
     m_url = url;
 
     // none of the plugins supports remote files
     if (url.isLocalFile()) {
         const QString urlpath = url.toLocalFile();
-        KConfig config("kmetainformationrc", KConfig::NoGlobals);
-        KConfigGroup pluginsgroup = config.group("Plugins");
         const KMimeType::Ptr filemimetype = KMimeType::findByUrl(url);
-        const KService::List kfmdplugins = KServiceTypeTrader::self()->query("KFileMetaData/Plugin");
-        foreach (const KService::Ptr &kfmdplugin, kfmdplugins) {
-            const QString kfmdname = kfmdplugin->desktopEntryName();
-            const bool enable = pluginsgroup.readEntry(kfmdname, true);
-            if (enable) {
-                // qDebug() << Q_FUNC_INFO << filemimetype->name() << kfmdname;
-                foreach (const QString &kfmdpluginmime, kMetaGlobMimeTypes(kfmdplugin->serviceTypes())) {
-                    bool mimematches = false;
-                    if (kfmdpluginmime.endsWith('*')) {
-                        const QString kfmdpluginmimeglob = kfmdpluginmime.mid(0, kfmdpluginmime.size() - 1);
-                        if (filemimetype && filemimetype->name().startsWith(kfmdpluginmimeglob)) {
-                            mimematches = true;
-                        }
-                    }
-
-                    if (!mimematches && filemimetype->is(kfmdpluginmime)) {
-                        mimematches = true;
-                    }
-
-                    if (mimematches) {
-                        kDebug() << "Extracting metadata via" << kfmdname;
-                        KFileMetaDataPlugin *kfmdplugininstance = kfmdplugin->createInstance<KFileMetaDataPlugin>();
-                        if (kfmdplugininstance) {
-                            items.append(kfmdplugininstance->metaData(urlpath));
-                            delete kfmdplugininstance;
-                        } else {
-                            kWarning() << "Could not create KFileMetaDataPlugin instance";
-                        }
-                        break;
-                    }
-                }
+        foreach (KFileMetaDataPluginEntry *entry, dispatch->plugins(filemimetype)) {
+            kDebug() << "Extracting metadata via" << entry->name;
+            KFileMetaDataPlugin *kfmdplugininstance = pool->instance(entry);
+            if (kfmdplugininstance && entry->notReentrant) {
+                QMutexLocker locker(&entry->mutex);
+                items.append(kfmdplugininstance->metaData(urlpath));
+            } else if (kfmdplugininstance) {
+                items.append(kfmdplugininstance->metaData(urlpath));
             }
         }
 
@@ -138,6 +267,85 @@ void KFileMetaInfoPrivate::init(const QString &filename, const KUrl &url)
     items.append(kfmi2);
 }
 
+// Results of fromPaths() with UseCache, the cost of an entry is one
+struct KFileMetaInfoCacheEntry
+{
+    qint64 mtime;
+    qint64 size;
+    KFileMetaInfo info;
+};
+
+class KFileMetaInfoCache
+{
+public:
+    KFileMetaInfoCache() : entries(KFILEMETAINFO_CACHESIZE) { }
+
+    QMutex mutex;
+    QCache<QString, KFileMetaInfoCacheEntry> entries;
+};
+K_GLOBAL_STATIC(KFileMetaInfoCache, globalMetaInfoCache)
+
+class KFileMetaInfoRunnable : public QRunnable
+{
+public:
+    KFileMetaInfoRunnable(const QStringList &paths, KFileMetaInfo *results, QAtomicInt *next,
+                          KFileMetaDataDispatch *dispatch, KFileMetaInfo::CacheMode cachemode)
+        : QRunnable(),
+        m_paths(paths), m_results(results), m_next(next),
+        m_dispatch(dispatch), m_cachemode(cachemode)
+    {
+    }
+
+    void run() final;
+
+private:
+    const QStringList m_paths;
+    KFileMetaInfo *m_results;
+    QAtomicInt *m_next;
+    KFileMetaDataDispatch *m_dispatch;
+    const KFileMetaInfo::CacheMode m_cachemode;
+};
+
+void KFileMetaInfoRunnable::run()
+{
+    KFileMetaDataPluginPool pool;
+    forever {
+        const int index = m_next->fetchAndAddOrdered(1);
+        if (index >= m_paths.size()) {
+            break;
+        }
+        const QString path = m_paths.at(index);
+        const QFileInfo fileinfo(path);
+        // only open the file if it is not a pipe
+        if (!fileinfo.isFile() && !fileinfo.isDir() && !fileinfo.isSymLink()) {
+            continue;
+        }
+
+        const qint64 mtime = fileinfo.lastModified().toMSecsSinceEpoch();
+        const qint64 size = fileinfo.size();
+        if (m_cachemode == KFileMetaInfo::UseCache) {
+            QMutexLocker locker(&globalMetaInfoCache->mutex);
+            const KFileMetaInfoCacheEntry *entry = globalMetaInfoCache->entries.object(path);
+            if (entry && entry->mtime == mtime && entry->size == size) {
+                m_results[index] = entry->info;
+                continue;
+            }
+        }
+
+        KFileMetaInfo &info = m_results[index];
+        info.d->init(fileinfo.fileName(), KUrl(path), m_dispatch, &pool);
+
+        if (m_cachemode == KFileMetaInfo::UseCache) {
+            KFileMetaInfoCacheEntry *entry = new KFileMetaInfoCacheEntry();
+            entry->mtime = mtime;
+            entry->size = size;
+            entry->info = info;
+            QMutexLocker locker(&globalMetaInfoCache->mutex);
+            globalMetaInfoCache->entries.insert(path, entry);
+        }
+    }
+}
+
 KFileMetaInfo::KFileMetaInfo(const QString &path)
     : d(new KFileMetaInfoPrivate())
 {
@@ -148,6 +356,25 @@ KFileMetaInfo::KFileMetaInfo(const QString &path)
     }
 }
 
+QList<KFileMetaInfo> KFileMetaInfo::fromPaths(const QStringList &paths, CacheMode cachemode)
+{
+    QVector<KFileMetaInfo> results(paths.size());
+    if (paths.isEmpty()) {
+        return results.toList();
+    }
+
+    KFileMetaDataDispatch dispatch;
+    QAtomicInt next(0);
+    const int threadcount = qMin(QThread::idealThreadCount(), paths.size());
+    QThreadPool threadpool;
+    threadpool.setMaxThreadCount(threadcount);
+    for (int i = 0; i < threadcount; i++) {
+        threadpool.start(new KFileMetaInfoRunnable(paths, results.data(), &next, &dispatch, cachemode));
+    }
+    threadpool.waitForDone();
+    return results.toList();
+}
+
 KFileMetaInfo::KFileMetaInfo(const KUrl &url)
     : d(new KFileMetaInfoPrivate())
 {
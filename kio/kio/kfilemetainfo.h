@@ -26,6 +26,7 @@ class KUrl;
 typedef QList<KFileMetaInfoItem> KFileMetaInfoItemList;
 
 class KFileMetaInfoPrivate;
+class KFileMetaInfoRunnable;
 /**
  * KFileMetaInfo provides metadata extracted from a file or other resource.
  *
@@ -36,6 +37,18 @@ class KFileMetaInfoPrivate;
 class KIO_EXPORT KFileMetaInfo
 {
 public:
+    /**
+     * @brief Whether fromPaths() reuses earlier results
+     * @since 4.24
+     **/
+    enum CacheMode {
+        /// extract the metadata of every file
+        NoCache = 0,
+        /// reuse the metadata extracted by an earlier call for files whose
+        /// modification time and size did not change since
+        UseCache = 1
+    };
+
     /**
      * @brief Construct a KFileMetaInfo that contains metainformation about
      * the resource pointed to by @p path.
@@ -88,7 +101,27 @@ public:
      * @brief Returns localized name of @p key
      **/
     static QString name(const QString &key);
+
+    /**
+     * @brief Extracts the metadata of many files at once.
+     *
+     * Equivalent to constructing a KFileMetaInfo for each of @p paths, but
+     * the plugin configuration is read and the plugins are looked up only
+     * once, each plugin is loaded at most once per thread and the files are
+     * processed on as many threads as there are cores.
+     *
+     * With UseCache results are remembered for the last 10000 files, changes
+     * to the plugin configuration are not noticed until the files change.
+     *
+     * @param paths local file paths, as for KFileMetaInfo(const QString &)
+     * @param cachemode whether to reuse results of earlier calls
+     * @return one instance per path, in the same order; paths that are not
+     * files, directories or symlinks give invalid instances
+     * @since 4.24
+     **/
+    static QList<KFileMetaInfo> fromPaths(const QStringList &paths, CacheMode cachemode = NoCache);
 private:
+    friend class KFileMetaInfoRunnable;
     QSharedDataPointer<KFileMetaInfoPrivate> d;
 };
 
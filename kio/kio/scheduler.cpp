@@ -33,6 +33,7 @@
 
 
 #include <QHash>
+#include <QFile>
 #include <QTextCodec>
 #include <QCoreApplication>
 #include <QThread>
@@ -41,10 +42,27 @@
 #include <QWidget>
 
 #include <assert.h>
+#include <string.h>
 
 // Slaves may be idle for a certain time (1 minute) before they are killed.
 static const int s_idleSlaveLifetime = 1 * 60;
 
+// Limit the memory used by tracing, the oldest events are dropped.
+static const int s_maxTraceEvents = 100000;
+
+// Set KIO_SCHEDULER_TRACE to any value to enable tracing from startup.
+static bool s_tracingEnabled = !qgetenv("KIO_SCHEDULER_TRACE").isEmpty();
+
+// monotonic clock in microseconds
+static qint64 schedulerClock()
+{
+    static QElapsedTimer s_clock;
+    if (!s_clock.isValid()) {
+        s_clock.start();
+    }
+    return (s_clock.nsecsElapsed() / 1000);
+}
+
 
 using namespace KIO;
 
@@ -105,6 +123,58 @@ void SessionData::reset()
     KProtocolManager::reparseConfiguration();
 }
 
+SchedulerHistogram::SchedulerHistogram()
+ : m_count(0),
+   m_total(0),
+   m_max(0)
+{
+    ::memset(m_buckets, 0, sizeof(m_buckets));
+}
+
+void SchedulerHistogram::add(qint64 msecs)
+{
+    msecs = qMax(msecs, qint64(0));
+    m_count++;
+    m_total += msecs;
+    m_max = qMax(m_max, msecs);
+    // bucket 0 is less than 1ms, bucket N is less than 2^N ms, the last one is everything else
+    int bucket = 0;
+    while (bucket < (m_bucketsCount - 1) && msecs >= (qint64(1) << bucket)) {
+        bucket++;
+    }
+    m_buckets[bucket]++;
+}
+
+QString SchedulerHistogram::toString() const
+{
+    if (m_count == 0) {
+        return QString::fromLatin1("none");
+    }
+    QString result = QString::fromLatin1("count %1, average %2ms, max %3ms,").arg(
+        QString::number(m_count), QString::number(m_total / m_count), QString::number(m_max)
+    );
+    for (int i = 0; i < m_bucketsCount; i++) {
+        if (m_buckets[i] == 0) {
+            continue;
+        }
+        if (i == (m_bucketsCount - 1)) {
+            result += QString::fromLatin1(" >=%1ms: %2").arg(QString::number(qint64(1) << (i - 1)), QString::number(m_buckets[i]));
+        } else {
+            result += QString::fromLatin1(" <%1ms: %2").arg(QString::number(qint64(1) << i), QString::number(m_buckets[i]));
+        }
+    }
+    return result;
+}
+
+SchedulerStatistics::SchedulerStatistics()
+ : slavesCreated(0),
+   slavesReused(0),
+   bytesTransferred(0),
+   jobsFinished(0),
+   jobsCancelled(0)
+{
+}
+
 int SerialPicker::changedPrioritySerial(int oldSerial, int newPriority) const
 {
     Q_ASSERT(newPriority >= -10 && newPriority <= 10);
@@ -317,6 +387,7 @@ void ProtoQueue::queueJob(SimpleJob *job)
 
     const bool wasQueueEmpty = hq.isQueueEmpty();
     hq.queueJob(job);
+    m_jobQueuedTime.insert(job, schedulerClock());
     // note that HostQueue::queueJob() into an empty queue changes its lowestSerial() too...
     // the queue's lowest serial job may have changed, so update the ordered list of queues.
     // however, we ignore all jobs that would cause more connections to a host than allowed.
@@ -375,7 +446,30 @@ void ProtoQueue::removeJob(SimpleJob *job)
 
     Q_ASSERT(hq.runningJobsCount() <= m_maxConnectionsPerHost);
 
+    // forget the times even if the job is not found below, the job may be
+    // deleted and its address reused by the next one
+    const qint64 queuedTime = m_jobQueuedTime.take(job);
+    const bool wasStarted = m_jobStartedTime.contains(job);
+    const qint64 startedTime = m_jobStartedTime.take(job);
+
     if (hq.removeJob(job)) {
+        const qint64 now = schedulerClock();
+        if (wasStarted) {
+            m_statistics.jobDuration.add((now - startedTime) / 1000);
+            m_statistics.bytesTransferred += job->processedAmount(KJob::Bytes);
+            m_statistics.jobsFinished++;
+            if (s_tracingEnabled) {
+                const qint64 slavePid = (jobPriv->m_slave ? jobPriv->m_slave->pid() : 0);
+                addTraceEvent(job, QString::fromLatin1("wait"), queuedTime, startedTime, 0);
+                addTraceEvent(job, QString::fromLatin1("run"), startedTime, now, slavePid);
+            }
+        } else {
+            m_statistics.jobsCancelled++;
+            if (s_tracingEnabled) {
+                addTraceEvent(job, QString::fromLatin1("cancelled"), queuedTime, now, 0);
+            }
+        }
+
         if (hq.lowestSerial() != prevLowestSerial) {
             // we have dequeued the not yet running job with the lowest serial
             Q_ASSERT(!jobPriv->m_slave);
@@ -436,6 +530,60 @@ SlaveInterface *ProtoQueue::createSlave(const QString &protocol, SimpleJob *job,
     return slave;
 }
 
+void ProtoQueue::addTraceEvent(SimpleJob *job, const QString &category, qint64 start, qint64 end, qint64 thread)
+{
+    if (m_traceEvents.size() >= s_maxTraceEvents) {
+        m_traceEvents.removeFirst();
+    }
+    const SchedulerTraceEvent event = {
+        SimpleJobPrivate::get(job)->m_url.prettyUrl(),
+        category,
+        start,
+        end - start,
+        thread
+    };
+    m_traceEvents.append(event);
+}
+
+QString ProtoQueue::statistics(const QString &protocol) const
+{
+    int queuedJobs = 0;
+    QString hostsStatistics;
+    QHash<QString, HostQueue>::const_iterator it = m_queuesByHostname.constBegin();
+    for (; it != m_queuesByHostname.constEnd(); ++it) {
+        queuedJobs += it.value().queuedJobsCount();
+        hostsStatistics += QString::fromLatin1("  host \"%1\": running %2, queued %3\n").arg(
+            it.key(), QString::number(it.value().runningJobsCount()), QString::number(it.value().queuedJobsCount())
+        );
+    }
+
+    const qint64 slavesAssigned = (m_statistics.slavesCreated + m_statistics.slavesReused);
+    const qint64 reuseRatio = (slavesAssigned > 0 ? (m_statistics.slavesReused * 100 / slavesAssigned) : 0);
+    QString result = QString::fromLatin1("protocol %1: max slaves %2, max slaves per host %3, running %4, queued %5\n").arg(
+        protocol, QString::number(m_maxConnectionsTotal), QString::number(m_maxConnectionsPerHost),
+        QString::number(m_runningJobsCount), QString::number(queuedJobs)
+    );
+    result += QString::fromLatin1("  slaves: created %1, reused %2 (%3%), idle %4\n").arg(
+        QString::number(m_statistics.slavesCreated), QString::number(m_statistics.slavesReused),
+        QString::number(reuseRatio), QString::number(m_slaveKeeper.allSlaves().count())
+    );
+    result += QString::fromLatin1("  jobs: finished %1, cancelled before start %2, bytes transferred %3\n").arg(
+        QString::number(m_statistics.jobsFinished), QString::number(m_statistics.jobsCancelled),
+        QString::number(m_statistics.bytesTransferred)
+    );
+    result += QString::fromLatin1("  wait time: %1\n").arg(m_statistics.waitTime.toString());
+    result += QString::fromLatin1("  spawn time: %1\n").arg(m_statistics.spawnTime.toString());
+    result += QString::fromLatin1("  job duration: %1\n").arg(m_statistics.jobDuration.toString());
+    result += hostsStatistics;
+    return result;
+}
+
+void ProtoQueue::resetStatistics()
+{
+    m_statistics = SchedulerStatistics();
+    m_traceEvents.clear();
+}
+
 bool ProtoQueue::removeSlave (KIO::SlaveInterface *slave)
 {
     const bool removedUnconnected = m_slaveKeeper.removeSlave(slave);
@@ -501,15 +649,25 @@ void ProtoQueue::startAJob()
         // so increase the count here already.
         m_runningJobsCount++;
 
+        const qint64 startedTime = schedulerClock();
+        m_statistics.waitTime.add((startedTime - m_jobQueuedTime.value(startingJob, startedTime)) / 1000);
+
         bool isNewSlave = false;
         SlaveInterface *slave = m_slaveKeeper.takeSlaveForJob(startingJob);
         SimpleJobPrivate *jobPriv = SimpleJobPrivate::get(startingJob);
         if (!slave) {
             isNewSlave = true;
             slave = createSlave(jobPriv->m_protocol, startingJob, jobPriv->m_url);
+            if (slave) {
+                m_statistics.slavesCreated++;
+                m_statistics.spawnTime.add((schedulerClock() - startedTime) / 1000);
+            }
+        } else {
+            m_statistics.slavesReused++;
         }
 
         if (slave) {
+            m_jobStartedTime.insert(startingJob, startedTime);
             jobPriv->m_slave = slave;
             setupSlave(slave, jobPriv->m_url, jobPriv->m_protocol, jobPriv->m_proxyList, isNewSlave);
             startJob(startingJob, slave);
@@ -579,6 +737,10 @@ public:
 
     void slotUnregisterWindow(QObject *);
 
+    QString statistics() const;
+    bool writeTrace(const QString &filePath) const;
+    void resetStatistics();
+
     ProtoQueue *protoQ(const QString& protocol, const QString& host)
     {
         ProtoQueue *pq = m_protocols.value(protocol, 0);
@@ -674,6 +836,31 @@ void Scheduler::unregisterWindow(QObject *wid)
     schedulerPrivate->slotUnregisterWindow(wid);
 }
 
+QString Scheduler::statistics() const
+{
+    return schedulerPrivate->statistics();
+}
+
+void Scheduler::resetStatistics()
+{
+    schedulerPrivate->resetStatistics();
+}
+
+bool Scheduler::isTracingEnabled() const
+{
+    return s_tracingEnabled;
+}
+
+void Scheduler::setTracingEnabled(bool enabled)
+{
+    s_tracingEnabled = enabled;
+}
+
+bool Scheduler::writeTrace(const QString &filePath) const
+{
+    return schedulerPrivate->writeTrace(filePath);
+}
+
 void Scheduler::emitReparseSlaveConfiguration()
 {
     // Do it immediately in this process, otherwise we might send a request before reparsing
@@ -714,6 +901,63 @@ void SchedulerPrivate::slotReparseSlaveConfiguration(const QString &proto, const
     }
 }
 
+QString SchedulerPrivate::statistics() const
+{
+    QString result;
+    QStringList protocols = m_protocols.keys();
+    protocols.sort();
+    Q_FOREACH (const QString &protocol, protocols) {
+        result += m_protocols.value(protocol)->statistics(protocol);
+    }
+    return result;
+}
+
+bool SchedulerPrivate::writeTrace(const QString &filePath) const
+{
+    QFile traceFile(filePath);
+    if (!traceFile.open(QFile::WriteOnly | QFile::Truncate)) {
+        kWarning(7006) << "Could not open" << filePath;
+        return false;
+    }
+
+    // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray trace("{\"traceEvents\":[");
+    bool first = true;
+    QHash<QString, ProtoQueue *>::const_iterator it = m_protocols.constBegin();
+    for (; it != m_protocols.constEnd(); ++it) {
+        Q_FOREACH (const SchedulerTraceEvent &event, it.value()->traceEvents()) {
+            if (!first) {
+                trace += ',';
+            }
+            first = false;
+            QString name = event.name;
+            name.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+            name.replace(QLatin1Char('"'), QLatin1String("\\\""));
+            trace += "\n{\"name\":\"" + name.toUtf8()
+                + "\",\"cat\":\"" + it.key().toUtf8() + ',' + event.category.toUtf8()
+                + "\",\"ph\":\"X\",\"ts\":" + QByteArray::number(event.timestamp)
+                + ",\"dur\":" + QByteArray::number(event.duration)
+                + ",\"pid\":" + pid
+                + ",\"tid\":" + QByteArray::number(event.thread) + '}';
+        }
+    }
+    trace += "\n]}\n";
+
+    if (traceFile.write(trace) != trace.size()) {
+        kWarning(7006) << "Could not write" << filePath;
+        return false;
+    }
+    return true;
+}
+
+void SchedulerPrivate::resetStatistics()
+{
+    Q_FOREACH (ProtoQueue *pq, m_protocols) {
+        pq->resetStatistics();
+    }
+}
+
 void SchedulerPrivate::doJob(SimpleJob *job)
 {
     kDebug(7006) << job;
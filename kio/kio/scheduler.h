@@ -138,6 +138,46 @@ namespace KIO {
 
         static Scheduler *self();
 
+    public Q_SLOTS:
+        /**
+         * Returns human-readable statistics about the scheduler: the queue depth per protocol
+         * and host, how long jobs waited for a slave, how long it took to create slaves, how
+         * often slaves were reused, the transferred bytes and histograms of the job durations.
+         * Also available via D-Bus, e.g.:
+         * \code
+         *    qdbus org.kde.myapp-1234 /KIO/Scheduler statistics
+         * \endcode
+         * @since 4.24
+         */
+        Q_SCRIPTABLE QString statistics() const;
+
+        /**
+         * Resets the statistics and the recorded trace events.
+         * @since 4.24
+         */
+        Q_SCRIPTABLE void resetStatistics();
+
+        /**
+         * Returns whether the time jobs spend waiting and running is recorded. Tracing can be
+         * enabled from startup by setting the KIO_SCHEDULER_TRACE environment variable.
+         * @since 4.24
+         */
+        Q_SCRIPTABLE bool isTracingEnabled() const;
+
+        /**
+         * Enables or disables recording of trace events.
+         * @since 4.24
+         */
+        Q_SCRIPTABLE void setTracingEnabled(bool enabled);
+
+        /**
+         * Writes the recorded trace events to @p filePath in the Chrome trace event format
+         * which can be loaded in chrome://tracing for example.
+         * @return true on success, false otherwise
+         * @since 4.24
+         */
+        Q_SCRIPTABLE bool writeTrace(const QString &filePath) const;
+
     Q_SIGNALS:
         // DBUS
         Q_SCRIPTABLE void reparseSlaveConfiguration(const QString &);
@@ -22,6 +22,7 @@
 #include <QSet>
 #include <QTimer>
 #include <QMap>
+#include <QElapsedTimer>
 
 // #define SCHEDULER_DEBUG
 
@@ -42,6 +43,51 @@ private:
     QString language;
 };
 
+// histogram of durations in milliseconds with power of two buckets
+class SchedulerHistogram
+{
+public:
+    SchedulerHistogram();
+
+    void add(qint64 msecs);
+    QString toString() const;
+
+private:
+    static const int m_bucketsCount = 16;
+    qint64 m_count;
+    qint64 m_total;
+    qint64 m_max;
+    qint64 m_buckets[m_bucketsCount];
+};
+
+class SchedulerStatistics
+{
+public:
+    SchedulerStatistics();
+
+    // time from queueing a job until a slave is assigned to it
+    SchedulerHistogram waitTime;
+    // time to create a new slave
+    SchedulerHistogram spawnTime;
+    // time from assigning a slave to a job until the job is finished
+    SchedulerHistogram jobDuration;
+    qint64 slavesCreated;
+    qint64 slavesReused;
+    qint64 bytesTransferred;
+    qint64 jobsFinished;
+    qint64 jobsCancelled;
+};
+
+// complete event in the Chrome trace format, times are in microseconds
+struct SchedulerTraceEvent
+{
+    QString name;
+    QString category;
+    qint64 timestamp;
+    qint64 duration;
+    qint64 thread;
+};
+
 class SlaveKeeper : public QObject
 {
     Q_OBJECT
@@ -73,6 +119,7 @@ public:
     int lowestSerial() const;
 
     bool isQueueEmpty() const { return m_queuedJobs.isEmpty(); }
+    int queuedJobsCount() const { return m_queuedJobs.count(); }
     bool isEmpty() const { return m_queuedJobs.isEmpty() && m_runningJobs.isEmpty(); }
     int runningJobsCount() const { return m_runningJobs.count(); }
 #ifdef SCHEDULER_DEBUG
@@ -129,6 +176,10 @@ public:
     bool removeSlave (KIO::SlaveInterface *slave);
     QList<KIO::SlaveInterface *> allSlaves() const;
 
+    QString statistics(const QString &protocol) const;
+    QList<SchedulerTraceEvent> traceEvents() const { return m_traceEvents; }
+    void resetStatistics();
+
 private slots:
     // start max one (non-connected) job and return
     void startAJob();
@@ -142,6 +193,14 @@ private:
     int m_maxConnectionsPerHost;
     int m_maxConnectionsTotal;
     int m_runningJobsCount;
+
+    void addTraceEvent(KIO::SimpleJob *job, const QString &category, qint64 start, qint64 end, qint64 thread);
+
+    SchedulerStatistics m_statistics;
+    // times are in microseconds since the scheduler clock was started
+    QHash<KIO::SimpleJob *, qint64> m_jobQueuedTime;
+    QHash<KIO::SimpleJob *, qint64> m_jobStartedTime;
+    QList<SchedulerTraceEvent> m_traceEvents;
 };
 
 } // namespace KIO
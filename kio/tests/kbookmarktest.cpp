@@ -23,7 +23,9 @@
 QTEST_KDEMAIN( KBookmarkTest, NoGUI )
 
 #include <kbookmark.h>
+#include <kbookmarkmanager.h>
 #include <kdebug.h>
+#include <ktempdir.h>
 #include <QtCore/QMimeData>
 
 static void compareBookmarks( const KBookmark& initialBookmark, const KBookmark& decodedBookmark )
@@ -97,3 +99,65 @@ void KBookmarkTest::testMimeDataBookmarkList()
 
     delete mimeData;
 }
+
+void KBookmarkTest::testManagerLookups()
+{
+    KTempDir tempDir;
+    KBookmarkManager *manager = KBookmarkManager::managerForExternalFile(tempDir.name() + "bookmarks.xml");
+    KBookmarkGroup root = manager->root();
+
+    KBookmark kde = root.addBookmark("KDE", KUrl("http://www.kde.org"));
+    KBookmarkGroup folder = root.createNewFolder("Folder");
+    KBookmark techbase = folder.addBookmark("Techbase", KUrl("http://techbase.kde.org"));
+    KBookmark kde2 = folder.addBookmark("KDE again", KUrl("http://www.kde.org"));
+
+    QCOMPARE(manager->findByAddress(kde.address()), kde);
+    QCOMPARE(manager->findByAddress("/1"), KBookmark(folder));
+    QCOMPARE(manager->findByAddress("/1/0"), techbase);
+    QCOMPARE(manager->findByAddress(""), KBookmark(root));
+    QVERIFY(manager->findByAddress("/1/5").isNull());
+    QCOMPARE(manager->findByUrl(KUrl("http://www.kde.org").url()), QList<KBookmark>() << kde << kde2);
+
+    // changes through the KBookmark API are seen by the next lookup
+    folder.moveBookmark(kde2, KBookmark());
+    QCOMPARE(manager->findByAddress("/1/0"), kde2);
+    QCOMPARE(manager->findByAddress(techbase.address()), techbase);
+    folder.deleteBookmark(kde2);
+    QCOMPARE(manager->findByUrl(KUrl("http://www.kde.org").url()), QList<KBookmark>() << kde);
+    techbase.setUrl(KUrl("http://api.kde.org"));
+    QVERIFY(manager->findByUrl(KUrl("http://techbase.kde.org").url()).isEmpty());
+    QCOMPARE(manager->findByUrl(KUrl("http://api.kde.org").url()), QList<KBookmark>() << techbase);
+
+    // changes made to the document directly have to be announced
+    QCOMPARE(manager->findByAddress("/0"), kde);
+    const QDomNode copy = kde.internalElement().cloneNode();
+    root.internalElement().insertBefore(copy, kde.internalElement());
+    manager->invalidateIndex();
+    QCOMPARE(manager->findByAddress("/0"), KBookmark(copy.toElement()));
+    QCOMPARE(manager->findByAddress("/1"), kde);
+    QCOMPARE(manager->findByAddress("/2/0"), techbase);
+
+    // but removed elements are noticed anyway
+    root.internalElement().removeChild(copy);
+    QCOMPARE(manager->findByAddress("/0"), kde);
+    QCOMPARE(manager->findByAddress("/1"), KBookmark(folder));
+
+    delete manager;
+}
+
+void KBookmarkTest::benchmarkFindByAddress()
+{
+    KTempDir tempDir;
+    KBookmarkManager *manager = KBookmarkManager::managerForExternalFile(tempDir.name() + "bookmarks.xml");
+    KBookmarkGroup folder = manager->root().createNewFolder("Folder");
+    for (int i = 0; i < 5000; ++i) {
+        folder.addBookmark(QString::number(i), KUrl("http://www.kde.org/" + QString::number(i)), "icon");
+    }
+
+    QBENCHMARK {
+        QVERIFY(!manager->findByAddress("/0/4999").isNull());
+        QCOMPARE(manager->findByUrl("http://www.kde.org/4999").count(), 1);
+    }
+
+    delete manager;
+}
@@ -27,6 +27,8 @@ class KBookmarkTest : public QObject
 private Q_SLOTS:
     void testMimeDataOneBookmark();
     void testMimeDataBookmarkList();
+    void testManagerLookups();
+    void benchmarkFindByAddress();
 };
 
 #endif // KBOOKMARKTEST_H
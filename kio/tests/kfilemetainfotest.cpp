@@ -91,6 +91,62 @@ void KFileMetaInfoTest::testReentrancy()
     m_eventLoop.exec();
 }
 
+void KFileMetaInfoTest::testFromPaths()
+{
+    QStringList paths;
+    for (int i = 0; i < 3; ++i) {
+        const QString file = m_tempDir.name() + "batchfile" + QString::number(i);
+        createTestFile(file);
+        paths << file;
+    }
+    paths << m_tempDir.name() + "doesnotexist";
+
+    for (int run = 0; run < 2; ++run) {
+        const QList<KFileMetaInfo> infos = KFileMetaInfo::fromPaths(paths, KFileMetaInfo::UseCache);
+        QCOMPARE(infos.size(), paths.size());
+        for (int i = 0; i < 3; ++i) {
+            QVERIFY(infos.at(i).isValid());
+            QCOMPARE(infos.at(i).keys(), KFileMetaInfo(paths.at(i)).keys());
+            const KFileMetaInfoItem& item = infos.at(i).item("http://www.semanticdesktop.org/ontologies/2007/03/22/nfo#fileName");
+            QCOMPARE(item.value(), QString("batchfile") + QString::number(i));
+        }
+        QVERIFY(!infos.at(3).isValid());
+    }
+
+    QVERIFY(KFileMetaInfo::fromPaths(QStringList()).isEmpty());
+}
+
+void KFileMetaInfoTest::benchmarkFromPaths_data()
+{
+    QTest::addColumn<bool>("batch");
+
+    QTest::newRow("one by one") << false;
+    QTest::newRow("fromPaths") << true;
+}
+
+void KFileMetaInfoTest::benchmarkFromPaths()
+{
+    QFETCH(bool, batch);
+
+    QStringList paths;
+    for (int i = 0; i < 200; ++i) {
+        const QString file = m_tempDir.name() + "benchmarkfile" + QString::number(i);
+        createTestFile(file, true);
+        paths << file;
+    }
+
+    QBENCHMARK {
+        if (batch) {
+            QCOMPARE(KFileMetaInfo::fromPaths(paths).size(), paths.size());
+        } else {
+            foreach (const QString &path, paths) {
+                KFileMetaInfo fileMetaInfo(path);
+                QVERIFY(fileMetaInfo.isValid());
+            }
+        }
+    }
+}
+
 void KFileMetaInfoTest::exitLoop()
 {
     --m_exitCount;
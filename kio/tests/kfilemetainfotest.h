@@ -32,6 +32,9 @@ private Q_SLOTS:
     void initTestCase();
     void testMetaInfo();
     void testReentrancy();
+    void testFromPaths();
+    void benchmarkFromPaths_data();
+    void benchmarkFromPaths();
 
 protected Q_SLOTS:
     void exitLoop();
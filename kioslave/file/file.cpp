@@ -545,7 +545,7 @@ void FileProtocol::put(const KUrl &url, int _mode, KIO::JobFlags _flags)
     if (_mode != -1 && !(_flags & KIO::Resume)) {
         if (KDE::chmod(dest_orig, _mode) != 0) {
             // couldn't chmod. Eat the error if the filesystem apparently doesn't support it.
-            KMountPoint::Ptr mp = KMountPoint::currentMountPoints().findByPath(dest_orig);
+            KMountPoint::Ptr mp = KMountPoint::currentMountPoint(dest_orig);
             if (mp && mp->testFileSystemFlag(KMountPoint::SupportsChmod)) {
                  warning(i18n("Could not change permissions for\n%1" ,  dest_orig));
             }
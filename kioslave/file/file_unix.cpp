@@ -284,7 +284,7 @@ void FileProtocol::copy(const KUrl &srcUrl, const KUrl &destUrl,
 #endif
             )
         {
-            KMountPoint::Ptr mp = KMountPoint::currentMountPoints().findByPath(dest);
+            KMountPoint::Ptr mp = KMountPoint::currentMountPoint(dest);
             // Eat the error if the filesystem apparently doesn't support chmod.
             if (mp && mp->testFileSystemFlag(KMountPoint::SupportsChmod)) {
                 warning(i18n("Could not change permissions for\n%1", dest));
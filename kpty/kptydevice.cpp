@@ -27,6 +27,7 @@
 #include <config.h>
 #include <config-pty.h>
 
+#include <QElapsedTimer>
 #include <QSocketNotifier>
 
 #include <klocale.h>
@@ -36,11 +37,11 @@
 #include <signal.h>
 #include <termios.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #ifdef HAVE_SYS_FILIO_H
 # include <sys/filio.h>
 #endif
-#include <sys/time.h>
 
 #if defined(Q_OS_FREEBSD) || defined(Q_OS_DRAGONFLY)
   // "the other end's output queue size" - kinda braindead, huh?
@@ -60,10 +61,16 @@
 /////////////////////////////////////////////////////
 
 #include <QtCore/qbytearray.h>
-#include <QtCore/qlist.h>
+
+#include <sys/uio.h>
 
 #define CHUNKSIZE 4096
+// the buffer shrinks back to this once it is drained
+#define KPTY_IDLEBUFFERSIZE (16 * CHUNKSIZE)
 
+// A single contiguous ring which doubles whenever it runs out of room, so
+// that the data can be read from and written to the pty with one readv() or
+// writev() of at most two spans. The capacity is always a power of two.
 class KRingBuffer
 {
 public:
@@ -74,15 +81,14 @@ public:
 
     void clear()
     {
-        buffers.clear();
-        buffers << QByteArray(CHUNKSIZE, char('\0'));
-        head = tail = 0;
+        buffer.resize(CHUNKSIZE);
+        head = 0;
         totalSize = 0;
     }
 
     inline bool isEmpty() const
     {
-        return buffers.count() == 1 && !tail;
+        return !totalSize;
     }
 
     inline int size() const
@@ -90,73 +96,93 @@ public:
         return totalSize;
     }
 
+    inline int capacity() const
+    {
+        return buffer.size();
+    }
+
+    // size of the contiguous span starting at readPointer()
     inline int readSize() const
     {
-        return (buffers.count() == 1 ? tail : buffers.first().size()) - head;
+        return qMin(totalSize, capacity() - head);
     }
 
     inline const char *readPointer() const
     {
         Q_ASSERT(totalSize > 0);
-        return buffers.first().constData() + head;
+        return buffer.constData() + head;
+    }
+
+    // Describe the buffered data as up to two spans, in order.
+    int readSpans(struct iovec *iov) const
+    {
+        if (!totalSize) {
+            return 0;
+        }
+        const int first = readSize();
+        iov[0].iov_base = const_cast<char *>(readPointer());
+        iov[0].iov_len = first;
+        if (first == totalSize) {
+            return 1;
+        }
+        iov[1].iov_base = const_cast<char *>(buffer.constData());
+        iov[1].iov_len = totalSize - first;
+        return 2;
     }
 
     void free(int bytes)
     {
+        Q_ASSERT(bytes <= totalSize);
         totalSize -= bytes;
-        Q_ASSERT(totalSize >= 0);
-
-        forever {
-            int nbs = readSize();
-
-            if (bytes < nbs) {
-                head += bytes;
-                if (head == tail && buffers.count() == 1) {
-                    buffers.first().resize(CHUNKSIZE);
-                    head = tail = 0;
-                }
-                break;
-            }
-
-            bytes -= nbs;
-            if (buffers.count() == 1) {
-                buffers.first().resize(CHUNKSIZE);
-                head = tail = 0;
-                break;
-            }
-
-            buffers.removeFirst();
+        if (!totalSize) {
             head = 0;
+            if (capacity() > KPTY_IDLEBUFFERSIZE) {
+                buffer.resize(KPTY_IDLEBUFFERSIZE);
+            }
+        } else {
+            head = (head + bytes) & (capacity() - 1);
         }
     }
 
-    char *reserve(int bytes)
+    // Make room for bytes more and describe that room as up to two spans.
+    // The data only becomes part of the buffer with commit().
+    int reserveSpans(int bytes, struct iovec *iov)
     {
-        totalSize += bytes;
-        char *ptr;
-        if (tail + bytes <= buffers.last().size()) {
-            ptr = buffers.last().data() + tail;
-            tail += bytes;
-        } else {
-            buffers.last().resize(tail);
-            QByteArray tmp(qMax(CHUNKSIZE, bytes), char('\0'));
-            ptr = tmp.data();
-            buffers << tmp;
-            tail = bytes;
+        if (bytes <= 0) {
+            return 0;
+        }
+        grow(bytes);
+        const int tail = (head + totalSize) & (capacity() - 1);
+        const int first = qMin(bytes, capacity() - tail);
+        char *ptr = buffer.data();
+        iov[0].iov_base = ptr + tail;
+        iov[0].iov_len = first;
+        if (first == bytes) {
+            return 1;
         }
-        return ptr;
+        iov[1].iov_base = ptr;
+        iov[1].iov_len = bytes - first;
+        return 2;
     }
 
-    // release a trailing part of the last reservation
-    inline void unreserve(int bytes)
+    inline void commit(int bytes)
     {
-        totalSize -= bytes;
-        tail -= bytes;
+        totalSize += bytes;
+        Q_ASSERT(totalSize <= capacity());
     }
 
-    inline void write(const char *data, int len)
+    void write(const char *data, int len)
     {
-        memcpy(reserve(len), data, len);
+        if (len <= 0) {
+            return;
+        }
+        struct iovec iov[2];
+        const int spans = reserveSpans(len, iov);
+        for (int i = 0; i < spans; ++i) {
+            memcpy(iov[i].iov_base, data, iov[i].iov_len);
+            data += iov[i].iov_len;
+        }
+        commit(len);
     }
 
     // Find the first occurrence of c and return the index after it.
@@ -164,27 +190,19 @@ public:
     // it is smaller than the buffer size. Otherwise -1 is returned.
     int indexAfter(char c, int maxLength = KMAXINT) const
     {
+        struct iovec iov[2];
+        const int spans = readSpans(iov);
         int index = 0;
-        int start = head;
-        QList<QByteArray>::ConstIterator it = buffers.begin();
-        forever {
-            if (!maxLength) {
-                return index;
-            }
-            if (index == size()) {
-                return -1;
-            }
-            const QByteArray &buf = *it;
-            ++it;
-            int len = qMin((it == buffers.end() ? tail : buf.size()) - start, maxLength);
-            const char *ptr = buf.data() + start;
+        for (int i = 0; i < spans && maxLength; ++i) {
+            const int len = qMin<int>(iov[i].iov_len, maxLength);
+            const char *ptr = static_cast<const char *>(iov[i].iov_base);
             if (const char *rptr = (const char *)memchr(ptr, c, len)) {
                 return index + (rptr - ptr) + 1;
             }
             index += len;
             maxLength -= len;
-            start = 0;
         }
+        return maxLength ? -1 : index;
     }
 
     inline int lineSize(int maxLength = KMAXINT) const
@@ -199,12 +217,11 @@ public:
 
     int read(char *data, int maxLength)
     {
-        int bytesToRead = qMin(size(), maxLength);
+        const int bytesToRead = qMin(size(), maxLength);
         int readSoFar = 0;
         while (readSoFar < bytesToRead) {
-            const char *ptr = readPointer();
-            int bs = qMin(bytesToRead - readSoFar, readSize());
-            memcpy(data + readSoFar, ptr, bs);
+            const int bs = qMin(bytesToRead - readSoFar, readSize());
+            memcpy(data + readSoFar, readPointer(), bs);
             readSoFar += bs;
             free(bs);
         }
@@ -217,8 +234,30 @@ public:
     }
 
 private:
-    QList<QByteArray> buffers;
-    int head, tail;
+    void grow(int bytes)
+    {
+        const int oldCapacity = capacity();
+        if (oldCapacity - totalSize >= bytes) {
+            return;
+        }
+        int newCapacity = oldCapacity;
+        while (newCapacity - totalSize < bytes) {
+            newCapacity *= 2;
+        }
+        if (head + totalSize <= oldCapacity) {
+            // not wrapped, the data stays where it is
+            buffer.resize(newCapacity);
+        } else {
+            // move the wrapped-around part behind the rest
+            buffer.resize(newCapacity);
+            const int wrapped = head + totalSize - oldCapacity;
+            char *ptr = buffer.data();
+            memcpy(ptr + oldCapacity, ptr, wrapped);
+        }
+    }
+
+    QByteArray buffer;
+    int head;
     int totalSize;
 };
 
@@ -249,6 +288,7 @@ public:
     KPtyDevicePrivate(KPty* parent) :
         KPtyPrivate(parent),
         emittedReadyRead(false), emittedBytesWritten(false),
+        suspended(false), throttled(false), readBufferLimit(0),
         readNotifier(0), writeNotifier(0)
     {
     }
@@ -258,9 +298,13 @@ public:
 
     bool doWait(int msecs, bool reading);
     void finishOpen(QIODevice::OpenMode mode);
+    void updateThrottle();
 
     bool emittedReadyRead;
     bool emittedBytesWritten;
+    bool suspended;
+    bool throttled;
+    qint64 readBufferLimit;
     QSocketNotifier *readNotifier;
     QSocketNotifier *writeNotifier;
     KRingBuffer readBuffer;
@@ -295,7 +339,8 @@ bool KPtyDevicePrivate::_k_canRead()
         }
 #endif
 
-        char *ptr = readBuffer.reserve(available);
+        struct iovec iov[2];
+        const int spans = readBuffer.reserveSpans(available, iov);
 #ifdef Q_OS_SOLARIS
         // Even if available > 0, it is possible for read()
         // to return 0 on Solaris, due to 0-byte writes in the stream.
@@ -309,14 +354,13 @@ bool KPtyDevicePrivate::_k_canRead()
 #endif
         // Useless block braces except in Solaris
         {
-            NO_INTR(readBytes, read(q->masterFd(), ptr, available));
+            NO_INTR(readBytes, readv(q->masterFd(), iov, spans));
         }
         if (readBytes < 0) {
-            readBuffer.unreserve(available);
             q->setErrorString(i18n("Error reading from PTY"));
             return false;
         }
-        readBuffer.unreserve(available - readBytes); // *should* be a no-op
+        readBuffer.commit(readBytes);
     }
 
     if (!readBytes) {
@@ -324,6 +368,7 @@ bool KPtyDevicePrivate::_k_canRead()
         emit q->readEof();
         return false;
     }
+    updateThrottle();
     if (!emittedReadyRead) {
         emittedReadyRead = true;
         emit q->readyRead();
@@ -340,8 +385,10 @@ bool KPtyDevicePrivate::_k_canWrite()
         return false;
     }
     qt_ignore_sigpipe();
+    struct iovec iov[2];
+    const int spans = writeBuffer.readSpans(iov);
     int wroteBytes;
-    NO_INTR(wroteBytes, write(q->masterFd(), writeBuffer.readPointer(), writeBuffer.readSize()));
+    NO_INTR(wroteBytes, writev(q->masterFd(), iov, spans));
     if (wroteBytes < 0) {
         q->setErrorString(i18n("Error writing to PTY"));
         return false;
@@ -358,72 +405,50 @@ bool KPtyDevicePrivate::_k_canWrite()
     return true;
 }
 
-#ifndef timeradd
-// Lifted from GLIBC
-# define timeradd(a, b, result) \
-    do { \
-        (result)->tv_sec = (a)->tv_sec + (b)->tv_sec; \
-        (result)->tv_usec = (a)->tv_usec + (b)->tv_usec; \
-        if ((result)->tv_usec >= 1000000) { \
-            ++(result)->tv_sec; \
-            (result)->tv_usec -= 1000000; \
-        } \
-    } while (0)
-# define timersub(a, b, result) \
-    do { \
-        (result)->tv_sec = (a)->tv_sec - (b)->tv_sec; \
-        (result)->tv_usec = (a)->tv_usec - (b)->tv_usec; \
-        if ((result)->tv_usec < 0) { \
-            --(result)->tv_sec; \
-            (result)->tv_usec += 1000000; \
-        } \
-    } while (0)
-#endif
+void KPtyDevicePrivate::updateThrottle()
+{
+    if (!readBufferLimit) {
+        if (throttled) {
+            throttled = false;
+            readNotifier->setEnabled(!suspended);
+        }
+        return;
+    }
+    if (readBuffer.size() >= readBufferLimit) {
+        if (!throttled) {
+            throttled = true;
+            readNotifier->setEnabled(false);
+        }
+    } else if (throttled) {
+        throttled = false;
+        readNotifier->setEnabled(!suspended);
+    }
+}
 
 bool KPtyDevicePrivate::doWait(int msecs, bool reading)
 {
     Q_Q(KPtyDevice);
-#ifndef Q_OS_LINUX
-    struct timeval etv;
-#endif
-    struct timeval tv, *tvp;
-
-    if (msecs < 0) {
-        tvp = 0;
-    } else {
-        tv.tv_sec = msecs / 1000;
-        tv.tv_usec = (msecs % 1000) * 1000;
-#ifndef Q_OS_LINUX
-        gettimeofday(&etv, 0);
-        timeradd(&tv, &etv, &etv);
-#endif
-        tvp = &tv;
-    }
+    QElapsedTimer timer;
+    timer.start();
 
     while (reading ? readNotifier->isEnabled() : !writeBuffer.isEmpty()) {
-        fd_set rfds;
-        fd_set wfds;
-
-        FD_ZERO(&rfds);
-        FD_ZERO(&wfds);
-
+        struct pollfd pfd;
+        pfd.fd = q->masterFd();
+        pfd.events = 0;
+        pfd.revents = 0;
         if (readNotifier->isEnabled()) {
-            FD_SET(q->masterFd(), &rfds);
+            pfd.events |= POLLIN;
         }
         if (!writeBuffer.isEmpty()) {
-            FD_SET(q->masterFd(), &wfds);
+            pfd.events |= POLLOUT;
         }
 
-#ifndef Q_OS_LINUX
-        if (tvp) {
-            gettimeofday(&tv, 0);
-            timersub(&etv, &tv, &tv);
-            if (tv.tv_sec < 0)
-                tv.tv_sec = tv.tv_usec = 0;
+        int timeout = -1;
+        if (msecs >= 0) {
+            timeout = qMax<qint64>(msecs - timer.elapsed(), 0);
         }
-#endif
 
-        switch (select(q->masterFd() + 1, &rfds, &wfds, 0, tvp)) {
+        switch (poll(&pfd, 1, timeout)) {
             case -1: {
                 if (errno == EINTR)
                     break;
@@ -434,13 +459,16 @@ bool KPtyDevicePrivate::doWait(int msecs, bool reading)
                 return false;
             }
             default: {
-                if (FD_ISSET(q->masterFd(), &rfds)) {
-                    bool canRead = _k_canRead();
-                    if (reading && canRead) {
-                        return true;
+                // a hung up pty is readable; the read reports the EOF
+                if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+                    if (readNotifier->isEnabled()) {
+                        bool canRead = _k_canRead();
+                        if (reading && canRead) {
+                            return true;
+                        }
                     }
                 }
-                if (FD_ISSET(q->masterFd(), &wfds)) {
+                if ((pfd.revents & (POLLOUT | POLLHUP | POLLERR)) && !writeBuffer.isEmpty()) {
                     bool canWrite = _k_canWrite();
                     if (!reading) {
                         return canWrite;
@@ -459,6 +487,8 @@ void KPtyDevicePrivate::finishOpen(QIODevice::OpenMode mode)
     q->QIODevice::open(mode);
     fcntl(q->masterFd(), F_SETFL, O_NONBLOCK);
     readBuffer.clear();
+    suspended = false;
+    throttled = false;
     readNotifier = new QSocketNotifier(q->masterFd(), QSocketNotifier::Read, q);
     writeNotifier = new QSocketNotifier(q->masterFd(), QSocketNotifier::Write, q);
     QObject::connect(readNotifier, SIGNAL(activated(int)), q, SLOT(_k_canRead()));
@@ -514,6 +544,8 @@ void KPtyDevice::close()
     }
     delete d->readNotifier;
     delete d->writeNotifier;
+    d->readNotifier = 0;
+    d->writeNotifier = 0;
     QIODevice::close();
     KPty::close();
 }
@@ -562,27 +594,68 @@ bool KPtyDevice::waitForBytesWritten(int msecs)
 void KPtyDevice::setSuspended(bool suspended)
 {
     Q_D(KPtyDevice);
-    d->readNotifier->setEnabled(!suspended);
+    d->suspended = suspended;
+    d->readNotifier->setEnabled(!suspended && !d->throttled);
 }
 
 bool KPtyDevice::isSuspended() const
 {
     Q_D(const KPtyDevice);
-    return !d->readNotifier->isEnabled();
+    return d->suspended || (!d->throttled && !d->readNotifier->isEnabled());
+}
+
+void KPtyDevice::setReadBufferSize(qint64 size)
+{
+    Q_D(KPtyDevice);
+    d->readBufferLimit = qMax<qint64>(size, 0);
+    if (d->readNotifier) {
+        d->updateThrottle();
+    }
+}
+
+qint64 KPtyDevice::readBufferSize() const
+{
+    Q_D(const KPtyDevice);
+    return d->readBufferLimit;
+}
+
+const char *KPtyDevice::peekSpan(qint64 *length) const
+{
+    Q_D(const KPtyDevice);
+    if (d->readBuffer.isEmpty()) {
+        *length = 0;
+        return 0;
+    }
+    *length = d->readBuffer.readSize();
+    return d->readBuffer.readPointer();
+}
+
+void KPtyDevice::consume(qint64 length)
+{
+    Q_D(KPtyDevice);
+    if (length <= 0) {
+        return;
+    }
+    d->readBuffer.free((int)qMin<qint64>(length, d->readBuffer.size()));
+    d->updateThrottle();
 }
 
 // protected
 qint64 KPtyDevice::readData(char *data, qint64 maxlen)
 {
     Q_D(KPtyDevice);
-    return d->readBuffer.read(data, (int)qMin<qint64>(maxlen, KMAXINT));
+    const int readBytes = d->readBuffer.read(data, (int)qMin<qint64>(maxlen, KMAXINT));
+    d->updateThrottle();
+    return readBytes;
 }
 
 // protected
 qint64 KPtyDevice::readLineData(char *data, qint64 maxlen)
 {
     Q_D(KPtyDevice);
-    return d->readBuffer.readLine(data, (int)qMin<qint64>(maxlen, KMAXINT));
+    const int readBytes = d->readBuffer.readLine(data, (int)qMin<qint64>(maxlen, KMAXINT));
+    d->updateThrottle();
+    return readBytes;
 }
 
 // protected
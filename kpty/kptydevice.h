@@ -106,6 +106,54 @@ public:
      */
     bool isSuspended() const;
 
+    /**
+     * Limits how much incoming data the KPtyDevice buffers.
+     *
+     * Once the read buffer holds @p size bytes or more, the KPtyDevice stops
+     * reading from the pty until enough data has been read or consumed to
+     * bring it back below the limit. The program on the other end is then
+     * blocked by the kernel, which gives slow consumers flow control instead
+     * of an ever growing buffer. While reading is paused waitForReadyRead()
+     * returns false and isSuspended() is not affected.
+     *
+     * A size of 0, the default, means the buffer is unlimited.
+     *
+     * @since 4.24
+     */
+    void setReadBufferSize(qint64 size);
+
+    /**
+     * Returns the limit set with setReadBufferSize(), 0 if there is none.
+     *
+     * @since 4.24
+     */
+    qint64 readBufferSize() const;
+
+    /**
+     * Returns a pointer to the oldest buffered incoming data, without copying
+     * it. The data may be split in two parts; @p length is set to the size of
+     * the first one only. Call consume() when done with it and peekSpan()
+     * again to get the rest.
+     *
+     * The pointer remains valid until the event loop is entered again or a
+     * read or wait function is called. Data which QIODevice buffered itself, which
+     * only happens when the device was not opened with
+     * QIODevice::Unbuffered, is not seen by this function.
+     *
+     * @param length set to the number of bytes available at the pointer
+     * @return the data, or 0 if nothing is buffered
+     * @since 4.24
+     */
+    const char *peekSpan(qint64 *length) const;
+
+    /**
+     * Discards the first @p length bytes of buffered incoming data, usually
+     * after processing them with peekSpan().
+     *
+     * @since 4.24
+     */
+    void consume(qint64 length);
+
     /**
      * @return always true
      */
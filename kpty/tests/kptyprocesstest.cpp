@@ -22,8 +22,11 @@
 #include "kptyprocesstest.h"
 
 #include <kptydevice.h>
+#include <kdebug.h>
 #include <qtest_kde.h>
 
+#include <QElapsedTimer>
+
 void KPtyProcessTest::test_suspend_pty()
 {
     KPtyProcess p;
@@ -54,6 +57,110 @@ void KPtyProcessTest::test_suspend_pty()
     p.waitForFinished();
 }
 
+void KPtyProcessTest::test_peek_consume()
+{
+    KPtyProcess p;
+    p.setProgram("echo", QStringList() << "peeked");
+    p.setPtyChannels(KPtyProcess::AllChannels);
+    p.start();
+
+    for (int i = 0; i < 5; ++i) {
+        QVERIFY(p.pty()->waitForReadyRead(500));
+        if (p.pty()->canReadLine()) {
+            break;
+        }
+    }
+
+    qint64 length = 0;
+    const char *data = p.pty()->peekSpan(&length);
+    QVERIFY(data);
+    QCOMPARE(QByteArray(data, length), QByteArray("peeked\r\n"));
+    p.pty()->consume(2);
+    QCOMPARE(p.pty()->bytesAvailable(), length - 2);
+    QCOMPARE(p.pty()->readAll(), QByteArray("eked\r\n"));
+    QVERIFY(!p.pty()->peekSpan(&length));
+    QCOMPARE(length, qint64(0));
+
+    p.waitForFinished(1000);
+}
+
+void KPtyProcessTest::test_read_buffer_size()
+{
+    static const qint64 total = 64 * 1024;
+    KPtyProcess p;
+    p.setProgram("head", QStringList() << "-c" << QString::number(total) << "/dev/zero");
+    p.setPtyChannels(KPtyProcess::AllChannels);
+    p.pty()->setReadBufferSize(4096);
+    QCOMPARE(p.pty()->readBufferSize(), qint64(4096));
+    p.start();
+
+    // once the limit is reached the pty is no longer read
+    while (p.pty()->bytesAvailable() < 4096) {
+        QVERIFY(p.pty()->waitForReadyRead(2000));
+    }
+    QVERIFY(!p.pty()->waitForReadyRead(500));
+    QVERIFY(!p.pty()->isSuspended());
+
+    // consuming the buffer resumes reading
+    qint64 received = 0;
+    while (received < total) {
+        qint64 length = 0;
+        if (!p.pty()->peekSpan(&length)) {
+            QVERIFY(p.pty()->waitForReadyRead(2000));
+            continue;
+        }
+        p.pty()->consume(length);
+        received += length;
+    }
+    QCOMPARE(received, total);
+
+    p.waitForFinished(1000);
+}
+
+void KPtyProcessTest::benchmarkThroughput_data()
+{
+    QTest::addColumn<bool>("peek");
+
+    QTest::newRow("readAll") << false;
+    QTest::newRow("peekSpan") << true;
+}
+
+void KPtyProcessTest::benchmarkThroughput()
+{
+    QFETCH(bool, peek);
+
+    static const qint64 total = 16 * 1024 * 1024;
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+    int runs = 0;
+    QBENCHMARK {
+        KPtyProcess p;
+        p.setProgram("head", QStringList() << "-c" << QString::number(total) << "/dev/zero");
+        p.setPtyChannels(KPtyProcess::AllChannels);
+        timer.start();
+        p.start();
+        qint64 received = 0;
+        while (received < total && p.pty()->waitForReadyRead(5000)) {
+            if (peek) {
+                qint64 length = 0;
+                while (p.pty()->peekSpan(&length)) {
+                    p.pty()->consume(length);
+                    received += length;
+                }
+            } else {
+                received += p.pty()->readAll().size();
+            }
+        }
+        elapsed += timer.elapsed();
+        ++runs;
+        QCOMPARE(received, total);
+        p.waitForFinished(1000);
+    }
+    if (elapsed) {
+        kDebug() << "MB/s:" << (total / (1024.0 * 1024.0)) * runs * 1000 / elapsed;
+    }
+}
+
 void KPtyProcessTest::test_shared_pty()
 {
     // start a first process
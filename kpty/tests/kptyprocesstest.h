@@ -36,6 +36,10 @@ private Q_SLOTS:
     void test_ctty();
     void test_shared_pty();
     void test_suspend_pty();
+    void test_peek_consume();
+    void test_read_buffer_size();
+    void benchmarkThroughput_data();
+    void benchmarkThroughput();
 
 // for pty_signals
 public Q_SLOTS:
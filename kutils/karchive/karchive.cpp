@@ -20,6 +20,11 @@
 #include "karchive.h"
 
 #include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
 #include <QDir>
 #include <QDirIterator>
 #include <QCoreApplication>
@@ -37,9 +42,7 @@
 #endif
 
 #include <sys/stat.h>
-#if defined(HAVE_STRMODE)
-#  include <string.h>
-#endif
+#include <string.h>
 
 #ifndef PATH_MAX
 #  define PATH_MAX _POSIX_PATH_MAX
@@ -48,7 +51,7 @@
 // NOTE: many KArchive users are not doing listing and extraction in a thread which means that the
 // UI will be "frozen" while that happens so process events while doing so
 #define KARCHIVE_TIMEOUT 250
-#define KARCHIVE_BUFFSIZE 10240
+#define KARCHIVE_BUFFSIZE 65536
 
 KArchiveEntry::KArchiveEntry()
     : encrypted(false),
@@ -180,10 +183,15 @@ QDebug operator<<(QDebug d, const KArchiveEntry &karchiveentry)
 #endif
 
 
+#if defined(HAVE_LIBARCHIVE)
+class KArchiveExtractRunnable;
+#endif
+
 class KArchivePrivate
 {
 public:
     KArchivePrivate();
+    ~KArchivePrivate();
 
     QString m_path;
     bool m_writable;
@@ -191,6 +199,10 @@ public:
     QByteArray m_readpass;
     QByteArray m_writepass;
     QString m_tempprefix;
+    int m_buffsize;
+    int m_threads;
+
+    int threadCount() const;
 
 #if defined(HAVE_LIBARCHIVE)
     struct archive* openRead(const QByteArray &path) const;
@@ -204,13 +216,60 @@ public:
 
     QString tempFilePath() const;
 
-    QList<KArchiveEntry> m_cache;
+    static KArchiveEntry entryFromArchive(struct archive_entry* entry);
+
+    bool updateIndex();
+    void clearIndex();
+    struct archive* openEntry(const QString &path, KArchiveEntry *karchiveentry, int *position);
+    void keepEntryReader(struct archive* readarchive, const int position);
+    void closeEntryReader();
+
+    bool isParallel() const;
+    QList<KArchiveExtractRunnable*> parallelRunnables(const QSet<QString> &paths, const bool preserve,
+                                                      QStringList *notfound, QAtomicInt *extracted,
+                                                      int *total) const;
+
+    // entries in archive order, the map holds the position of the first entry for each pathname
+    QList<KArchiveEntry> m_index;
+    QHash<QByteArray, int> m_indexmap;
+    bool m_indexvalid;
+    KDE_struct_stat m_indexstat;
+
+    // reader left after the data of the entry at m_entryposition, entries that come later in the
+    // archive are read from it instead of from the first header
+    struct archive* m_entryreader;
+    int m_entryposition;
 #endif
 };
 
 KArchivePrivate::KArchivePrivate()
-    : m_writable(false)
+    : m_writable(false),
+    m_buffsize(KARCHIVE_BUFFSIZE),
+    m_threads(1)
+#if defined(HAVE_LIBARCHIVE)
+    , m_indexvalid(false),
+    m_entryreader(nullptr),
+    m_entryposition(-1)
+#endif
 {
+#if defined(HAVE_LIBARCHIVE)
+    ::memset(&m_indexstat, 0, sizeof(m_indexstat));
+#endif
+}
+
+KArchivePrivate::~KArchivePrivate()
+{
+#if defined(HAVE_LIBARCHIVE)
+    closeEntryReader();
+#endif
+}
+
+int KArchivePrivate::threadCount() const
+{
+    if (m_threads <= 0) {
+        return qMax(QThread::idealThreadCount(), 1);
+    }
+    return m_threads;
 }
 
 #if defined(HAVE_LIBARCHIVE)
@@ -237,7 +296,7 @@ struct archive* KArchivePrivate::openRead(const QByteArray &path) const
             return nullptr;
         }
 
-        if (archive_read_open_filename(readarchive, path, KARCHIVE_BUFFSIZE) != ARCHIVE_OK) {
+        if (archive_read_open_filename(readarchive, path, m_buffsize) != ARCHIVE_OK) {
             kDebug() << "archive_read_open_filename" << archive_error_string(readarchive);
             KArchivePrivate::closeRead(readarchive);
             return nullptr;
@@ -282,6 +341,13 @@ struct archive* KArchivePrivate::openWrite(const QByteArray &path) const
 
         (void)archive_write_set_format_pax_restricted(writearchive);
 
+        const int threads = threadCount();
+        if (threads > 1) {
+            // only some filters (e.g. xz and zstd) support compressing in threads
+            const QByteArray threadsvalue = QByteArray::number(threads);
+            (void)archive_write_set_filter_option(writearchive, NULL, "threads", threadsvalue.constData());
+        }
+
         if (!m_writepass.isEmpty() && archive_write_set_passphrase(writearchive, m_writepass.constData()) != ARCHIVE_OK) {
             kDebug() << "archive_write_set_passphrase" << archive_error_string(writearchive);
             KArchivePrivate::closeWrite(writearchive);
@@ -363,8 +429,8 @@ bool KArchivePrivate::closeWrite(struct archive* writearchive)
 
 bool KArchivePrivate::copyData(struct archive* readarchive, struct archive* writearchive)
 {
-    char readbuffer[KARCHIVE_BUFFSIZE];
-    ssize_t readsize = archive_read_data(readarchive, readbuffer, sizeof(readbuffer));
+    QByteArray readbuffer(m_buffsize, '\0');
+    ssize_t readsize = archive_read_data(readarchive, readbuffer.data(), readbuffer.size());
     while (readsize > 0) {
         QCoreApplication::processEvents(QEventLoop::AllEvents, KARCHIVE_TIMEOUT);
 
@@ -375,13 +441,13 @@ bool KArchivePrivate::copyData(struct archive* readarchive, struct archive* writ
             return false;
         }
 
-        if (archive_write_data(writearchive, readbuffer, readsize) != readsize) {
+        if (archive_write_data(writearchive, readbuffer.constData(), readsize) != readsize) {
             m_error = archive_error_string(writearchive);
             kDebug() << "archive_write_data" << m_error;
             return false;
         }
 
-        readsize = archive_read_data(readarchive, readbuffer, sizeof(readbuffer));
+        readsize = archive_read_data(readarchive, readbuffer.data(), readbuffer.size());
     }
 
     return true;
@@ -389,8 +455,8 @@ bool KArchivePrivate::copyData(struct archive* readarchive, struct archive* writ
 
 bool KArchivePrivate::copyData(struct archive* readarchive, QByteArray *buffer)
 {
-    char readbuffer[KARCHIVE_BUFFSIZE];
-    ssize_t readsize = archive_read_data(readarchive, readbuffer, sizeof(readbuffer));
+    QByteArray readbuffer(m_buffsize, '\0');
+    ssize_t readsize = archive_read_data(readarchive, readbuffer.data(), readbuffer.size());
     while (readsize > 0) {
         QCoreApplication::processEvents(QEventLoop::AllEvents, KARCHIVE_TIMEOUT);
 
@@ -401,9 +467,9 @@ bool KArchivePrivate::copyData(struct archive* readarchive, QByteArray *buffer)
             return false;
         }
 
-        buffer->append(readbuffer, readsize);
+        buffer->append(readbuffer.constData(), readsize);
 
-        readsize = archive_read_data(readarchive, readbuffer, sizeof(readbuffer));
+        readsize = archive_read_data(readarchive, readbuffer.data(), readbuffer.size());
     }
 
     return true;
@@ -417,6 +483,421 @@ QString KArchivePrivate::tempFilePath() const
     tmptemplate.append(fileinfo.completeSuffix());
     return KTemporaryFile::filePath(tmptemplate);
 }
+
+KArchiveEntry KArchivePrivate::entryFromArchive(struct archive_entry* entry)
+{
+    KArchiveEntry result;
+    result.encrypted = bool(archive_entry_is_encrypted(entry));
+    result.size = archive_entry_size(entry);
+    result.gid = archive_entry_gid(entry);
+    result.uid = archive_entry_uid(entry);
+    result.mode = archive_entry_mode(entry);
+    result.atime = archive_entry_atime(entry);
+    result.ctime = archive_entry_ctime(entry);
+    result.mtime = archive_entry_mtime(entry);
+    result.hardlink =  archive_entry_hardlink(entry);
+    result.symlink = archive_entry_symlink(entry);
+    result.pathname = archive_entry_pathname(entry);
+    result.groupname = archive_entry_gname(entry);
+    result.username = archive_entry_uname(entry);
+    return result;
+}
+
+bool KArchivePrivate::updateIndex()
+{
+    KDE_struct_stat statistic;
+    if (KDE::stat(m_path, &statistic) == -1) {
+        clearIndex();
+        // let openRead() report the error
+    } else if (m_indexvalid
+        && statistic.st_ino == m_indexstat.st_ino
+        && statistic.st_size == m_indexstat.st_size
+        && statistic.st_mtim.tv_sec == m_indexstat.st_mtim.tv_sec
+        && statistic.st_mtim.tv_nsec == m_indexstat.st_mtim.tv_nsec) {
+        return true;
+    }
+
+    clearIndex();
+
+    struct archive* readarchive = openRead(QFile::encodeName(m_path));
+    if (!readarchive) {
+        m_error = i18n("Could not open archive: %1", m_path);
+        kDebug() << m_error;
+        return false;
+    }
+
+    // NOTE: for formats with central directory (zip, 7z) libarchive reads the headers from it
+    // and skipping the entry data is a seek
+    struct archive_entry* entry = archive_entry_new();
+    int ret = archive_read_next_header(readarchive, &entry);
+    while (ret != ARCHIVE_EOF) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, KARCHIVE_TIMEOUT);
+
+        if (ret < ARCHIVE_OK) {
+            m_error = archive_error_string(readarchive);
+            kDebug() << "archive_read_next_header" << m_error;
+            KArchivePrivate::closeRead(readarchive);
+            clearIndex();
+            return false;
+        }
+
+        const KArchiveEntry karchiveentry = KArchivePrivate::entryFromArchive(entry);
+        if (!m_indexmap.contains(karchiveentry.pathname)) {
+            m_indexmap.insert(karchiveentry.pathname, m_index.size());
+        }
+        m_index.append(karchiveentry);
+
+        archive_read_data_skip(readarchive);
+        ret = archive_read_next_header(readarchive, &entry);
+    }
+
+    KArchivePrivate::closeRead(readarchive);
+
+    m_indexvalid = true;
+    m_indexstat = statistic;
+    return true;
+}
+
+void KArchivePrivate::clearIndex()
+{
+    closeEntryReader();
+    m_index.clear();
+    m_indexmap.clear();
+    m_indexvalid = false;
+}
+
+struct archive* KArchivePrivate::openEntry(const QString &path, KArchiveEntry *karchiveentry, int *position)
+{
+    if (!updateIndex()) {
+        return nullptr;
+    }
+
+    const int entryposition = m_indexmap.value(QFile::encodeName(path), -1);
+    if (entryposition < 0) {
+        m_error = i18n("Entry not in archive: %1", path);
+        kDebug() << m_error;
+        return nullptr;
+    }
+
+    // the kept reader is taken so that it is not used again while the caller reads from it
+    struct archive* readarchive = m_entryreader;
+    int current = m_entryposition;
+    m_entryreader = nullptr;
+    m_entryposition = -1;
+    if (readarchive && current >= entryposition) {
+        KArchivePrivate::closeRead(readarchive);
+        readarchive = nullptr;
+    }
+    if (!readarchive) {
+        readarchive = openRead(QFile::encodeName(m_path));
+        if (!readarchive) {
+            m_error = i18n("Could not open archive: %1", m_path);
+            kDebug() << m_error;
+            return nullptr;
+        }
+        current = -1;
+    }
+
+    // the position is known from the index so there is no need to compare the pathnames, the
+    // data of the entries in between is skipped by libarchive
+    struct archive_entry* entry = nullptr;
+    int ret = ARCHIVE_OK;
+    while (current < entryposition) {
+        ret = archive_read_next_header(readarchive, &entry);
+        if (ret == ARCHIVE_EOF) {
+            break;
+        } else if (ret < ARCHIVE_OK) {
+            m_error = archive_error_string(readarchive);
+            kDebug() << "archive_read_next_header" << m_error;
+            break;
+        }
+        current++;
+    }
+
+    if (current == entryposition) {
+        if (karchiveentry) {
+            *karchiveentry = m_index.at(entryposition);
+        }
+        if (position) {
+            *position = entryposition;
+        }
+        return readarchive;
+    }
+
+    if (ret == ARCHIVE_EOF) {
+        m_error = i18n("Entry not in archive: %1", path);
+        kDebug() << m_error;
+    }
+    KArchivePrivate::closeRead(readarchive);
+    return nullptr;
+}
+
+void KArchivePrivate::keepEntryReader(struct archive* readarchive, const int position)
+{
+    if (m_entryreader || !m_indexvalid) {
+        // another entry was read meanwhile or the archive changed
+        KArchivePrivate::closeRead(readarchive);
+        return;
+    }
+    m_entryreader = readarchive;
+    m_entryposition = position;
+}
+
+void KArchivePrivate::closeEntryReader()
+{
+    if (m_entryreader) {
+        KArchivePrivate::closeRead(m_entryreader);
+        m_entryreader = nullptr;
+        m_entryposition = -1;
+    }
+}
+
+class KArchiveDevice : public QIODevice
+{
+public:
+    KArchiveDevice(struct archive* readarchive, const qint64 size);
+    ~KArchiveDevice();
+
+    bool isSequential() const final;
+    qint64 size() const final;
+    qint64 bytesAvailable() const final;
+    void close() final;
+
+protected:
+    qint64 readData(char *data, qint64 maxsize) final;
+    qint64 writeData(const char *data, qint64 maxsize) final;
+
+private:
+    struct archive* m_readarchive;
+    qint64 m_size;
+    qint64 m_read;
+};
+
+KArchiveDevice::KArchiveDevice(struct archive* readarchive, const qint64 size)
+    : m_readarchive(readarchive),
+    m_size(size),
+    m_read(0)
+{
+    QIODevice::open(QIODevice::ReadOnly);
+}
+
+KArchiveDevice::~KArchiveDevice()
+{
+    KArchiveDevice::close();
+}
+
+bool KArchiveDevice::isSequential() const
+{
+    return true;
+}
+
+qint64 KArchiveDevice::size() const
+{
+    return m_size;
+}
+
+qint64 KArchiveDevice::bytesAvailable() const
+{
+    if (!m_readarchive) {
+        return QIODevice::bytesAvailable();
+    }
+    return qMax(m_size - m_read, qint64(0)) + QIODevice::bytesAvailable();
+}
+
+void KArchiveDevice::close()
+{
+    if (m_readarchive) {
+        KArchivePrivate::closeRead(m_readarchive);
+        m_readarchive = nullptr;
+    }
+    QIODevice::close();
+}
+
+qint64 KArchiveDevice::readData(char *data, qint64 maxsize)
+{
+    if (!m_readarchive) {
+        return -1;
+    }
+
+    const ssize_t readsize = archive_read_data(m_readarchive, data, maxsize);
+    if (readsize < 0) {
+        const QString error = QString::fromLocal8Bit(archive_error_string(m_readarchive));
+        kDebug() << "archive_read_data" << error;
+        setErrorString(error);
+        return -1;
+    }
+    m_read += readsize;
+    return readsize;
+}
+
+qint64 KArchiveDevice::writeData(const char *data, qint64 maxsize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxsize);
+    return -1;
+}
+
+class KArchiveExtractRunnable : public QRunnable
+{
+public:
+    KArchiveExtractRunnable(const KArchivePrivate *karchiveprivate, const QList<int> &positions,
+                            const bool preserve, QAtomicInt *extracted);
+
+    QString error() const;
+
+protected:
+    void run() final;
+
+private:
+    const KArchivePrivate* m_karchiveprivate;
+    QList<int> m_positions;
+    bool m_preserve;
+    QAtomicInt* m_extracted;
+    QString m_error;
+};
+
+KArchiveExtractRunnable::KArchiveExtractRunnable(const KArchivePrivate *karchiveprivate, const QList<int> &positions,
+                                                 const bool preserve, QAtomicInt *extracted)
+    : QRunnable(),
+    m_karchiveprivate(karchiveprivate),
+    m_positions(positions),
+    m_preserve(preserve),
+    m_extracted(extracted)
+{
+    setAutoDelete(false);
+}
+
+QString KArchiveExtractRunnable::error() const
+{
+    return m_error;
+}
+
+void KArchiveExtractRunnable::run()
+{
+    // every runnable has its own reader and writer, the positions are sorted
+    struct archive* readarchive = m_karchiveprivate->openRead(QFile::encodeName(m_karchiveprivate->m_path));
+    if (!readarchive) {
+        m_error = i18n("Could not open archive: %1", m_karchiveprivate->m_path);
+        kDebug() << m_error;
+        return;
+    }
+
+    struct archive* writearchive = m_karchiveprivate->openDisk(m_preserve);
+    if (!writearchive) {
+        m_error = i18n("Could not open destination: %1", QDir::currentPath());
+        kDebug() << m_error;
+        KArchivePrivate::closeRead(readarchive);
+        return;
+    }
+
+    int current = 0;
+    int next = 0;
+    struct archive_entry* entry = archive_entry_new();
+    int ret = archive_read_next_header(readarchive, &entry);
+    while (ret != ARCHIVE_EOF && next < m_positions.size()) {
+        if (ret < ARCHIVE_OK) {
+            m_error = archive_error_string(readarchive);
+            kDebug() << "archive_read_next_header" << m_error;
+            break;
+        }
+
+        if (current == m_positions.at(next)) {
+            next++;
+
+            if (archive_write_header(writearchive, entry) != ARCHIVE_OK) {
+                m_error = archive_error_string(writearchive);
+                kDebug() << "archive_write_header" << m_error;
+                break;
+            }
+
+            if (archive_read_extract2(readarchive, entry, writearchive) != ARCHIVE_OK) {
+                m_error = archive_error_string(readarchive);
+                kDebug() << "archive_read_extract2" << m_error;
+                break;
+            }
+
+            if (archive_write_finish_entry(writearchive) != ARCHIVE_OK) {
+                m_error = archive_error_string(writearchive);
+                kDebug() << "archive_write_finish_entry" << m_error;
+                break;
+            }
+
+            m_extracted->ref();
+        }
+
+        current++;
+        ret = archive_read_next_header(readarchive, &entry);
+    }
+
+    KArchivePrivate::closeWrite(writearchive);
+    KArchivePrivate::closeRead(readarchive);
+}
+
+bool KArchivePrivate::isParallel() const
+{
+    if (threadCount() <= 1) {
+        return false;
+    }
+
+    // entries of solid archives (compressed tar, 7z, etc.) can only be reached by decompressing
+    // everything before them so extracting those in parallel would be slower
+    const KMimeType::Ptr kmimetype = KMimeType::findByPath(m_path);
+    if (kmimetype) {
+        return (
+            kmimetype->is(QString::fromLatin1("application/zip"))
+            || kmimetype->is(QString::fromLatin1("application/x-java-archive"))
+            || kmimetype->is(QString::fromLatin1("application/x-tar"))
+        );
+    }
+    return false;
+}
+
+QList<KArchiveExtractRunnable*> KArchivePrivate::parallelRunnables(const QSet<QString> &paths, const bool preserve,
+                                                                   QStringList *notfound, QAtomicInt *extracted,
+                                                                   int *total) const
+{
+    QList<KArchiveExtractRunnable*> result;
+
+    QList<int> positions;
+    qint64 totalsize = 0;
+    for (int i = 0; i < m_index.size(); i++) {
+        const KArchiveEntry &karchiveentry = m_index.at(i);
+        const QString pathnamestring = QFile::decodeName(karchiveentry.pathname);
+        if (!paths.contains(pathnamestring)) {
+            continue;
+        }
+        notfound->removeAll(pathnamestring);
+        positions.append(i);
+        totalsize += qMax(karchiveentry.size, qint64(1));
+    }
+
+    *total = positions.size();
+    if (positions.isEmpty()) {
+        return result;
+    }
+
+    // split the entries in chunks of roughly equal size, consecutive entries go into the same
+    // chunk so that every runnable reads only part of the archive
+    const int threads = qMin(threadCount(), positions.size());
+    const qint64 chunksize = (totalsize / threads) + 1;
+    QList<int> chunkpositions;
+    qint64 currentsize = 0;
+    foreach (const int position, positions) {
+        chunkpositions.append(position);
+        currentsize += qMax(m_index.at(position).size, qint64(1));
+        if (currentsize >= chunksize) {
+            result.append(new KArchiveExtractRunnable(this, chunkpositions, preserve, extracted));
+            chunkpositions.clear();
+            currentsize = 0;
+        }
+    }
+    if (!chunkpositions.isEmpty()) {
+        result.append(new KArchiveExtractRunnable(this, chunkpositions, preserve, extracted));
+    }
+    kDebug() << "Extracting" << positions.size() << "entries in" << result.size() << "chunks";
+
+    return result;
+}
 #endif // HAVE_LIBARCHIVE
 
 KArchive::KArchive(const QString &path, QObject *parent)
@@ -651,24 +1132,33 @@ bool KArchive::add(const QStringList &paths, const QByteArray &strip, const QByt
                 break;
             }
 
-            const QByteArray data = file.readAll();
-            if (data.isEmpty() && statistic.st_size > 0) {
-                d->m_error = i18n("Could not read source: %1", path);
-                kDebug() << d->m_error;
-                result = false;
-                break;
+            QByteArray readbuffer(d->m_buffsize, '\0');
+            qint64 totalsize = 0;
+            qint64 readsize = file.read(readbuffer.data(), readbuffer.size());
+            while (readsize > 0) {
+                if (archive_write_data(writearchive, readbuffer.constData(), readsize) != readsize) {
+                    d->m_error = archive_error_string(writearchive);
+                    kDebug() << "archive_write_data" << d->m_error;
+                    readsize = -1;
+                    break;
+                }
+                totalsize += readsize;
+
+                readsize = file.read(readbuffer.data(), readbuffer.size());
             }
 
-            if (statistic.st_size > 0 && data.size() != statistic.st_size) {
-                d->m_error = i18n("Read and stat size are different: %1", path);
-                kDebug() << d->m_error;
+            if (readsize < 0) {
+                if (d->m_error.isEmpty()) {
+                    d->m_error = i18n("Could not read source: %1", path);
+                    kDebug() << d->m_error;
+                }
                 result = false;
                 break;
             }
 
-            if (archive_write_data(writearchive, data.constData(), data.size()) != statistic.st_size) {
-                d->m_error = archive_error_string(writearchive);
-                kDebug() << "archive_write_data" << d->m_error;
+            if (totalsize != statistic.st_size) {
+                d->m_error = i18n("Read and stat size are different: %1", path);
+                kDebug() << d->m_error;
                 result = false;
                 break;
             }
@@ -743,7 +1233,6 @@ bool KArchive::remove(const QStringList &paths) const
         return result;
     }
 
-    d->m_cache = KArchive::list();
     QStringList recursivepaths;
     foreach (const QString &path, paths) {
         if (path.endsWith(QLatin1Char('/')) || S_ISDIR(KArchive::entry(path).mode)) {
@@ -755,7 +1244,7 @@ bool KArchive::remove(const QStringList &paths) const
         }
     }
     recursivepaths.removeDuplicates();
-    d->m_cache.clear();
+    d->m_error.clear();
 
     QStringList notfound = paths;
 
@@ -857,22 +1346,6 @@ bool KArchive::extract(const QStringList &paths, const QString &destination, con
         return result;
     }
 
-    struct archive* readarchive = d->openRead(QFile::encodeName(d->m_path));
-    if (!readarchive) {
-        d->m_error = i18n("Could not open archive: %1", d->m_path);
-        kDebug() << d->m_error;
-        return result;
-    }
-
-    struct archive* writearchive = d->openDisk(preserve);
-    if (!writearchive) {
-        d->m_error = i18n("Could not open destination: %1", destination);
-        kDebug() << d->m_error;
-        KArchivePrivate::closeRead(readarchive);
-        return result;
-    }
-
-    d->m_cache = KArchive::list();
     QStringList recursivepaths;
     foreach (const QString &path, paths) {
         if (path.endsWith(QLatin1Char('/')) || S_ISDIR(KArchive::entry(path).mode)) {
@@ -884,65 +1357,118 @@ bool KArchive::extract(const QStringList &paths, const QString &destination, con
         }
     }
     recursivepaths.removeDuplicates();
-    d->m_cache.clear();
+    d->m_error.clear();
 
     QStringList notfound = paths;
 
-    qreal progressvalue = 0.0;
-    const qreal progessstep = (qreal(1.0) / qreal(recursivepaths.size()));
+    if (d->isParallel() && d->updateIndex()) {
+        QAtomicInt extracted(0);
+        int total = 0;
+        const QList<KArchiveExtractRunnable*> runnables = d->parallelRunnables(
+            QSet<QString>::fromList(recursivepaths), preserve, &notfound, &extracted, &total
+        );
+
+        QThreadPool threadpool;
+        threadpool.setMaxThreadCount(d->threadCount());
+        foreach (KArchiveExtractRunnable* runnable, runnables) {
+            threadpool.start(runnable);
+        }
 
-    struct archive_entry* entry = archive_entry_new();
-    int ret = archive_read_next_header(readarchive, &entry);
-    while (ret != ARCHIVE_EOF) {
-        QCoreApplication::processEvents(QEventLoop::AllEvents, KARCHIVE_TIMEOUT);
+        // progress is reported periodically instead of for every entry
+        int lastextracted = 0;
+        bool done = false;
+        while (!done) {
+            done = threadpool.waitForDone(KARCHIVE_TIMEOUT);
+            QCoreApplication::processEvents(QEventLoop::AllEvents, KARCHIVE_TIMEOUT);
 
-        if (ret < ARCHIVE_OK) {
-            d->m_error = archive_error_string(readarchive);
-            kDebug() << "archive_read_next_header" << d->m_error;
-            result = false;
-            break;
+            const int currentextracted = extracted.load();
+            if (currentextracted != lastextracted) {
+                lastextracted = currentextracted;
+                emit progress(qreal(currentextracted) / qreal(total));
+            }
         }
 
-        const QByteArray pathname = archive_entry_pathname(entry);
-        const QString pathnamestring = QFile::decodeName(pathname);
-        if (!recursivepaths.contains(pathnamestring)) {
-            archive_read_data_skip(readarchive);
-            ret = archive_read_next_header(readarchive, &entry);
-            continue;
+        result = !runnables.isEmpty();
+        foreach (KArchiveExtractRunnable* runnable, runnables) {
+            const QString runnableerror = runnable->error();
+            if (!runnableerror.isEmpty()) {
+                d->m_error = runnableerror;
+                result = false;
+            }
+            delete runnable;
         }
-
-        notfound.removeAll(pathnamestring);
-        result = true;
-
-        if (archive_write_header(writearchive, entry) != ARCHIVE_OK) {
-            d->m_error = archive_error_string(writearchive);
-            kDebug() << "archive_write_header" << d->m_error;
-            result = false;
-            break;
+    } else {
+        struct archive* readarchive = d->openRead(QFile::encodeName(d->m_path));
+        if (!readarchive) {
+            d->m_error = i18n("Could not open archive: %1", d->m_path);
+            kDebug() << d->m_error;
+            return result;
         }
 
-        if (archive_read_extract2(readarchive, entry, writearchive) != ARCHIVE_OK) {
-            d->m_error = archive_error_string(readarchive);
-            kDebug() << "archive_read_extract2" << d->m_error;
-            result = false;
-            break;
+        struct archive* writearchive = d->openDisk(preserve);
+        if (!writearchive) {
+            d->m_error = i18n("Could not open destination: %1", destination);
+            kDebug() << d->m_error;
+            KArchivePrivate::closeRead(readarchive);
+            return result;
         }
 
-        if (archive_write_finish_entry(writearchive) != ARCHIVE_OK) {
-            d->m_error = archive_error_string(writearchive);
-            kDebug() << "archive_write_finish_entry" << d->m_error;
-            result = false;
-            break;
-        }
+        qreal progressvalue = 0.0;
+        const qreal progessstep = (qreal(1.0) / qreal(recursivepaths.size()));
 
-        progressvalue += progessstep;
-        emit progress(progressvalue);
+        struct archive_entry* entry = archive_entry_new();
+        int ret = archive_read_next_header(readarchive, &entry);
+        while (ret != ARCHIVE_EOF) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, KARCHIVE_TIMEOUT);
 
-        ret = archive_read_next_header(readarchive, &entry);
-    }
+            if (ret < ARCHIVE_OK) {
+                d->m_error = archive_error_string(readarchive);
+                kDebug() << "archive_read_next_header" << d->m_error;
+                result = false;
+                break;
+            }
 
-    KArchivePrivate::closeWrite(writearchive);
-    KArchivePrivate::closeRead(readarchive);
+            const QByteArray pathname = archive_entry_pathname(entry);
+            const QString pathnamestring = QFile::decodeName(pathname);
+            if (!recursivepaths.contains(pathnamestring)) {
+                archive_read_data_skip(readarchive);
+                ret = archive_read_next_header(readarchive, &entry);
+                continue;
+            }
+
+            notfound.removeAll(pathnamestring);
+            result = true;
+
+            if (archive_write_header(writearchive, entry) != ARCHIVE_OK) {
+                d->m_error = archive_error_string(writearchive);
+                kDebug() << "archive_write_header" << d->m_error;
+                result = false;
+                break;
+            }
+
+            if (archive_read_extract2(readarchive, entry, writearchive) != ARCHIVE_OK) {
+                d->m_error = archive_error_string(readarchive);
+                kDebug() << "archive_read_extract2" << d->m_error;
+                result = false;
+                break;
+            }
+
+            if (archive_write_finish_entry(writearchive) != ARCHIVE_OK) {
+                d->m_error = archive_error_string(writearchive);
+                kDebug() << "archive_write_finish_entry" << d->m_error;
+                result = false;
+                break;
+            }
+
+            progressvalue += progessstep;
+            emit progress(progressvalue);
+
+            ret = archive_read_next_header(readarchive, &entry);
+        }
+
+        KArchivePrivate::closeWrite(writearchive);
+        KArchivePrivate::closeRead(readarchive);
+    }
 
     Q_ASSERT_X(currentdir == QDir::currentPath(), "KArchive::extract", "Current directory changed");
     if (!QDir::setCurrent(currentdir)) {
@@ -975,73 +1501,22 @@ QList<KArchiveEntry> KArchive::list(const QString &path) const
         return result;
     }
 
-    if (!d->m_cache.isEmpty()) {
-        if (!path.isEmpty()) {
-            foreach (const KArchiveEntry &karchiveentry, d->m_cache) {
-                const QString pathnamestring = QFile::decodeName(karchiveentry.pathname);
-                if (!pathnamestring.startsWith(path)) {
-                    continue;
-                }
-                result.append(karchiveentry);
-            }
-            return result;
-        }
-
-        result = d->m_cache;
+    if (!d->updateIndex()) {
         return result;
     }
 
-    struct archive* readarchive = d->openRead(QFile::encodeName(d->m_path));
-    if (!readarchive) {
-        d->m_error = i18n("Could not open archive: %1", d->m_path);
-        kDebug() << d->m_error;
+    if (path.isEmpty()) {
+        result = d->m_index;
         return result;
     }
 
-    struct archive_entry* entry = archive_entry_new();
-    int ret = archive_read_next_header(readarchive, &entry);
-    while (ret != ARCHIVE_EOF) {
-        QCoreApplication::processEvents(QEventLoop::AllEvents, KARCHIVE_TIMEOUT);
-
-        if (ret < ARCHIVE_OK) {
-            d->m_error = archive_error_string(readarchive);
-            kDebug() << "archive_read_next_header" << d->m_error;
-            result.clear();
-            break;
-        }
-
-        const QByteArray pathname = archive_entry_pathname(entry);
-        if (!path.isEmpty()) {
-            const QString pathnamestring = QFile::decodeName(pathname);
-            if (!pathnamestring.startsWith(path)) {
-                archive_read_data_skip(readarchive);
-                ret = archive_read_next_header(readarchive, &entry);
-                continue;
-            }
+    foreach (const KArchiveEntry &karchiveentry, d->m_index) {
+        const QString pathnamestring = QFile::decodeName(karchiveentry.pathname);
+        if (!pathnamestring.startsWith(path)) {
+            continue;
         }
-
-        KArchiveEntry karchiveentry;
-        karchiveentry.encrypted = bool(archive_entry_is_encrypted(entry));
-        karchiveentry.size = archive_entry_size(entry);
-        karchiveentry.gid = archive_entry_gid(entry);
-        karchiveentry.uid = archive_entry_uid(entry);
-        karchiveentry.mode = archive_entry_mode(entry);
-        karchiveentry.atime = archive_entry_atime(entry);
-        karchiveentry.ctime = archive_entry_ctime(entry);
-        karchiveentry.mtime = archive_entry_mtime(entry);
-        karchiveentry.hardlink =  archive_entry_hardlink(entry);
-        karchiveentry.symlink = archive_entry_symlink(entry);
-        karchiveentry.pathname = pathname;
-        karchiveentry.groupname = archive_entry_gname(entry);
-        karchiveentry.username = archive_entry_uname(entry);
-
-        result << karchiveentry;
-
-        archive_read_data_skip(readarchive);
-        ret = archive_read_next_header(readarchive, &entry);
+        result.append(karchiveentry);
     }
-
-    KArchivePrivate::closeRead(readarchive);
 #else
     Q_UNUSED(path);
 #endif // HAVE_LIBARCHIVE
@@ -1061,68 +1536,17 @@ KArchiveEntry KArchive::entry(const QString &path) const
         return result;
     }
 
-    if (!d->m_cache.isEmpty()) {
-        foreach (const KArchiveEntry &karchiveentry, d->m_cache) {
-            const QString pathnamestring = QFile::decodeName(karchiveentry.pathname);
-            if (pathnamestring != path) {
-                continue;
-            }
-            result = karchiveentry;
-            break;
-        }
+    if (!d->updateIndex()) {
         return result;
     }
 
-    struct archive* readarchive = d->openRead(QFile::encodeName(d->m_path));
-    if (!readarchive) {
-        d->m_error = i18n("Could not open archive: %1", d->m_path);
-        kDebug() << d->m_error;
-        return result;
-    }
-
-    bool found = false;
-    struct archive_entry* entry = archive_entry_new();
-    int ret = archive_read_next_header(readarchive, &entry);
-    while (ret != ARCHIVE_EOF) {
-        QCoreApplication::processEvents(QEventLoop::AllEvents, KARCHIVE_TIMEOUT);
-
-        if (ret < ARCHIVE_OK) {
-            d->m_error = archive_error_string(readarchive);
-            kDebug() << "archive_read_next_header" << d->m_error;
-            break;
-        }
-
-        const QByteArray pathname = archive_entry_pathname(entry);
-        const QString pathnamestring = QFile::decodeName(pathname);
-        if (pathnamestring == path) {
-            result.encrypted = bool(archive_entry_is_encrypted(entry));
-            result.size = archive_entry_size(entry);
-            result.gid = archive_entry_gid(entry);
-            result.uid = archive_entry_uid(entry);
-            result.mode = archive_entry_mode(entry);
-            result.atime = archive_entry_atime(entry);
-            result.ctime = archive_entry_ctime(entry);
-            result.mtime = archive_entry_mtime(entry);
-            result.hardlink =  archive_entry_hardlink(entry);
-            result.symlink = archive_entry_symlink(entry);
-            result.pathname = pathname;
-            result.groupname = archive_entry_gname(entry);
-            result.username = archive_entry_uname(entry);
-
-            found = true;
-            break;
-        }
-
-        archive_read_data_skip(readarchive);
-        ret = archive_read_next_header(readarchive, &entry);
-    }
-
-    KArchivePrivate::closeRead(readarchive);
-
-    if (!found) {
+    const int position = d->m_indexmap.value(QFile::encodeName(path), -1);
+    if (position < 0) {
         d->m_error = i18n("Entry not in archive: %1", path);
         kDebug() << d->m_error;
+        return result;
     }
+    result = d->m_index.at(position);
 #else
     Q_UNUSED(path);
 #endif // HAVE_LIBARCHIVE
@@ -1130,7 +1554,6 @@ KArchiveEntry KArchive::entry(const QString &path) const
     return result;
 }
 
-
 QByteArray KArchive::data(const QString &path) const
 {
     QByteArray result;
@@ -1143,49 +1566,52 @@ QByteArray KArchive::data(const QString &path) const
         return result;
     }
 
-    struct archive* readarchive = d->openRead(QFile::encodeName(d->m_path));
+    KArchiveEntry karchiveentry;
+    int position = -1;
+    struct archive* readarchive = d->openEntry(path, &karchiveentry, &position);
     if (!readarchive) {
-        d->m_error = i18n("Could not open archive: %1", d->m_path);
-        kDebug() << d->m_error;
         return result;
     }
 
-    bool found = false;
-    struct archive_entry* entry = archive_entry_new();
-    int ret = archive_read_next_header(readarchive, &entry);
-    while (ret != ARCHIVE_EOF) {
-        QCoreApplication::processEvents(QEventLoop::AllEvents, KARCHIVE_TIMEOUT);
-
-        if (ret < ARCHIVE_OK) {
-            d->m_error = archive_error_string(readarchive);
-            kDebug() << "archive_read_next_header" << d->m_error;
-            break;
-        }
+    if (karchiveentry.size > 0) {
+        result.reserve(karchiveentry.size);
+    }
+    if (!d->copyData(readarchive, &result)) {
+        result.clear();
+        KArchivePrivate::closeRead(readarchive);
+        return result;
+    }
 
-        const QByteArray pathname = archive_entry_pathname(entry);
-        const QString pathnamestring = QFile::decodeName(pathname);
-        if (pathnamestring == path) {
-            d->copyData(readarchive, &result);
+    // reading the entries in archive order does not reopen the archive for each of them
+    d->keepEntryReader(readarchive, position);
+#else
+    Q_UNUSED(path);
+#endif // HAVE_LIBARCHIVE
 
-            found = true;
-            break;
-        }
+    return result;
+}
 
-        ret = archive_read_next_header(readarchive, &entry);
+QIODevice* KArchive::device(const QString &path) const
+{
+#if defined(HAVE_LIBARCHIVE)
+    d->m_error.clear();
+    if (d->m_path.isEmpty()) {
+        d->m_error = i18n("Empty archive path");
+        kDebug() << d->m_error;
+        return nullptr;
     }
 
-    KArchivePrivate::closeRead(readarchive);
-
-    if (!found) {
-        d->m_error = i18n("Entry not in archive: %1", path);
-        kDebug() << d->m_error;
-        result.clear();
+    KArchiveEntry karchiveentry;
+    struct archive* readarchive = d->openEntry(path, &karchiveentry, nullptr);
+    if (!readarchive) {
+        return nullptr;
     }
+
+    return new KArchiveDevice(readarchive, karchiveentry.size);
 #else
     Q_UNUSED(path);
+    return nullptr;
 #endif // HAVE_LIBARCHIVE
-
-    return result;
 }
 
 bool KArchive::isReadable() const
@@ -1226,6 +1652,10 @@ bool KArchive::requiresPassphrase() const
 void KArchive::setReadPassphrase(const QString &passphrase)
 {
     d->m_readpass = passphrase.toUtf8();
+#if defined(HAVE_LIBARCHIVE)
+    // headers of some formats are encrypted too
+    d->clearIndex();
+#endif
 }
 
 void KArchive::setWritePassphrase(const QString &passphrase)
@@ -1243,6 +1673,30 @@ void KArchive::setTempPrefix(const QString &prefix)
     d->m_tempprefix = prefix;
 }
 
+int KArchive::bufferSize() const
+{
+    return d->m_buffsize;
+}
+
+void KArchive::setBufferSize(const int size)
+{
+    if (size <= 0) {
+        kWarning() << "Invalid buffer size" << size;
+        return;
+    }
+    d->m_buffsize = size;
+}
+
+int KArchive::threads() const
+{
+    return d->m_threads;
+}
+
+void KArchive::setThreads(const int threads)
+{
+    d->m_threads = threads;
+}
+
 QString KArchive::errorString() const
 {
     return d->m_error;
@@ -22,6 +22,7 @@
 #include "karchive_export.h"
 
 #include <QStringList>
+#include <QIODevice>
 
 #include <sys/types.h>
 
@@ -95,6 +96,7 @@ class KArchivePrivate;
     \endcode
 
     @note Paths ending with "/" will be considered as directories
+    @note The entries are indexed once and the index is reused until the archive changes on disk
     @warning The operations are done on temporary file, copy of the orignal, which after
     successfull operation (add or remove) replaces the orignal thus if it is interrupted the
     source may get corrupted
@@ -135,8 +137,19 @@ public:
     QList<KArchiveEntry> list(const QString &path = QString()) const;
     //! @brief Get entry information for path in archive
     KArchiveEntry entry(const QString &path) const;
-    //! @brief Get data for path in archive
+    /*!
+        @brief Get data for path in archive
+        @note Reading entries in the order they are listed continues from the previous entry
+        instead of reading the archive from the start for each of them
+    */
     QByteArray data(const QString &path) const;
+    /*!
+        @brief Get read-only sequential device for path in archive, the data is decompressed as
+        it is read instead of being held in memory
+        @note The caller is responsible for deleting the device, returns null on failure
+        @since 4.24
+    */
+    QIODevice* device(const QString &path) const;
 
     //! @brief Returns if path is readable archive
     bool isReadable() const;
@@ -160,6 +173,33 @@ public:
     //! @brief Sets the temporary file path prefix to @p prefix
     void setTempPrefix(const QString &prefix);
 
+    /*!
+        @brief Returns the size of the buffer used for reading and writing data
+        @since 4.24
+    */
+    int bufferSize() const;
+    /*!
+        @brief Sets the size of the buffer used for reading and writing data to @p size, the
+        default is 64KiB
+        @since 4.24
+    */
+    void setBufferSize(const int size);
+
+    /*!
+        @brief Returns the number of threads used for extraction and compression
+        @since 4.24
+    */
+    int threads() const;
+    /*!
+        @brief Sets the number of threads used for extraction and compression to @p threads,
+        zero means one thread per CPU core. The default is 1
+        @note Entries are extracted in parallel only from formats where each entry can be read
+        independently (zip and uncompressed tar), progress is emited periodically in that case
+        @note Compression uses the threads only for filters that support it (xz and zstd)
+        @since 4.24
+    */
+    void setThreads(const int threads);
+
     //! @brief Returns human-readable description of the error that occured
     QString errorString() const;
 
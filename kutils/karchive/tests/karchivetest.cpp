@@ -50,6 +50,9 @@ private Q_SLOTS:
     void list_data();
     void list();
 
+    void data_data();
+    void data();
+
     void add_data();
     void add();
 
@@ -57,6 +60,7 @@ private Q_SLOTS:
     void remove();
 
     // TODO: extract tests
+    void extractParallel();
 
     void error_data();
     void error();
@@ -102,6 +106,43 @@ void KArchiveTest::list()
     QVERIFY(S_ISREG(karchiveentries.at(1).mode));
 }
 
+void KArchiveTest::data_data()
+{
+    QTest::addColumn<QString>("archivepath");
+    QTest::newRow(".tar.gz") << QFile::decodeName(KDESRCDIR "/tests.tar.gz");
+    QTest::newRow(".zip") << QFile::decodeName(KDESRCDIR "/tests.zip");
+}
+
+void KArchiveTest::data()
+{
+    QFETCH(QString, archivepath);
+
+    KArchive karchive(archivepath);
+    const KArchiveEntry karchiveentry = karchive.entry(QString::fromLatin1("tests/CMakeLists.txt"));
+    QVERIFY(!karchiveentry.isNull());
+    const QByteArray karchivedata = karchive.data(QString::fromLatin1("tests/CMakeLists.txt"));
+    QCOMPARE(karchivedata.size(), int(karchiveentry.size));
+
+    QIODevice* karchivedevice = karchive.device(QString::fromLatin1("tests/CMakeLists.txt"));
+    QVERIFY(karchivedevice);
+    QVERIFY(karchivedevice->isSequential());
+    QCOMPARE(karchivedevice->size(), karchiveentry.size);
+    QCOMPARE(karchivedevice->readAll(), karchivedata);
+    delete karchivedevice;
+
+    // the device took the reader, then forward from the kept reader and backward
+    const QByteArray karchivedata2 = karchive.data(QString::fromLatin1("tests/karchivetest.cpp"));
+    QCOMPARE(karchivedata2.size(), int(karchive.entry(QString::fromLatin1("tests/karchivetest.cpp")).size));
+    QCOMPARE(karchive.data(QString::fromLatin1("tests/CMakeLists.txt")), karchivedata);
+    QCOMPARE(karchive.data(QString::fromLatin1("tests/karchivetest.cpp")), karchivedata2);
+    QCOMPARE(karchive.data(QString::fromLatin1("tests/CMakeLists.txt")), karchivedata);
+
+    QVERIFY(karchive.entry(QString::fromLatin1("does_not_exist")).isNull());
+    QVERIFY(karchive.data(QString::fromLatin1("does_not_exist")).isEmpty());
+    QVERIFY(!karchive.device(QString::fromLatin1("does_not_exist")));
+    QCOMPARE(karchive.errorString(), QString::fromLatin1("Entry not in archive: does_not_exist"));
+}
+
 void KArchiveTest::add_data()
 {
     QTest::addColumn<QString>("archiveext");
@@ -176,6 +217,29 @@ void KArchiveTest::remove()
     }
 }
 
+void KArchiveTest::extractParallel()
+{
+    KArchive karchive(QFile::decodeName(KDESRCDIR "/tests.zip"));
+    QVERIFY(karchive.isReadable());
+    karchive.setThreads(0);
+    karchive.setBufferSize(4096);
+    QCOMPARE(karchive.bufferSize(), 4096);
+
+    QSignalSpy signalspy(&karchive, SIGNAL(progress(qreal)));
+    QVERIFY(signalspy.isValid());
+
+    KTempDir ktempdir;
+    QVERIFY(ktempdir.exists());
+    QStringList toextract = QStringList()
+        << QFile::decodeName("tests/");
+    QVERIFY(karchive.extract(toextract, ktempdir.name()));
+    QCOMPARE(karchive.errorString(), QString());
+    QVERIFY(QFile::exists(ktempdir.name() + QLatin1String("tests/CMakeLists.txt")));
+    QVERIFY(QFile::exists(ktempdir.name() + QLatin1String("tests/karchivetest.cpp")));
+    QVERIFY(signalspy.size() > 0);
+    QCOMPARE(signalspy.last().at(0).toReal(), qreal(1.0));
+}
+
 void KArchiveTest::error_data()
 {
     QTest::addColumn<QString>("archivepath");
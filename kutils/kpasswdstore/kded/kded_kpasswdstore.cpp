@@ -18,6 +18,7 @@
 
 #include "kded_kpasswdstore.h"
 #include "kpluginfactory.h"
+#include "kdebug.h"
 
 K_PLUGIN_FACTORY(KPasswdStoreModuleFactory, registerPlugin<KPasswdStoreModule>();)
 K_EXPORT_PLUGIN(KPasswdStoreModuleFactory("kpasswdstore"))
@@ -32,111 +33,106 @@ KPasswdStoreModule::~KPasswdStoreModule()
     qDeleteAll(m_stores);
 }
 
-bool KPasswdStoreModule::openStore(const QByteArray &cookie, const QString &storeid, const qlonglong windowid)
+KPasswdStoreImpl* KPasswdStoreModule::findStore(const QByteArray &cookie, const QString &storeid) const
 {
-    KPasswdStoreMap::iterator it = m_stores.begin();
-    while (it != m_stores.end()) {
-        if (it.key() != cookie) {
-            it++;
-            continue;
-        }
-        KPasswdStoreImpl *store = it.value();
-        if (store->storeID() == storeid) {
-            return store->openStore(windowid);
+    KPasswdStoreMap::const_iterator it = m_stores.constFind(cookie);
+    while (it != m_stores.constEnd() && it.key() == cookie) {
+        if (it.value()->storeID() == storeid) {
+            return it.value();
         }
         it++;
     }
-    KPasswdStoreImpl *store = new KPasswdStoreImpl(storeid);
-    m_stores.insert(cookie, store);
-    return store->openStore(windowid);
+    return nullptr;
+}
+
+KPasswdStoreImpl* KPasswdStoreModule::findOrCreateStore(const QByteArray &cookie, const QString &storeid)
+{
+    KPasswdStoreImpl *store = findStore(cookie, storeid);
+    if (!store) {
+        store = new KPasswdStoreImpl(storeid);
+        m_stores.insert(cookie, store);
+    }
+    return store;
+}
+
+bool KPasswdStoreModule::openStore(const QByteArray &cookie, const QString &storeid, const qlonglong windowid)
+{
+    return findOrCreateStore(cookie, storeid)->openStore(windowid);
 }
 
 bool KPasswdStoreModule::closeStore(const QByteArray &cookie, const QString &storeid, const qlonglong windowid)
 {
-    KPasswdStoreMap::iterator it = m_stores.begin();
-    while (it != m_stores.end()) {
-        if (it.key() != cookie) {
-            it++;
-            continue;
-        }
-        KPasswdStoreImpl *store = it.value();
-        if (store->storeID() == storeid) {
-            return store->closeStore();
-        }
-        it++;
+    KPasswdStoreImpl *store = findStore(cookie, storeid);
+    if (!store) {
+        return false;
     }
-    return false;
+    return store->closeStore();
 }
 
 void KPasswdStoreModule::setCacheOnly(const QByteArray &cookie, const QString &storeid, const bool cacheonly)
 {
-    KPasswdStoreMap::iterator it = m_stores.begin();
-    while (it != m_stores.end()) {
-        if (it.key() != cookie) {
-            it++;
-            continue;
-        }
-        KPasswdStoreImpl *store = it.value();
-        if (store->storeID() == storeid) {
-            store->setCacheOnly(cacheonly);
-        }
-        it++;
+    KPasswdStoreImpl *store = findStore(cookie, storeid);
+    if (store) {
+        store->setCacheOnly(cacheonly);
     }
 }
 
 bool KPasswdStoreModule::cacheOnly(const QByteArray &cookie, const QString &storeid) const
 {
-    KPasswdStoreMap::const_iterator it = m_stores.begin();
-    while (it != m_stores.end()) {
-        if (it.key() != cookie) {
-            it++;
-            continue;
-        }
-        const KPasswdStoreImpl *store = it.value();
-        if (store->storeID() == storeid) {
-            return store->cacheOnly();
-        }
-        it++;
+    const KPasswdStoreImpl *store = findStore(cookie, storeid);
+    if (!store) {
+        return false;
     }
-    return false;
+    return store->cacheOnly();
 }
 
 QString KPasswdStoreModule::getPasswd(const QByteArray &cookie, const QString &storeid, const QByteArray &key, const qlonglong windowid)
 {
-    KPasswdStoreMap::iterator it = m_stores.begin();
-    while (it != m_stores.end()) {
-        if (it.key() != cookie) {
-            it++;
-            continue;
-        }
-        KPasswdStoreImpl *store = it.value();
-        if (store->storeID() == storeid) {
-            return store->getPasswd(key, windowid);
-        }
-        it++;
-    }
-    KPasswdStoreImpl *store = new KPasswdStoreImpl(storeid);
-    m_stores.insert(cookie, store);
-    return store->getPasswd(key, windowid);
+    return findOrCreateStore(cookie, storeid)->getPasswd(key, windowid);
 }
 
 bool KPasswdStoreModule::storePasswd(const QByteArray &cookie, const QString &storeid, const QByteArray &key, const QString &passwd, const qlonglong windowid)
 {
-    KPasswdStoreMap::iterator it = m_stores.begin();
-    while (it != m_stores.end()) {
-        if (it.key() != cookie) {
-            it++;
-            continue;
-        }
-        KPasswdStoreImpl *store = it.value();
-        if (store->storeID() == storeid) {
-            return store->storePasswd(key, passwd, windowid);
-        }
-        it++;
+    return findOrCreateStore(cookie, storeid)->storePasswd(key, passwd, windowid);
+}
+
+static QList<QByteArray> keysForStrings(const QStringList &strings)
+{
+    QList<QByteArray> result;
+    result.reserve(strings.size());
+    foreach (const QString &string, strings) {
+        result.append(string.toLatin1());
+    }
+    return result;
+}
+
+static QStringList stringsForKeys(const QList<QByteArray> &keys, const QMap<QByteArray, QString> &passwds)
+{
+    QStringList result;
+    result.reserve(keys.size());
+    foreach (const QByteArray &key, keys) {
+        result.append(passwds.value(key));
+    }
+    return result;
+}
+
+QStringList KPasswdStoreModule::getPasswds(const QByteArray &cookie, const QString &storeid, const QStringList &keys, const qlonglong windowid)
+{
+    const QList<QByteArray> keybytes = keysForStrings(keys);
+    return stringsForKeys(keybytes, findOrCreateStore(cookie, storeid)->getPasswds(keybytes, windowid));
+}
+
+bool KPasswdStoreModule::storePasswds(const QByteArray &cookie, const QString &storeid, const QStringList &keys, const QStringList &passwds, const qlonglong windowid)
+{
+    if (keys.size() != passwds.size()) {
+        kWarning() << "Number of keys and passwords does not match";
+        return false;
+    }
+    QMap<QByteArray, QString> passwdsmap;
+    for (int i = 0; i < keys.size(); i++) {
+        passwdsmap.insert(keys.at(i).toLatin1(), passwds.at(i));
     }
-    KPasswdStoreImpl *store = new KPasswdStoreImpl(storeid);
-    m_stores.insert(cookie, store);
-    return store->storePasswd(key, passwd, windowid);
+    return findOrCreateStore(cookie, storeid)->storePasswds(passwdsmap, windowid);
 }
 
 #include "moc_kded_kpasswdstore.cpp"
@@ -23,6 +23,7 @@
 #include "kpasswdstoreimpl.h"
 
 #include <QMap>
+#include <QStringList>
 
 class KPasswdStoreModule: public KDEDModule
 {
@@ -43,7 +44,13 @@ public Q_SLOTS:
     Q_SCRIPTABLE QString getPasswd(const QByteArray &cookie, const QString &storeid, const QByteArray &key, const qlonglong windowid = 0);
     Q_SCRIPTABLE bool storePasswd(const QByteArray &cookie, const QString &storeid, const QByteArray &key, const QString &passwd, const qlonglong windowid = 0);
 
+    Q_SCRIPTABLE QStringList getPasswds(const QByteArray &cookie, const QString &storeid, const QStringList &keys, const qlonglong windowid = 0);
+    Q_SCRIPTABLE bool storePasswds(const QByteArray &cookie, const QString &storeid, const QStringList &keys, const QStringList &passwds, const qlonglong windowid = 0);
+
 private:
+    KPasswdStoreImpl* findStore(const QByteArray &cookie, const QString &storeid) const;
+    KPasswdStoreImpl* findOrCreateStore(const QByteArray &cookie, const QString &storeid);
+
     typedef QMap<QByteArray, KPasswdStoreImpl*> KPasswdStoreMap;
     KPasswdStoreMap m_stores;
 };
@@ -26,6 +26,8 @@
 #include "kdebug.h"
 
 #include <QCryptographicHash>
+#include <QFileInfo>
+#include <QDateTime>
 
 #if defined(HAVE_OPENSSL)
 #  include <openssl/evp.h>
@@ -37,6 +39,52 @@ static const int kpasswdstore_buffsize = 1024;
 static const int kpasswdstore_passretries = 3;
 static const qint64 kpasswdstore_passtimeout = 2; // minutes
 
+// The store file is shared by all stores. It is parsed once and again only
+// when something other than this process changes it
+class KPasswdStoreFile
+{
+public:
+    KPasswdStoreFile() : m_settings(nullptr), m_size(-1) { }
+    ~KPasswdStoreFile() { delete m_settings; }
+
+    KSettings* settings(const QString &path);
+    void sync();
+
+private:
+    KSettings *m_settings;
+    QString m_path;
+    QDateTime m_mtime;
+    qint64 m_size;
+};
+
+KSettings* KPasswdStoreFile::settings(const QString &path)
+{
+    const QFileInfo fileinfo(path);
+    if (m_settings && (path != m_path || fileinfo.lastModified() != m_mtime || fileinfo.size() != m_size)) {
+        kDebug() << "Password store changed on disk, reloading";
+        delete m_settings;
+        m_settings = nullptr;
+    }
+    if (!m_settings) {
+        m_settings = new KSettings(path, KSettings::SimpleConfig);
+        m_path = path;
+        m_mtime = fileinfo.lastModified();
+        m_size = fileinfo.size();
+    }
+    return m_settings;
+}
+
+void KPasswdStoreFile::sync()
+{
+    Q_ASSERT(m_settings);
+    m_settings->sync();
+    const QFileInfo fileinfo(m_path);
+    m_mtime = fileinfo.lastModified();
+    m_size = fileinfo.size();
+}
+
+K_GLOBAL_STATIC(KPasswdStoreFile, globalPasswdStoreFile)
+
 static inline QWidget* widgetForWindowID(const qlonglong windowid)
 {
     return QWidget::find(windowid);
@@ -63,7 +111,9 @@ KPasswdStoreImpl::KPasswdStoreImpl(const QString &id)
 #if defined(HAVE_OPENSSL)
     , m_opensslkeylen(0),
     m_opensslivlen(0),
-    m_opensslblocklen(0)
+    m_opensslblocklen(0),
+    m_encryptctx(nullptr),
+    m_decryptctx(nullptr)
 #endif
 {
 #if defined(HAVE_OPENSSL)
@@ -85,6 +135,7 @@ KPasswdStoreImpl::KPasswdStoreImpl(const QString &id)
 
 KPasswdStoreImpl::~KPasswdStoreImpl()
 {
+    clearPasswd();
 }
 
 QString KPasswdStoreImpl::storeID() const
@@ -141,16 +192,28 @@ QString KPasswdStoreImpl::getPasswd(const QByteArray &key, const qlonglong windo
         return QString();
     }
 
-    bool ok = false;
-    KSettings ksettings(m_passwdstore, KSettings::SimpleConfig);
-    QString storekey = m_storeid;
-    storekey.append(QLatin1Char('/'));
-    storekey.append(QString::fromLatin1(key.constData(), key.size()));
-    const QString passwd = ksettings.string(storekey);
-    if (passwd.isEmpty()) {
-        return QString();
+    return readPasswd(globalPasswdStoreFile->settings(m_passwdstore), key);
+}
+
+QMap<QByteArray, QString> KPasswdStoreImpl::getPasswds(const QList<QByteArray> &keys, const qlonglong windowid)
+{
+    QMap<QByteArray, QString> result;
+    if (m_cacheonly) {
+        foreach (const QByteArray &key, keys) {
+            result.insert(key, m_cachemap.value(key, QString()));
+        }
+        return result;
     }
-    return decryptPasswd(passwd, &ok);
+
+    if (!openStore(windowid)) {
+        return result;
+    }
+
+    KSettings *ksettings = globalPasswdStoreFile->settings(m_passwdstore);
+    foreach (const QByteArray &key, keys) {
+        result.insert(key, readPasswd(ksettings, key));
+    }
+    return result;
 }
 
 bool KPasswdStoreImpl::storePasswd(const QByteArray &key, const QString &passwd, const qlonglong windowid)
@@ -168,12 +231,62 @@ bool KPasswdStoreImpl::storePasswd(const QByteArray &key, const QString &passwd,
         return false;
     }
 
-    bool ok = false;
-    KSettings ksettings(m_passwdstore, KSettings::SimpleConfig);
+    KSettings *ksettings = globalPasswdStoreFile->settings(m_passwdstore);
+    const bool result = writePasswd(ksettings, key, passwd);
+    globalPasswdStoreFile->sync();
+    return result;
+}
+
+bool KPasswdStoreImpl::storePasswds(const QMap<QByteArray, QString> &passwds, const qlonglong windowid)
+{
+    if (m_cacheonly) {
+        QMap<QByteArray, QString>::const_iterator it = passwds.constBegin();
+        while (it != passwds.constEnd()) {
+            m_cachemap.insert(it.key(), it.value());
+            it++;
+        }
+        return true;
+    }
+
+    if (!openStore(windowid)) {
+        return storePasswds(passwds, windowid);
+    }
+
+    bool result = true;
+    KSettings *ksettings = globalPasswdStoreFile->settings(m_passwdstore);
+    QMap<QByteArray, QString>::const_iterator it = passwds.constBegin();
+    while (it != passwds.constEnd()) {
+        if (it.value().isEmpty() || !writePasswd(ksettings, it.key(), it.value())) {
+            result = false;
+        }
+        it++;
+    }
+    globalPasswdStoreFile->sync();
+    return result;
+}
+
+QString KPasswdStoreImpl::storeKey(const QByteArray &key) const
+{
     QString storekey = m_storeid;
     storekey.append(QLatin1Char('/'));
     storekey.append(QString::fromLatin1(key.constData(), key.size()));
-    ksettings.setString(storekey, encryptPasswd(passwd, &ok));
+    return storekey;
+}
+
+QString KPasswdStoreImpl::readPasswd(KSettings *ksettings, const QByteArray &key) const
+{
+    bool ok = false;
+    const QString passwd = ksettings->string(storeKey(key));
+    if (passwd.isEmpty()) {
+        return QString();
+    }
+    return decryptPasswd(passwd, &ok);
+}
+
+bool KPasswdStoreImpl::writePasswd(KSettings *ksettings, const QByteArray &key, const QString &passwd) const
+{
+    bool ok = false;
+    ksettings->setString(storeKey(key), encryptPasswd(passwd, &ok));
     return ok;
 }
 
@@ -183,7 +296,7 @@ bool KPasswdStoreImpl::ensurePasswd(const qlonglong windowid, const bool showerr
 
 #if defined(HAVE_OPENSSL)
     if (!m_passwd.isEmpty() && m_passwdtimer.elapsed() >= m_timeout) {
-        m_passwd.clear();
+        clearPasswd();
     }
     m_passwdtimer.restart();
 
@@ -192,10 +305,10 @@ bool KPasswdStoreImpl::ensurePasswd(const qlonglong windowid, const bool showerr
         // the only reason to encrypt and decrypt passwords is to obscure them
         // for the naked eye, if one can overwrite, delete or otherwise alter
         // the password store then there are more possibilities for havoc
-        KSettings ksettings(m_passwdstore, KSettings::SimpleConfig);
+        KSettings *ksettings = globalPasswdStoreFile->settings(m_passwdstore);
         QString storekey = QString::fromLatin1("KPasswdStore/");
         storekey.append(m_storeid);
-        const QString storepasswdhash = ksettings.string(storekey);
+        const QString storepasswdhash = ksettings->string(storekey);
         if (storepasswdhash.isEmpty()) {
             KNewPasswordDialog knewpasswddialog(widgetForWindowID(windowid));
             knewpasswddialog.setPrompt(i18n("Enter a password for <b>%1</b> password storage", m_storeid));
@@ -243,7 +356,8 @@ bool KPasswdStoreImpl::ensurePasswd(const qlonglong windowid, const bool showerr
         }
 
         if (storepasswdhash.isEmpty()) {
-            ksettings.setString(storekey, passhash);
+            ksettings->setString(storekey, passhash);
+            globalPasswdStoreFile->sync();
             return true;
         }
         if (passhash != storepasswdhash) {
@@ -274,31 +388,60 @@ void KPasswdStoreImpl::clearPasswd()
 #if defined(HAVE_OPENSSL)
     m_passwd.clear();
     m_passwdiv.clear();
+    if (m_encryptctx) {
+        EVP_CIPHER_CTX_free(m_encryptctx);
+        m_encryptctx = nullptr;
+    }
+    if (m_decryptctx) {
+        EVP_CIPHER_CTX_free(m_decryptctx);
+        m_decryptctx = nullptr;
+    }
 #endif
 }
 
-QString KPasswdStoreImpl::encryptPasswd(const QString &passwd, bool *ok) const
-{
 #if defined(HAVE_OPENSSL)
-    EVP_CIPHER_CTX *opensslctx = EVP_CIPHER_CTX_new();
-    if (Q_UNLIKELY(!opensslctx)) {
-        kWarning() << ERR_error_string(ERR_get_error(), NULL);
-        return QString();
+EVP_CIPHER_CTX* KPasswdStoreImpl::cipherContext(const bool encrypt) const
+{
+    EVP_CIPHER_CTX **opensslctx = (encrypt ? &m_encryptctx : &m_decryptctx);
+    const EVP_CIPHER *opensslcipher = nullptr;
+    const uchar *opensslkey = nullptr;
+    if (!*opensslctx) {
+        *opensslctx = EVP_CIPHER_CTX_new();
+        if (Q_UNLIKELY(!*opensslctx)) {
+            kWarning() << ERR_error_string(ERR_get_error(), NULL);
+            return nullptr;
+        }
+        opensslcipher = EVP_aes_256_cbc();
+        opensslkey = reinterpret_cast<const uchar*>(m_passwd.constData());
     }
 
-    int opensslresult = EVP_EncryptInit(
-        opensslctx, EVP_aes_256_cbc(),
-        reinterpret_cast<const uchar*>(m_passwd.constData()),
-        reinterpret_cast<const uchar*>(m_passwdiv.constData())
+    // the key schedule is set up once, after that only the IV is reset
+    const int opensslresult = EVP_CipherInit_ex(
+        *opensslctx, opensslcipher, NULL,
+        opensslkey,
+        reinterpret_cast<const uchar*>(m_passwdiv.constData()),
+        encrypt ? 1 : 0
     );
     if (Q_UNLIKELY(opensslresult != 1)) {
         kWarning() << ERR_error_string(ERR_get_error(), NULL);
-        EVP_CIPHER_CTX_free(opensslctx);
-        return QString();
+        EVP_CIPHER_CTX_free(*opensslctx);
+        *opensslctx = nullptr;
+        return nullptr;
     }
 
-    Q_ASSERT(EVP_CIPHER_CTX_key_length(opensslctx) == m_opensslkeylen);
-    Q_ASSERT(EVP_CIPHER_CTX_iv_length(opensslctx) == m_opensslivlen);
+    Q_ASSERT(EVP_CIPHER_CTX_key_length(*opensslctx) == m_opensslkeylen);
+    Q_ASSERT(EVP_CIPHER_CTX_iv_length(*opensslctx) == m_opensslivlen);
+    return *opensslctx;
+}
+#endif
+
+QString KPasswdStoreImpl::encryptPasswd(const QString &passwd, bool *ok) const
+{
+#if defined(HAVE_OPENSSL)
+    EVP_CIPHER_CTX *opensslctx = cipherContext(true);
+    if (Q_UNLIKELY(!opensslctx)) {
+        return QString();
+    }
 
     const QByteArray passwdbytes = passwd.toUtf8();
     const int opensslbuffersize = (kpasswdstore_buffsize * m_opensslblocklen);
@@ -306,7 +449,7 @@ QString KPasswdStoreImpl::encryptPasswd(const QString &passwd, bool *ok) const
     ::memset(opensslbuffer, 0, opensslbuffersize * sizeof(uchar));
     int opensslbufferpos = 0;
     int openssloutputsize = 0;
-    opensslresult = EVP_EncryptUpdate(
+    int opensslresult = EVP_EncryptUpdate(
         opensslctx,
         opensslbuffer, &opensslbufferpos,
         reinterpret_cast<const uchar*>(passwdbytes.constData()), passwdbytes.size()
@@ -314,23 +457,20 @@ QString KPasswdStoreImpl::encryptPasswd(const QString &passwd, bool *ok) const
     openssloutputsize = opensslbufferpos;
     if (Q_UNLIKELY(opensslresult != 1)) {
         kWarning() << ERR_error_string(ERR_get_error(), NULL);
-        EVP_CIPHER_CTX_free(opensslctx);
         return QString();
     }
 
-    opensslresult = EVP_EncryptFinal(
+    opensslresult = EVP_EncryptFinal_ex(
         opensslctx,
         opensslbuffer + opensslbufferpos, &opensslbufferpos
     );
     openssloutputsize += opensslbufferpos;
     if (Q_UNLIKELY(opensslresult != 1)) {
         kWarning() << ERR_error_string(ERR_get_error(), NULL);
-        EVP_CIPHER_CTX_free(opensslctx);
         return QString();
     }
 
     const QString result = QString::fromLatin1(QByteArray(reinterpret_cast<char*>(opensslbuffer), openssloutputsize).toHex());
-    EVP_CIPHER_CTX_free(opensslctx);
     *ok = !result.isEmpty();
     return result;
 #else
@@ -343,33 +483,18 @@ QString KPasswdStoreImpl::encryptPasswd(const QString &passwd, bool *ok) const
 QString KPasswdStoreImpl::decryptPasswd(const QString &passwd, bool *ok) const
 {
 #if defined(HAVE_OPENSSL)
-    EVP_CIPHER_CTX *opensslctx = EVP_CIPHER_CTX_new();
+    EVP_CIPHER_CTX *opensslctx = cipherContext(false);
     if (Q_UNLIKELY(!opensslctx)) {
-        kWarning() << ERR_error_string(ERR_get_error(), NULL);
         return QString();
     }
 
-    int opensslresult = EVP_DecryptInit(
-        opensslctx, EVP_aes_256_cbc(),
-        reinterpret_cast<const uchar*>(m_passwd.constData()),
-        reinterpret_cast<const uchar*>(m_passwdiv.constData())
-    );
-    if (Q_UNLIKELY(opensslresult != 1)) {
-        kWarning() << ERR_error_string(ERR_get_error(), NULL);
-        EVP_CIPHER_CTX_free(opensslctx);
-        return QString();
-    }
-
-    Q_ASSERT(EVP_CIPHER_CTX_key_length(opensslctx) == m_opensslkeylen);
-    Q_ASSERT(EVP_CIPHER_CTX_iv_length(opensslctx) == m_opensslivlen);
-
     const QByteArray passwdbytes = QByteArray::fromHex(passwd.toLatin1());
     const int opensslbuffersize = (kpasswdstore_buffsize * m_opensslblocklen);
     uchar opensslbuffer[opensslbuffersize];
     ::memset(opensslbuffer, 0, opensslbuffersize * sizeof(uchar));
     int opensslbufferpos = 0;
     int openssloutputsize = 0;
-    opensslresult = EVP_DecryptUpdate(
+    int opensslresult = EVP_DecryptUpdate(
         opensslctx,
         opensslbuffer, &opensslbufferpos,
         reinterpret_cast<const uchar*>(passwdbytes.constData()), passwdbytes.size()
@@ -377,23 +502,20 @@ QString KPasswdStoreImpl::decryptPasswd(const QString &passwd, bool *ok) const
     openssloutputsize = opensslbufferpos;
     if (Q_UNLIKELY(opensslresult != 1)) {
         kWarning() << ERR_error_string(ERR_get_error(), NULL);
-        EVP_CIPHER_CTX_free(opensslctx);
         return QString();
     }
 
-    opensslresult = EVP_DecryptFinal(
+    opensslresult = EVP_DecryptFinal_ex(
         opensslctx,
         opensslbuffer + opensslbufferpos, &opensslbufferpos
     );
     openssloutputsize += opensslbufferpos;
     if (Q_UNLIKELY(opensslresult != 1)) {
         kWarning() << ERR_error_string(ERR_get_error(), NULL);
-        EVP_CIPHER_CTX_free(opensslctx);
         return QString();
     }
 
     const QString result = QString::fromUtf8(reinterpret_cast<char*>(opensslbuffer), openssloutputsize);
-    EVP_CIPHER_CTX_free(opensslctx);
     *ok = !result.isEmpty();
     return result;
 #else
@@ -26,6 +26,12 @@
 #include <QMap>
 #include <QElapsedTimer>
 
+#if defined(HAVE_OPENSSL)
+#  include <openssl/evp.h>
+#endif
+
+class KSettings;
+
 class KPasswdStoreImpl
 {
 public:
@@ -43,11 +49,22 @@ public:
     QString getPasswd(const QByteArray &key, const qlonglong windowid);
     bool storePasswd(const QByteArray &key, const QString &passwd, const qlonglong windowid);
 
+    QMap<QByteArray, QString> getPasswds(const QList<QByteArray> &keys, const qlonglong windowid);
+    bool storePasswds(const QMap<QByteArray, QString> &passwds, const qlonglong windowid);
+
 private:
     bool ensurePasswd(const qlonglong windowid, const bool showerror, bool *cancel);
     bool hasPasswd() const;
     void clearPasswd();
 
+    QString storeKey(const QByteArray &key) const;
+    QString readPasswd(KSettings *ksettings, const QByteArray &key) const;
+    bool writePasswd(KSettings *ksettings, const QByteArray &key, const QString &passwd) const;
+
+#if defined(HAVE_OPENSSL)
+    EVP_CIPHER_CTX* cipherContext(const bool encrypt) const;
+#endif
+
     QString encryptPasswd(const QString &passwd, bool *ok) const;
     QString decryptPasswd(const QString &passwd, bool *ok) const;
 
@@ -65,6 +82,8 @@ private:
     QByteArray m_passwd;
     QByteArray m_passwdiv;
     QElapsedTimer m_passwdtimer;
+    mutable EVP_CIPHER_CTX *m_encryptctx;
+    mutable EVP_CIPHER_CTX *m_decryptctx;
 #endif
 };
 
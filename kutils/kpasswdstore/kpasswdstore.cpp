@@ -146,6 +146,50 @@ bool KPasswdStore::storePasswd(const QByteArray &key, const QString &passwd, con
     return result.value();
 }
 
+QMap<QByteArray, QString> KPasswdStore::getPasswds(const QList<QByteArray> &keys, const qlonglong windowid)
+{
+    QMap<QByteArray, QString> result;
+    if (keys.isEmpty() || !openStore(windowid)) {
+        return result;
+    }
+    QStringList keystrings;
+    keystrings.reserve(keys.size());
+    foreach (const QByteArray &key, keys) {
+        keystrings.append(QString::fromLatin1(key.constData(), key.size()));
+    }
+    QDBusReply<QStringList> reply = d->interface->call("getPasswds", d->cookie, d->storeid, keystrings, windowid);
+    const QStringList passwds = reply.value();
+    if (passwds.size() != keys.size()) {
+        return result;
+    }
+    for (int i = 0; i < keys.size(); i++) {
+        result.insert(keys.at(i), passwds.at(i));
+    }
+    return result;
+}
+
+bool KPasswdStore::storePasswds(const QMap<QByteArray, QString> &passwds, const qlonglong windowid)
+{
+    if (passwds.isEmpty()) {
+        return true;
+    }
+    if (!openStore(windowid)) {
+        return false;
+    }
+    QStringList keystrings;
+    QStringList passwdstrings;
+    keystrings.reserve(passwds.size());
+    passwdstrings.reserve(passwds.size());
+    QMap<QByteArray, QString>::const_iterator it = passwds.constBegin();
+    while (it != passwds.constEnd()) {
+        keystrings.append(QString::fromLatin1(it.key().constData(), it.key().size()));
+        passwdstrings.append(it.value());
+        it++;
+    }
+    QDBusReply<bool> result = d->interface->call("storePasswds", d->cookie, d->storeid, keystrings, passwdstrings, windowid);
+    return result.value();
+}
+
 QStringList KPasswdStore::stores()
 {
     KSettings passwdstore(KStandardDirs::locateLocal("data", "kpasswdstore.ini"), KSettings::SimpleConfig);
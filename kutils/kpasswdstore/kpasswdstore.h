@@ -22,6 +22,7 @@
 #include "kpasswdstore_export.h"
 
 #include <QObject>
+#include <QMap>
 
 class KPasswdStorePrivate;
 
@@ -102,6 +103,19 @@ public:
     */
     bool storePasswd(const QByteArray &key, const QString &passwd, const qlonglong windowid = 0);
 
+    /*!
+        @brief Retrieves the passwords for all @p keys from the password store
+        at once, keys without password map to an empty string
+        @since 4.24
+    */
+    QMap<QByteArray, QString> getPasswds(const QList<QByteArray> &keys, const qlonglong windowid = 0);
+    /*!
+        @brief Stores all @p passwds, keyed as for @p storePasswd(), in the
+        password store at once. Returns @p false if any of them was not stored
+        @since 4.24
+    */
+    bool storePasswds(const QMap<QByteArray, QString> &passwds, const qlonglong windowid = 0);
+
     /*!
         @brief Returns unique key for @p string for use with @p getPasswd() and @p storePasswd()
     */
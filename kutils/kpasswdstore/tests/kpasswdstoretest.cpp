@@ -0,0 +1,99 @@
+/*  This file is part of the KDE libraries
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License version 2, as published by the Free Software Foundation.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include "../kded/kpasswdstoreimpl.cpp" // private implementation
+
+#include <QFile>
+#include <qtest_kde.h>
+#include <ktempdir.h>
+
+// Opening the store asks for its password, only what works without it is
+// tested here
+class KPasswdStoreTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testCacheOnly();
+    void testStoreFile();
+};
+
+QTEST_KDEMAIN(KPasswdStoreTest, NoGUI)
+
+void KPasswdStoreTest::testCacheOnly()
+{
+    const QString storefile = KStandardDirs::locateLocal("data", "kpasswdstore.ini");
+    QFile::remove(storefile);
+
+    KPasswdStoreImpl store("kpasswdstoretest");
+    store.setCacheOnly(true);
+    QVERIFY(store.cacheOnly());
+    // there is nothing to open
+    QVERIFY(!store.openStore(0));
+
+    QMap<QByteArray, QString> passwds;
+    passwds.insert("first", "one");
+    passwds.insert("second", "two");
+    QVERIFY(store.storePasswds(passwds, 0));
+    QVERIFY(store.storePasswd("third", "three", 0));
+
+    const QList<QByteArray> keys = QList<QByteArray>() << "first" << "third" << "missing";
+    QMap<QByteArray, QString> expected;
+    expected.insert("first", "one");
+    expected.insert("third", "three");
+    expected.insert("missing", QString());
+    QCOMPARE(store.getPasswds(keys, 0), expected);
+    QCOMPARE(store.getPasswd("second", 0), QString("two"));
+
+    // the passwords are only kept in memory
+    QVERIFY(!QFile::exists(storefile));
+
+    // and forgotten when the mode is set again
+    store.setCacheOnly(true);
+    QVERIFY(store.getPasswd("first", 0).isEmpty());
+    QVERIFY(store.getPasswds(keys, 0).value("third").isEmpty());
+}
+
+void KPasswdStoreTest::testStoreFile()
+{
+    KTempDir tempdir;
+    const QString path = tempdir.name() + "kpasswdstore.ini";
+
+    KPasswdStoreFile storefile;
+    KSettings *ksettings = storefile.settings(path);
+    QVERIFY(ksettings);
+    ksettings->setString("store/key", "value");
+    storefile.sync();
+    QVERIFY(QFile::exists(path));
+
+    // the own changes do not cause the file to be parsed again
+    QCOMPARE(storefile.settings(path), ksettings);
+    QCOMPARE(storefile.settings(path)->string("store/key"), QString("value"));
+
+    // the changes of other processes do
+    {
+        KSettings other(path, KSettings::SimpleConfig);
+        other.setString("store/key", "another value");
+        other.sync();
+    }
+    QCOMPARE(storefile.settings(path)->string("store/key"), QString("another value"));
+
+    // so does another file
+    const QString otherpath = tempdir.name() + "other.ini";
+    QVERIFY(storefile.settings(otherpath)->string("store/key").isEmpty());
+}
+
+#include "kpasswdstoretest.moc"
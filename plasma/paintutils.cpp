@@ -26,7 +26,6 @@
 #include <QPixmap>
 
 #include "kiconeffect.h"
-#include "private/effects/blur.cpp"
 #include "private/effects/halopainter_p.h"
 #include "svg.h"
 
@@ -126,7 +125,9 @@ QPixmap texturedText(const QString &text, const QFont &font, Plasma::Svg *textur
     texture->paint(&buffPainter, contentsRect.adjusted(-1, -1, 1, 1), "shadow");
     buffPainter.end();
 
-    expblur<16, 7>(image, 1);
+    // the stack blur with radius 2 spreads as much as the exponential blur with radius 1 that
+    // was used before did
+    KIconEffect::blur(image, 2);
     //hole in the shadow
     buffPainter.begin(&image);
     buffPainter.setCompositionMode(QPainter::CompositionMode_DestinationOut);
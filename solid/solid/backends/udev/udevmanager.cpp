@@ -25,6 +25,7 @@
 #include "../shared/rootdevice.h"
 
 #include <QtCore/QSet>
+#include <QtCore/QHash>
 #include <QtCore/QFile>
 #include <QtCore/QDir>
 #include <QtCore/QDebug>
@@ -44,9 +45,25 @@ public:
     bool isOfInterest(const QString &udi, const UdevQt::Device &device);
     bool checkOfInterest(const UdevQt::Device &device);
 
+    void ensureIndexed();
+    void indexDevice(const QString &udi, const UdevQt::Device &device);
+    void unindexDevice(const QString &udi);
+
     UdevQt::Client *m_client;
-    QStringList m_devicesOfInterest;
+    QSet<QString> m_devicesOfInterest;
     QSet<Solid::DeviceInterface::Type> m_supportedInterfaces;
+
+    // The parent and the interfaces of the devices of interest, built on the first query and
+    // kept up to date from the udev events so that queries do not enumerate and probe every
+    // device again
+    struct DeviceEntry
+    {
+        QString parentUdi;
+        QSet<Solid::DeviceInterface::Type> interfaces;
+    };
+    bool m_indexed;
+    QStringList m_indexedDevices;
+    QHash<QString, DeviceEntry> m_index;
 };
 
 UDevManager::Private::Private()
@@ -63,6 +80,7 @@ UDevManager::Private::Private()
         << "input"
         << "pci";
     m_client = new UdevQt::Client(subsystems);
+    m_indexed = false;
 }
 
 UDevManager::Private::~Private()
@@ -78,12 +96,51 @@ bool UDevManager::Private::isOfInterest(const QString &udi, const UdevQt::Device
 
     bool isOfInterest = checkOfInterest(device);
     if (isOfInterest) {
-        m_devicesOfInterest.append(udi);
+        m_devicesOfInterest.insert(udi);
     }
 
     return isOfInterest;
 }
 
+void UDevManager::Private::ensureIndexed()
+{
+    if (m_indexed) {
+        return;
+    }
+
+    m_indexed = true;
+    foreach (const UdevQt::Device &device, m_client->allDevices()) {
+        const QString udi = QString::fromLatin1(UDEV_UDI_PREFIX) + device.sysfsPath();
+        if (isOfInterest(udi, device)) {
+            indexDevice(udi, device);
+        }
+    }
+}
+
+void UDevManager::Private::indexDevice(const QString &udi, const UdevQt::Device &device)
+{
+    const UDevDevice udevDevice(device);
+    DeviceEntry entry;
+    entry.parentUdi = udevDevice.parentUdi();
+    foreach (const Solid::DeviceInterface::Type type, m_supportedInterfaces) {
+        if (udevDevice.queryDeviceInterface(type)) {
+            entry.interfaces.insert(type);
+        }
+    }
+
+    if (!m_index.contains(udi)) {
+        m_indexedDevices.append(udi);
+    }
+    m_index.insert(udi, entry);
+}
+
+void UDevManager::Private::unindexDevice(const QString &udi)
+{
+    if (m_index.remove(udi) > 0) {
+        m_indexedDevices.removeAll(udi);
+    }
+}
+
 bool UDevManager::Private::checkOfInterest(const UdevQt::Device &device)
 {
 #ifdef UDEV_DETAILED_OUTPUT
@@ -189,42 +246,31 @@ QSet<Solid::DeviceInterface::Type> UDevManager::supportedInterfaces() const
 
 QStringList UDevManager::allDevices()
 {
-    QStringList res;
-    foreach (const UdevQt::Device &device, d->m_client->allDevices()) {
-        if (d->isOfInterest(udiPrefix() + device.sysfsPath(), device)) {
-            res << udiPrefix() + device.sysfsPath();
-        }
-    }
-    return res;
+    d->ensureIndexed();
+    return d->m_indexedDevices;
 }
 
 QStringList UDevManager::devicesFromQuery(const QString &parentUdi,
                                           Solid::DeviceInterface::Type type)
 {
-    QStringList allDev = allDevices();
-    QStringList result;
+    d->ensureIndexed();
 
-    if (!parentUdi.isEmpty()) {
-        foreach (const QString &udi, allDev) {
-            UDevDevice device(d->m_client->deviceBySysfsPath(udi.right(udi.size() - udiPrefix().size())));
-            if (device.queryDeviceInterface(type) && device.parentUdi() == parentUdi) {
-                result << udi;
-            }
-        }
+    if (parentUdi.isEmpty() && type == Solid::DeviceInterface::Unknown) {
+        return d->m_indexedDevices;
+    }
 
-        return result;
-    } else if (type != Solid::DeviceInterface::Unknown) {
-        foreach (const QString &udi, allDev) {
-            UDevDevice device(d->m_client->deviceBySysfsPath(udi.right(udi.size() - udiPrefix().size())));
-            if (device.queryDeviceInterface(type)) {
-                result << udi;
-            }
+    QStringList result;
+    foreach (const QString &udi, d->m_indexedDevices) {
+        const Private::DeviceEntry &entry = d->m_index[udi];
+        if (!entry.interfaces.contains(type)) {
+            continue;
         }
-
-        return result;
-    } else {
-        return allDev;
+        if (!parentUdi.isEmpty() && entry.parentUdi != parentUdi) {
+            continue;
+        }
+        result << udi;
     }
+    return result;
 }
 
 QObject *UDevManager::createDevice(const QString &udi_)
@@ -251,6 +297,9 @@ void UDevManager::slotDeviceAdded(const UdevQt::Device &device)
 {
     const QString udi = udiPrefix() + device.sysfsPath();
     if (d->isOfInterest(udi, device)) {
+        if (d->m_indexed) {
+            d->indexDevice(udi, device);
+        }
         emit deviceAdded(udi);
     }
 }
@@ -259,8 +308,9 @@ void UDevManager::slotDeviceRemoved(const UdevQt::Device &device)
 {
     const QString udi = udiPrefix() + device.sysfsPath();
     if (d->isOfInterest(udi, device)) {
+        d->unindexDevice(udi);
         emit deviceRemoved(udi);
-        d->m_devicesOfInterest.removeAll(udi);
+        d->m_devicesOfInterest.remove(udi);
     }
 }
 
@@ -269,6 +319,11 @@ void UDevManager::slotDeviceChanged(const UdevQt::Device &device)
     const QString udi = udiPrefix() + device.sysfsPath();
     const bool wasofinterest = d->m_devicesOfInterest.contains(udi);
     if (d->isOfInterest(udi, device)) {
+        if (d->m_indexed) {
+            // the properties deciding the interfaces may have changed
+            d->indexDevice(udi, device);
+        }
+
         if (device.subsystem() == "block") {
             const QString idfsusage = device.deviceProperty("ID_FS_USAGE");
             const bool hascontent = (idfsusage == "filesystem" || idfsusage == "crypto");
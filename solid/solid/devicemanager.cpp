@@ -138,13 +138,25 @@ QList<Solid::Device> Solid::Device::listFromQuery(const Predicate &predicate,
 
         QStringList udis;
         if (predicate.isValid()) {
-            QSet<DeviceInterface::Type> supportedTypes = backend->supportedInterfaces();
-            if (supportedTypes.intersect(usedTypes).isEmpty()) {
+            // only devices having one of the used interfaces can match the predicate
+            QSet<DeviceInterface::Type> queryTypes = backend->supportedInterfaces();
+            queryTypes.intersect(usedTypes);
+            if (queryTypes.isEmpty()) {
                 continue;
             }
 
-            foreach (DeviceInterface::Type type, supportedTypes) {
-                udis += backend->devicesFromQuery(parentUdi, type);
+            if (queryTypes.size() == 1) {
+                udis = backend->devicesFromQuery(parentUdi, *queryTypes.constBegin());
+            } else {
+                QSet<QString> seen;
+                foreach (DeviceInterface::Type type, queryTypes) {
+                    foreach (const QString &udi, backend->devicesFromQuery(parentUdi, type)) {
+                        if (!seen.contains(udi)) {
+                            seen.insert(udi);
+                            udis.append(udi);
+                        }
+                    }
+                }
             }
         } else {
             udis += backend->allDevices();
@@ -22,6 +22,23 @@
 
 #include <solid/device.h>
 #include <solid/deviceinterface.h>
+#include <solid/acadapter.h>
+#include <solid/audiointerface.h>
+#include <solid/battery.h>
+#include <solid/block.h>
+#include <solid/button.h>
+#include <solid/camera.h>
+#include <solid/graphic.h>
+#include <solid/input.h>
+#include <solid/networkinterface.h>
+#include <solid/opticaldisc.h>
+#include <solid/opticaldrive.h>
+#include <solid/portablemediaplayer.h>
+#include <solid/processor.h>
+#include <solid/storageaccess.h>
+#include <solid/storagedrive.h>
+#include <solid/storagevolume.h>
+#include <solid/video.h>
 #include <QtCore/QStringList>
 #include <QtCore/qmetaobject.h>
 
@@ -33,7 +50,12 @@ namespace Solid
 
         Private() : isValid(false), type(PropertyCheck),
                     compOperator(Predicate::Equals),
-                    operand1(0), operand2(0) {}
+                    operand1(0), operand2(0),
+                    metaObject(0), propertyIndex(-1) {}
+
+        void compile();
+        static int resolveProperty(const QMetaObject *metaObject, const QString &property,
+                                   const QVariant &value, QVariant *expected);
 
         bool isValid;
         Type type;
@@ -45,9 +67,88 @@ namespace Solid
 
         Predicate *operand1;
         Predicate *operand2;
+
+        // The property and the expected value are resolved once when the predicate is
+        // created instead of looking them up by name for every matched device
+        const QMetaObject *metaObject;
+        int propertyIndex;
+        QVariant expected;
     };
 }
 
+static const QMetaObject *metaObjectForType(Solid::DeviceInterface::Type type)
+{
+    switch (type)
+    {
+    case Solid::DeviceInterface::Processor:
+        return &Solid::Processor::staticMetaObject;
+    case Solid::DeviceInterface::Block:
+        return &Solid::Block::staticMetaObject;
+    case Solid::DeviceInterface::StorageAccess:
+        return &Solid::StorageAccess::staticMetaObject;
+    case Solid::DeviceInterface::StorageDrive:
+        return &Solid::StorageDrive::staticMetaObject;
+    case Solid::DeviceInterface::OpticalDrive:
+        return &Solid::OpticalDrive::staticMetaObject;
+    case Solid::DeviceInterface::StorageVolume:
+        return &Solid::StorageVolume::staticMetaObject;
+    case Solid::DeviceInterface::OpticalDisc:
+        return &Solid::OpticalDisc::staticMetaObject;
+    case Solid::DeviceInterface::Camera:
+        return &Solid::Camera::staticMetaObject;
+    case Solid::DeviceInterface::PortableMediaPlayer:
+        return &Solid::PortableMediaPlayer::staticMetaObject;
+    case Solid::DeviceInterface::NetworkInterface:
+        return &Solid::NetworkInterface::staticMetaObject;
+    case Solid::DeviceInterface::AcAdapter:
+        return &Solid::AcAdapter::staticMetaObject;
+    case Solid::DeviceInterface::Battery:
+        return &Solid::Battery::staticMetaObject;
+    case Solid::DeviceInterface::Button:
+        return &Solid::Button::staticMetaObject;
+    case Solid::DeviceInterface::AudioInterface:
+        return &Solid::AudioInterface::staticMetaObject;
+    case Solid::DeviceInterface::Video:
+        return &Solid::Video::staticMetaObject;
+    case Solid::DeviceInterface::Graphic:
+        return &Solid::Graphic::staticMetaObject;
+    case Solid::DeviceInterface::Input:
+        return &Solid::Input::staticMetaObject;
+    case Solid::DeviceInterface::Unknown:
+    case Solid::DeviceInterface::Last:
+        break;
+    }
+    return 0;
+}
+
+int Solid::Predicate::Private::resolveProperty(const QMetaObject *metaObject, const QString &property,
+                                               const QVariant &value, QVariant *expected)
+{
+    const int index = metaObject->indexOfProperty(property.toLatin1());
+    QMetaProperty metaProp = metaObject->property(index);
+    *expected = value;
+
+    if (metaProp.isEnumType() && expected->type()==QVariant::String) {
+        QMetaEnum metaEnum = metaProp.enumerator();
+        int enumValue = metaEnum.keysToValue(value.toString().toLatin1());
+        if (enumValue>=0) { // No value found for these keys, resetting expected to invalid
+            *expected = enumValue;
+        } else {
+            *expected = QVariant();
+        }
+    }
+
+    return metaProp.isReadable() ? index : -1;
+}
+
+void Solid::Predicate::Private::compile()
+{
+    metaObject = metaObjectForType(ifaceType);
+    if (metaObject) {
+        propertyIndex = resolveProperty(metaObject, property, value, &expected);
+    }
+}
+
 
 Solid::Predicate::Predicate()
     : d(new Private())
@@ -70,6 +171,7 @@ Solid::Predicate::Predicate(const DeviceInterface::Type &ifaceType,
     d->property = property;
     d->value = value;
     d->compOperator = compOperator;
+    d->compile();
 }
 
 Solid::Predicate::Predicate(const QString &ifaceName,
@@ -86,6 +188,7 @@ Solid::Predicate::Predicate(const QString &ifaceName,
         d->property = property;
         d->value = value;
         d->compOperator = compOperator;
+        d->compile();
     }
 }
 
@@ -140,6 +243,9 @@ Solid::Predicate &Solid::Predicate::operator=(const Predicate &other)
         d->property = other.d->property;
         d->value = other.d->value;
         d->compOperator = other.d->compOperator;
+        d->metaObject = other.d->metaObject;
+        d->propertyIndex = other.d->propertyIndex;
+        d->expected = other.d->expected;
     }
 
     return *this;
@@ -204,21 +310,15 @@ bool Solid::Predicate::matches(const Device &device) const
 
         if (iface!=0)
         {
-            const int index = iface->metaObject()->indexOfProperty(d->property.toLatin1());
-            QMetaProperty metaProp = iface->metaObject()->property(index);
-            QVariant value = metaProp.isReadable() ? metaProp.read(iface) : QVariant();
-            QVariant expected = d->value;
-
-            if (metaProp.isEnumType() && expected.type()==QVariant::String) {
-                QMetaEnum metaEnum = metaProp.enumerator();
-                int value = metaEnum.keysToValue(d->value.toString().toLatin1());
-                if (value>=0) { // No value found for these keys, resetting expected to invalid
-                    expected = value;
-                } else {
-                    expected = QVariant();
-                }
+            const QMetaObject *metaObject = iface->metaObject();
+            int index = d->propertyIndex;
+            QVariant expected = d->expected;
+            if (metaObject!=d->metaObject) {
+                index = Private::resolveProperty(metaObject, d->property, d->value, &expected);
             }
 
+            const QVariant value = index>=0 ? metaObject->property(index).read(iface) : QVariant();
+
             if (d->compOperator==Mask) {
                 bool v_ok = false;
                 int v = value.toInt(&v_ok);
@@ -434,6 +434,30 @@ void SolidHwTest::testPredicate()
     QCOMPARE(list.size(), 0);
 }
 
+void SolidHwTest::benchmarkPredicate()
+{
+    const Solid::Predicate predicate = Solid::Predicate::fromString("[[StorageVolume.usage == 'FileSystem' AND StorageVolume.ignored == false] OR NetworkInterface.wireless == true]");
+    QVERIFY(predicate.isValid());
+
+    QList<Solid::Device> list;
+    QBENCHMARK {
+        list = Solid::Device::listFromQuery(predicate);
+    }
+    QVERIFY(!list.isEmpty());
+
+    const QList<Solid::Device> devices = Solid::Device::allDevices();
+    int matches = 0;
+    QBENCHMARK {
+        matches = 0;
+        foreach (const Solid::Device &device, devices) {
+            if (predicate.matches(device)) {
+                matches++;
+            }
+        }
+    }
+    QCOMPARE(matches, list.size());
+}
+
 void SolidHwTest::testSetupTeardown()
 {
     Solid::StorageAccess *access;
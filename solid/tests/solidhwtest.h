@@ -47,6 +47,7 @@ private slots:
     void testDeviceInterfaceIntrospectionCornerCases();
     void testDeviceInterfaces();
     void testPredicate();
+    void benchmarkPredicate();
     void testSetupTeardown();
     void testMisc();
 